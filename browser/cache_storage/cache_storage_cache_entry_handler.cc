@@ -193,6 +193,13 @@ int CacheStorageCacheEntryHandler::DiskCacheBlobEntry::Read(
   if (!disk_cache_entry_)
     return net::ERR_CACHE_READ_FAILURE;
 
+  if (shared_body_entry_ &&
+      disk_cache_index == CacheStorageCache::INDEX_RESPONSE_BODY) {
+    return shared_body_entry_->ReadData(disk_cache_index, offset,
+                                        dst_buffer.get(), bytes_to_read,
+                                        std::move(callback));
+  }
+
   return disk_cache_entry_->ReadData(disk_cache_index, offset, dst_buffer.get(),
                                      bytes_to_read, std::move(callback));
 }
@@ -208,6 +215,10 @@ int CacheStorageCacheEntryHandler::DiskCacheBlobEntry::GetSize(
     case CacheStorageCache::INDEX_HEADERS:
       return disk_cache_entry_->GetDataSize(CacheStorageCache::INDEX_HEADERS);
     case CacheStorageCache::INDEX_RESPONSE_BODY:
+      if (shared_body_entry_) {
+        return shared_body_entry_->GetDataSize(
+            CacheStorageCache::INDEX_RESPONSE_BODY);
+      }
       return disk_cache_entry_->GetDataSize(
           CacheStorageCache::INDEX_RESPONSE_BODY);
     case CacheStorageCache::INDEX_SIDE_DATA:
@@ -221,6 +232,17 @@ void CacheStorageCacheEntryHandler::DiskCacheBlobEntry::Invalidate() {
   cache_handle_ = base::nullopt;
   entry_handler_ = nullptr;
   disk_cache_entry_ = nullptr;
+  shared_body_entry_ = nullptr;
+  keep_shared_body_backend_alive_.Reset();
+}
+
+void CacheStorageCacheEntryHandler::DiskCacheBlobEntry::SetSharedBodyEntry(
+    disk_cache::ScopedEntryPtr body_entry,
+    base::OnceClosure keep_backend_alive) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(body_entry);
+  keep_shared_body_backend_alive_ = std::move(keep_backend_alive);
+  shared_body_entry_ = std::move(body_entry);
 }
 
 disk_cache::ScopedEntryPtr&
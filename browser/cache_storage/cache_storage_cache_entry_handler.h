@@ -7,7 +7,9 @@
 
 #include <memory>
 #include <set>
+#include <string>
 
+#include "base/callback.h"
 #include "base/macros.h"
 #include "base/memory/ref_counted.h"
 #include "base/memory/scoped_refptr.h"
@@ -58,6 +60,9 @@ struct PutContext {
   // Provided while writing to the cache.
   ErrorCallback callback;
   ScopedWritableEntry cache_entry;
+  // Set once the body has been added to the shared body store, see
+  // LegacyCacheStorageBodyStore.
+  std::string shared_body_key;
 
  private:
   DISALLOW_COPY_AND_ASSIGN(PutContext);
@@ -87,6 +92,12 @@ class CONTENT_EXPORT CacheStorageCacheEntryHandler {
 
     void Invalidate();
 
+    // Reads the response body from |body_entry| rather than from the cache's
+    // own entry. |keep_backend_alive| holds whatever owns the backend of
+    // |body_entry|, and is dropped after it.
+    void SetSharedBodyEntry(disk_cache::ScopedEntryPtr body_entry,
+                            base::OnceClosure keep_backend_alive);
+
     disk_cache::ScopedEntryPtr& disk_cache_entry();
 
    private:
@@ -96,6 +107,9 @@ class CONTENT_EXPORT CacheStorageCacheEntryHandler {
     base::WeakPtr<CacheStorageCacheEntryHandler> entry_handler_;
     base::Optional<CacheStorageCacheHandle> cache_handle_;
     disk_cache::ScopedEntryPtr disk_cache_entry_;
+    // Keeps the backend of |shared_body_entry_| alive.
+    base::OnceClosure keep_shared_body_backend_alive_;
+    disk_cache::ScopedEntryPtr shared_body_entry_;
 
     SEQUENCE_CHECKER(sequence_checker_);
 
@@ -30,6 +30,7 @@
 #include "content/browser/blob_storage/chrome_blob_storage_context.h"
 #include "content/browser/cache_storage/cache_storage_cache.h"
 #include "content/browser/cache_storage/cache_storage_cache_handle.h"
+#include "content/browser/cache_storage/cache_storage_cache_observer.h"
 #include "content/browser/cache_storage/cache_storage_histogram_utils.h"
 #include "content/browser/cache_storage/cache_storage_manager.h"
 #include "content/browser/cache_storage/legacy/legacy_cache_storage.h"
@@ -86,6 +87,23 @@ void SizeCallback(base::RunLoop* run_loop,
     run_loop->Quit();
 }
 
+// Counts the size updates of the cache it observes.
+class CountingCacheObserver : public CacheStorageCacheObserver {
+ public:
+  CountingCacheObserver() = default;
+
+  void CacheSizeUpdated(const LegacyCacheStorageCache* cache) override {
+    ++size_update_count_;
+  }
+
+  int size_update_count() const { return size_update_count_; }
+
+ private:
+  int size_update_count_ = 0;
+
+  DISALLOW_COPY_AND_ASSIGN(CountingCacheObserver);
+};
+
 // A blob that never finishes writing to its pipe.
 class SlowBlob : public storage::FakeBlob {
  public:
@@ -462,7 +480,8 @@ class TestCacheStorageCache : public LegacyCacheStorageCache {
                                 std::move(blob_storage_context),
                                 0 /* cache_size */,
                                 0 /* cache_padding */,
-                                CreateTestPaddingKey()),
+                                CreateTestPaddingKey(),
+                                nullptr /* body_store */),
         delay_backend_creation_(false) {}
 
   ~TestCacheStorageCache() override { base::RunLoop().RunUntilIdle(); }
@@ -986,6 +1005,8 @@ class CacheStorageCacheTest : public testing::Test {
     cache_->max_query_size_bytes_ = max_bytes;
   }
 
+  bool UrlIndexIsComplete() { return cache_->url_index_.is_complete(); }
+
   size_t EstimatedResponseSizeWithoutBlob(
       const blink::mojom::FetchAPIResponse& response) {
     return LegacyCacheStorageCache::EstimatedResponseSizeWithoutBlob(response);
@@ -1233,6 +1254,94 @@ TEST_P(CacheStorageCacheTestP, PutBadMessage) {
   EXPECT_FALSE(Match(body_request_));
 }
 
+TEST_P(CacheStorageCacheTestP, PutBatch) {
+  std::vector<blink::mojom::BatchOperationPtr> operations;
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(body_request_),
+      CreateBlobBodyResponse(), nullptr /* match_options */));
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(body_request_with_query_),
+      CreateBlobBodyResponseWithQuery(), nullptr /* match_options */));
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(no_body_request_),
+      CreateNoBodyResponse(), nullptr /* match_options */));
+  EXPECT_EQ(CacheStorageError::kSuccess, BatchOperation(std::move(operations)));
+
+  EXPECT_TRUE(Match(body_request_));
+  mojo::Remote<blink::mojom::Blob> blob(
+      std::move(callback_response_->blob->blob));
+  EXPECT_EQ(expected_blob_data_, storage::BlobToString(blob.get()));
+  EXPECT_TRUE(Match(body_request_with_query_));
+  EXPECT_TRUE(Match(no_body_request_));
+  EXPECT_TRUE(Keys());
+  EXPECT_EQ(3u, callback_strings_.size());
+}
+
+TEST_P(CacheStorageCacheTestP, PutBatchFailureKeepsNoEntries) {
+  // Open the backend.
+  EXPECT_TRUE(Keys());
+  cache_->UseFailableBackend(FailableBackend::FailureStage::WRITE_HEADERS);
+
+  std::vector<blink::mojom::BatchOperationPtr> operations;
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(body_request_),
+      CreateBlobBodyResponse(), nullptr /* match_options */));
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(no_body_request_),
+      CreateNoBodyResponse(), nullptr /* match_options */));
+  EXPECT_EQ(CacheStorageError::kErrorStorage,
+            BatchOperation(std::move(operations)));
+
+  EXPECT_FALSE(Match(body_request_));
+  EXPECT_FALSE(Match(no_body_request_));
+  EXPECT_TRUE(Keys());
+  EXPECT_EQ(0u, callback_strings_.size());
+}
+
+TEST_P(CacheStorageCacheTestP, PutBatchReplaceUpdatesSizeOnce) {
+  EXPECT_TRUE(Put(body_request_, CreateNoBodyResponse()));
+  EXPECT_TRUE(Put(body_request_with_query_, CreateNoBodyResponse()));
+  EXPECT_TRUE(Put(no_body_request_, CreateNoBodyResponse()));
+  base::RunLoop().RunUntilIdle();
+
+  CountingCacheObserver observer;
+  cache_->SetObserver(&observer);
+  const int notify_count =
+      quota_manager_proxy_->notify_storage_modified_count();
+
+  std::vector<blink::mojom::BatchOperationPtr> operations;
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(body_request_),
+      CreateBlobBodyResponse(), nullptr /* match_options */));
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(body_request_with_query_),
+      CreateBlobBodyResponseWithQuery(), nullptr /* match_options */));
+  operations.push_back(blink::mojom::BatchOperation::New(
+      blink::mojom::OperationType::kPut,
+      BackgroundFetchSettledFetch::CloneRequest(no_body_request_),
+      CreateNoBodyResponse(), nullptr /* match_options */));
+  EXPECT_EQ(CacheStorageError::kSuccess, BatchOperation(std::move(operations)));
+  base::RunLoop().RunUntilIdle();
+
+  // Replacing the three entries is reported once, for the whole batch.
+  EXPECT_EQ(notify_count + 1,
+            quota_manager_proxy_->notify_storage_modified_count());
+  EXPECT_EQ(1, observer.size_update_count());
+  cache_->SetObserver(nullptr);
+
+  EXPECT_TRUE(Match(body_request_));
+  EXPECT_TRUE(callback_response_->blob);
+  EXPECT_TRUE(Keys());
+  EXPECT_EQ(3u, callback_strings_.size());
+}
+
 TEST_P(CacheStorageCacheTestP, PutReplace) {
   EXPECT_TRUE(Put(body_request_, CreateNoBodyResponse()));
   EXPECT_TRUE(Match(body_request_));
@@ -1660,6 +1769,59 @@ TEST_P(CacheStorageCacheTestP, VaryStar) {
   EXPECT_FALSE(Match(body_request_));
 }
 
+TEST_P(CacheStorageCacheTestP, VaryWithCompleteUrlIndex) {
+  body_request_->headers["vary_foo"] = "foo";
+  blink::mojom::FetchAPIResponsePtr body_response = CreateBlobBodyResponse();
+  body_response->headers["vary"] = "vary_foo";
+  EXPECT_TRUE(Put(body_request_, std::move(body_response)));
+  EXPECT_TRUE(Keys());
+  EXPECT_TRUE(UrlIndexIsComplete());
+  EXPECT_TRUE(Match(body_request_));
+
+  body_request_->headers["vary_foo"] = "bar";
+  EXPECT_FALSE(Match(body_request_));
+
+  blink::mojom::CacheQueryOptionsPtr match_options =
+      blink::mojom::CacheQueryOptions::New();
+  match_options->ignore_search = true;
+  EXPECT_FALSE(Match(body_request_, match_options->Clone()));
+
+  match_options->ignore_vary = true;
+  EXPECT_TRUE(Match(body_request_, match_options->Clone()));
+}
+
+TEST_P(CacheStorageCacheTestP, IgnoreSearchWithCompleteUrlIndex) {
+  EXPECT_TRUE(Put(no_body_request_, CreateNoBodyResponse()));
+  EXPECT_TRUE(Keys());
+  EXPECT_TRUE(UrlIndexIsComplete());
+  EXPECT_FALSE(Match(body_request_));
+
+  // Entries put and deleted after the index is built are found, or not, by
+  // queries using it.
+  EXPECT_TRUE(Put(body_request_, CreateBlobBodyResponse()));
+  EXPECT_TRUE(Put(body_request_with_query_, CreateBlobBodyResponseWithQuery()));
+
+  blink::mojom::CacheQueryOptionsPtr match_options =
+      blink::mojom::CacheQueryOptions::New();
+  match_options->ignore_search = true;
+  std::vector<blink::mojom::FetchAPIResponsePtr> responses;
+  EXPECT_TRUE(MatchAll(body_request_, match_options->Clone(), &responses));
+  EXPECT_EQ(2u, responses.size());
+
+  EXPECT_TRUE(Delete(body_request_));
+  EXPECT_FALSE(Match(body_request_));
+  EXPECT_TRUE(Match(body_request_, match_options->Clone()));
+  responses.clear();
+  EXPECT_TRUE(MatchAll(body_request_, match_options->Clone(), &responses));
+  ASSERT_EQ(1u, responses.size());
+  EXPECT_EQ(body_request_with_query_->url, responses[0]->url_list[0]);
+
+  EXPECT_TRUE(Keys());
+  std::vector<std::string> expected_keys{no_body_request_->url.spec(),
+                                         body_request_with_query_->url.spec()};
+  EXPECT_EQ(expected_keys, callback_strings_);
+}
+
 TEST_P(CacheStorageCacheTestP, EmptyKeys) {
   EXPECT_TRUE(Keys());
   EXPECT_EQ(0u, callback_strings_.size());
@@ -40,6 +40,8 @@ base::StringPiece ClientToName(CacheStorageSchedulerClient client_type) {
   switch (client_type) {
     case CacheStorageSchedulerClient::kBackgroundSync:
       RETURN_LITERAL_STRING_PIECE("BackgroundSyncManager");
+    case CacheStorageSchedulerClient::kBodyStore:
+      RETURN_LITERAL_STRING_PIECE("BodyStore");
     case CacheStorageSchedulerClient::kCache:
       RETURN_LITERAL_STRING_PIECE("Cache");
     case CacheStorageSchedulerClient::kStorage:
@@ -24,6 +24,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/test/bind_test_util.h"
 #include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "build/build_config.h"
 #include "content/browser/blob_storage/chrome_blob_storage_context.h"
@@ -34,6 +35,7 @@
 #include "content/browser/cache_storage/cache_storage_scheduler.h"
 #include "content/browser/cache_storage/cross_sequence/cross_sequence_cache_storage_manager.h"
 #include "content/browser/cache_storage/legacy/legacy_cache_storage.h"
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_body_store.h"
 #include "content/browser/cache_storage/legacy/legacy_cache_storage_manager.h"
 #include "content/common/background_fetch/background_fetch_types.h"
 #include "content/public/browser/browser_thread.h"
@@ -426,6 +428,19 @@ class CacheStorageManagerTest : public testing::Test {
     return write_was_scheduled;
   }
 
+  bool AppendCacheStorageIndexJournal(const url::Origin& origin) {
+    DCHECK(ManagerType() == TestManager::kLegacy);
+    callback_bool_ = false;
+    base::RunLoop loop;
+    auto* impl = LegacyCacheStorage::From(CacheStorageForOrigin(origin));
+    bool write_was_scheduled = impl->InitiateScheduledIndexJournalWriteForTest(
+        base::BindOnce(&CacheStorageManagerTest::BoolCallback,
+                       base::Unretained(this), &loop));
+    loop.Run();
+    DCHECK(callback_bool_);
+    return write_was_scheduled;
+  }
+
   void DestroyStorageManager() {
     if (quota_manager_proxy_)
       quota_manager_proxy_->SimulateQuotaManagerDestroyed();
@@ -652,6 +667,29 @@ class CacheStorageManagerTest : public testing::Test {
     return callback_error_ == CacheStorageError::kSuccess;
   }
 
+  bool CachePutWithBody(CacheStorageCache* cache,
+                        const GURL& url,
+                        const std::string& body) {
+    auto request = blink::mojom::FetchAPIRequest::New();
+    request->url = url;
+
+    std::string blob_uuid = base::GenerateGUID();
+    auto blob = blink::mojom::SerializedBlob::New();
+    blob->uuid = blob_uuid;
+    blob->size = body.size();
+    blob_storage_context_->context()->RegisterFromMemory(
+        blob->blob.InitWithNewPipeAndPassReceiver(), blob_uuid,
+        std::vector<uint8_t>(body.begin(), body.end()));
+
+    base::RunLoop loop;
+    CachePutWithStatusCodeAndBlobInternal(cache, std::move(request), 200,
+                                          std::move(blob), &loop,
+                                          FetchResponseType::kCors);
+    loop.Run();
+
+    return callback_error_ == CacheStorageError::kSuccess;
+  }
+
   void CachePutWithStatusCodeAndBlobInternal(
       CacheStorageCache* cache,
       blink::mojom::FetchAPIRequestPtr request,
@@ -1942,6 +1980,117 @@ TEST_F(CacheStorageManagerTest, MAYBE_GetOriginSizeWithOldIndex) {
   EXPECT_EQ(cache_size_v2, Size(origin1_));
 }
 
+TEST_F(CacheStorageManagerTest, IndexJournalKeepsSizeUpdates) {
+  const std::string kCacheName = "foo";
+  EXPECT_TRUE(Open(origin1_, kCacheName));
+  CacheStorageCacheHandle cache_handle = std::move(callback_cache_handle_);
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("foo")));
+  base::FilePath storage_dir =
+      LegacyCacheStorageCache::From(cache_handle)->path().DirName();
+  base::FilePath index_path =
+      storage_dir.AppendASCII(LegacyCacheStorage::kIndexFileName);
+  base::FilePath journal_path =
+      storage_dir.AppendASCII(LegacyCacheStorage::kIndexJournalFileName);
+  EXPECT_TRUE(FlushCacheStorageIndex(origin1_));
+  EXPECT_FALSE(base::PathExists(journal_path));
+  std::string index_contents;
+  ASSERT_TRUE(base::ReadFileToString(index_path, &index_contents));
+
+  // Size updates are appended to the journal, leaving the index file as is.
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("bar")));
+  EXPECT_TRUE(AppendCacheStorageIndexJournal(origin1_));
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("baz")));
+  EXPECT_TRUE(AppendCacheStorageIndexJournal(origin1_));
+  int64_t size = Size(origin1_);
+  EXPECT_TRUE(base::PathExists(journal_path));
+  std::string new_index_contents;
+  ASSERT_TRUE(base::ReadFileToString(index_path, &new_index_contents));
+  EXPECT_EQ(index_contents, new_index_contents);
+  cache_handle = CacheStorageCacheHandle();
+  DestroyStorageManager();
+
+  // Loading the index replays the journal and folds it into the index file.
+  CreateStorageManager();
+  EXPECT_EQ(size, GetOriginUsage(origin1_));
+  DestroyStorageManager();
+  EXPECT_FALSE(base::PathExists(journal_path));
+  ASSERT_TRUE(base::ReadFileToString(index_path, &new_index_contents));
+  proto::CacheStorageIndex index;
+  ASSERT_TRUE(index.ParseFromString(new_index_contents));
+  ASSERT_EQ(1, index.cache_size());
+  EXPECT_EQ(kCacheName, index.cache(0).name());
+}
+
+TEST_F(CacheStorageManagerTest, IndexJournalIgnoresTornAndStaleRecords) {
+  EXPECT_TRUE(Open(origin1_, "foo"));
+  CacheStorageCacheHandle cache_handle = std::move(callback_cache_handle_);
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("foo")));
+  base::FilePath storage_dir =
+      LegacyCacheStorageCache::From(cache_handle)->path().DirName();
+  base::FilePath journal_path =
+      storage_dir.AppendASCII(LegacyCacheStorage::kIndexJournalFileName);
+  base::FilePath backup_journal_path = storage_dir.AppendASCII("journal.bak");
+  EXPECT_TRUE(FlushCacheStorageIndex(origin1_));
+
+  // Keep a journal that refers to the index as it is now.
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("bar")));
+  EXPECT_TRUE(AppendCacheStorageIndexJournal(origin1_));
+  EXPECT_TRUE(base::CopyFile(journal_path, backup_journal_path));
+
+  // Rewrite the index with a larger size.
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("baz")));
+  EXPECT_TRUE(FlushCacheStorageIndex(origin1_));
+  EXPECT_FALSE(base::PathExists(journal_path));
+  int64_t size = Size(origin1_);
+  cache_handle = CacheStorageCacheHandle();
+  DestroyStorageManager();
+
+  // Records referring to an older index are not replayed over the new one,
+  // and a torn record at the end is ignored.
+  EXPECT_TRUE(base::CopyFile(backup_journal_path, journal_path));
+  ASSERT_TRUE(base::AppendToFile(journal_path, "\x00\x00\x01", 3));
+  CreateStorageManager();
+  EXPECT_EQ(size, GetOriginUsage(origin1_));
+  EXPECT_TRUE(Open(origin1_, "foo"));
+  EXPECT_EQ(size, Size(origin1_));
+}
+
+TEST_F(CacheStorageManagerTest, IndexJournalWithStaleRecordsIsNotTrusted) {
+  EXPECT_TRUE(Open(origin1_, "foo"));
+  CacheStorageCacheHandle cache_handle = std::move(callback_cache_handle_);
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("foo")));
+  base::FilePath storage_dir =
+      LegacyCacheStorageCache::From(cache_handle)->path().DirName();
+  base::FilePath journal_path =
+      storage_dir.AppendASCII(LegacyCacheStorage::kIndexJournalFileName);
+  base::FilePath backup_journal_path = storage_dir.AppendASCII("journal.bak");
+  EXPECT_TRUE(FlushCacheStorageIndex(origin1_));
+  EXPECT_TRUE(AppendCacheStorageIndexJournal(origin1_));
+  EXPECT_TRUE(base::CopyFile(journal_path, backup_journal_path));
+
+  EXPECT_TRUE(
+      CachePut(cache_handle.value(), origin1_.GetURL().Resolve("bar")));
+  EXPECT_TRUE(FlushCacheStorageIndex(origin1_));
+  int64_t size = Size(origin1_);
+  cache_handle = CacheStorageCacheHandle();
+  DestroyStorageManager();
+
+  // A journal made only of records for an older index is skipped, and its
+  // mtime does not vouch for the sizes in the index.
+  EXPECT_TRUE(base::CopyFile(backup_journal_path, journal_path));
+  CreateStorageManager();
+  EXPECT_EQ(size, GetOriginUsage(origin1_));
+  EXPECT_TRUE(Open(origin1_, "foo"));
+  EXPECT_EQ(size, Size(origin1_));
+}
+
 TEST_P(CacheStorageManagerLegacyOnlyTestP, GetSizeThenCloseAllCaches) {
   EXPECT_TRUE(Open(origin1_, "foo"));
   EXPECT_TRUE(
@@ -2029,6 +2178,75 @@ TEST_F(CacheStorageManagerTest, DeleteUnreferencedCacheDirectories) {
   EXPECT_FALSE(base::DirectoryExists(unreferenced_path));
 }
 
+TEST_F(CacheStorageManagerTest, SharedBodiesStoredOnce) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeature(kCacheStorageSharedBodies);
+  const GURL kFooURL = origin1_.GetURL().Resolve("foo");
+  const std::string body(2 * kCacheStorageSharedBodiesMinSize.Get(), 'x');
+
+  EXPECT_TRUE(Open(origin1_, "foo"));
+  CacheStorageCacheHandle foo_handle = std::move(callback_cache_handle_);
+  EXPECT_TRUE(CachePutWithBody(foo_handle.value(), kFooURL, body));
+  int64_t size_one = Size(origin1_);
+  EXPECT_GT(size_one, static_cast<int64_t>(body.size()));
+
+  auto* legacy_manager =
+      static_cast<LegacyCacheStorageManager*>(cache_manager_.get());
+  base::FilePath origin_path = LegacyCacheStorageManager::ConstructOriginPath(
+      legacy_manager->root_path(), origin1_, CacheStorageOwner::kCacheAPI);
+  EXPECT_TRUE(base::DirectoryExists(
+      origin_path.AppendASCII(LegacyCacheStorageBodyStore::kDirName)));
+
+  // Putting the same body into a second cache only adds its metadata.
+  EXPECT_TRUE(Open(origin1_, "bar"));
+  CacheStorageCacheHandle bar_handle = std::move(callback_cache_handle_);
+  EXPECT_TRUE(CachePutWithBody(bar_handle.value(), kFooURL, body));
+  EXPECT_LT(Size(origin1_) - size_one, static_cast<int64_t>(body.size()));
+  EXPECT_EQ(Size(origin1_), GetQuotaOriginUsage(origin1_));
+
+  // The body outlives the entries of one cache.
+  EXPECT_TRUE(CacheDelete(foo_handle.value(), kFooURL));
+  EXPECT_TRUE(CacheMatch(bar_handle.value(), kFooURL));
+  ASSERT_TRUE(callback_cache_handle_response_->blob);
+  EXPECT_EQ(body.size(), callback_cache_handle_response_->blob->size);
+
+  // And is deleted with the last entry referring to it.
+  EXPECT_TRUE(CacheDelete(bar_handle.value(), kFooURL));
+  EXPECT_LT(Size(origin1_), static_cast<int64_t>(body.size()));
+}
+
+TEST_F(CacheStorageManagerTest, SharedBodiesOfRemovedCachesSweptOnOpen) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeature(kCacheStorageSharedBodies);
+  const GURL kFooURL = origin1_.GetURL().Resolve("foo");
+  const std::string body(2 * kCacheStorageSharedBodiesMinSize.Get(), 'x');
+
+  EXPECT_TRUE(Open(origin1_, "foo"));
+  EXPECT_TRUE(CachePutWithBody(callback_cache_handle_.value(), kFooURL, body));
+  callback_cache_handle_ = CacheStorageCacheHandle();
+
+  auto* legacy_manager =
+      static_cast<LegacyCacheStorageManager*>(cache_manager_.get());
+  base::FilePath origin_path = LegacyCacheStorageManager::ConstructOriginPath(
+      legacy_manager->root_path(), origin1_, CacheStorageOwner::kCacheAPI);
+  base::FilePath store_path =
+      origin_path.AppendASCII(LegacyCacheStorageBodyStore::kDirName);
+  base::FilePath backup_path = origin_path.DirName().AppendASCII("bodies.bak");
+  DestroyStorageManager();
+  ASSERT_TRUE(base::CopyDirectory(store_path, backup_path, true));
+
+  // Delete the cache, then bring back the store as it was before the cache's
+  // bodies were released, as if the browser crashed in between.
+  CreateStorageManager();
+  EXPECT_TRUE(Delete(origin1_, "foo"));
+  DestroyStorageManager();
+  ASSERT_TRUE(base::DeleteFileRecursively(store_path));
+  ASSERT_TRUE(base::CopyDirectory(backup_path, store_path, true));
+
+  CreateStorageManager();
+  EXPECT_LT(Size(origin1_), static_cast<int64_t>(body.size()));
+}
+
 TEST_P(CacheStorageManagerTestP, OpenCacheStorageAccessed) {
   EXPECT_EQ(0, quota_manager_proxy_->notify_storage_accessed_count());
   EXPECT_TRUE(Open(origin1_, "foo"));
@@ -19,6 +19,7 @@ CacheStorageOperation::CacheStorageOperation(
     CacheStorageSchedulerMode mode,
     CacheStorageSchedulerOp op_type,
     CacheStorageSchedulerPriority priority,
+    std::string key,
     scoped_refptr<base::SequencedTaskRunner> task_runner)
     : closure_(std::move(closure)),
       creation_ticks_(base::TimeTicks::Now()),
@@ -27,6 +28,7 @@ CacheStorageOperation::CacheStorageOperation(
       mode_(mode),
       op_type_(op_type),
       priority_(priority),
+      key_(std::move(key)),
       task_runner_(std::move(task_runner)) {}
 
 CacheStorageOperation::~CacheStorageOperation() {
@@ -5,6 +5,8 @@
 #ifndef CONTENT_BROWSER_CACHE_STORAGE_CACHE_STORAGE_OPERATION_H_
 #define CONTENT_BROWSER_CACHE_STORAGE_CACHE_STORAGE_OPERATION_H_
 
+#include <string>
+
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/memory/ref_counted.h"
@@ -26,6 +28,7 @@ class CONTENT_EXPORT CacheStorageOperation {
                         CacheStorageSchedulerMode mode,
                         CacheStorageSchedulerOp op_type,
                         CacheStorageSchedulerPriority priority,
+                        std::string key,
                         scoped_refptr<base::SequencedTaskRunner> task_runner);
 
   ~CacheStorageOperation();
@@ -38,6 +41,9 @@ class CONTENT_EXPORT CacheStorageOperation {
   CacheStorageSchedulerMode mode() const { return mode_; }
   CacheStorageSchedulerOp op_type() const { return op_type_; }
   CacheStorageSchedulerPriority priority() const { return priority_; }
+  // The key of the entry the operation is limited to, or empty if it may
+  // touch any entry.
+  const std::string& key() const { return key_; }
   base::WeakPtr<CacheStorageOperation> AsWeakPtr() {
     return weak_ptr_factory_.GetWeakPtr();
   }
@@ -62,6 +68,7 @@ class CONTENT_EXPORT CacheStorageOperation {
   const CacheStorageSchedulerMode mode_;
   const CacheStorageSchedulerOp op_type_;
   const CacheStorageSchedulerPriority priority_;
+  const std::string key_;
   scoped_refptr<base::SequencedTaskRunner> task_runner_;
   base::WeakPtrFactory<CacheStorageOperation> weak_ptr_factory_{this};
 
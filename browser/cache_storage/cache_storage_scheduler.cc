@@ -4,6 +4,7 @@
 
 #include "content/browser/cache_storage/cache_storage_scheduler.h"
 
+#include <algorithm>
 #include <string>
 
 #include "base/bind.h"
@@ -50,15 +51,22 @@ bool OpPointerLessThan(const std::unique_ptr<CacheStorageOperation>& left,
   return left->id() > right->id();
 }
 
+// Returns true if |left| and |right| must not run in parallel.  An empty key
+// covers every entry.
+bool OperationsConflict(const CacheStorageOperation& left,
+                        const CacheStorageOperation& right) {
+  if (left.mode() == right.mode())
+    return left.mode() == CacheStorageSchedulerMode::kExclusive;
+  return left.key().empty() || right.key().empty() ||
+         left.key() == right.key();
+}
+
 }  // namespace
 
 CacheStorageScheduler::CacheStorageScheduler(
     CacheStorageSchedulerClient client_type,
     scoped_refptr<base::SequencedTaskRunner> task_runner)
-    : task_runner_(std::move(task_runner)), client_type_(client_type) {
-  std::make_heap(pending_operations_.begin(), pending_operations_.end(),
-                 &OpPointerLessThan);
-}
+    : task_runner_(std::move(task_runner)), client_type_(client_type) {}
 
 CacheStorageScheduler::~CacheStorageScheduler() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
@@ -75,16 +83,32 @@ void CacheStorageScheduler::ScheduleOperation(
     CacheStorageSchedulerOp op_type,
     CacheStorageSchedulerPriority priority,
     base::OnceClosure closure) {
+  ScheduleOperationOnKey(id, mode, op_type, priority, std::string(),
+                         std::move(closure));
+}
+
+void CacheStorageScheduler::ScheduleOperationOnKey(
+    CacheStorageSchedulerId id,
+    CacheStorageSchedulerMode mode,
+    CacheStorageSchedulerOp op_type,
+    CacheStorageSchedulerPriority priority,
+    const std::string& key,
+    base::OnceClosure closure) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   RecordCacheStorageSchedulerUMA(CacheStorageSchedulerUMA::kQueueLength,
                                  client_type_, op_type,
                                  pending_operations_.size());
 
-  pending_operations_.push_back(std::make_unique<CacheStorageOperation>(
-      std::move(closure), id, client_type_, mode, op_type, priority,
-      task_runner_));
-  std::push_heap(pending_operations_.begin(), pending_operations_.end(),
-                 &OpPointerLessThan);
+  auto operation = std::make_unique<CacheStorageOperation>(
+      std::move(closure), id, client_type_, mode, op_type, priority, key,
+      task_runner_);
+  auto position = std::upper_bound(
+      pending_operations_.begin(), pending_operations_.end(), operation,
+      [](const std::unique_ptr<CacheStorageOperation>& value,
+         const std::unique_ptr<CacheStorageOperation>& element) {
+        return OpPointerLessThan(element, value);
+      });
+  pending_operations_.insert(position, std::move(operation));
   MaybeRunOperation();
 }
 
@@ -96,7 +120,6 @@ void CacheStorageScheduler::CompleteOperationAndRunNext(
   DCHECK_EQ(it->second->id(), id);
 
   if (it->second->mode() == CacheStorageSchedulerMode::kShared) {
-    DCHECK_EQ(num_running_exclusive_, 0);
     DCHECK_GT(num_running_shared_, 0);
     num_running_shared_ -= 1;
     if (num_running_shared_ == 0) {
@@ -105,7 +128,6 @@ void CacheStorageScheduler::CompleteOperationAndRunNext(
       peak_parallel_shared_ = 0;
     }
   } else {
-    DCHECK_EQ(num_running_shared_, 0);
     DCHECK_EQ(num_running_exclusive_, 1);
     num_running_exclusive_ -= 1;
   }
@@ -132,62 +154,75 @@ void CacheStorageScheduler::DispatchOperationTask(base::OnceClosure task) {
 
 void CacheStorageScheduler::MaybeRunOperation() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
-  // If there are no operations, then we can't run anything.
-  if (pending_operations_.empty()) {
-    DoneStartingAvailableOperations();
-    return;
-  }
+  const int max_shared_ops = kCacheStorageMaxSharedOps.Get();
+
+  // The pending operations passed over so far.  Later operations must not
+  // start ahead of the ones they conflict with.
+  std::vector<CacheStorageOperation*> waiting_operations;
+  bool exclusive_waiting = false;
+
+  auto it = pending_operations_.begin();
+  while (it != pending_operations_.end()) {
+    // Nothing can start behind a waiting kExclusive operation on every
+    // entry, nor once neither kShared nor kExclusive operations can start.
+    if (exclusive_waiting && waiting_operations.back()->key().empty() &&
+        waiting_operations.back()->mode() ==
+            CacheStorageSchedulerMode::kExclusive) {
+      break;
+    }
+    if (num_running_shared_ >= max_shared_ops &&
+        (num_running_exclusive_ > 0 || exclusive_waiting)) {
+      break;
+    }
+
+    CacheStorageOperation* next_operation = it->get();
+    const bool is_shared =
+        next_operation->mode() == CacheStorageSchedulerMode::kShared;
 
-  auto* next_operation = pending_operations_.front().get();
-
-  // Determine if we can run the next operation based on its mode
-  // and the current state of executing operations.  We allow multiple
-  // kShared operations to run in parallel, but a kExclusive operation
-  // must not overlap with any other operation.
-  if (next_operation->mode() == CacheStorageSchedulerMode::kShared) {
-    if (num_running_exclusive_ > 0 ||
-        num_running_shared_ >= kCacheStorageMaxSharedOps.Get()) {
-      DoneStartingAvailableOperations();
-      return;
+    bool can_run = !(is_shared && num_running_shared_ >= max_shared_ops) &&
+                   !ConflictsWithRunningOperation(*next_operation);
+    for (size_t i = 0; can_run && i < waiting_operations.size(); ++i) {
+      if (OperationsConflict(*next_operation, *waiting_operations[i]))
+        can_run = false;
+    }
+    if (!can_run) {
+      waiting_operations.push_back(next_operation);
+      exclusive_waiting |= !is_shared;
+      ++it;
+      continue;
     }
-  } else if (num_running_shared_ > 0 || num_running_exclusive_ > 0) {
-    DCHECK_EQ(next_operation->mode(), CacheStorageSchedulerMode::kExclusive);
-    DoneStartingAvailableOperations();
-    return;
-  }
 
-  running_operations_.emplace(next_operation->id(),
-                              std::move(pending_operations_.front()));
-  std::pop_heap(pending_operations_.begin(), pending_operations_.end(),
-                &OpPointerLessThan);
-  pending_operations_.pop_back();
-
-  RecordCacheStorageSchedulerUMA(
-      CacheStorageSchedulerUMA::kQueueDuration, client_type_,
-      next_operation->op_type(),
-      base::TimeTicks::Now() - next_operation->creation_ticks());
-
-  if (next_operation->mode() == CacheStorageSchedulerMode::kShared) {
-    DCHECK_EQ(num_running_exclusive_, 0);
-    num_running_shared_ += 1;
-    peak_parallel_shared_ =
-        std::max(num_running_shared_, peak_parallel_shared_);
-  } else {
-    DCHECK_EQ(num_running_exclusive_, 0);
-    DCHECK_EQ(num_running_shared_, 0);
-    num_running_exclusive_ += 1;
+    running_operations_.emplace(next_operation->id(), std::move(*it));
+    it = pending_operations_.erase(it);
+
+    RecordCacheStorageSchedulerUMA(
+        CacheStorageSchedulerUMA::kQueueDuration, client_type_,
+        next_operation->op_type(),
+        base::TimeTicks::Now() - next_operation->creation_ticks());
+
+    if (is_shared) {
+      num_running_shared_ += 1;
+      peak_parallel_shared_ =
+          std::max(num_running_shared_, peak_parallel_shared_);
+    } else {
+      DCHECK_EQ(num_running_exclusive_, 0);
+      num_running_exclusive_ += 1;
+    }
+
+    DispatchOperationTask(base::BindOnce(&CacheStorageOperation::Run,
+                                         next_operation->AsWeakPtr()));
   }
 
-  DispatchOperationTask(
-      base::BindOnce(&CacheStorageOperation::Run, next_operation->AsWeakPtr()));
+  DoneStartingAvailableOperations();
+}
 
-  // If we just executed a kShared operation, then we may be able to schedule
-  // additional kShared parallel operations.  Recurse to process the next
-  // pending operation.
-  if (next_operation->mode() == CacheStorageSchedulerMode::kShared)
-    MaybeRunOperation();
-  else
-    DoneStartingAvailableOperations();
+bool CacheStorageScheduler::ConflictsWithRunningOperation(
+    const CacheStorageOperation& operation) const {
+  for (const auto& running : running_operations_) {
+    if (OperationsConflict(operation, *running.second))
+      return true;
+  }
+  return false;
 }
 
 }  // namespace content
@@ -6,6 +6,7 @@
 #define CONTENT_BROWSER_CACHE_STORAGE_CACHE_STORAGE_SCHEDULER_H_
 
 #include <map>
+#include <string>
 #include <vector>
 
 #include "base/bind.h"
@@ -27,6 +28,14 @@ class CacheStorageOperation;
 // operation by calling ScheduleOperation() with your callback. Once your
 // operation is done be sure to call CompleteOperationAndRunNext() to schedule
 // the next operation.
+//
+// kShared operations run in parallel with each other, up to a limit, and
+// kExclusive operations run one at a time.  An operation limited to a single
+// entry can be scheduled with ScheduleOperationOnKey(), which lets kShared
+// and kExclusive operations on different entries run in parallel.
+// Operations start in the order they were scheduled (by priority), except
+// that an operation may start ahead of earlier ones it does not conflict
+// with.
 class CONTENT_EXPORT CacheStorageScheduler {
  public:
   CacheStorageScheduler(CacheStorageSchedulerClient client_type,
@@ -48,6 +57,18 @@ class CONTENT_EXPORT CacheStorageScheduler {
                          CacheStorageSchedulerPriority priority,
                          base::OnceClosure closure);
 
+  // As ScheduleOperation(), for an operation that only reads or writes the
+  // entry identified by the non-empty |key|.  A kExclusive operation on a key
+  // still never runs in parallel with another kExclusive operation, but it
+  // only excludes the kShared operations on the same key and those scheduled
+  // with ScheduleOperation().
+  void ScheduleOperationOnKey(CacheStorageSchedulerId id,
+                              CacheStorageSchedulerMode mode,
+                              CacheStorageSchedulerOp op_type,
+                              CacheStorageSchedulerPriority priority,
+                              const std::string& key,
+                              base::OnceClosure closure);
+
   // Call this after each operation completes. It cleans up the operation
   // associated with the given id.  If may also start the next set of
   // operations.
@@ -77,10 +98,15 @@ class CONTENT_EXPORT CacheStorageScheduler {
   virtual void DoneStartingAvailableOperations() {}
 
  private:
-  // Maybe start running the next operation depending on the current
-  // set of running operations and the mode of the next operation.
+  // Start running the pending operations that do not conflict with the
+  // running operations or with the pending operations ahead of them.
   void MaybeRunOperation();
 
+  // Returns true if |operation| can not start while a running operation
+  // runs.
+  bool ConflictsWithRunningOperation(
+      const CacheStorageOperation& operation) const;
+
   template <typename... Args>
   void RunNextContinuation(CacheStorageSchedulerId id,
                            base::OnceCallback<void(Args...)> callback,
@@ -97,9 +123,9 @@ class CONTENT_EXPORT CacheStorageScheduler {
 
   scoped_refptr<base::SequencedTaskRunner> task_runner_;
 
-  // Managed as a heap using std::push_heap and std::pop_heap.  We do not
-  // use std::priority_queue since it does not support moving the contained
-  // unique_ptr out when the operation begins execution.
+  // Sorted so that the operation to run first is at the front.  Operations
+  // may be taken out of the middle when they start ahead of conflicting
+  // ones, which std::priority_queue does not support.
   std::vector<std::unique_ptr<CacheStorageOperation>> pending_operations_;
 
   std::map<CacheStorageSchedulerId, std::unique_ptr<CacheStorageOperation>>
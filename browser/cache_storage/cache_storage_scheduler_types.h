@@ -18,8 +18,9 @@ using CacheStorageSchedulerId = int64_t;
 // directly recorded in the histogram.
 enum class CacheStorageSchedulerClient {
   kBackgroundSync = 0,
-  kCache = 1,
-  kStorage = 2,
+  kBodyStore = 1,
+  kCache = 2,
+  kStorage = 3,
 };
 
 enum class CacheStorageSchedulerMode {
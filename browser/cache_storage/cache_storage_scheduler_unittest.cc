@@ -533,5 +533,130 @@ TEST_F(CacheStorageSchedulerTest, ScheduleByPriorityTwoNormalOneHigh) {
   EXPECT_EQ(1, task3_.callback_count());
 }
 
+TEST_F(CacheStorageSchedulerTest, ScheduleExclusiveAndSharedOnKeys) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeatureWithParameters(
+      features::kCacheStorageParallelOps, {{"max_shared_ops", "3"}});
+
+  scheduler_.ScheduleOperationOnKey(
+      task1_.id(), CacheStorageSchedulerMode::kExclusive,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      "a", base::BindOnce(&TestTask::Run, base::Unretained(&task1_)));
+  scheduler_.ScheduleOperationOnKey(
+      task2_.id(), CacheStorageSchedulerMode::kShared,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      "a", base::BindOnce(&TestTask::Run, base::Unretained(&task2_)));
+  base::RunLoop done_loop1;
+  scheduler_.SetDoneStartingClosure(done_loop1.QuitClosure());
+  scheduler_.ScheduleOperationOnKey(
+      task3_.id(), CacheStorageSchedulerMode::kShared,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      "b", base::BindOnce(&TestTask::Run, base::Unretained(&task3_)));
+
+  // Should run the shared op on the other key alongside the exclusive op.
+  task1_.run_loop().Run();
+  task3_.run_loop().Run();
+  done_loop1.Run();
+  EXPECT_EQ(1, task1_.callback_count());
+  EXPECT_EQ(0, task2_.callback_count());
+  EXPECT_EQ(1, task3_.callback_count());
+  EXPECT_TRUE(scheduler_.IsRunningExclusiveOperation());
+
+  base::RunLoop done_loop2;
+  scheduler_.SetDoneStartingClosure(done_loop2.QuitClosure());
+
+  // Should run the shared op on the same key after the exclusive op
+  // completes.
+  task1_.Done();
+  task2_.run_loop().Run();
+  done_loop2.Run();
+  EXPECT_EQ(1, task2_.callback_count());
+  EXPECT_FALSE(scheduler_.IsRunningExclusiveOperation());
+
+  task2_.Done();
+  task3_.Done();
+  EXPECT_FALSE(scheduler_.ScheduledOperations());
+}
+
+TEST_F(CacheStorageSchedulerTest, ScheduleExclusiveOnKeysOneAtATime) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeatureWithParameters(
+      features::kCacheStorageParallelOps, {{"max_shared_ops", "3"}});
+
+  scheduler_.ScheduleOperationOnKey(
+      task1_.id(), CacheStorageSchedulerMode::kExclusive,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      "a", base::BindOnce(&TestTask::Run, base::Unretained(&task1_)));
+  scheduler_.ScheduleOperationOnKey(
+      task2_.id(), CacheStorageSchedulerMode::kExclusive,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      "b", base::BindOnce(&TestTask::Run, base::Unretained(&task2_)));
+  base::RunLoop done_loop1;
+  scheduler_.SetDoneStartingClosure(done_loop1.QuitClosure());
+  scheduler_.ScheduleOperationOnKey(
+      task3_.id(), CacheStorageSchedulerMode::kShared,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      "b", base::BindOnce(&TestTask::Run, base::Unretained(&task3_)));
+
+  // Exclusive ops on different keys still run one at a time, and the shared
+  // op must not start ahead of the pending exclusive op on its key.
+  task1_.run_loop().Run();
+  done_loop1.Run();
+  EXPECT_EQ(1, task1_.callback_count());
+  EXPECT_EQ(0, task2_.callback_count());
+  EXPECT_EQ(0, task3_.callback_count());
+
+  base::RunLoop done_loop2;
+  scheduler_.SetDoneStartingClosure(done_loop2.QuitClosure());
+  task1_.Done();
+  task2_.run_loop().Run();
+  done_loop2.Run();
+  EXPECT_EQ(1, task2_.callback_count());
+  EXPECT_EQ(0, task3_.callback_count());
+
+  base::RunLoop done_loop3;
+  scheduler_.SetDoneStartingClosure(done_loop3.QuitClosure());
+  task2_.Done();
+  task3_.run_loop().Run();
+  done_loop3.Run();
+  EXPECT_EQ(1, task3_.callback_count());
+
+  task3_.Done();
+  EXPECT_FALSE(scheduler_.ScheduledOperations());
+}
+
+TEST_F(CacheStorageSchedulerTest, ScheduleSharedWithoutKeyAfterExclusiveOnKey) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeatureWithParameters(
+      features::kCacheStorageParallelOps, {{"max_shared_ops", "3"}});
+
+  scheduler_.ScheduleOperationOnKey(
+      task1_.id(), CacheStorageSchedulerMode::kExclusive,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      "a", base::BindOnce(&TestTask::Run, base::Unretained(&task1_)));
+  base::RunLoop done_loop1;
+  scheduler_.SetDoneStartingClosure(done_loop1.QuitClosure());
+  scheduler_.ScheduleOperation(
+      task2_.id(), CacheStorageSchedulerMode::kShared,
+      CacheStorageSchedulerOp::kTest, CacheStorageSchedulerPriority::kNormal,
+      base::BindOnce(&TestTask::Run, base::Unretained(&task2_)));
+
+  // A shared op without a key may read any entry, so it waits.
+  task1_.run_loop().Run();
+  done_loop1.Run();
+  EXPECT_EQ(1, task1_.callback_count());
+  EXPECT_EQ(0, task2_.callback_count());
+
+  base::RunLoop done_loop2;
+  scheduler_.SetDoneStartingClosure(done_loop2.QuitClosure());
+  task1_.Done();
+  task2_.run_loop().Run();
+  done_loop2.Run();
+  EXPECT_EQ(1, task2_.callback_count());
+
+  task2_.Done();
+  EXPECT_FALSE(scheduler_.ScheduledOperations());
+}
+
 }  // namespace cache_storage_scheduler_unittest
 }  // namespace content
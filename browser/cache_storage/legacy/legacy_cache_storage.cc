@@ -6,6 +6,7 @@
 
 #include <stddef.h>
 
+#include <limits>
 #include <memory>
 #include <set>
 #include <string>
@@ -13,11 +14,14 @@
 #include <vector>
 
 #include "base/barrier_closure.h"
+#include "base/big_endian.h"
 #include "base/bind.h"
 #include "base/bind_helpers.h"
+#include "base/files/file.h"
 #include "base/files/file_util.h"
 #include "base/files/memory_mapped_file.h"
 #include "base/guid.h"
+#include "base/hash/hash.h"
 #include "base/hash/sha1.h"
 #include "base/location.h"
 #include "base/memory/ptr_util.h"
@@ -25,9 +29,11 @@
 #include "base/memory/scoped_refptr.h"
 #include "base/metrics/histogram_macros.h"
 #include "base/numerics/safe_conversions.h"
+#include "base/rand_util.h"
 #include "base/sequenced_task_runner.h"
 #include "base/stl_util.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_piece.h"
 #include "base/strings/string_util.h"
 #include "base/threading/sequenced_task_runner_handle.h"
 #include "base/trace_event/trace_event.h"
@@ -40,6 +46,7 @@
 #include "content/browser/cache_storage/cache_storage_quota_client.h"
 #include "content/browser/cache_storage/cache_storage_scheduler.h"
 #include "content/browser/cache_storage/cache_storage_trace_utils.h"
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_body_store.h"
 #include "content/browser/cache_storage/legacy/legacy_cache_storage_manager.h"
 #include "content/common/background_fetch/background_fetch_types.h"
 #include "crypto/symmetric_key.h"
@@ -58,6 +65,13 @@ namespace content {
 
 namespace {
 
+// Each journal record is framed by its size and a hash of its contents, so
+// that a record torn by a crash ends the replay.
+constexpr size_t kIndexJournalRecordHeaderSize = 2 * sizeof(uint32_t);
+
+// The journal is folded into the index file once it holds this many records.
+constexpr size_t kMaxIndexJournalRecords = 64;
+
 std::string HexedHash(const std::string& value) {
   std::string value_hash = base::SHA1HashString(value);
   std::string valued_hexed_hash = base::ToLowerASCII(
@@ -65,15 +79,42 @@ std::string HexedHash(const std::string& value) {
   return valued_hexed_hash;
 }
 
+void AppendIndexJournalRecord(const std::string& record, std::string* journal) {
+  char header[kIndexJournalRecordHeaderSize];
+  base::WriteBigEndian(header, base::checked_cast<uint32_t>(record.size()));
+  base::WriteBigEndian(header + sizeof(uint32_t), base::PersistentHash(record));
+  journal->append(header, sizeof(header));
+  journal->append(record);
+}
+
 void SizeRetrievedFromAllCaches(std::unique_ptr<int64_t> accumulator,
                                 LegacyCacheStorage::SizeCallback callback) {
   base::SequencedTaskRunnerHandle::Get()->PostTask(
       FROM_HERE, base::BindOnce(std::move(callback), *accumulator));
 }
 
+// Adds the size of the bodies shared between caches, which no cache counts,
+// to |caches_size|. Closes |body_store| afterwards if |close| is true.
+void AddSharedBodiesSize(scoped_refptr<LegacyCacheStorageBodyStore> body_store,
+                         bool close,
+                         LegacyCacheStorage::SizeCallback callback,
+                         int64_t caches_size) {
+  auto add_size = base::BindOnce(
+      [](LegacyCacheStorage::SizeCallback callback, int64_t caches_size,
+         int64_t bodies_size) {
+        std::move(callback).Run(caches_size + bodies_size);
+      },
+      std::move(callback), caches_size);
+  if (close)
+    body_store->GetSizeThenClose(std::move(add_size));
+  else
+    body_store->Size(std::move(add_size));
+}
+
 }  // namespace
 
 const char LegacyCacheStorage::kIndexFileName[] = "index.txt";
+const char LegacyCacheStorage::kIndexJournalFileName[] = "index.txt.journal";
 
 struct LegacyCacheStorage::CacheMatchResponse {
   CacheMatchResponse() = default;
@@ -132,6 +173,13 @@ class LegacyCacheStorage::CacheLoader {
   virtual void WriteIndex(const CacheStorageIndex& index,
                           BoolCallback callback) = 0;
 
+  // Writes the size and padding of the caches in |cache_names| to disk if
+  // applicable. Cheaper than WriteIndex() when only sizes have changed since
+  // the last write.
+  virtual void WriteIndexChanges(const CacheStorageIndex& index,
+                                 const std::set<std::string>& cache_names,
+                                 BoolCallback callback) = 0;
+
   // Loads the cache index from disk if applicable.
   virtual void LoadIndex(CacheStorageIndexLoadCallback callback) = 0;
 
@@ -144,6 +192,10 @@ class LegacyCacheStorage::CacheLoader {
   // loader is holding a handle to the cache, it should drop it now.
   virtual void NotifyCacheDoomed(CacheStorageCacheHandle cache_handle) {}
 
+  // Returns the store of the response bodies the caches share, or nullptr if
+  // the caches do not share bodies.
+  virtual LegacyCacheStorageBodyStore* body_store() { return nullptr; }
+
  protected:
   const scoped_refptr<base::SequencedTaskRunner> cache_task_runner_;
   const scoped_refptr<base::SequencedTaskRunner> scheduler_task_runner_;
@@ -209,6 +261,12 @@ class LegacyCacheStorage::MemoryLoader
     std::move(callback).Run(true);
   }
 
+  void WriteIndexChanges(const CacheStorageIndex& index,
+                         const std::set<std::string>& cache_names,
+                         BoolCallback callback) override {
+    std::move(callback).Run(true);
+  }
+
   void LoadIndex(CacheStorageIndexLoadCallback callback) override {
     std::move(callback).Run(std::make_unique<CacheStorageIndex>());
   }
@@ -254,7 +312,17 @@ class LegacyCacheStorage::SimpleCacheLoader
                     cache_storage,
                     origin,
                     owner),
-        origin_path_(origin_path) {}
+        origin_path_(origin_path) {
+    // Only caches of the Cache API are likely to hold the same bodies. The
+    // store is always created so that bodies shared while
+    // kCacheStorageSharedBodies was enabled can still be read.
+    if (owner_ == CacheStorageOwner::kCacheAPI) {
+      body_store_ = base::MakeRefCounted<LegacyCacheStorageBodyStore>(
+          origin_path_.AppendASCII(LegacyCacheStorageBodyStore::kDirName),
+          origin_, owner_, cache_task_runner_, scheduler_task_runner_,
+          quota_manager_proxy_);
+    }
+  }
 
   std::unique_ptr<LegacyCacheStorageCache> CreateCache(
       const std::string& cache_name,
@@ -269,7 +337,7 @@ class LegacyCacheStorage::SimpleCacheLoader
     return LegacyCacheStorageCache::CreatePersistentCache(
         origin_, owner_, cache_name, cache_storage_, cache_path,
         scheduler_task_runner_, quota_manager_proxy_, blob_storage_context_,
-        cache_size, cache_padding, std::move(cache_padding_key));
+        cache_size, cache_padding, std::move(cache_padding_key), body_store_);
   }
 
   void PrepareNewCacheDestination(const std::string& cache_name,
@@ -316,14 +384,17 @@ class LegacyCacheStorage::SimpleCacheLoader
     DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
     DCHECK(base::Contains(doomed_cache_to_path_, cache));
 
-    base::FilePath cache_path =
-        origin_path_.AppendASCII(doomed_cache_to_path_[cache]);
+    const std::string cache_dir = doomed_cache_to_path_[cache];
+    base::FilePath cache_path = origin_path_.AppendASCII(cache_dir);
     doomed_cache_to_path_.erase(cache);
 
     cache_task_runner_->PostTask(
         FROM_HERE,
         base::BindOnce(&SimpleCacheLoader::CleanUpDeleteCacheDirInPool,
                        cache_path));
+
+    if (body_store_)
+      body_store_->ReleaseBodiesOfCaches({cache_dir});
   }
 
   static void CleanUpDeleteCacheDirInPool(const base::FilePath& cache_path) {
@@ -344,6 +415,16 @@ class LegacyCacheStorage::SimpleCacheLoader
     // TODO(crbug.com/809329): Add a test for validating fields in the proto
     protobuf_index.set_origin(origin_.GetURL().spec());
 
+    // Journal records appended from now on apply to this version of the
+    // index. The id is random so that records left over from an index that
+    // failed to load can never match. It only becomes |checkpoint_id_| once
+    // the index is on disk.
+    const int64_t checkpoint_id = base::checked_cast<int64_t>(
+        base::RandGenerator(std::numeric_limits<int64_t>::max()) + 1);
+    protobuf_index.set_checkpoint_id(checkpoint_id);
+    pending_checkpoint_id_ = checkpoint_id;
+    journal_records_ = 0;
+
     for (const auto& cache_metadata : index.ordered_cache_metadata()) {
       DCHECK(base::Contains(cache_name_to_cache_dir_, cache_metadata.name));
 
@@ -373,7 +454,9 @@ class LegacyCacheStorage::SimpleCacheLoader
         base::BindOnce(&SimpleCacheLoader::WriteIndexWriteToFileInPool,
                        tmp_path, index_path, serialized, quota_manager_proxy_,
                        origin_),
-        std::move(callback));
+        base::BindOnce(&SimpleCacheLoader::WriteIndexDidWrite,
+                       weak_ptr_factory_.GetWeakPtr(), checkpoint_id,
+                       std::move(callback)));
   }
 
   static bool WriteIndexWriteToFileInPool(
@@ -390,7 +473,116 @@ class LegacyCacheStorage::SimpleCacheLoader
     }
 
     // Atomically rename the temporary index file to become the real one.
-    return base::ReplaceFile(tmp_path, index_path, nullptr);
+    if (!base::ReplaceFile(tmp_path, index_path, nullptr))
+      return false;
+
+    // The new index includes everything in the journal. Records left behind
+    // if this fails are skipped, as they refer to an older checkpoint.
+    base::DeleteFile(index_path.DirName().AppendASCII(
+                         LegacyCacheStorage::kIndexJournalFileName),
+                     /* recursive */ false);
+    return true;
+  }
+
+  void WriteIndexDidWrite(int64_t checkpoint_id,
+                          BoolCallback callback,
+                          bool success) {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+    if (pending_checkpoint_id_ == checkpoint_id)
+      pending_checkpoint_id_ = 0;
+    if (success) {
+      checkpoint_id_ = checkpoint_id;
+    } else if (!pending_checkpoint_id_) {
+      // The index on disk is still at |checkpoint_id_|, and any records
+      // appended for |checkpoint_id| will not be replayed, so make the next
+      // write a checkpoint.
+      journal_records_ = kMaxIndexJournalRecords;
+    }
+    std::move(callback).Run(success);
+  }
+
+  // Returns the checkpoint that records appended now apply to: the index
+  // being written, if any, as appends are sequenced after the write.
+  int64_t GetJournalCheckpointId() const {
+    return pending_checkpoint_id_ ? pending_checkpoint_id_ : checkpoint_id_;
+  }
+
+  void WriteIndexChanges(const CacheStorageIndex& index,
+                         const std::set<std::string>& cache_names,
+                         BoolCallback callback) override {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+
+    // Rewrite the index if it was written before the journal existed, or if
+    // replaying the journal would start to cost more than reading the index.
+    const int64_t checkpoint_id = GetJournalCheckpointId();
+    if (!checkpoint_id ||
+        journal_records_ + cache_names.size() > kMaxIndexJournalRecords) {
+      WriteIndex(index, std::move(callback));
+      return;
+    }
+
+    std::string records;
+    for (const std::string& cache_name : cache_names) {
+      const CacheStorageIndex::CacheMetadata* cache_metadata =
+          index.GetMetadata(cache_name);
+      if (!cache_metadata)
+        continue;
+
+      proto::CacheStorageIndexJournalRecord record;
+      record.set_checkpoint_id(checkpoint_id);
+      record.set_name(cache_name);
+      if (cache_metadata->size != LegacyCacheStorage::kSizeUnknown)
+        record.set_size(cache_metadata->size);
+      record.set_padding(cache_metadata->padding);
+      record.set_padding_version(
+          LegacyCacheStorageCache::GetResponsePaddingVersion());
+
+      std::string serialized;
+      bool success = record.SerializeToString(&serialized);
+      DCHECK(success);
+      AppendIndexJournalRecord(serialized, &records);
+      ++journal_records_;
+    }
+
+    if (records.empty()) {
+      std::move(callback).Run(true);
+      return;
+    }
+
+    PostTaskAndReplyWithResult(
+        cache_task_runner_.get(), FROM_HERE,
+        base::BindOnce(&SimpleCacheLoader::AppendToIndexJournalInPool,
+                       origin_path_.AppendASCII(
+                           LegacyCacheStorage::kIndexJournalFileName),
+                       records, quota_manager_proxy_, origin_),
+        base::BindOnce(&SimpleCacheLoader::WriteIndexChangesDidAppend,
+                       weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+  }
+
+  static bool AppendToIndexJournalInPool(
+      const base::FilePath& journal_path,
+      const std::string& records,
+      scoped_refptr<storage::QuotaManagerProxy> quota_manager_proxy,
+      const url::Origin& origin) {
+    base::File file(journal_path,
+                    base::File::FLAG_OPEN_ALWAYS | base::File::FLAG_APPEND);
+    if (!file.IsValid() ||
+        file.WriteAtCurrentPos(records.data(),
+                               base::checked_cast<int>(records.size())) !=
+            base::checked_cast<int>(records.size())) {
+      quota_manager_proxy->NotifyWriteFailed(origin);
+      return false;
+    }
+    return true;
+  }
+
+  void WriteIndexChangesDidAppend(BoolCallback callback, bool success) {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+    // A partially written record hides the records appended after it, so
+    // make the next write a checkpoint.
+    if (!success)
+      journal_records_ = kMaxIndexJournalRecords;
+    std::move(callback).Run(success);
   }
 
   void LoadIndex(CacheStorageIndexLoadCallback callback) override {
@@ -408,6 +600,11 @@ class LegacyCacheStorage::SimpleCacheLoader
                              proto::CacheStorageIndex protobuf_index) {
     DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
 
+    // Any journal was folded into the index as it was read.
+    checkpoint_id_ = protobuf_index.checkpoint_id();
+    pending_checkpoint_id_ = 0;
+    journal_records_ = 0;
+
     std::unique_ptr<std::set<std::string>> cache_dirs(
         new std::set<std::string>);
 
@@ -443,12 +640,25 @@ class LegacyCacheStorage::SimpleCacheLoader
       cache_dirs->insert(cache.cache_dir());
     }
 
-    cache_task_runner_->PostTask(
-        FROM_HERE, base::BindOnce(&DeleteUnreferencedCachesInPool, origin_path_,
-                                  std::move(cache_dirs)));
+    PostTaskAndReplyWithResult(
+        cache_task_runner_.get(), FROM_HERE,
+        base::BindOnce(&DeleteUnreferencedCachesInPool, origin_path_,
+                       std::move(cache_dirs)),
+        base::BindOnce(&SimpleCacheLoader::DeleteUnreferencedCachesDidDelete,
+                       weak_ptr_factory_.GetWeakPtr()));
     std::move(callback).Run(std::move(index));
   }
 
+  void DeleteUnreferencedCachesDidDelete(
+      const std::set<std::string>& deleted_cache_dirs) {
+    if (body_store_)
+      body_store_->ReleaseBodiesOfCaches(deleted_cache_dirs);
+  }
+
+  LegacyCacheStorageBodyStore* body_store() override {
+    return body_store_.get();
+  }
+
   void NotifyCacheDoomed(CacheStorageCacheHandle cache_handle) override {
     auto* impl = LegacyCacheStorageCache::From(cache_handle);
     DCHECK(base::Contains(cache_name_to_cache_dir_, impl->cache_name()));
@@ -462,8 +672,9 @@ class LegacyCacheStorage::SimpleCacheLoader
   ~SimpleCacheLoader() override {}
 
   // Iterates over the caches and deletes any directory not found in
-  // |cache_dirs|. Runs on cache_task_runner_
-  static void DeleteUnreferencedCachesInPool(
+  // |cache_dirs|, other than the shared body store. Returns the names of the
+  // deleted directories. Runs on cache_task_runner_
+  static std::set<std::string> DeleteUnreferencedCachesInPool(
       const base::FilePath& cache_base_dir,
       std::unique_ptr<std::set<std::string>> cache_dirs) {
     base::FileEnumerator file_enum(cache_base_dir, false /* recursive */,
@@ -472,13 +683,71 @@ class LegacyCacheStorage::SimpleCacheLoader
     {
       base::FilePath cache_path;
       while (!(cache_path = file_enum.Next()).empty()) {
-        if (!base::Contains(*cache_dirs, cache_path.BaseName().AsUTF8Unsafe()))
+        const std::string cache_dir = cache_path.BaseName().AsUTF8Unsafe();
+        if (!base::Contains(*cache_dirs, cache_dir) &&
+            cache_dir != LegacyCacheStorageBodyStore::kDirName) {
           dirs_to_delete.push_back(cache_path);
+        }
       }
     }
 
-    for (const base::FilePath& cache_path : dirs_to_delete)
+    std::set<std::string> deleted_cache_dirs;
+    for (const base::FilePath& cache_path : dirs_to_delete) {
       base::DeleteFileRecursively(cache_path);
+      deleted_cache_dirs.insert(cache_path.BaseName().AsUTF8Unsafe());
+    }
+    return deleted_cache_dirs;
+  }
+
+  // Applies the records in |journal| that refer to the checkpoint of |index|,
+  // in the order they were appended. Returns false if the journal ends with a
+  // torn or corrupt record, which is not applied, nor anything after it, or
+  // if it has records for another checkpoint, which are skipped. Either way
+  // the journal may be missing updates, so its mtime says nothing about how
+  // recent the index is.
+  // Runs on cache_task_runner_
+  static bool ReplayIndexJournalInPool(base::StringPiece journal,
+                                       proto::CacheStorageIndex* index) {
+    bool all_records_applied = true;
+    while (!journal.empty()) {
+      if (journal.size() < kIndexJournalRecordHeaderSize)
+        return false;
+      uint32_t record_size;
+      uint32_t record_hash;
+      base::ReadBigEndian(journal.data(), &record_size);
+      base::ReadBigEndian(journal.data() + sizeof(uint32_t), &record_hash);
+      journal.remove_prefix(kIndexJournalRecordHeaderSize);
+      if (journal.size() < record_size)
+        return false;
+      base::StringPiece serialized = journal.substr(0, record_size);
+      journal.remove_prefix(record_size);
+
+      proto::CacheStorageIndexJournalRecord record;
+      if (base::PersistentHash(serialized.data(), serialized.size()) !=
+              record_hash ||
+          !record.ParseFromArray(serialized.data(),
+                                 base::checked_cast<int>(serialized.size()))) {
+        return false;
+      }
+      if (record.checkpoint_id() != index->checkpoint_id()) {
+        all_records_applied = false;
+        continue;
+      }
+
+      for (int i = 0, max = index->cache_size(); i < max; ++i) {
+        proto::CacheStorageIndex::Cache* cache = index->mutable_cache(i);
+        if (cache->name() != record.name())
+          continue;
+        if (record.has_size())
+          cache->set_size(record.size());
+        else
+          cache->clear_size();
+        cache->set_padding(record.padding());
+        cache->set_padding_version(record.padding_version());
+        break;
+      }
+    }
+    return all_records_applied;
   }
 
   // Runs on cache_task_runner_
@@ -489,6 +758,9 @@ class LegacyCacheStorage::SimpleCacheLoader
     const base::FilePath index_path =
         origin_path.AppendASCII(LegacyCacheStorage::kIndexFileName);
 
+    const base::FilePath journal_path =
+        origin_path.AppendASCII(LegacyCacheStorage::kIndexJournalFileName);
+
     proto::CacheStorageIndex index;
     std::string body;
     if (!base::ReadFileToString(index_path, &body) ||
@@ -502,6 +774,20 @@ class LegacyCacheStorage::SimpleCacheLoader
       index_last_modified = file_info.last_modified;
     bool index_modified = false;
 
+    // Apply the size updates appended since the index was written, and fold
+    // them into the index file below. Only a journal replayed in full is as
+    // recent as its modification time; otherwise sizes of caches modified
+    // since the index was written are recomputed.
+    if (base::ReadFileToString(journal_path, &body)) {
+      if (ReplayIndexJournalInPool(body, &index) &&
+          GetFileInfo(journal_path, &file_info) &&
+          index_last_modified < file_info.last_modified) {
+        index_last_modified = file_info.last_modified;
+      }
+      index_modified = true;
+      body.clear();
+    }
+
     // Look for caches that have no cache_dir. Give any such caches a directory
     // with a random name and move them there. Then, rewrite the index file.
     // Additionally invalidate the size of any index entries where the cache was
@@ -559,6 +845,19 @@ class LegacyCacheStorage::SimpleCacheLoader
   std::map<std::string, std::string> cache_name_to_cache_dir_;
   std::map<CacheStorageCache*, std::string> doomed_cache_to_path_;
 
+  // Owned jointly with the caches, and the blobs reading shared bodies.
+  scoped_refptr<LegacyCacheStorageBodyStore> body_store_;
+
+  // The version of the index file on disk, or 0 if the index file has no
+  // version yet.
+  int64_t checkpoint_id_ = 0;
+  // The version of the index file being written, or 0 if no write is in
+  // flight.
+  int64_t pending_checkpoint_id_ = 0;
+  // The number of records appended to the journal since the index was
+  // written.
+  size_t journal_records_ = 0;
+
   SEQUENCE_CHECKER(sequence_checker_);
   base::WeakPtrFactory<SimpleCacheLoader> weak_ptr_factory_{this};
 };
@@ -843,31 +1142,44 @@ void LegacyCacheStorage::ScheduleWriteIndex() {
   int64_t delay_ms = app_on_background_ ? kWriteIndexBackgroundDelayMilliseconds
                                         : kWriteIndexDelayMilliseconds;
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
-  index_write_task_.Reset(base::BindOnce(&LegacyCacheStorage::WriteIndex,
-                                         weak_factory_.GetWeakPtr(),
-                                         base::DoNothing::Once<bool>()));
+  index_write_task_.Reset(base::BindOnce(
+      &LegacyCacheStorage::WriteIndex, weak_factory_.GetWeakPtr(),
+      /* checkpoint = */ false, base::DoNothing::Once<bool>()));
   base::SequencedTaskRunnerHandle::Get()->PostDelayedTask(
       FROM_HERE, index_write_task_.callback(),
       base::TimeDelta::FromMilliseconds(delay_ms));
 }
 
-void LegacyCacheStorage::WriteIndex(base::OnceCallback<void(bool)> callback) {
+void LegacyCacheStorage::WriteIndex(bool checkpoint,
+                                    base::OnceCallback<void(bool)> callback) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   auto id = scheduler_->CreateId();
+  // The index is serialized as soon as the operation starts, and the writes
+  // to disk are sequenced, so only the operations changing the index need to
+  // be excluded.
   scheduler_->ScheduleOperation(
-      id, CacheStorageSchedulerMode::kExclusive,
+      id, CacheStorageSchedulerMode::kShared,
       CacheStorageSchedulerOp::kWriteIndex,
       CacheStorageSchedulerPriority::kNormal,
       base::BindOnce(
           &LegacyCacheStorage::WriteIndexImpl, weak_factory_.GetWeakPtr(),
+          checkpoint,
           scheduler_->WrapCallbackToRunNext(id, std::move(callback))));
 }
 
 void LegacyCacheStorage::WriteIndexImpl(
+    bool checkpoint,
     base::OnceCallback<void(bool)> callback) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
-  DCHECK(scheduler_->IsRunningExclusiveOperation());
-  cache_loader_->WriteIndex(*cache_index_, std::move(callback));
+  DCHECK(!scheduler_->IsRunningExclusiveOperation());
+  std::set<std::string> cache_names;
+  cache_names.swap(caches_with_unwritten_sizes_);
+  if (checkpoint) {
+    cache_loader_->WriteIndex(*cache_index_, std::move(callback));
+    return;
+  }
+  cache_loader_->WriteIndexChanges(*cache_index_, cache_names,
+                                   std::move(callback));
 }
 
 bool LegacyCacheStorage::InitiateScheduledIndexWriteForTest(
@@ -875,7 +1187,19 @@ bool LegacyCacheStorage::InitiateScheduledIndexWriteForTest(
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   if (index_write_pending()) {
     index_write_task_.Cancel();
-    WriteIndex(std::move(callback));
+    WriteIndex(/* checkpoint = */ true, std::move(callback));
+    return true;
+  }
+  std::move(callback).Run(true /* success */);
+  return false;
+}
+
+bool LegacyCacheStorage::InitiateScheduledIndexJournalWriteForTest(
+    base::OnceCallback<void(bool)> callback) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (index_write_pending()) {
+    index_write_task_.Cancel();
+    WriteIndex(/* checkpoint = */ false, std::move(callback));
     return true;
   }
   std::move(callback).Run(true /* success */);
@@ -892,8 +1216,10 @@ void LegacyCacheStorage::CacheSizeUpdated(
       cache_index_->SetCacheSize(cache->cache_name(), cache->cache_size());
   bool padding_changed = cache_index_->SetCachePadding(cache->cache_name(),
                                                        cache->cache_padding());
-  if (size_changed || padding_changed)
+  if (size_changed || padding_changed) {
+    caches_with_unwritten_sizes_.insert(cache->cache_name());
     ScheduleWriteIndex();
+  }
 }
 
 void LegacyCacheStorage::ReleaseUnreferencedCaches() {
@@ -1047,6 +1373,7 @@ void LegacyCacheStorage::CreateCacheDidCreateCache(
 
   CacheStorageCacheHandle handle = cache_ptr->CreateHandle();
   index_write_task_.Cancel();
+  caches_with_unwritten_sizes_.clear();
   cache_loader_->WriteIndex(
       *cache_index_,
       base::BindOnce(&LegacyCacheStorage::CreateCacheDidWriteIndex,
@@ -1106,6 +1433,7 @@ void LegacyCacheStorage::DoomCacheImpl(const std::string& cache_name,
   LegacyCacheStorageCache::From(cache_handle)->SetObserver(nullptr);
   cache_index_->DoomCache(cache_name);
   index_write_task_.Cancel();
+  caches_with_unwritten_sizes_.clear();
   cache_loader_->WriteIndex(
       *cache_index_,
       base::BindOnce(&LegacyCacheStorage::DeleteCacheDidWriteIndex,
@@ -1374,6 +1702,13 @@ void LegacyCacheStorage::GetSizeThenCloseAllCachesImpl(SizeCallback callback) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   DCHECK(initialized_);
 
+  // The body store is closed last, as the caches may still be using it.
+  if (LegacyCacheStorageBodyStore* body_store = cache_loader_->body_store()) {
+    callback = base::BindOnce(&AddSharedBodiesSize,
+                              base::WrapRefCounted(body_store),
+                              true /* close */, std::move(callback));
+  }
+
   std::unique_ptr<int64_t> accumulator(new int64_t(0));
   int64_t* accumulator_ptr = accumulator.get();
 
@@ -1403,6 +1738,12 @@ void LegacyCacheStorage::SizeImpl(SizeCallback callback) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   DCHECK(initialized_);
 
+  if (LegacyCacheStorageBodyStore* body_store = cache_loader_->body_store()) {
+    callback = base::BindOnce(&AddSharedBodiesSize,
+                              base::WrapRefCounted(body_store),
+                              false /* close */, std::move(callback));
+  }
+
   if (cache_index_->GetPaddedStorageSize() != kSizeUnknown) {
     base::SequencedTaskRunnerHandle::Get()->PostTask(
         FROM_HERE, base::BindOnce(std::move(callback),
@@ -1437,6 +1778,7 @@ void LegacyCacheStorage::FlushIndexIfDirty() {
   if (!index_write_pending())
     return;
   index_write_task_.Cancel();
+  caches_with_unwritten_sizes_.clear();
   cache_loader_->WriteIndex(*cache_index_, base::DoNothing::Once<bool>());
 }
 
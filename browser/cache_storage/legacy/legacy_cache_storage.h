@@ -8,6 +8,8 @@
 #include <stdint.h>
 
 #include <map>
+#include <set>
+#include <string>
 
 #include "base/files/file_path.h"
 #include "base/gtest_prod_util.h"
@@ -55,6 +57,8 @@ class CONTENT_EXPORT LegacyCacheStorage : public CacheStorage,
   using SizeCallback = base::OnceCallback<void(int64_t)>;
 
   static const char kIndexFileName[];
+  // Size updates are appended here between full writes of the index file.
+  static const char kIndexJournalFileName[];
 
   LegacyCacheStorage(
       const base::FilePath& origin_path,
@@ -265,14 +269,21 @@ class CONTENT_EXPORT LegacyCacheStorage : public CacheStorage,
 
   void NotifyCacheContentChanged(const std::string& cache_name);
 
+  // Scheduled writes only record the caches whose size changed, appending to
+  // the index journal. Checkpoints rewrite the whole index file.
   void ScheduleWriteIndex();
-  void WriteIndex(base::OnceCallback<void(bool)> callback);
-  void WriteIndexImpl(base::OnceCallback<void(bool)> callback);
+  void WriteIndex(bool checkpoint, base::OnceCallback<void(bool)> callback);
+  void WriteIndexImpl(bool checkpoint,
+                      base::OnceCallback<void(bool)> callback);
   bool index_write_pending() const { return !index_write_task_.IsCancelled(); }
-  // Start a scheduled index write immediately. Returns true if a write was
-  // scheduled, or false if not.
+  // Start a scheduled index write immediately, as a checkpoint. Returns true
+  // if a write was scheduled, or false if not.
   bool InitiateScheduledIndexWriteForTest(
       base::OnceCallback<void(bool)> callback);
+  // As above, but writes the scheduled changes the way the scheduled task
+  // would.
+  bool InitiateScheduledIndexJournalWriteForTest(
+      base::OnceCallback<void(bool)> callback);
 
   void FlushIndexIfDirty();
 
@@ -326,6 +337,8 @@ class CONTENT_EXPORT LegacyCacheStorage : public CacheStorage,
   LegacyCacheStorageManager* cache_storage_manager_;
 
   base::CancelableOnceClosure index_write_task_;
+  // The caches whose size or padding changed since the index was last written.
+  std::set<std::string> caches_with_unwritten_sizes_;
   size_t handle_ref_count_ = 0;
 
 #if defined(OS_ANDROID)
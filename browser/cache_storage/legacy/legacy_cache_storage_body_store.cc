@@ -0,0 +1,857 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_body_store.h"
+
+#include <limits>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/callback_helpers.h"
+#include "base/files/file_enumerator.h"
+#include "base/files/file_util.h"
+#include "base/stl_util.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/task_runner_util.h"
+#include "base/threading/sequenced_task_runner_handle.h"
+#include "content/browser/cache_storage/cache_storage.pb.h"
+#include "content/browser/cache_storage/cache_storage_cache.h"
+#include "content/browser/cache_storage/cache_storage_quota_client.h"
+#include "content/browser/cache_storage/cache_storage_scheduler.h"
+#include "crypto/secure_hash.h"
+#include "crypto/sha2.h"
+#include "mojo/public/cpp/bindings/remote.h"
+#include "mojo/public/cpp/system/data_pipe_drainer.h"
+#include "net/base/completion_repeating_callback.h"
+#include "net/base/io_buffer.h"
+#include "net/base/net_errors.h"
+#include "services/network/public/mojom/fetch_api.mojom.h"
+#include "storage/browser/quota/quota_manager_proxy.h"
+#include "third_party/blink/public/common/blob/blob_utils.h"
+#include "third_party/blink/public/mojom/quota/quota_types.mojom.h"
+
+namespace content {
+
+const base::Feature kCacheStorageSharedBodies{
+    "CacheStorageSharedBodies", base::FEATURE_DISABLED_BY_DEFAULT};
+const base::FeatureParam<int> kCacheStorageSharedBodiesMinSize{
+    &kCacheStorageSharedBodies, "min_size", 16 * 1024};
+
+// static
+const char LegacyCacheStorageBodyStore::kDirName[] = "shared_bodies";
+
+// Reads a blob through to compute the key of its body.
+class LegacyCacheStorageBodyStore::BodyHasher
+    : public mojo::DataPipeDrainer::Client {
+ public:
+  BodyHasher(mojo::PendingRemote<blink::mojom::Blob> blob, uint64_t blob_size)
+      : blob_(std::move(blob)),
+        blob_size_(blob_size),
+        hash_(crypto::SecureHash::Create(crypto::SecureHash::SHA256)) {}
+
+  // Runs |callback| with the key, or an empty string if the blob could not
+  // be read in full. |callback| may delete this.
+  void Start(KeyCallback callback) {
+    callback_ = std::move(callback);
+
+    MojoCreateDataPipeOptions options;
+    options.struct_size = sizeof(MojoCreateDataPipeOptions);
+    options.flags = MOJO_CREATE_DATA_PIPE_FLAG_NONE;
+    options.element_num_bytes = 1;
+    options.capacity_num_bytes =
+        blink::BlobUtils::GetDataPipeCapacity(blob_size_);
+
+    mojo::ScopedDataPipeProducerHandle producer_handle;
+    mojo::ScopedDataPipeConsumerHandle consumer_handle;
+    if (mojo::CreateDataPipe(&options, &producer_handle, &consumer_handle) !=
+        MOJO_RESULT_OK) {
+      std::move(callback_).Run(std::string());
+      return;
+    }
+
+    blob_->ReadAll(std::move(producer_handle), mojo::NullRemote());
+    drainer_ = std::make_unique<mojo::DataPipeDrainer>(
+        this, std::move(consumer_handle));
+  }
+
+  // mojo::DataPipeDrainer::Client:
+  void OnDataAvailable(const void* data, size_t num_bytes) override {
+    hash_->Update(data, num_bytes);
+    bytes_read_ += num_bytes;
+  }
+
+  void OnDataComplete() override {
+    // The pipe is also closed if reading the blob fails part way.
+    if (bytes_read_ != blob_size_) {
+      std::move(callback_).Run(std::string());
+      return;
+    }
+    uint8_t digest[crypto::kSHA256Length];
+    hash_->Finish(digest, sizeof(digest));
+    std::move(callback_).Run(base::HexEncode(digest, sizeof(digest)));
+  }
+
+ private:
+  mojo::Remote<blink::mojom::Blob> blob_;
+  const uint64_t blob_size_;
+  uint64_t bytes_read_ = 0;
+  std::unique_ptr<crypto::SecureHash> hash_;
+  std::unique_ptr<mojo::DataPipeDrainer> drainer_;
+  KeyCallback callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(BodyHasher);
+};
+
+struct LegacyCacheStorageBodyStore::PutBodyContext {
+  PutBodyContext(const std::string& referrer,
+                 uint64_t blob_size,
+                 KeyCallback callback)
+      : referrer(referrer),
+        blob_size(blob_size),
+        callback(std::move(callback)) {}
+
+  const std::string referrer;
+  mojo::PendingRemote<blink::mojom::Blob> blob;
+  const uint64_t blob_size;
+  KeyCallback callback;
+
+  // Provided while storing the body.
+  std::string key;
+  ScopedWritableEntry entry;
+  std::unique_ptr<proto::CacheStorageSharedBody> referrers;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(PutBodyContext);
+};
+
+struct LegacyCacheStorageBodyStore::ReleaseContext {
+  ReleaseContext() = default;
+
+  // Set to release |referrer| from the body with |key| only.
+  std::string key;
+  std::string referrer;
+  bool opened_key = false;
+
+  // Otherwise, every body is visited to release the referrers of the caches
+  // in |cache_dirs|, or if |sweep| is set, of every cache not in it.
+  std::set<std::string> cache_dirs;
+  bool sweep = false;
+  std::unique_ptr<disk_cache::Backend::Iterator> iterator;
+
+  base::OnceClosure callback;
+  // The entry whose referrers are being written.
+  disk_cache::ScopedEntryPtr entry;
+  bool modified = false;
+
+  // Returns true if |body_referrer| is to be released.
+  bool Releases(const std::string& body_referrer) const {
+    if (!key.empty())
+      return body_referrer == referrer;
+    const std::string cache_dir =
+        body_referrer.substr(0, body_referrer.find(' '));
+    return base::Contains(cache_dirs, cache_dir) != sweep;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ReleaseContext);
+};
+
+LegacyCacheStorageBodyStore::LegacyCacheStorageBodyStore(
+    const base::FilePath& path,
+    const url::Origin& origin,
+    CacheStorageOwner owner,
+    scoped_refptr<base::SequencedTaskRunner> cache_task_runner,
+    scoped_refptr<base::SequencedTaskRunner> scheduler_task_runner,
+    scoped_refptr<storage::QuotaManagerProxy> quota_manager_proxy)
+    : path_(path),
+      origin_(origin),
+      owner_(owner),
+      cache_task_runner_(std::move(cache_task_runner)),
+      quota_manager_proxy_(std::move(quota_manager_proxy)),
+      scheduler_(std::make_unique<CacheStorageScheduler>(
+          CacheStorageSchedulerClient::kBodyStore,
+          std::move(scheduler_task_runner))) {}
+
+LegacyCacheStorageBodyStore::~LegacyCacheStorageBodyStore() = default;
+
+// static
+bool LegacyCacheStorageBodyStore::ShouldShareBody(
+    const blink::mojom::FetchAPIResponse& response,
+    uint64_t body_size) {
+  if (!base::FeatureList::IsEnabled(kCacheStorageSharedBodies))
+    return false;
+  if (response.response_type == network::mojom::FetchResponseType::kOpaque ||
+      response.response_type ==
+          network::mojom::FetchResponseType::kOpaqueRedirect) {
+    return false;
+  }
+  return body_size >=
+         static_cast<uint64_t>(kCacheStorageSharedBodiesMinSize.Get());
+}
+
+// static
+std::string LegacyCacheStorageBodyStore::GetReferrer(
+    const base::FilePath& cache_path,
+    const std::string& entry_key) {
+  return cache_path.BaseName().AsUTF8Unsafe() + " " + entry_key;
+}
+
+// static
+std::set<std::string> LegacyCacheStorageBodyStore::ListCacheDirsInPool(
+    const base::FilePath& origin_path) {
+  std::set<std::string> cache_dirs;
+  base::FileEnumerator file_enum(origin_path, false /* recursive */,
+                                 base::FileEnumerator::DIRECTORIES);
+  for (base::FilePath path = file_enum.Next(); !path.empty();
+       path = file_enum.Next()) {
+    cache_dirs.insert(path.BaseName().AsUTF8Unsafe());
+  }
+  return cache_dirs;
+}
+
+void LegacyCacheStorageBodyStore::PutBody(
+    const std::string& referrer,
+    mojo::PendingRemote<blink::mojom::Blob> blob,
+    uint64_t blob_size,
+    KeyCallback callback) {
+  auto context = std::make_unique<PutBodyContext>(referrer, blob_size,
+                                                  std::move(callback));
+
+  // The body is read twice: once here to find its key, and then again to
+  // write it if no body with that key is stored yet.
+  mojo::Remote<blink::mojom::Blob> blob_remote(std::move(blob));
+  blob_remote->Clone(context->blob.InitWithNewPipeAndPassReceiver());
+
+  auto hasher =
+      std::make_unique<BodyHasher>(blob_remote.Unbind(), context->blob_size);
+  BodyHasher* hasher_raw = hasher.get();
+  BodyHasherIDMap::KeyType hasher_id =
+      active_body_hashers_.Add(std::move(hasher));
+  hasher_raw->Start(base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyDidHash,
+                                   weak_ptr_factory_.GetWeakPtr(), hasher_id,
+                                   std::move(context)));
+}
+
+void LegacyCacheStorageBodyStore::OpenBody(const std::string& key,
+                                           EntryCallback callback) {
+  InitIfNeeded();
+  auto id = scheduler_->CreateId();
+  scheduler_->ScheduleOperationOnKey(
+      id, CacheStorageSchedulerMode::kShared, CacheStorageSchedulerOp::kMatch,
+      CacheStorageSchedulerPriority::kNormal, key,
+      base::BindOnce(
+          &LegacyCacheStorageBodyStore::OpenBodyImpl,
+          weak_ptr_factory_.GetWeakPtr(), key,
+          scheduler_->WrapCallbackToRunNext(id, std::move(callback))));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseBody(const std::string& key,
+                                              const std::string& referrer) {
+  InitIfNeeded();
+  auto context = std::make_unique<ReleaseContext>();
+  context->key = key;
+  context->referrer = referrer;
+  auto id = scheduler_->CreateId();
+  context->callback =
+      scheduler_->WrapCallbackToRunNext(id, base::DoNothing::Once());
+  scheduler_->ScheduleOperationOnKey(
+      id, CacheStorageSchedulerMode::kExclusive,
+      CacheStorageSchedulerOp::kDelete, CacheStorageSchedulerPriority::kNormal,
+      key,
+      base::BindOnce(&LegacyCacheStorageBodyStore::ReleaseImpl,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseBodiesOfCaches(
+    const std::set<std::string>& cache_dirs) {
+  if (cache_dirs.empty())
+    return;
+  InitIfNeeded();
+  auto context = std::make_unique<ReleaseContext>();
+  context->cache_dirs = cache_dirs;
+  auto id = scheduler_->CreateId();
+  context->callback =
+      scheduler_->WrapCallbackToRunNext(id, base::DoNothing::Once());
+  scheduler_->ScheduleOperation(
+      id, CacheStorageSchedulerMode::kExclusive,
+      CacheStorageSchedulerOp::kDelete, CacheStorageSchedulerPriority::kNormal,
+      base::BindOnce(&LegacyCacheStorageBodyStore::ReleaseImpl,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+}
+
+void LegacyCacheStorageBodyStore::Size(SizeCallback callback) {
+  InitIfNeeded();
+  auto id = scheduler_->CreateId();
+  scheduler_->ScheduleOperation(
+      id, CacheStorageSchedulerMode::kShared, CacheStorageSchedulerOp::kSize,
+      CacheStorageSchedulerPriority::kNormal,
+      base::BindOnce(
+          &LegacyCacheStorageBodyStore::SizeImpl,
+          weak_ptr_factory_.GetWeakPtr(),
+          scheduler_->WrapCallbackToRunNext(id, std::move(callback))));
+}
+
+void LegacyCacheStorageBodyStore::GetSizeThenClose(SizeCallback callback) {
+  InitIfNeeded();
+  auto id = scheduler_->CreateId();
+  scheduler_->ScheduleOperation(
+      id, CacheStorageSchedulerMode::kExclusive,
+      CacheStorageSchedulerOp::kSizeThenClose,
+      CacheStorageSchedulerPriority::kNormal,
+      base::BindOnce(
+          &LegacyCacheStorageBodyStore::GetSizeThenCloseImpl,
+          weak_ptr_factory_.GetWeakPtr(),
+          scheduler_->WrapCallbackToRunNext(id, std::move(callback))));
+}
+
+void LegacyCacheStorageBodyStore::InitIfNeeded() {
+  if (init_scheduled_)
+    return;
+  init_scheduled_ = true;
+
+  auto id = scheduler_->CreateId();
+  scheduler_->ScheduleOperation(
+      id, CacheStorageSchedulerMode::kExclusive, CacheStorageSchedulerOp::kInit,
+      CacheStorageSchedulerPriority::kNormal,
+      base::BindOnce(
+          &LegacyCacheStorageBodyStore::InitImpl,
+          weak_ptr_factory_.GetWeakPtr(),
+          scheduler_->WrapCallbackToRunNext(id, base::DoNothing::Once())));
+}
+
+void LegacyCacheStorageBodyStore::InitImpl(base::OnceClosure callback) {
+  DCHECK_EQ(BACKEND_UNINITIALIZED, backend_state_);
+  PostTaskAndReplyWithResult(
+      cache_task_runner_.get(), FROM_HERE,
+      base::BindOnce(&base::DirectoryExists, path_),
+      base::BindOnce(&LegacyCacheStorageBodyStore::InitDidCheckPath,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+}
+
+void LegacyCacheStorageBodyStore::InitDidCheckPath(base::OnceClosure callback,
+                                                   bool exists) {
+  if (!exists) {
+    backend_state_ = BACKEND_ABSENT;
+    std::move(callback).Run();
+    return;
+  }
+  CreateBackend(base::BindOnce(
+      &LegacyCacheStorageBodyStore::InitDidCreateBackend,
+      weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+}
+
+void LegacyCacheStorageBodyStore::InitDidCreateBackend(
+    base::OnceClosure callback,
+    bool success) {
+  // Without the backend the stored bodies cannot be read, and the caches
+  // treat the entries using them as corrupt.
+  if (!success) {
+    backend_state_ = BACKEND_CLOSED;
+    std::move(callback).Run();
+    return;
+  }
+
+  // A crash between removing a cache directory and releasing its bodies
+  // leaves referrers that nothing will release. Sweep them before any other
+  // operation, so that those bodies stop counting towards the quota.
+  PostTaskAndReplyWithResult(
+      cache_task_runner_.get(), FROM_HERE,
+      base::BindOnce(&LegacyCacheStorageBodyStore::ListCacheDirsInPool,
+                     path_.DirName()),
+      base::BindOnce(&LegacyCacheStorageBodyStore::InitDidListCacheDirs,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+}
+
+void LegacyCacheStorageBodyStore::InitDidListCacheDirs(
+    base::OnceClosure callback,
+    std::set<std::string> cache_dirs) {
+  auto context = std::make_unique<ReleaseContext>();
+  context->cache_dirs = std::move(cache_dirs);
+  context->sweep = true;
+  context->callback = std::move(callback);
+  ReleaseImpl(std::move(context));
+}
+
+void LegacyCacheStorageBodyStore::CreateBackend(
+    base::OnceCallback<void(bool)> callback) {
+  DCHECK(!backend_);
+  DCHECK(scheduler_->IsRunningExclusiveOperation());
+
+  std::unique_ptr<ScopedBackendPtr> backend_ptr(new ScopedBackendPtr());
+
+  // Temporary pointer so that backend_ptr can be Pass()'d in Bind below.
+  ScopedBackendPtr* backend = backend_ptr.get();
+
+  // Create a callback that is copyable, even though it can only be called once.
+  // BindRepeating() cannot be used directly because |callback| and
+  // |backend_ptr| are not copyable.
+  net::CompletionRepeatingCallback create_cache_callback =
+      base::AdaptCallbackForRepeating(
+          base::BindOnce(&LegacyCacheStorageBodyStore::CreateBackendDidCreate,
+                         weak_ptr_factory_.GetWeakPtr(), std::move(callback),
+                         std::move(backend_ptr)));
+
+  // Use APP_CACHE as opposed to DISK_CACHE to prevent eviction, as the
+  // caches do. The size is controlled per-origin by the QuotaManager.
+  int rv = disk_cache::CreateCacheBackend(
+      net::APP_CACHE, net::CACHE_BACKEND_SIMPLE, path_,
+      std::numeric_limits<int64_t>::max(),
+      disk_cache::ResetHandling::kNeverReset, nullptr, backend,
+      base::OnceClosure(), create_cache_callback);
+  if (rv != net::ERR_IO_PENDING)
+    std::move(create_cache_callback).Run(rv);
+}
+
+void LegacyCacheStorageBodyStore::CreateBackendDidCreate(
+    base::OnceCallback<void(bool)> callback,
+    std::unique_ptr<ScopedBackendPtr> backend_ptr,
+    int rv) {
+  if (rv != net::OK) {
+    std::move(callback).Run(false);
+    return;
+  }
+
+  backend_ = std::move(*backend_ptr);
+  backend_state_ = BACKEND_OPEN;
+
+  net::Int64CompletionRepeatingCallback got_size_callback =
+      base::AdaptCallbackForRepeating(
+          base::BindOnce(&LegacyCacheStorageBodyStore::CreateBackendDidGetSize,
+                         weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+  int64_t size_rv = backend_->CalculateSizeOfAllEntries(got_size_callback);
+  if (size_rv != net::ERR_IO_PENDING)
+    std::move(got_size_callback).Run(size_rv);
+}
+
+void LegacyCacheStorageBodyStore::CreateBackendDidGetSize(
+    base::OnceCallback<void(bool)> callback,
+    int64_t size) {
+  // The quota manager already accounts for the bodies found on disk.
+  if (size > 0)
+    size_ = size;
+  std::move(callback).Run(true);
+}
+
+void LegacyCacheStorageBodyStore::PutBodyDidHash(
+    BodyHasherIDMap::KeyType hasher_id,
+    std::unique_ptr<PutBodyContext> context,
+    const std::string& key) {
+  // |key| is owned by the hasher.
+  context->key = key;
+  active_body_hashers_.Remove(hasher_id);
+
+  if (context->key.empty()) {
+    std::move(context->callback).Run(std::string());
+    return;
+  }
+
+  InitIfNeeded();
+  const std::string body_key = context->key;
+  auto id = scheduler_->CreateId();
+  context->callback =
+      scheduler_->WrapCallbackToRunNext(id, std::move(context->callback));
+  scheduler_->ScheduleOperationOnKey(
+      id, CacheStorageSchedulerMode::kExclusive, CacheStorageSchedulerOp::kPut,
+      CacheStorageSchedulerPriority::kNormal, body_key,
+      base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyImpl,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+}
+
+void LegacyCacheStorageBodyStore::PutBodyImpl(
+    std::unique_ptr<PutBodyContext> context) {
+  switch (backend_state_) {
+    case BACKEND_UNINITIALIZED:
+      NOTREACHED();
+      break;
+    case BACKEND_ABSENT:
+      CreateBackend(base::BindOnce(
+          &LegacyCacheStorageBodyStore::PutBodyDidCreateBackend,
+          weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+      return;
+    case BACKEND_OPEN:
+      PutBodyDidCreateBackend(std::move(context), true /* success */);
+      return;
+    case BACKEND_CLOSED:
+      break;
+  }
+  PutBodyComplete(std::move(context), false /* success */);
+}
+
+void LegacyCacheStorageBodyStore::PutBodyDidCreateBackend(
+    std::unique_ptr<PutBodyContext> context,
+    bool success) {
+  if (!success) {
+    PutBodyComplete(std::move(context), false /* success */);
+    return;
+  }
+
+  const std::string key = context->key;
+  auto open_entry_callback = base::AdaptCallbackForRepeating(
+      base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyDidOpenEntry,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+  disk_cache::EntryResult result =
+      backend_->OpenOrCreateEntry(key, net::MEDIUM, open_entry_callback);
+  if (result.net_error() != net::ERR_IO_PENDING)
+    std::move(open_entry_callback).Run(std::move(result));
+}
+
+void LegacyCacheStorageBodyStore::PutBodyDidOpenEntry(
+    std::unique_ptr<PutBodyContext> context,
+    disk_cache::EntryResult result) {
+  if (result.net_error() != net::OK) {
+    quota_manager_proxy_->NotifyWriteFailed(origin_);
+    PutBodyComplete(std::move(context), false /* success */);
+    return;
+  }
+
+  const bool opened = result.opened();
+  context->entry.reset(result.ReleaseEntry());
+
+  if (opened) {
+    // The body may already be stored.
+    disk_cache::Entry* entry = context->entry.get();
+    ReadReferrers(
+        entry,
+        base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyDidReadReferrers,
+                       weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+    return;
+  }
+
+  context->referrers = std::make_unique<proto::CacheStorageSharedBody>();
+  context->referrers->add_referrers(context->referrer);
+
+  auto blob_to_cache = std::make_unique<CacheStorageBlobToDiskCache>(
+      quota_manager_proxy_, origin_);
+  CacheStorageBlobToDiskCache* blob_to_cache_raw = blob_to_cache.get();
+  BlobToDiskCacheIDMap::KeyType blob_to_cache_key =
+      active_blob_to_disk_cache_writers_.Add(std::move(blob_to_cache));
+
+  ScopedWritableEntry entry = std::move(context->entry);
+  mojo::PendingRemote<blink::mojom::Blob> blob = std::move(context->blob);
+  const uint64_t blob_size = context->blob_size;
+  blob_to_cache_raw->StreamBlobToCache(
+      std::move(entry), CacheStorageCache::INDEX_RESPONSE_BODY, std::move(blob),
+      blob_size,
+      base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyDidWriteBody,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context),
+                     blob_to_cache_key));
+}
+
+void LegacyCacheStorageBodyStore::PutBodyDidReadReferrers(
+    std::unique_ptr<PutBodyContext> context,
+    std::unique_ptr<proto::CacheStorageSharedBody> referrers) {
+  if (!referrers ||
+      static_cast<uint64_t>(context->entry->GetDataSize(
+          CacheStorageCache::INDEX_RESPONSE_BODY)) != context->blob_size) {
+    // The stored body is corrupt. Doom it and store the body again.
+    context->entry.reset();
+    PutBodyCreateEntry(std::move(context));
+    return;
+  }
+
+  // Adding a referrer never invalidates the stored body, so it is kept even
+  // if writing the referrers fails.
+  context->entry.get_deleter().WritingCompleted();
+  context->blob.reset();
+  context->referrers = std::move(referrers);
+  if (!base::Contains(context->referrers->referrers(), context->referrer))
+    context->referrers->add_referrers(context->referrer);
+
+  disk_cache::Entry* entry = context->entry.get();
+  const proto::CacheStorageSharedBody& new_referrers = *context->referrers;
+  WriteReferrers(
+      entry, new_referrers,
+      base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyDidWriteReferrers,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+}
+
+void LegacyCacheStorageBodyStore::PutBodyCreateEntry(
+    std::unique_ptr<PutBodyContext> context) {
+  const std::string key = context->key;
+  auto create_entry_callback = base::AdaptCallbackForRepeating(
+      base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyDidOpenEntry,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+  disk_cache::EntryResult result =
+      backend_->CreateEntry(key, net::MEDIUM, create_entry_callback);
+  if (result.net_error() != net::ERR_IO_PENDING)
+    std::move(create_entry_callback).Run(std::move(result));
+}
+
+void LegacyCacheStorageBodyStore::PutBodyDidWriteBody(
+    std::unique_ptr<PutBodyContext> context,
+    BlobToDiskCacheIDMap::KeyType blob_to_cache_key,
+    ScopedWritableEntry entry,
+    bool success) {
+  active_blob_to_disk_cache_writers_.Remove(blob_to_cache_key);
+  context->entry = std::move(entry);
+
+  if (!success) {
+    PutBodyComplete(std::move(context), false /* success */);
+    return;
+  }
+
+  disk_cache::Entry* entry_ptr = context->entry.get();
+  const proto::CacheStorageSharedBody& referrers = *context->referrers;
+  WriteReferrers(
+      entry_ptr, referrers,
+      base::BindOnce(&LegacyCacheStorageBodyStore::PutBodyDidWriteReferrers,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+}
+
+void LegacyCacheStorageBodyStore::PutBodyDidWriteReferrers(
+    std::unique_ptr<PutBodyContext> context,
+    bool success) {
+  if (success)
+    context->entry.get_deleter().WritingCompleted();
+  PutBodyComplete(std::move(context), success);
+}
+
+void LegacyCacheStorageBodyStore::PutBodyComplete(
+    std::unique_ptr<PutBodyContext> context,
+    bool success) {
+  // Dooms a newly created entry unless it was written in full.
+  context->entry.reset();
+  UpdateSize(base::BindOnce(std::move(context->callback),
+                            success ? context->key : std::string()));
+}
+
+void LegacyCacheStorageBodyStore::OpenBodyImpl(const std::string& key,
+                                               EntryCallback callback) {
+  if (backend_state_ != BACKEND_OPEN) {
+    std::move(callback).Run(nullptr);
+    return;
+  }
+
+  auto open_entry_callback = base::AdaptCallbackForRepeating(
+      base::BindOnce(&LegacyCacheStorageBodyStore::OpenBodyDidOpenEntry,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+  disk_cache::EntryResult result =
+      backend_->OpenEntry(key, net::MEDIUM, open_entry_callback);
+  if (result.net_error() != net::ERR_IO_PENDING)
+    std::move(open_entry_callback).Run(std::move(result));
+}
+
+void LegacyCacheStorageBodyStore::OpenBodyDidOpenEntry(
+    EntryCallback callback,
+    disk_cache::EntryResult result) {
+  if (result.net_error() != net::OK) {
+    std::move(callback).Run(nullptr);
+    return;
+  }
+  std::move(callback).Run(disk_cache::ScopedEntryPtr(result.ReleaseEntry()));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseImpl(
+    std::unique_ptr<ReleaseContext> context) {
+  if (backend_state_ != BACKEND_OPEN) {
+    std::move(context->callback).Run();
+    return;
+  }
+  if (context->key.empty())
+    context->iterator = backend_->CreateIterator();
+  ReleaseOpenNextEntry(std::move(context));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseOpenNextEntry(
+    std::unique_ptr<ReleaseContext> context) {
+  if (!context->key.empty() && context->opened_key) {
+    ReleaseComplete(std::move(context));
+    return;
+  }
+
+  // Create a callback that is copyable, even though it can only be called once.
+  // BindRepeating() cannot be used directly because |context| is not
+  // copyable.
+  base::RepeatingCallback<void(disk_cache::EntryResult)> open_entry_callback;
+  disk_cache::EntryResult result;
+  if (!context->key.empty()) {
+    context->opened_key = true;
+    const std::string key = context->key;
+    open_entry_callback = base::AdaptCallbackForRepeating(
+        base::BindOnce(&LegacyCacheStorageBodyStore::ReleaseDidOpenEntry,
+                       weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+    result = backend_->OpenEntry(key, net::MEDIUM, open_entry_callback);
+  } else {
+    disk_cache::Backend::Iterator& iterator = *context->iterator;
+    open_entry_callback = base::AdaptCallbackForRepeating(
+        base::BindOnce(&LegacyCacheStorageBodyStore::ReleaseDidOpenEntry,
+                       weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+    result = iterator.OpenNextEntry(open_entry_callback);
+  }
+
+  if (result.net_error() == net::ERR_IO_PENDING)
+    return;
+
+  // Avoid recursing once per entry when the entries open synchronously.
+  base::SequencedTaskRunnerHandle::Get()->PostTask(
+      FROM_HERE,
+      base::BindOnce(std::move(open_entry_callback), std::move(result)));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseDidOpenEntry(
+    std::unique_ptr<ReleaseContext> context,
+    disk_cache::EntryResult result) {
+  // The body does not exist, or iteration is complete.
+  if (result.net_error() != net::OK) {
+    ReleaseComplete(std::move(context));
+    return;
+  }
+
+  disk_cache::ScopedEntryPtr entry(result.ReleaseEntry());
+  disk_cache::Entry* entry_ptr = entry.get();
+  ReadReferrers(
+      entry_ptr,
+      base::BindOnce(&LegacyCacheStorageBodyStore::ReleaseDidReadReferrers,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context),
+                     std::move(entry)));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseDidReadReferrers(
+    std::unique_ptr<ReleaseContext> context,
+    disk_cache::ScopedEntryPtr entry,
+    std::unique_ptr<proto::CacheStorageSharedBody> referrers) {
+  // A body whose referrers cannot be read is corrupt, and is deleted.
+  proto::CacheStorageSharedBody remaining;
+  if (referrers) {
+    for (const std::string& referrer : referrers->referrers()) {
+      if (!context->Releases(referrer))
+        remaining.add_referrers(referrer);
+    }
+    if (remaining.referrers_size() == referrers->referrers_size()) {
+      ReleaseOpenNextEntry(std::move(context));
+      return;
+    }
+  }
+
+  context->modified = true;
+  if (remaining.referrers_size() == 0) {
+    entry->Doom();
+    ReleaseOpenNextEntry(std::move(context));
+    return;
+  }
+
+  context->entry = std::move(entry);
+  disk_cache::Entry* entry_ptr = context->entry.get();
+  WriteReferrers(
+      entry_ptr, remaining,
+      base::BindOnce(&LegacyCacheStorageBodyStore::ReleaseDidWriteReferrers,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(context)));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseDidWriteReferrers(
+    std::unique_ptr<ReleaseContext> context,
+    bool success) {
+  // The referrers may now be torn, so the body can no longer be tracked.
+  if (!success)
+    context->entry->Doom();
+  context->entry.reset();
+  ReleaseOpenNextEntry(std::move(context));
+}
+
+void LegacyCacheStorageBodyStore::ReleaseComplete(
+    std::unique_ptr<ReleaseContext> context) {
+  context->iterator.reset();
+  if (!context->modified) {
+    std::move(context->callback).Run();
+    return;
+  }
+  UpdateSize(std::move(context->callback));
+}
+
+void LegacyCacheStorageBodyStore::SizeImpl(SizeCallback callback) {
+  std::move(callback).Run(size_);
+}
+
+void LegacyCacheStorageBodyStore::GetSizeThenCloseImpl(SizeCallback callback) {
+  backend_.reset();
+  backend_state_ = BACKEND_CLOSED;
+  std::move(callback).Run(size_);
+}
+
+void LegacyCacheStorageBodyStore::ReadReferrers(disk_cache::Entry* entry,
+                                                ReferrersCallback callback) {
+  DCHECK(entry);
+
+  scoped_refptr<net::IOBufferWithSize> buffer =
+      base::MakeRefCounted<net::IOBufferWithSize>(
+          entry->GetDataSize(CacheStorageCache::INDEX_HEADERS));
+
+  // Create a callback that is copyable, even though it can only be called once.
+  // BindRepeating() cannot be used directly because |callback| is not
+  // copyable.
+  net::CompletionRepeatingCallback read_callback =
+      base::AdaptCallbackForRepeating(base::BindOnce(
+          [](ReferrersCallback callback,
+             scoped_refptr<net::IOBufferWithSize> buffer, int rv) {
+            auto referrers = std::make_unique<proto::CacheStorageSharedBody>();
+            if (rv != buffer->size() ||
+                !referrers->ParseFromArray(buffer->data(), buffer->size())) {
+              referrers.reset();
+            }
+            std::move(callback).Run(std::move(referrers));
+          },
+          std::move(callback), buffer));
+
+  int rv = entry->ReadData(CacheStorageCache::INDEX_HEADERS, 0, buffer.get(),
+                           buffer->size(), read_callback);
+  if (rv != net::ERR_IO_PENDING)
+    std::move(read_callback).Run(rv);
+}
+
+void LegacyCacheStorageBodyStore::WriteReferrers(
+    disk_cache::Entry* entry,
+    const proto::CacheStorageSharedBody& referrers,
+    base::OnceCallback<void(bool)> callback) {
+  DCHECK(entry);
+
+  auto serialized = std::make_unique<std::string>();
+  if (!referrers.SerializeToString(serialized.get())) {
+    std::move(callback).Run(false);
+    return;
+  }
+  scoped_refptr<net::StringIOBuffer> buffer =
+      base::MakeRefCounted<net::StringIOBuffer>(std::move(serialized));
+
+  net::CompletionRepeatingCallback write_callback =
+      base::AdaptCallbackForRepeating(base::BindOnce(
+          [](base::OnceCallback<void(bool)> callback, int expected_bytes,
+             int rv) { std::move(callback).Run(rv == expected_bytes); },
+          std::move(callback), buffer->size()));
+
+  int rv = entry->WriteData(CacheStorageCache::INDEX_HEADERS, 0, buffer.get(),
+                            buffer->size(), write_callback,
+                            true /* truncate */);
+  if (rv != net::ERR_IO_PENDING)
+    std::move(write_callback).Run(rv);
+}
+
+void LegacyCacheStorageBodyStore::UpdateSize(base::OnceClosure callback) {
+  if (backend_state_ != BACKEND_OPEN) {
+    std::move(callback).Run();
+    return;
+  }
+
+  net::Int64CompletionRepeatingCallback got_size_callback =
+      base::AdaptCallbackForRepeating(
+          base::BindOnce(&LegacyCacheStorageBodyStore::UpdateSizeDidGetSize,
+                         weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+  int64_t rv = backend_->CalculateSizeOfAllEntries(got_size_callback);
+  if (rv != net::ERR_IO_PENDING)
+    std::move(got_size_callback).Run(rv);
+}
+
+void LegacyCacheStorageBodyStore::UpdateSizeDidGetSize(
+    base::OnceClosure callback,
+    int64_t size) {
+  if (size >= 0 && size != size_) {
+    quota_manager_proxy_->NotifyStorageModified(
+        CacheStorageQuotaClient::GetClientTypeFromOwner(owner_), origin_,
+        blink::mojom::StorageType::kTemporary, size - size_);
+    size_ = size;
+  }
+  std::move(callback).Run();
+}
+
+}  // namespace content
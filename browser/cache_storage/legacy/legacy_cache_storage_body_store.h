@@ -0,0 +1,251 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_CACHE_STORAGE_LEGACY_LEGACY_CACHE_STORAGE_BODY_STORE_H_
+#define CONTENT_BROWSER_CACHE_STORAGE_LEGACY_LEGACY_CACHE_STORAGE_BODY_STORE_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <set>
+#include <string>
+
+#include "base/callback.h"
+#include "base/containers/id_map.h"
+#include "base/feature_list.h"
+#include "base/files/file_path.h"
+#include "base/macros.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/weak_ptr.h"
+#include "base/metrics/field_trial_params.h"
+#include "base/sequenced_task_runner.h"
+#include "content/browser/cache_storage/cache_storage_blob_to_disk_cache.h"
+#include "content/browser/cache_storage/scoped_writable_entry.h"
+#include "content/common/content_export.h"
+#include "mojo/public/cpp/bindings/pending_remote.h"
+#include "net/disk_cache/disk_cache.h"
+#include "third_party/blink/public/mojom/blob/blob.mojom.h"
+#include "third_party/blink/public/mojom/fetch/fetch_api_response.mojom.h"
+#include "url/origin.h"
+
+namespace storage {
+class QuotaManagerProxy;
+}
+
+namespace content {
+
+class CacheStorageScheduler;
+enum class CacheStorageOwner;
+
+namespace proto {
+class CacheStorageSharedBody;
+}
+
+// Stores response bodies that several caches of an origin share, so that a
+// body put into more than one cache is only written to disk once. Disabled
+// by default.
+CONTENT_EXPORT extern const base::Feature kCacheStorageSharedBodies;
+// Bodies smaller than this are always stored in the cache's own entry.
+CONTENT_EXPORT extern const base::FeatureParam<int>
+    kCacheStorageSharedBodiesMinSize;
+
+// The shared response bodies of one origin's LegacyCacheStorage, kept in a
+// simple disk_cache backend of their own next to the caches' directories.
+//
+// Bodies are content addressed: the key of a body is derived from the
+// SHA-256 of its bytes, so putting a body that is already stored only adds
+// a referrer to it. The INDEX_HEADERS stream of each entry holds the
+// referrers (proto::CacheStorageSharedBody), naming every cache entry that
+// uses the body, and INDEX_RESPONSE_BODY holds the body itself. A body is
+// deleted with its last referrer. When the store is opened, referrers naming
+// caches whose directory is gone are swept; referrers naming missing entries
+// of caches that still exist are not.
+//
+// Opaque responses are never shared, since deduplicating them would reveal
+// through quota usage whether two cross-origin bodies are equal.
+//
+// The store is ref counted so that blobs reading a body keep its backend
+// alive. It must only be used on the scheduler sequence.
+class CONTENT_EXPORT LegacyCacheStorageBodyStore
+    : public base::RefCounted<LegacyCacheStorageBodyStore> {
+ public:
+  // Runs with the key of the stored body, or an empty string on failure.
+  using KeyCallback = base::OnceCallback<void(const std::string&)>;
+  // Runs with the entry of the body, or nullptr if it could not be opened.
+  using EntryCallback = base::OnceCallback<void(disk_cache::ScopedEntryPtr)>;
+  using SizeCallback = base::OnceCallback<void(int64_t)>;
+
+  // The directory of the store, relative to the origin's path.
+  static const char kDirName[];
+
+  LegacyCacheStorageBodyStore(
+      const base::FilePath& path,
+      const url::Origin& origin,
+      CacheStorageOwner owner,
+      scoped_refptr<base::SequencedTaskRunner> cache_task_runner,
+      scoped_refptr<base::SequencedTaskRunner> scheduler_task_runner,
+      scoped_refptr<storage::QuotaManagerProxy> quota_manager_proxy);
+
+  // Returns true if a body of |body_size| bytes of |response| should be kept
+  // in the store.
+  static bool ShouldShareBody(const blink::mojom::FetchAPIResponse& response,
+                              uint64_t body_size);
+
+  // Returns the referrer naming the entry with |entry_key| in the cache
+  // stored at |cache_path|.
+  static std::string GetReferrer(const base::FilePath& cache_path,
+                                 const std::string& entry_key);
+
+  // Stores the body read from |blob|, or adds |referrer| to the stored body
+  // if it has the same contents.
+  void PutBody(const std::string& referrer,
+               mojo::PendingRemote<blink::mojom::Blob> blob,
+               uint64_t blob_size,
+               KeyCallback callback);
+
+  void OpenBody(const std::string& key, EntryCallback callback);
+
+  // Removes |referrer| from the body with |key|, deleting the body if it was
+  // the last one.
+  void ReleaseBody(const std::string& key, const std::string& referrer);
+
+  // As ReleaseBody(), for every body referred to by the caches stored in
+  // |cache_dirs|. Used once caches are deleted.
+  void ReleaseBodiesOfCaches(const std::set<std::string>& cache_dirs);
+
+  // The size of the stored bodies.
+  void Size(SizeCallback callback);
+
+  // Gets the size of the stored bodies, closes the backend, and then runs
+  // |callback| with the size.
+  void GetSizeThenClose(SizeCallback callback);
+
+ private:
+  friend class base::RefCounted<LegacyCacheStorageBodyStore>;
+
+  // The backend is only created once a body is stored, so that origins which
+  // never share a body do not get a directory for it.
+  enum BackendState {
+    BACKEND_UNINITIALIZED,  // Not yet known whether the directory exists.
+    BACKEND_ABSENT,         // No directory; created by the first put.
+    BACKEND_OPEN,           // Backend can be used.
+    BACKEND_CLOSED          // Backend cannot be used.  All ops should fail.
+  };
+
+  class BodyHasher;
+  struct PutBodyContext;
+  struct ReleaseContext;
+
+  using BodyHasherIDMap = base::IDMap<std::unique_ptr<BodyHasher>>;
+  using BlobToDiskCacheIDMap =
+      base::IDMap<std::unique_ptr<CacheStorageBlobToDiskCache>>;
+  using ReferrersCallback = base::OnceCallback<void(
+      std::unique_ptr<proto::CacheStorageSharedBody>)>;
+  using ScopedBackendPtr = std::unique_ptr<disk_cache::Backend>;
+
+  ~LegacyCacheStorageBodyStore();
+
+  // Schedules the initialization of the backend ahead of the first
+  // operation.
+  void InitIfNeeded();
+  void InitImpl(base::OnceClosure callback);
+  void InitDidCheckPath(base::OnceClosure callback, bool exists);
+  void InitDidCreateBackend(base::OnceClosure callback, bool success);
+  void InitDidListCacheDirs(base::OnceClosure callback,
+                            std::set<std::string> cache_dirs);
+
+  // Returns the names of the directories in |origin_path|, which include
+  // those of every cache of the origin.
+  static std::set<std::string> ListCacheDirsInPool(
+      const base::FilePath& origin_path);
+
+  // Creates the backend, and then runs |callback| with true on success and
+  // once the size of the stored bodies is known.
+  void CreateBackend(base::OnceCallback<void(bool)> callback);
+  void CreateBackendDidCreate(base::OnceCallback<void(bool)> callback,
+                              std::unique_ptr<ScopedBackendPtr> backend_ptr,
+                              int rv);
+  void CreateBackendDidGetSize(base::OnceCallback<void(bool)> callback,
+                               int64_t size);
+
+  // PutBody callbacks.
+  void PutBodyDidHash(BodyHasherIDMap::KeyType hasher_id,
+                      std::unique_ptr<PutBodyContext> context,
+                      const std::string& key);
+  void PutBodyImpl(std::unique_ptr<PutBodyContext> context);
+  void PutBodyDidCreateBackend(std::unique_ptr<PutBodyContext> context,
+                               bool success);
+  void PutBodyDidOpenEntry(std::unique_ptr<PutBodyContext> context,
+                           disk_cache::EntryResult result);
+  void PutBodyDidReadReferrers(
+      std::unique_ptr<PutBodyContext> context,
+      std::unique_ptr<proto::CacheStorageSharedBody> referrers);
+  void PutBodyCreateEntry(std::unique_ptr<PutBodyContext> context);
+  void PutBodyDidWriteBody(std::unique_ptr<PutBodyContext> context,
+                           BlobToDiskCacheIDMap::KeyType blob_to_cache_key,
+                           ScopedWritableEntry entry,
+                           bool success);
+  void PutBodyDidWriteReferrers(std::unique_ptr<PutBodyContext> context,
+                                bool success);
+  void PutBodyComplete(std::unique_ptr<PutBodyContext> context, bool success);
+
+  void OpenBodyImpl(const std::string& key, EntryCallback callback);
+  void OpenBodyDidOpenEntry(EntryCallback callback,
+                            disk_cache::EntryResult result);
+
+  // ReleaseBody and ReleaseBodiesOfCaches callbacks. Both visit entries and
+  // drop the referrers |context| says to.
+  void ReleaseImpl(std::unique_ptr<ReleaseContext> context);
+  void ReleaseOpenNextEntry(std::unique_ptr<ReleaseContext> context);
+  void ReleaseDidOpenEntry(std::unique_ptr<ReleaseContext> context,
+                           disk_cache::EntryResult result);
+  void ReleaseDidReadReferrers(
+      std::unique_ptr<ReleaseContext> context,
+      disk_cache::ScopedEntryPtr entry,
+      std::unique_ptr<proto::CacheStorageSharedBody> referrers);
+  void ReleaseDidWriteReferrers(std::unique_ptr<ReleaseContext> context,
+                                bool success);
+  void ReleaseComplete(std::unique_ptr<ReleaseContext> context);
+
+  void SizeImpl(SizeCallback callback);
+  void GetSizeThenCloseImpl(SizeCallback callback);
+
+  // Reads and writes the referrers of an entry. The callback is guaranteed
+  // to be run.
+  void ReadReferrers(disk_cache::Entry* entry, ReferrersCallback callback);
+  void WriteReferrers(disk_cache::Entry* entry,
+                      const proto::CacheStorageSharedBody& referrers,
+                      base::OnceCallback<void(bool)> callback);
+
+  // Calculates the size of the stored bodies, and notifies the quota manager
+  // of any change from the last report.
+  void UpdateSize(base::OnceClosure callback);
+  void UpdateSizeDidGetSize(base::OnceClosure callback, int64_t size);
+
+  const base::FilePath path_;
+  const url::Origin origin_;
+  const CacheStorageOwner owner_;
+  const scoped_refptr<base::SequencedTaskRunner> cache_task_runner_;
+  const scoped_refptr<storage::QuotaManagerProxy> quota_manager_proxy_;
+  std::unique_ptr<CacheStorageScheduler> scheduler_;
+
+  // Be sure to check |backend_state_| before use.
+  std::unique_ptr<disk_cache::Backend> backend_;
+  BackendState backend_state_ = BACKEND_UNINITIALIZED;
+  bool init_scheduled_ = false;
+
+  // The size of the stored bodies, as last reported to the quota manager.
+  int64_t size_ = 0;
+
+  BodyHasherIDMap active_body_hashers_;
+  BlobToDiskCacheIDMap active_blob_to_disk_cache_writers_;
+
+  base::WeakPtrFactory<LegacyCacheStorageBodyStore> weak_ptr_factory_{this};
+
+  DISALLOW_COPY_AND_ASSIGN(LegacyCacheStorageBodyStore);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_CACHE_STORAGE_LEGACY_LEGACY_CACHE_STORAGE_BODY_STORE_H_
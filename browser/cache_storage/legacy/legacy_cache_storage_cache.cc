@@ -9,6 +9,7 @@
 #include <functional>
 #include <limits>
 #include <memory>
+#include <set>
 #include <string>
 #include <utility>
 
@@ -40,6 +41,7 @@
 #include "content/browser/cache_storage/cache_storage_scheduler.h"
 #include "content/browser/cache_storage/cache_storage_trace_utils.h"
 #include "content/browser/cache_storage/legacy/legacy_cache_storage.h"
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_body_store.h"
 #include "content/common/background_fetch/background_fetch_types.h"
 #include "content/common/service_worker/service_worker_utils.h"
 #include "content/public/common/content_features.h"
@@ -403,6 +405,38 @@ net::RequestPriority GetDiskCachePriority(
                                                           : net::MEDIUM;
 }
 
+// The number of response bodies a batch put streams into the cache at once.
+constexpr size_t kMaxParallelBatchPuts = 8;
+
+// Returns true if |operations| can be written by a single batch put: there
+// are several of them, all puts, and each writes a different entry.
+bool ShouldBatchPuts(
+    const std::vector<blink::mojom::BatchOperationPtr>& operations) {
+  if (operations.size() < 2)
+    return false;
+  std::set<std::string> keys;
+  for (const auto& operation : operations) {
+    if (operation->operation_type != blink::mojom::OperationType::kPut ||
+        !keys.insert(operation->request->url.spec()).second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns the scheduler key of an operation on |request| if it can only touch
+// the entry |request| is stored in, which is keyed by its URL. Returns an
+// empty key if it may touch any entry.
+std::string GetSchedulerKey(
+    const blink::mojom::FetchAPIRequestPtr& request,
+    const blink::mojom::CacheQueryOptionsPtr& options) {
+  if (!request || request->url.is_empty() ||
+      (options && options->ignore_search)) {
+    return std::string();
+  }
+  return request->url.spec();
+}
+
 }  // namespace
 
 struct LegacyCacheStorageCache::QueryCacheResult {
@@ -412,6 +446,7 @@ struct LegacyCacheStorageCache::QueryCacheResult {
   blink::mojom::FetchAPIResponsePtr response;
   disk_cache::ScopedEntryPtr entry;
   base::Time entry_time;
+  std::string shared_body_key;
 };
 
 struct LegacyCacheStorageCache::QueryCacheContext {
@@ -436,6 +471,16 @@ struct LegacyCacheStorageCache::QueryCacheContext {
 
   // Iteration state
   std::unique_ptr<disk_cache::Backend::Iterator> backend_iterator;
+  net::RequestPriority disk_cache_priority = net::MEDIUM;
+
+  // Set instead of |backend_iterator| when only the entries the URL index
+  // lists need to be visited.
+  base::Optional<std::vector<std::string>> indexed_keys;
+  size_t next_indexed_key = 0;
+
+  // Set while a full scan records every key in the backend, so that the URL
+  // index can be marked complete once the scan finishes.
+  base::Optional<std::vector<std::string>> scanned_keys;
 
   // Output of QueryCache
   std::unique_ptr<std::vector<QueryCacheResult>> matches;
@@ -444,6 +489,28 @@ struct LegacyCacheStorageCache::QueryCacheContext {
   DISALLOW_COPY_AND_ASSIGN(QueryCacheContext);
 };
 
+struct LegacyCacheStorageCache::BatchPutContext {
+  BatchPutContext() = default;
+  ~BatchPutContext() = default;
+
+  int64_t trace_id = 0;
+  ErrorCallback callback;
+
+  // The puts not started yet, from |next_put| on.
+  std::vector<std::unique_ptr<PutContext>> puts;
+  size_t next_put = 0;
+  size_t num_running = 0;
+  bool starting_puts = false;
+
+  // The puts written successfully, whose entries are doomed unless the whole
+  // batch succeeds.
+  std::vector<std::unique_ptr<PutContext>> completed_puts;
+  blink::mojom::CacheStorageError error = CacheStorageError::kSuccess;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BatchPutContext);
+};
+
 // static
 std::unique_ptr<LegacyCacheStorageCache>
 LegacyCacheStorageCache::CreateMemoryCache(
@@ -459,7 +526,8 @@ LegacyCacheStorageCache::CreateMemoryCache(
       origin, owner, cache_name, base::FilePath(), cache_storage,
       std::move(scheduler_task_runner), std::move(quota_manager_proxy),
       std::move(blob_storage_context), 0 /* cache_size */,
-      0 /* cache_padding */, std::move(cache_padding_key));
+      0 /* cache_padding */, std::move(cache_padding_key),
+      nullptr /* body_store */);
   cache->SetObserver(cache_storage);
   cache->InitBackend();
   return base::WrapUnique(cache);
@@ -478,12 +546,13 @@ LegacyCacheStorageCache::CreatePersistentCache(
     scoped_refptr<BlobStorageContextWrapper> blob_storage_context,
     int64_t cache_size,
     int64_t cache_padding,
-    std::unique_ptr<crypto::SymmetricKey> cache_padding_key) {
+    std::unique_ptr<crypto::SymmetricKey> cache_padding_key,
+    scoped_refptr<LegacyCacheStorageBodyStore> body_store) {
   LegacyCacheStorageCache* cache = new LegacyCacheStorageCache(
       origin, owner, cache_name, path, cache_storage,
       std::move(scheduler_task_runner), std::move(quota_manager_proxy),
       std::move(blob_storage_context), cache_size, cache_padding,
-      std::move(cache_padding_key));
+      std::move(cache_padding_key), std::move(body_store));
   cache->SetObserver(cache_storage);
   cache->InitBackend();
   return base::WrapUnique(cache);
@@ -538,9 +607,10 @@ void LegacyCacheStorageCache::Match(
   }
 
   auto id = scheduler_->CreateId();
-  scheduler_->ScheduleOperation(
+  const std::string key = GetSchedulerKey(request, match_options);
+  scheduler_->ScheduleOperationOnKey(
       id, CacheStorageSchedulerMode::kShared, CacheStorageSchedulerOp::kMatch,
-      priority,
+      priority, key,
       base::BindOnce(
           &LegacyCacheStorageCache::MatchImpl, weak_ptr_factory_.GetWeakPtr(),
           std::move(request), std::move(match_options), trace_id, priority,
@@ -560,10 +630,11 @@ void LegacyCacheStorageCache::MatchAll(
   }
 
   auto id = scheduler_->CreateId();
-  scheduler_->ScheduleOperation(
+  const std::string key = GetSchedulerKey(request, match_options);
+  scheduler_->ScheduleOperationOnKey(
       id, CacheStorageSchedulerMode::kShared,
       CacheStorageSchedulerOp::kMatchAll,
-      CacheStorageSchedulerPriority::kNormal,
+      CacheStorageSchedulerPriority::kNormal, key,
       base::BindOnce(
           &LegacyCacheStorageCache::MatchAllImpl,
           weak_ptr_factory_.GetWeakPtr(), std::move(request),
@@ -745,8 +816,9 @@ void LegacyCacheStorageCache::BatchDidGetUsageAndQuota(
   // invocation, and (critically) that subsequent invocations are ignored.
   // TODO(jsbell): Replace AdaptCallbackForRepeating with ...? crbug.com/730593
   auto callback_copy = base::AdaptCallbackForRepeating(std::move(callback));
+  const bool batch_puts = ShouldBatchPuts(operations);
   auto barrier_closure = base::BarrierClosure(
-      operations.size(),
+      batch_puts ? 1 : operations.size(),
       base::BindOnce(&LegacyCacheStorageCache::BatchDidAllOperations,
                      weak_ptr_factory_.GetWeakPtr(), callback_copy, message,
                      trace_id));
@@ -761,6 +833,15 @@ void LegacyCacheStorageCache::BatchDidGetUsageAndQuota(
   // will no-op automatically.)
   CacheStorageCacheHandle handle = CreateHandle();
 
+  if (batch_puts) {
+    if (skip_side_data) {
+      for (auto& operation : operations)
+        operation->response->side_data_blob_for_cache_put = nullptr;
+    }
+    BatchPut(std::move(operations), trace_id, completion_callback);
+    return;
+  }
+
   for (auto& operation : operations) {
     switch (operation->operation_type) {
       case blink::mojom::OperationType::kPut:
@@ -831,9 +912,10 @@ void LegacyCacheStorageCache::Keys(blink::mojom::FetchAPIRequestPtr request,
   }
 
   auto id = scheduler_->CreateId();
-  scheduler_->ScheduleOperation(
+  const std::string key = GetSchedulerKey(request, options);
+  scheduler_->ScheduleOperationOnKey(
       id, CacheStorageSchedulerMode::kShared, CacheStorageSchedulerOp::kKeys,
-      CacheStorageSchedulerPriority::kNormal,
+      CacheStorageSchedulerPriority::kNormal, key,
       base::BindOnce(
           &LegacyCacheStorageCache::KeysImpl, weak_ptr_factory_.GetWeakPtr(),
           std::move(request), std::move(options), trace_id,
@@ -930,7 +1012,8 @@ LegacyCacheStorageCache::LegacyCacheStorageCache(
     scoped_refptr<BlobStorageContextWrapper> blob_storage_context,
     int64_t cache_size,
     int64_t cache_padding,
-    std::unique_ptr<crypto::SymmetricKey> cache_padding_key)
+    std::unique_ptr<crypto::SymmetricKey> cache_padding_key,
+    scoped_refptr<LegacyCacheStorageBodyStore> body_store)
     : origin_(origin),
       owner_(owner),
       cache_name_(cache_name),
@@ -949,6 +1032,7 @@ LegacyCacheStorageCache::LegacyCacheStorageCache(
           CacheStorageCacheEntryHandler::CreateCacheEntryHandler(
               owner,
               std::move(blob_storage_context))),
+      body_store_(std::move(body_store)),
       memory_only_(path.empty()) {
   DCHECK(!origin_.opaque());
   DCHECK(quota_manager_proxy_.get());
@@ -993,12 +1077,25 @@ void LegacyCacheStorageCache::QueryCache(
   std::unique_ptr<QueryCacheContext> query_cache_context(
       new QueryCacheContext(std::move(request), std::move(options),
                             std::move(callback), query_types));
-  if (query_cache_context->request &&
-      !query_cache_context->request->url.is_empty() &&
-      (!query_cache_context->options ||
-       !query_cache_context->options->ignore_search)) {
+  query_cache_context->disk_cache_priority = GetDiskCachePriority(priority);
+  const bool has_request_url = query_cache_context->request &&
+                               !query_cache_context->request->url.is_empty();
+  const bool ignore_vary = query_cache_context->options &&
+                           query_cache_context->options->ignore_vary;
+  if (has_request_url && (!query_cache_context->options ||
+                          !query_cache_context->options->ignore_search)) {
     // There is no need to scan the entire backend, just open the exact
-    // URL.
+    // URL. A complete index also knows when there is nothing to open.
+    if (url_index_.is_complete() &&
+        (!url_index_.Contains(request_url) ||
+         (!ignore_vary &&
+          !url_index_.MayMatchVary(request_url,
+                                   query_cache_context->request->headers)))) {
+      std::move(query_cache_context->callback)
+          .Run(CacheStorageError::kSuccess,
+               std::move(query_cache_context->matches));
+      return;
+    }
 
     // Create a callback that is copyable, even though it can only be called
     // once. BindRepeating() cannot be used directly because
@@ -1014,6 +1111,17 @@ void LegacyCacheStorageCache::QueryCache(
     return;
   }
 
+  if (has_request_url && url_index_.is_complete()) {
+    // ignoreSearch: only the entries whose URL matches without the query
+    // need to be visited.
+    query_cache_context->indexed_keys =
+        url_index_.FindIgnoringSearch(query_cache_context->request->url);
+    QueryCacheOpenNextEntry(std::move(query_cache_context));
+    return;
+  }
+
+  if (!url_index_.is_complete())
+    query_cache_context->scanned_keys.emplace();
   query_cache_context->backend_iterator = backend_->CreateIterator();
   QueryCacheOpenNextEntry(std::move(query_cache_context));
 }
@@ -1044,8 +1152,33 @@ void LegacyCacheStorageCache::QueryCacheOpenNextEntry(
       },
       CreateHandle()));
 
-  if (!query_cache_context->backend_iterator) {
+  if (query_cache_context->indexed_keys) {
+    // Skip the entries whose Vary headers are known not to match.
+    const std::vector<std::string>& keys = *query_cache_context->indexed_keys;
+    size_t& next = query_cache_context->next_indexed_key;
+    if (!query_cache_context->options ||
+        !query_cache_context->options->ignore_vary) {
+      while (next < keys.size() &&
+             !url_index_.MayMatchVary(keys[next],
+                                      query_cache_context->request->headers)) {
+        ++next;
+      }
+    }
+  }
+
+  if (query_cache_context->indexed_keys
+          ? query_cache_context->next_indexed_key ==
+                query_cache_context->indexed_keys->size()
+          : !query_cache_context->backend_iterator) {
     // Iteration is complete.
+    if (query_cache_context->scanned_keys && !url_index_.is_complete()) {
+      // The scan saw every key in the backend, and no entry was added or
+      // removed meanwhile since those are exclusive operations.
+      for (const std::string& key : *query_cache_context->scanned_keys)
+        url_index_.AddKey(key);
+      url_index_.MarkComplete();
+    }
+
     std::sort(query_cache_context->matches->begin(),
               query_cache_context->matches->end(), QueryCacheResultCompare);
 
@@ -1055,17 +1188,29 @@ void LegacyCacheStorageCache::QueryCacheOpenNextEntry(
     return;
   }
 
-  disk_cache::Backend::Iterator& iterator =
-      *query_cache_context->backend_iterator;
-
   // Create a callback that is copyable, even though it can only be called once.
   // BindRepeating() cannot be used directly because |query_cache_context| is
   // not copyable.
-  auto open_entry_callback = base::AdaptCallbackForRepeating(base::BindOnce(
-      &LegacyCacheStorageCache::QueryCacheFilterEntry,
-      weak_ptr_factory_.GetWeakPtr(), std::move(query_cache_context)));
-
-  disk_cache::EntryResult result = iterator.OpenNextEntry(open_entry_callback);
+  base::RepeatingCallback<void(disk_cache::EntryResult)> open_entry_callback;
+  disk_cache::EntryResult result;
+  if (query_cache_context->indexed_keys) {
+    const std::string key =
+        (*query_cache_context->indexed_keys)
+            [query_cache_context->next_indexed_key++];
+    const net::RequestPriority priority =
+        query_cache_context->disk_cache_priority;
+    open_entry_callback = base::AdaptCallbackForRepeating(base::BindOnce(
+        &LegacyCacheStorageCache::QueryCacheDidOpenIndexedEntry,
+        weak_ptr_factory_.GetWeakPtr(), std::move(query_cache_context), key));
+    result = backend_->OpenEntry(key, priority, open_entry_callback);
+  } else {
+    disk_cache::Backend::Iterator& iterator =
+        *query_cache_context->backend_iterator;
+    open_entry_callback = base::AdaptCallbackForRepeating(base::BindOnce(
+        &LegacyCacheStorageCache::QueryCacheFilterEntry,
+        weak_ptr_factory_.GetWeakPtr(), std::move(query_cache_context)));
+    result = iterator.OpenNextEntry(open_entry_callback);
+  }
 
   if (result.net_error() == net::ERR_IO_PENDING)
     return;
@@ -1084,6 +1229,19 @@ void LegacyCacheStorageCache::QueryCacheOpenNextEntry(
       base::BindOnce(std::move(open_entry_callback), std::move(result)));
 }
 
+void LegacyCacheStorageCache::QueryCacheDidOpenIndexedEntry(
+    std::unique_ptr<QueryCacheContext> query_cache_context,
+    const std::string& key,
+    disk_cache::EntryResult result) {
+  if (result.net_error() != net::OK) {
+    // The entry no longer exists, so the index was out of date.
+    url_index_.RemoveKey(key);
+    QueryCacheOpenNextEntry(std::move(query_cache_context));
+    return;
+  }
+  QueryCacheFilterEntry(std::move(query_cache_context), std::move(result));
+}
+
 void LegacyCacheStorageCache::QueryCacheFilterEntry(
     std::unique_ptr<QueryCacheContext> query_cache_context,
     disk_cache::EntryResult result) {
@@ -1110,6 +1268,9 @@ void LegacyCacheStorageCache::QueryCacheFilterEntry(
     return;
   }
 
+  if (query_cache_context->scanned_keys)
+    query_cache_context->scanned_keys->push_back(entry->GetKey());
+
   if (query_cache_context->request &&
       !query_cache_context->request->url.is_empty()) {
     GURL requestURL = query_cache_context->request->url;
@@ -1140,7 +1301,7 @@ void LegacyCacheStorageCache::QueryCacheDidReadMetadata(
     disk_cache::ScopedEntryPtr entry,
     std::unique_ptr<proto::CacheMetadata> metadata) {
   if (!metadata) {
-    entry->Doom();
+    QueryCacheDoomEntry(query_cache_context.get(), std::move(entry));
     QueryCacheOpenNextEntry(std::move(query_cache_context));
     return;
   }
@@ -1158,11 +1319,13 @@ void LegacyCacheStorageCache::QueryCacheDidReadMetadata(
   match->response = CreateResponse(*metadata, cache_name_);
 
   if (!match->response) {
-    entry->Doom();
+    QueryCacheDoomEntry(query_cache_context.get(), std::move(entry));
     query_cache_context->matches->pop_back();
     QueryCacheOpenNextEntry(std::move(query_cache_context));
     return;
   }
+  url_index_.AddEntry(entry->GetKey(), match->request->headers,
+                      match->response->headers);
 
   if (query_cache_context->request &&
       (!query_cache_context->options ||
@@ -1174,8 +1337,56 @@ void LegacyCacheStorageCache::QueryCacheDidReadMetadata(
     return;
   }
 
+  match->shared_body_key = metadata->shared_body_key();
+  if (!match->shared_body_key.empty() &&
+      (query_cache_context->query_types & QUERY_CACHE_RESPONSES_WITH_BODIES)) {
+    if (!body_store_) {
+      QueryCacheDoomEntry(query_cache_context.get(), std::move(entry));
+      query_cache_context->matches->pop_back();
+      QueryCacheOpenNextEntry(std::move(query_cache_context));
+      return;
+    }
+    const std::string shared_body_key = match->shared_body_key;
+    body_store_->OpenBody(
+        shared_body_key,
+        base::BindOnce(&LegacyCacheStorageCache::QueryCacheDidOpenSharedBody,
+                       weak_ptr_factory_.GetWeakPtr(),
+                       std::move(query_cache_context), std::move(entry)));
+    return;
+  }
+
+  QueryCachePopulateMatch(std::move(query_cache_context), std::move(entry),
+                          nullptr /* body_entry */);
+}
+
+void LegacyCacheStorageCache::QueryCacheDidOpenSharedBody(
+    std::unique_ptr<QueryCacheContext> query_cache_context,
+    disk_cache::ScopedEntryPtr entry,
+    disk_cache::ScopedEntryPtr body_entry) {
+  if (!body_entry) {
+    QueryCacheDoomEntry(query_cache_context.get(), std::move(entry));
+    query_cache_context->matches->pop_back();
+    QueryCacheOpenNextEntry(std::move(query_cache_context));
+    return;
+  }
+  QueryCachePopulateMatch(std::move(query_cache_context), std::move(entry),
+                          std::move(body_entry));
+}
+
+void LegacyCacheStorageCache::QueryCachePopulateMatch(
+    std::unique_ptr<QueryCacheContext> query_cache_context,
+    disk_cache::ScopedEntryPtr entry,
+    disk_cache::ScopedEntryPtr body_entry) {
+  QueryCacheResult* match = &query_cache_context->matches->back();
   auto blob_entry = cache_entry_handler_->CreateDiskCacheBlobEntry(
       CreateHandle(), std::move(entry));
+  if (body_entry) {
+    blob_entry->SetSharedBodyEntry(
+        std::move(body_entry),
+        base::BindOnce(
+            base::DoNothing::Once<scoped_refptr<LegacyCacheStorageBodyStore>>(),
+            body_store_));
+  }
 
   if (query_cache_context->query_types & QUERY_CACHE_ENTRIES)
     match->entry = std::move(blob_entry->disk_cache_entry());
@@ -1202,7 +1413,7 @@ void LegacyCacheStorageCache::QueryCacheDidReadMetadata(
           .Run(CacheStorageError::kErrorQueryTooLarge, nullptr);
       return;
     }
-    if (blob_entry->disk_cache_entry()->GetDataSize(INDEX_RESPONSE_BODY) == 0) {
+    if (blob_entry->GetSize(INDEX_RESPONSE_BODY) == 0) {
       QueryCacheOpenNextEntry(std::move(query_cache_context));
       return;
     }
@@ -1217,6 +1428,19 @@ void LegacyCacheStorageCache::QueryCacheDidReadMetadata(
   QueryCacheOpenNextEntry(std::move(query_cache_context));
 }
 
+void LegacyCacheStorageCache::QueryCacheDoomEntry(
+    QueryCacheContext* query_cache_context,
+    disk_cache::ScopedEntryPtr entry) {
+  const std::string key = entry->GetKey();
+  entry->Doom();
+  url_index_.RemoveKey(key);
+  // The entry was the last one recorded by a full scan.
+  if (query_cache_context->scanned_keys) {
+    DCHECK_EQ(key, query_cache_context->scanned_keys->back());
+    query_cache_context->scanned_keys->pop_back();
+  }
+}
+
 // static
 bool LegacyCacheStorageCache::QueryCacheResultCompare(
     const QueryCacheResult& lhs,
@@ -1372,10 +1596,10 @@ void LegacyCacheStorageCache::WriteSideDataDidGetQuota(
   }
 
   auto id = scheduler_->CreateId();
-  scheduler_->ScheduleOperation(
+  scheduler_->ScheduleOperationOnKey(
       id, CacheStorageSchedulerMode::kExclusive,
       CacheStorageSchedulerOp::kWriteSideData,
-      CacheStorageSchedulerPriority::kNormal,
+      CacheStorageSchedulerPriority::kNormal, url.spec(),
       base::BindOnce(&LegacyCacheStorageCache::WriteSideDataImpl,
                      weak_ptr_factory_.GetWeakPtr(),
                      scheduler_->WrapCallbackToRunNext(id, std::move(callback)),
@@ -1567,15 +1791,18 @@ void LegacyCacheStorageCache::Put(blink::mojom::FetchAPIRequestPtr request,
   UMA_HISTOGRAM_ENUMERATION("ServiceWorkerCache.Cache.AllWritesResponseType",
                             response->response_type);
 
+  const std::string key = request->url.spec();
   auto put_context = cache_entry_handler_->CreatePutContext(
       std::move(request), std::move(response), trace_id);
   auto id = scheduler_->CreateId();
   put_context->callback =
       scheduler_->WrapCallbackToRunNext(id, std::move(callback));
 
-  scheduler_->ScheduleOperation(
+  // Only the entry for the request URL is replaced, so reads of other entries
+  // can run meanwhile.
+  scheduler_->ScheduleOperationOnKey(
       id, CacheStorageSchedulerMode::kExclusive, CacheStorageSchedulerOp::kPut,
-      CacheStorageSchedulerPriority::kNormal,
+      CacheStorageSchedulerPriority::kNormal, key,
       base::BindOnce(&LegacyCacheStorageCache::PutImpl,
                      weak_ptr_factory_.GetWeakPtr(), std::move(put_context)));
 }
@@ -1615,10 +1842,16 @@ void LegacyCacheStorageCache::PutImpl(std::unique_ptr<PutContext> put_context) {
       blink::mojom::CacheQueryOptions::New();
   query_options->ignore_method = true;
   query_options->ignore_vary = true;
-  DeleteImpl(
-      std::move(delete_request), std::move(query_options),
+  auto delete_callback =
       base::BindOnce(&LegacyCacheStorageCache::PutDidDeleteEntry,
-                     weak_ptr_factory_.GetWeakPtr(), std::move(put_context)));
+                     weak_ptr_factory_.GetWeakPtr(), std::move(put_context));
+  if (batch_put_context_) {
+    BatchPutDeleteEntry(std::move(delete_request), std::move(query_options),
+                        std::move(delete_callback));
+    return;
+  }
+  DeleteImpl(std::move(delete_request), std::move(query_options),
+             std::move(delete_callback));
 }
 
 void LegacyCacheStorageCache::PutDidDeleteEntry(
@@ -1641,6 +1874,49 @@ void LegacyCacheStorageCache::PutDidDeleteEntry(
     return;
   }
 
+  // A body put into more than one cache of the origin is stored once, in
+  // the body store. The entry then only records its key.
+  if (body_store_ && put_context->blob &&
+      LegacyCacheStorageBodyStore::ShouldShareBody(*put_context->response,
+                                                   put_context->blob_size)) {
+    const std::string referrer = LegacyCacheStorageBodyStore::GetReferrer(
+        path_, put_context->request->url.spec());
+    mojo::PendingRemote<blink::mojom::Blob> blob =
+        std::move(put_context->blob);
+    const uint64_t blob_size = put_context->blob_size;
+    body_store_->PutBody(
+        referrer, std::move(blob), blob_size,
+        base::BindOnce(&LegacyCacheStorageCache::PutDidStoreSharedBody,
+                       weak_ptr_factory_.GetWeakPtr(), std::move(put_context)));
+    return;
+  }
+
+  PutOpenEntry(std::move(put_context));
+}
+
+void LegacyCacheStorageCache::PutDidStoreSharedBody(
+    std::unique_ptr<PutContext> put_context,
+    const std::string& shared_body_key) {
+  if (shared_body_key.empty()) {
+    PutComplete(
+        std::move(put_context),
+        MakeErrorStorage(ErrorStorageType::kPutDidStoreSharedBodyFailed));
+    return;
+  }
+  put_context->shared_body_key = shared_body_key;
+
+  if (backend_state_ != BACKEND_OPEN) {
+    PutComplete(
+        std::move(put_context),
+        MakeErrorStorage(ErrorStorageType::kPutDidDeleteEntryBackendClosed));
+    return;
+  }
+
+  PutOpenEntry(std::move(put_context));
+}
+
+void LegacyCacheStorageCache::PutOpenEntry(
+    std::unique_ptr<PutContext> put_context) {
   const blink::mojom::FetchAPIRequest& request_ = *(put_context->request);
   disk_cache::Backend* backend_ptr = backend_.get();
 
@@ -1716,6 +1992,8 @@ void LegacyCacheStorageCache::PutDidCreateEntry(
   }
   for (const auto& header : put_context->response->cors_exposed_header_names)
     response_metadata->add_cors_exposed_header_names(header);
+  if (!put_context->shared_body_key.empty())
+    metadata.set_shared_body_key(put_context->shared_body_key);
 
   std::unique_ptr<std::string> serialized(new std::string());
   if (!metadata.SerializeToString(serialized.get())) {
@@ -1899,20 +2177,207 @@ void LegacyCacheStorageCache::PutWriteBlobToCacheComplete(
 void LegacyCacheStorageCache::PutComplete(
     std::unique_ptr<PutContext> put_context,
     blink::mojom::CacheStorageError error) {
-  if (error == CacheStorageError::kSuccess) {
-    // Make sure we've written everything.
-    DCHECK(put_context->cache_entry);
-    DCHECK(!put_context->blob);
-    DCHECK(!put_context->side_data_blob);
+  // The entry is doomed once |put_context| is destroyed uncommitted.
+  if (error != CacheStorageError::kSuccess &&
+      !put_context->shared_body_key.empty()) {
+    ReleaseSharedBody(put_context->shared_body_key,
+                      put_context->request->url.spec());
+  }
 
-    // Tell the WritableScopedEntry not to doom the entry since it was a
-    // successful operation.
-    put_context->cache_entry.get_deleter().WritingCompleted();
+  if (batch_put_context_) {
+    BatchPutDidPutOne(std::move(put_context), error);
+    return;
   }
 
+  if (error == CacheStorageError::kSuccess)
+    PutCommitEntry(put_context.get());
+
   UpdateCacheSize(base::BindOnce(std::move(put_context->callback), error));
 }
 
+void LegacyCacheStorageCache::PutCommitEntry(PutContext* put_context) {
+  // Make sure we've written everything.
+  DCHECK(put_context->cache_entry);
+  DCHECK(!put_context->blob);
+  DCHECK(!put_context->side_data_blob);
+
+  // Tell the WritableScopedEntry not to doom the entry since it was a
+  // successful operation.
+  put_context->cache_entry.get_deleter().WritingCompleted();
+
+  url_index_.AddEntry(put_context->request->url.spec(),
+                      put_context->request->headers,
+                      put_context->response->headers);
+}
+
+void LegacyCacheStorageCache::ReleaseSharedBody(
+    const std::string& shared_body_key,
+    const std::string& key) {
+  if (!body_store_)
+    return;
+  body_store_->ReleaseBody(
+      shared_body_key, LegacyCacheStorageBodyStore::GetReferrer(path_, key));
+}
+
+void LegacyCacheStorageCache::BatchPut(
+    std::vector<blink::mojom::BatchOperationPtr> operations,
+    int64_t trace_id,
+    ErrorCallback callback) {
+  DCHECK(BACKEND_OPEN == backend_state_ || initializing_);
+
+  auto batch_put_context = std::make_unique<BatchPutContext>();
+  batch_put_context->trace_id = trace_id;
+  for (auto& operation : operations) {
+    DCHECK_EQ(blink::mojom::OperationType::kPut, operation->operation_type);
+    UMA_HISTOGRAM_ENUMERATION("ServiceWorkerCache.Cache.AllWritesResponseType",
+                              operation->response->response_type);
+    auto put_context = cache_entry_handler_->CreatePutContext(
+        std::move(operation->request), std::move(operation->response),
+        trace_id);
+    // Each put reports to the batch instead, see PutComplete().
+    put_context->callback = base::DoNothing();
+    batch_put_context->puts.push_back(std::move(put_context));
+  }
+
+  auto id = scheduler_->CreateId();
+  batch_put_context->callback =
+      scheduler_->WrapCallbackToRunNext(id, std::move(callback));
+
+  // The batch is atomic, so nothing may observe it half written.
+  scheduler_->ScheduleOperation(
+      id, CacheStorageSchedulerMode::kExclusive, CacheStorageSchedulerOp::kPut,
+      CacheStorageSchedulerPriority::kNormal,
+      base::BindOnce(&LegacyCacheStorageCache::BatchPutImpl,
+                     weak_ptr_factory_.GetWeakPtr(),
+                     std::move(batch_put_context)));
+}
+
+void LegacyCacheStorageCache::BatchPutImpl(
+    std::unique_ptr<BatchPutContext> batch_put_context) {
+  DCHECK_NE(BACKEND_UNINITIALIZED, backend_state_);
+  DCHECK(!batch_put_context_);
+  TRACE_EVENT_WITH_FLOW1("CacheStorage",
+                         "LegacyCacheStorageCache::BatchPutImpl",
+                         TRACE_ID_GLOBAL(batch_put_context->trace_id),
+                         TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT,
+                         "count", batch_put_context->puts.size());
+  if (backend_state_ != BACKEND_OPEN) {
+    std::move(batch_put_context->callback)
+        .Run(MakeErrorStorage(ErrorStorageType::kPutImplBackendClosed));
+    return;
+  }
+
+  // Hold the cache alive while performing any operation touching the
+  // disk_cache backend.
+  batch_put_context->callback =
+      WrapCallbackWithHandle(std::move(batch_put_context->callback));
+
+  batch_put_context_ = std::move(batch_put_context);
+  BatchPutStartPuts();
+}
+
+void LegacyCacheStorageCache::BatchPutStartPuts() {
+  BatchPutContext* batch_put_context = batch_put_context_.get();
+  DCHECK(batch_put_context);
+
+  // Puts that complete synchronously get here again, while the outer call
+  // is still starting puts.
+  if (batch_put_context->starting_puts)
+    return;
+
+  batch_put_context->starting_puts = true;
+  while (batch_put_context->error == CacheStorageError::kSuccess &&
+         batch_put_context->num_running < kMaxParallelBatchPuts &&
+         batch_put_context->next_put < batch_put_context->puts.size()) {
+    ++batch_put_context->num_running;
+    PutImpl(std::move(
+        batch_put_context->puts[batch_put_context->next_put++]));
+  }
+  batch_put_context->starting_puts = false;
+
+  // After a failure, the remaining puts are not started.
+  if (batch_put_context->num_running == 0 &&
+      (batch_put_context->error != CacheStorageError::kSuccess ||
+       batch_put_context->next_put == batch_put_context->puts.size())) {
+    BatchPutComplete();
+  }
+}
+
+void LegacyCacheStorageCache::BatchPutDidPutOne(
+    std::unique_ptr<PutContext> put_context,
+    blink::mojom::CacheStorageError error) {
+  DCHECK_GT(batch_put_context_->num_running, 0u);
+  --batch_put_context_->num_running;
+  if (error == CacheStorageError::kSuccess)
+    batch_put_context_->completed_puts.push_back(std::move(put_context));
+  else if (batch_put_context_->error == CacheStorageError::kSuccess)
+    batch_put_context_->error = error;
+
+  BatchPutStartPuts();
+}
+
+void LegacyCacheStorageCache::BatchPutComplete() {
+  std::unique_ptr<BatchPutContext> batch_put_context =
+      std::move(batch_put_context_);
+  TRACE_EVENT_WITH_FLOW0("CacheStorage",
+                         "LegacyCacheStorageCache::BatchPutComplete",
+                         TRACE_ID_GLOBAL(batch_put_context->trace_id),
+                         TRACE_EVENT_FLAG_FLOW_IN | TRACE_EVENT_FLAG_FLOW_OUT);
+
+  for (auto& put_context : batch_put_context->completed_puts) {
+    if (batch_put_context->error == CacheStorageError::kSuccess) {
+      PutCommitEntry(put_context.get());
+      continue;
+    }
+    // The entry is doomed once |put_context| is destroyed uncommitted, so
+    // take back the padding PutDidWriteHeaders() added for it.
+    if (ShouldPadResourceSize(*put_context->response)) {
+      cache_padding_ -= CalculateResponsePadding(*put_context->response,
+                                                 cache_padding_key_.get(),
+                                                 0 /* side_data_size */);
+    }
+    if (!put_context->shared_body_key.empty()) {
+      ReleaseSharedBody(put_context->shared_body_key,
+                        put_context->request->url.spec());
+    }
+  }
+  batch_put_context->completed_puts.clear();
+
+  UpdateCacheSize(base::BindOnce(std::move(batch_put_context->callback),
+                                 batch_put_context->error));
+}
+
+void LegacyCacheStorageCache::BatchPutDeleteEntry(
+    blink::mojom::FetchAPIRequestPtr request,
+    blink::mojom::CacheQueryOptionsPtr match_options,
+    ErrorCallback callback) {
+  DCHECK(batch_put_context_);
+  QueryCache(
+      std::move(request), std::move(match_options),
+      QUERY_CACHE_ENTRIES | QUERY_CACHE_RESPONSES_NO_BODIES,
+      CacheStorageSchedulerPriority::kNormal,
+      base::BindOnce(&LegacyCacheStorageCache::BatchPutDidQueryEntry,
+                     weak_ptr_factory_.GetWeakPtr(), std::move(callback)));
+}
+
+void LegacyCacheStorageCache::BatchPutDidQueryEntry(
+    ErrorCallback callback,
+    CacheStorageError error,
+    std::unique_ptr<QueryCacheResults> query_cache_results) {
+  if (error != CacheStorageError::kSuccess) {
+    std::move(callback).Run(error);
+    return;
+  }
+
+  if (query_cache_results->empty()) {
+    std::move(callback).Run(CacheStorageError::kErrorNotFound);
+    return;
+  }
+
+  DoomQueryCacheResults(query_cache_results.get());
+  std::move(callback).Run(CacheStorageError::kSuccess);
+}
+
 void LegacyCacheStorageCache::CalculateCacheSizePadding(
     SizePaddingCallback got_sizes_callback) {
   // Create a callback that is copyable, even though it can only be called once.
@@ -2021,10 +2486,11 @@ void LegacyCacheStorageCache::GetAllMatchedEntries(
   }
 
   auto id = scheduler_->CreateId();
-  scheduler_->ScheduleOperation(
+  const std::string key = GetSchedulerKey(request, options);
+  scheduler_->ScheduleOperationOnKey(
       id, CacheStorageSchedulerMode::kShared,
       CacheStorageSchedulerOp::kGetAllMatched,
-      CacheStorageSchedulerPriority::kNormal,
+      CacheStorageSchedulerPriority::kNormal, key,
       base::BindOnce(
           &LegacyCacheStorageCache::GetAllMatchedEntriesImpl,
           weak_ptr_factory_.GetWeakPtr(), std::move(request),
@@ -2109,9 +2575,11 @@ void LegacyCacheStorageCache::Delete(blink::mojom::BatchOperationPtr operation,
   request->headers = operation->request->headers;
 
   auto id = scheduler_->CreateId();
-  scheduler_->ScheduleOperation(
+  const std::string key = GetSchedulerKey(request, operation->match_options);
+  scheduler_->ScheduleOperationOnKey(
       id, CacheStorageSchedulerMode::kExclusive,
       CacheStorageSchedulerOp::kDelete, CacheStorageSchedulerPriority::kNormal,
+      key,
       base::BindOnce(
           &LegacyCacheStorageCache::DeleteImpl, weak_ptr_factory_.GetWeakPtr(),
           std::move(request), std::move(operation->match_options),
@@ -2155,6 +2623,14 @@ void LegacyCacheStorageCache::DeleteDidQueryCache(
     return;
   }
 
+  DoomQueryCacheResults(query_cache_results.get());
+
+  UpdateCacheSize(
+      base::BindOnce(std::move(callback), CacheStorageError::kSuccess));
+}
+
+void LegacyCacheStorageCache::DoomQueryCacheResults(
+    QueryCacheResults* query_cache_results) {
   DCHECK(scheduler_->IsRunningExclusiveOperation());
 
   for (auto& result : *query_cache_results) {
@@ -2164,11 +2640,11 @@ void LegacyCacheStorageCache::DeleteDidQueryCache(
           CalculateResponsePadding(*result.response, cache_padding_key_.get(),
                                    entry->GetDataSize(INDEX_SIDE_DATA));
     }
+    url_index_.RemoveKey(entry->GetKey());
+    if (!result.shared_body_key.empty())
+      ReleaseSharedBody(result.shared_body_key, entry->GetKey());
     entry->Doom();
   }
-
-  UpdateCacheSize(
-      base::BindOnce(std::move(callback), CacheStorageError::kSuccess));
 }
 
 void LegacyCacheStorageCache::KeysImpl(
@@ -2306,6 +2782,7 @@ void LegacyCacheStorageCache::CreateBackendDidCreate(
   }
 
   backend_ = std::move(*backend_ptr);
+  url_index_.Reset();
   std::move(callback).Run(CacheStorageError::kSuccess);
 }
 
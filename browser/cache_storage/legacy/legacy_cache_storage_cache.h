@@ -15,11 +15,13 @@
 #include "base/containers/id_map.h"
 #include "base/files/file_path.h"
 #include "base/macros.h"
+#include "base/memory/scoped_refptr.h"
 #include "base/memory/weak_ptr.h"
 #include "base/optional.h"
 #include "content/browser/cache_storage/cache_storage_cache.h"
 #include "content/browser/cache_storage/cache_storage_handle.h"
 #include "content/browser/cache_storage/cache_storage_manager.h"
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_url_index.h"
 #include "content/browser/cache_storage/scoped_writable_entry.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/io_buffer.h"
@@ -43,6 +45,7 @@ class CacheStorageCacheObserver;
 class CacheStorageScheduler;
 enum class CacheStorageOwner;
 class LegacyCacheStorage;
+class LegacyCacheStorageBodyStore;
 struct PutContext;
 
 namespace proto {
@@ -82,7 +85,8 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
       scoped_refptr<BlobStorageContextWrapper> blob_storage_context,
       int64_t cache_size,
       int64_t cache_padding,
-      std::unique_ptr<crypto::SymmetricKey> cache_padding_key);
+      std::unique_ptr<crypto::SymmetricKey> cache_padding_key,
+      scoped_refptr<LegacyCacheStorageBodyStore> body_store);
   static int64_t CalculateResponsePadding(
       const blink::mojom::FetchAPIResponse& response,
       const crypto::SymmetricKey* padding_key,
@@ -229,6 +233,7 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
   friend class cache_storage_cache_unittest::TestCacheStorageCache;
   friend class cache_storage_cache_unittest::CacheStorageCacheTest;
 
+  struct BatchPutContext;
   struct QueryCacheContext;
   struct QueryCacheResult;
 
@@ -253,7 +258,8 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
       scoped_refptr<BlobStorageContextWrapper> blob_storage_context,
       int64_t cache_size,
       int64_t cache_padding,
-      std::unique_ptr<crypto::SymmetricKey> cache_padding_key);
+      std::unique_ptr<crypto::SymmetricKey> cache_padding_key,
+      scoped_refptr<LegacyCacheStorageBodyStore> body_store);
 
   // Runs |callback| with matching requests/response data. The data provided
   // in the QueryCacheResults depends on the |query_type|. If |query_type| is
@@ -271,6 +277,10 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
       disk_cache::EntryResult result);
   void QueryCacheOpenNextEntry(
       std::unique_ptr<QueryCacheContext> query_cache_context);
+  void QueryCacheDidOpenIndexedEntry(
+      std::unique_ptr<QueryCacheContext> query_cache_context,
+      const std::string& key,
+      disk_cache::EntryResult result);
   void QueryCacheFilterEntry(
       std::unique_ptr<QueryCacheContext> query_cache_context,
       disk_cache::EntryResult result);
@@ -278,6 +288,20 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
       std::unique_ptr<QueryCacheContext> query_cache_context,
       disk_cache::ScopedEntryPtr entry,
       std::unique_ptr<proto::CacheMetadata> metadata);
+  void QueryCacheDidOpenSharedBody(
+      std::unique_ptr<QueryCacheContext> query_cache_context,
+      disk_cache::ScopedEntryPtr entry,
+      disk_cache::ScopedEntryPtr body_entry);
+  // Adds the bodies and entries the query asks for to the last match, read
+  // from |entry| and, if the body is shared, |body_entry|.
+  void QueryCachePopulateMatch(
+      std::unique_ptr<QueryCacheContext> query_cache_context,
+      disk_cache::ScopedEntryPtr entry,
+      disk_cache::ScopedEntryPtr body_entry);
+  // Dooms |entry|, found to be unreadable by a query, and drops it from the
+  // URL index.
+  void QueryCacheDoomEntry(QueryCacheContext* query_cache_context,
+                           disk_cache::ScopedEntryPtr entry);
   static bool QueryCacheResultCompare(const QueryCacheResult& lhs,
                                       const QueryCacheResult& rhs);
   static size_t EstimatedResponseSizeWithoutBlob(
@@ -368,6 +392,9 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
   void PutImpl(std::unique_ptr<PutContext> put_context);
   void PutDidDeleteEntry(std::unique_ptr<PutContext> put_context,
                          blink::mojom::CacheStorageError error);
+  void PutDidStoreSharedBody(std::unique_ptr<PutContext> put_context,
+                             const std::string& shared_body_key);
+  void PutOpenEntry(std::unique_ptr<PutContext> put_context);
   void PutDidGetUsageAndQuota(std::unique_ptr<PutContext> put_context,
                               blink::mojom::QuotaStatusCode status_code,
                               int64_t usage,
@@ -390,6 +417,34 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
                                    int rv);
   void PutComplete(std::unique_ptr<PutContext> put_context,
                    blink::mojom::CacheStorageError error);
+  // Keeps the entry written by a successful put.
+  void PutCommitEntry(PutContext* put_context);
+  // Drops the reference of the entry with |key| to the shared body with
+  // |shared_body_key|.
+  void ReleaseSharedBody(const std::string& shared_body_key,
+                         const std::string& key);
+
+  // Puts several responses, each to a different URL, as one operation that
+  // streams a few bodies into the cache at once. The new entries are only
+  // kept if every put succeeds, and the cache size is updated once for the
+  // whole batch.
+  void BatchPut(std::vector<blink::mojom::BatchOperationPtr> operations,
+                int64_t trace_id,
+                ErrorCallback callback);
+  void BatchPutImpl(std::unique_ptr<BatchPutContext> batch_put_context);
+  void BatchPutStartPuts();
+  void BatchPutDidPutOne(std::unique_ptr<PutContext> put_context,
+                         blink::mojom::CacheStorageError error);
+  void BatchPutComplete();
+  // Like DeleteImpl(), but leaves the cache size update to
+  // BatchPutComplete(). Used for the entries the batch replaces.
+  void BatchPutDeleteEntry(blink::mojom::FetchAPIRequestPtr request,
+                           blink::mojom::CacheQueryOptionsPtr match_options,
+                           ErrorCallback callback);
+  void BatchPutDidQueryEntry(
+      ErrorCallback callback,
+      blink::mojom::CacheStorageError error,
+      std::unique_ptr<QueryCacheResults> query_cache_results);
 
   // Asynchronously calculates the current cache size, notifies the quota
   // manager of any change from the last report, and sets cache_size_ to the new
@@ -420,6 +475,9 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
       ErrorCallback callback,
       blink::mojom::CacheStorageError error,
       std::unique_ptr<QueryCacheResults> query_cache_results);
+  // Dooms the entries of |query_cache_results| and removes their padding
+  // from the cache padding.
+  void DoomQueryCacheResults(QueryCacheResults* query_cache_results);
 
   // Keys callbacks.
   void KeysImpl(blink::mojom::FetchAPIRequestPtr request,
@@ -537,9 +595,21 @@ class CONTENT_EXPORT LegacyCacheStorageCache : public CacheStorageCache {
   CacheStorageCacheObserver* cache_observer_;
   std::unique_ptr<CacheStorageCacheEntryHandler> cache_entry_handler_;
 
+  // The origin's store of response bodies shared between caches, or nullptr
+  // if this cache does not use it.
+  scoped_refptr<LegacyCacheStorageBodyStore> body_store_;
+
+  // Lets ignoreSearch queries visit only the entries with a matching URL, and
+  // exact URL queries skip opening entries that do not exist.
+  LegacyCacheStorageUrlIndex url_index_;
+
   // Owns the elements of the list
   BlobToDiskCacheIDMap active_blob_to_disk_cache_writers_;
 
+  // Set while a BatchPut() operation runs. Puts report to it rather than
+  // completing on their own.
+  std::unique_ptr<BatchPutContext> batch_put_context_;
+
   // Whether or not to store data in disk or memory.
   bool memory_only_;
 
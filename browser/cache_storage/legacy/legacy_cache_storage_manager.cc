@@ -31,6 +31,7 @@
 #include "content/browser/cache_storage/cache_storage.h"
 #include "content/browser/cache_storage/cache_storage.pb.h"
 #include "content/browser/cache_storage/cache_storage_quota_client.h"
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_body_store.h"
 #include "content/browser/service_worker/service_worker_context_core.h"
 #include "net/base/url_util.h"
 #include "storage/browser/quota/quota_manager_proxy.h"
@@ -68,6 +69,12 @@ int64_t GetCacheStorageSize(const base::FilePath& base_path,
   // index file will also update the directory modify time slightly after
   // immediately invalidating it.  To avoid this we only look at the cache
   // directories and not the base directory containing the index itself.
+  // The index does not record the size of the bodies shared between caches.
+  if (base::PathExists(
+          base_path.AppendASCII(LegacyCacheStorageBodyStore::kDirName))) {
+    return CacheStorage::kSizeUnknown;
+  }
+
   int64_t storage_size = 0;
   for (int i = 0, max = index.cache_size(); i < max; ++i) {
     const proto::CacheStorageIndex::Cache& cache = index.cache(i);
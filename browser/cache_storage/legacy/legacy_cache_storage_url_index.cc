@@ -0,0 +1,123 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_url_index.h"
+
+#include <algorithm>
+
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+
+namespace content {
+
+LegacyCacheStorageUrlIndex::VaryInfo::VaryInfo() = default;
+LegacyCacheStorageUrlIndex::VaryInfo::VaryInfo(const VaryInfo& other) =
+    default;
+LegacyCacheStorageUrlIndex::VaryInfo::~VaryInfo() = default;
+
+LegacyCacheStorageUrlIndex::LegacyCacheStorageUrlIndex() = default;
+
+LegacyCacheStorageUrlIndex::~LegacyCacheStorageUrlIndex() = default;
+
+void LegacyCacheStorageUrlIndex::Reset() {
+  entries_.clear();
+  keys_by_url_without_query_.clear();
+  complete_ = false;
+}
+
+void LegacyCacheStorageUrlIndex::MarkComplete() {
+  complete_ = true;
+}
+
+void LegacyCacheStorageUrlIndex::AddKey(const std::string& key) {
+  if (!entries_.emplace(key, base::nullopt).second)
+    return;
+  keys_by_url_without_query_[StripQuery(GURL(key))].insert(key);
+}
+
+void LegacyCacheStorageUrlIndex::AddEntry(
+    const std::string& key,
+    const blink::FetchAPIRequestHeadersMap& cached_request_headers,
+    const ResponseHeaderMap& response_headers) {
+  AddKey(key);
+
+  VaryInfo vary_info;
+  auto vary_iter = std::find_if(
+      response_headers.begin(), response_headers.end(),
+      [](const ResponseHeaderMap::value_type& pair) -> bool {
+        return base::CompareCaseInsensitiveASCII(pair.first, "vary") == 0;
+      });
+  if (vary_iter != response_headers.end()) {
+    for (const std::string& trimmed :
+         base::SplitString(vary_iter->second, ",", base::TRIM_WHITESPACE,
+                           base::SPLIT_WANT_NONEMPTY)) {
+      if (trimmed == "*") {
+        vary_info.varies_on_everything = true;
+        vary_info.headers.clear();
+        break;
+      }
+      auto cached_iter = cached_request_headers.find(trimmed);
+      if (cached_iter == cached_request_headers.end())
+        vary_info.headers.emplace_back(trimmed, base::nullopt);
+      else
+        vary_info.headers.emplace_back(trimmed, cached_iter->second);
+    }
+  }
+  entries_[key] = std::move(vary_info);
+}
+
+void LegacyCacheStorageUrlIndex::RemoveKey(const std::string& key) {
+  if (!entries_.erase(key))
+    return;
+  auto it = keys_by_url_without_query_.find(StripQuery(GURL(key)));
+  if (it == keys_by_url_without_query_.end())
+    return;
+  it->second.erase(key);
+  if (it->second.empty())
+    keys_by_url_without_query_.erase(it);
+}
+
+bool LegacyCacheStorageUrlIndex::Contains(const std::string& key) const {
+  return entries_.find(key) != entries_.end();
+}
+
+std::vector<std::string> LegacyCacheStorageUrlIndex::FindIgnoringSearch(
+    const GURL& url) const {
+  auto it = keys_by_url_without_query_.find(StripQuery(url));
+  if (it == keys_by_url_without_query_.end())
+    return std::vector<std::string>();
+  return std::vector<std::string>(it->second.begin(), it->second.end());
+}
+
+bool LegacyCacheStorageUrlIndex::MayMatchVary(
+    const std::string& key,
+    const blink::FetchAPIRequestHeadersMap& request_headers) const {
+  auto it = entries_.find(key);
+  if (it == entries_.end() || !it->second)
+    return true;
+  const VaryInfo& vary_info = *it->second;
+  if (vary_info.varies_on_everything)
+    return false;
+
+  // Mirrors VaryMatches() in legacy_cache_storage_cache.cc.
+  for (const auto& header : vary_info.headers) {
+    auto request_iter = request_headers.find(header.first);
+    if ((request_iter == request_headers.end()) != !header.second)
+      return false;
+    if (request_iter != request_headers.end() &&
+        request_iter->second != *header.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// static
+std::string LegacyCacheStorageUrlIndex::StripQuery(const GURL& url) {
+  url::Replacements<char> replacements;
+  replacements.ClearQuery();
+  return url.ReplaceComponents(replacements).spec();
+}
+
+}  // namespace content
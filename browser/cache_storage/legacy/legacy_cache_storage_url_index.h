@@ -0,0 +1,101 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_CACHE_STORAGE_LEGACY_LEGACY_CACHE_STORAGE_URL_INDEX_H_
+#define CONTENT_BROWSER_CACHE_STORAGE_LEGACY_LEGACY_CACHE_STORAGE_URL_INDEX_H_
+
+#include <stddef.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/containers/flat_map.h"
+#include "base/macros.h"
+#include "base/optional.h"
+#include "content/common/content_export.h"
+#include "third_party/blink/public/common/fetch/fetch_api_request_headers_map.h"
+#include "url/gurl.h"
+
+namespace content {
+
+// An in-memory index of the entries of one LegacyCacheStorageCache, so that
+// queries which cannot open an entry by its exact URL (ignoreSearch) do not
+// have to open every entry in the disk cache and read its metadata.
+//
+// Entries are keyed by their disk_cache key (the request URL) and are also
+// indexed by that URL with the query removed. For each entry the index can
+// also record the request header values its response varies on, so entries
+// whose Vary headers rule out a match are skipped without being opened.
+//
+// The index is only usable once is_complete(), i.e. after it has seen every
+// key in the backend, which the cache achieves by recording the keys during a
+// full scan of the backend. From then on the cache keeps it up to date with
+// every put and delete. This class is not thread safe and is owned by the
+// LegacyCacheStorageCache.
+class CONTENT_EXPORT LegacyCacheStorageUrlIndex {
+ public:
+  using ResponseHeaderMap = base::flat_map<std::string, std::string>;
+
+  LegacyCacheStorageUrlIndex();
+  ~LegacyCacheStorageUrlIndex();
+
+  bool is_complete() const { return complete_; }
+  size_t size() const { return entries_.size(); }
+
+  // Empties the index and marks it incomplete, before rebuilding it.
+  void Reset();
+  void MarkComplete();
+
+  // Records the entry with |key|, keeping its Vary information if it is
+  // already known.
+  void AddKey(const std::string& key);
+
+  // Records the entry with |key| along with the Vary information of the
+  // request and response stored in it.
+  void AddEntry(const std::string& key,
+                const blink::FetchAPIRequestHeadersMap& cached_request_headers,
+                const ResponseHeaderMap& response_headers);
+
+  void RemoveKey(const std::string& key);
+
+  bool Contains(const std::string& key) const;
+
+  // Returns the keys of the entries whose URL matches |url| once the query
+  // of both is removed, in key order.
+  std::vector<std::string> FindIgnoringSearch(const GURL& url) const;
+
+  // Returns false if the recorded Vary information of the entry with |key|
+  // rules out a match for a request with |request_headers|. Returns true if
+  // it may match, including when nothing is known about the entry.
+  bool MayMatchVary(
+      const std::string& key,
+      const blink::FetchAPIRequestHeadersMap& request_headers) const;
+
+ private:
+  // The request header values a response varies on, as they were in the
+  // cached request. A header missing from the cached request has no value.
+  struct VaryInfo {
+    VaryInfo();
+    VaryInfo(const VaryInfo& other);
+    ~VaryInfo();
+
+    bool varies_on_everything = false;
+    std::vector<std::pair<std::string, base::Optional<std::string>>> headers;
+  };
+
+  static std::string StripQuery(const GURL& url);
+
+  std::map<std::string, base::Optional<VaryInfo>> entries_;
+  std::map<std::string, std::set<std::string>> keys_by_url_without_query_;
+  bool complete_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(LegacyCacheStorageUrlIndex);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_CACHE_STORAGE_LEGACY_LEGACY_CACHE_STORAGE_URL_INDEX_H_
@@ -0,0 +1,88 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/cache_storage/legacy/legacy_cache_storage_url_index.h"
+
+#include <string>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+namespace content {
+namespace {
+
+using ResponseHeaderMap = LegacyCacheStorageUrlIndex::ResponseHeaderMap;
+
+TEST(LegacyCacheStorageUrlIndexTest, AddAndRemoveKeys) {
+  LegacyCacheStorageUrlIndex index;
+  EXPECT_FALSE(index.is_complete());
+
+  index.AddKey("http://example.com/a?x=1");
+  index.AddKey("http://example.com/a?x=1");
+  index.AddEntry("http://example.com/b", {}, {});
+  index.MarkComplete();
+  EXPECT_TRUE(index.is_complete());
+  EXPECT_EQ(2u, index.size());
+  EXPECT_TRUE(index.Contains("http://example.com/a?x=1"));
+  EXPECT_FALSE(index.Contains("http://example.com/a"));
+
+  index.RemoveKey("http://example.com/a?x=1");
+  index.RemoveKey("http://example.com/missing");
+  EXPECT_EQ(1u, index.size());
+  EXPECT_FALSE(index.Contains("http://example.com/a?x=1"));
+  EXPECT_TRUE(index.FindIgnoringSearch(GURL("http://example.com/a")).empty());
+
+  index.Reset();
+  EXPECT_FALSE(index.is_complete());
+  EXPECT_EQ(0u, index.size());
+}
+
+TEST(LegacyCacheStorageUrlIndexTest, FindIgnoringSearch) {
+  LegacyCacheStorageUrlIndex index;
+  index.AddKey("http://example.com/a?y=2");
+  index.AddKey("http://example.com/a?x=1");
+  index.AddKey("http://example.com/a");
+  index.AddKey("http://example.com/ab");
+  index.AddKey("http://example.org/a?x=1");
+
+  const std::vector<std::string> expected = {
+      "http://example.com/a", "http://example.com/a?x=1",
+      "http://example.com/a?y=2"};
+  EXPECT_EQ(expected, index.FindIgnoringSearch(GURL("http://example.com/a")));
+  EXPECT_EQ(expected,
+            index.FindIgnoringSearch(GURL("http://example.com/a?z=3")));
+  EXPECT_TRUE(index.FindIgnoringSearch(GURL("http://example.com/")).empty());
+}
+
+TEST(LegacyCacheStorageUrlIndexTest, MayMatchVary) {
+  const std::string key = "http://example.com/a";
+  LegacyCacheStorageUrlIndex index;
+
+  // Nothing is known about entries added by key only.
+  index.AddKey(key);
+  EXPECT_TRUE(index.MayMatchVary(key, {{"accept", "text/html"}}));
+  EXPECT_TRUE(index.MayMatchVary("http://example.com/missing", {}));
+
+  index.AddEntry(key, {{"accept", "text/html"}},
+                 ResponseHeaderMap({{"Vary", "Accept, X-Missing"}}));
+  EXPECT_TRUE(index.MayMatchVary(key, {{"accept", "text/html"}}));
+  EXPECT_FALSE(index.MayMatchVary(key, {{"accept", "image/png"}}));
+  EXPECT_FALSE(index.MayMatchVary(key, {}));
+  EXPECT_FALSE(index.MayMatchVary(
+      key, {{"accept", "text/html"}, {"x-missing", "present"}}));
+
+  // Adding the key again keeps the Vary information.
+  index.AddKey(key);
+  EXPECT_FALSE(index.MayMatchVary(key, {{"accept", "image/png"}}));
+
+  index.AddEntry(key, {}, ResponseHeaderMap({{"vary", "Accept, *"}}));
+  EXPECT_FALSE(index.MayMatchVary(key, {}));
+
+  index.AddEntry(key, {{"accept", "text/html"}}, {});
+  EXPECT_TRUE(index.MayMatchVary(key, {{"accept", "image/png"}}));
+}
+
+}  // namespace
+}  // namespace content
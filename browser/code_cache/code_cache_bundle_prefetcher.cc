@@ -0,0 +1,135 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/code_cache/code_cache_bundle_prefetcher.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/ref_counted.h"
+#include "base/metrics/field_trial_params.h"
+#include "base/metrics/histogram_macros.h"
+#include "content/browser/code_cache/generated_code_cache.h"
+#include "content/common/code_cache_bundle.h"
+#include "content/public/browser/browser_thread.h"
+#include "mojo/public/cpp/base/big_buffer.h"
+
+namespace content {
+
+const base::Feature kCodeCacheBundle{"CodeCacheBundle",
+                                     base::FEATURE_DISABLED_BY_DEFAULT};
+
+namespace {
+
+// The number of scripts remembered for each origin lock.
+constexpr base::FeatureParam<int> kCodeCacheBundleMaxURLs{&kCodeCacheBundle,
+                                                          "max_urls", 32};
+// Entries that would make a bundle larger than this are left out.
+constexpr base::FeatureParam<int> kCodeCacheBundleMaxSizeKB{
+    &kCodeCacheBundle, "max_size_kb", 4 * 1024};
+
+// The number of origin locks to remember scripts for.
+constexpr size_t kMaxOriginLocks = 100;
+
+// Collects the entries fetched for one bundle, and runs the callback once all
+// the fetches have completed.
+class BundleBuilder : public base::RefCounted<BundleBuilder> {
+ public:
+  BundleBuilder(size_t fetch_count,
+                size_t max_size_bytes,
+                CodeCacheBundlePrefetcher::PrefetchCallback callback)
+      : pending_fetch_count_(fetch_count),
+        max_size_bytes_(max_size_bytes),
+        callback_(std::move(callback)) {}
+
+  void OnFetched(const GURL& url,
+                 const base::Time& response_time,
+                 mojo_base::BigBuffer data) {
+    if (data.size() > 0 && size_bytes_ + data.size() <= max_size_bytes_) {
+      size_bytes_ += data.size();
+      entries_.emplace_back(url, response_time, std::move(data));
+    }
+
+    DCHECK_GT(pending_fetch_count_, 0u);
+    if (--pending_fetch_count_ > 0)
+      return;
+
+    UMA_HISTOGRAM_COUNTS_100("SiteIsolatedCodeCache.JS.Bundle.EntryCount",
+                             entries_.size());
+    if (entries_.empty()) {
+      std::move(callback_).Run(base::ReadOnlySharedMemoryRegion());
+      return;
+    }
+    std::move(callback_).Run(CodeCacheBundle::Serialize(entries_));
+  }
+
+ private:
+  friend class base::RefCounted<BundleBuilder>;
+  ~BundleBuilder() = default;
+
+  size_t pending_fetch_count_;
+  const size_t max_size_bytes_;
+  size_t size_bytes_ = 0;
+  std::vector<CodeCacheBundle::Entry> entries_;
+  CodeCacheBundlePrefetcher::PrefetchCallback callback_;
+
+  DISALLOW_COPY_AND_ASSIGN(BundleBuilder);
+};
+
+}  // namespace
+
+CodeCacheBundlePrefetcher::CodeCacheBundlePrefetcher(
+    GeneratedCodeCache* code_cache)
+    : code_cache_(code_cache),
+      max_urls_per_origin_lock_(std::max(0, kCodeCacheBundleMaxURLs.Get())),
+      recorded_urls_(kMaxOriginLocks) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+}
+
+CodeCacheBundlePrefetcher::~CodeCacheBundlePrefetcher() {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+}
+
+void CodeCacheBundlePrefetcher::RecordFetch(const GURL& origin_lock,
+                                            const GURL& url) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (max_urls_per_origin_lock_ == 0)
+    return;
+
+  auto it = recorded_urls_.Get(origin_lock);
+  if (it == recorded_urls_.end())
+    it = recorded_urls_.Put(origin_lock, std::vector<GURL>());
+  std::vector<GURL>& urls = it->second;
+  auto url_it = std::find(urls.begin(), urls.end(), url);
+  if (url_it != urls.end())
+    urls.erase(url_it);
+  else if (urls.size() == max_urls_per_origin_lock_)
+    urls.erase(urls.begin());
+  urls.push_back(url);
+}
+
+void CodeCacheBundlePrefetcher::Prefetch(const GURL& origin_lock,
+                                         PrefetchCallback callback) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  auto it = recorded_urls_.Peek(origin_lock);
+  if (it == recorded_urls_.end()) {
+    std::move(callback).Run(base::ReadOnlySharedMemoryRegion());
+    return;
+  }
+
+  const std::vector<GURL>& urls = it->second;
+  auto builder = base::MakeRefCounted<BundleBuilder>(
+      urls.size(),
+      static_cast<size_t>(std::max(0, kCodeCacheBundleMaxSizeKB.Get())) * 1024,
+      std::move(callback));
+  for (const GURL& url : urls) {
+    code_cache_->FetchEntry(
+        url, origin_lock,
+        base::BindRepeating(&BundleBuilder::OnFetched, builder, url));
+  }
+}
+
+}  // namespace content
@@ -0,0 +1,63 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_CODE_CACHE_CODE_CACHE_BUNDLE_PREFETCHER_H_
+#define CONTENT_BROWSER_CODE_CACHE_CODE_CACHE_BUNDLE_PREFETCHER_H_
+
+#include <vector>
+
+#include "base/callback.h"
+#include "base/containers/mru_cache.h"
+#include "base/feature_list.h"
+#include "base/macros.h"
+#include "base/memory/read_only_shared_memory_region.h"
+#include "content/common/content_export.h"
+#include "url/gurl.h"
+
+namespace content {
+
+class GeneratedCodeCache;
+
+// Prefetches a CodeCacheBundle for each main frame navigation, and sends it to
+// the renderer that commits the navigation.
+CONTENT_EXPORT extern const base::Feature kCodeCacheBundle;
+
+// Predicts the scripts that a renderer locked to an origin will fetch from the
+// JavaScript code cache, from the scripts fetched by renderers locked to the
+// same origin before, and prefetches their entries into a CodeCacheBundle.
+//
+// There is one instance per GeneratedCodeCacheContext. It lives on the UI
+// thread.
+class CONTENT_EXPORT CodeCacheBundlePrefetcher {
+ public:
+  // Runs with the bundle, or with an invalid region if there is nothing to
+  // prefetch.
+  using PrefetchCallback =
+      base::OnceCallback<void(base::ReadOnlySharedMemoryRegion)>;
+
+  explicit CodeCacheBundlePrefetcher(GeneratedCodeCache* code_cache);
+  ~CodeCacheBundlePrefetcher();
+
+  // Records that a renderer locked to |origin_lock| fetched the code cache
+  // entry of |url|.
+  void RecordFetch(const GURL& origin_lock, const GURL& url);
+
+  // Fetches the entries recorded for |origin_lock| and runs |callback| with
+  // the ones found. |callback| is not run if the code cache is destroyed
+  // first.
+  void Prefetch(const GURL& origin_lock, PrefetchCallback callback);
+
+ private:
+  GeneratedCodeCache* const code_cache_;
+  const size_t max_urls_per_origin_lock_;
+
+  // The URLs recorded for each origin lock, most recent last.
+  base::MRUCache<GURL, std::vector<GURL>> recorded_urls_;
+
+  DISALLOW_COPY_AND_ASSIGN(CodeCacheBundlePrefetcher);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_CODE_CACHE_CODE_CACHE_BUNDLE_PREFETCHER_H_
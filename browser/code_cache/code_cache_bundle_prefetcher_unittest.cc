@@ -0,0 +1,133 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/code_cache/code_cache_bundle_prefetcher.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/scoped_feature_list.h"
+#include "content/browser/code_cache/generated_code_cache.h"
+#include "content/common/code_cache_bundle.h"
+#include "content/public/test/browser_task_environment.h"
+#include "net/disk_cache/disk_cache.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+
+namespace {
+
+constexpr char kOriginLock[] = "https://example.com/";
+constexpr char kOtherOriginLock[] = "https://other.com/";
+
+class CodeCacheBundlePrefetcherTest : public testing::Test {
+ public:
+  void SetUp() override {
+    scoped_feature_list_.InitAndEnableFeatureWithParameters(
+        kCodeCacheBundle, {{"max_urls", "2"}});
+    ASSERT_TRUE(cache_dir_.CreateUniqueTempDir());
+    code_cache_ = std::make_unique<GeneratedCodeCache>(
+        cache_dir_.GetPath(), 1024 * 1024,
+        GeneratedCodeCache::CodeCacheType::kJavaScript);
+    prefetcher_ =
+        std::make_unique<CodeCacheBundlePrefetcher>(code_cache_.get());
+  }
+
+  void TearDown() override {
+    prefetcher_.reset();
+    disk_cache::FlushCacheThreadForTesting();
+    code_cache_.reset();
+    task_environment_.RunUntilIdle();
+  }
+
+  void Write(const GURL& url, const std::string& data) {
+    code_cache_->WriteEntry(url, GURL(kOriginLock), base::Time::Now(),
+                            std::vector<uint8_t>(data.begin(), data.end()));
+  }
+
+  // Returns null if the prefetch found nothing.
+  std::unique_ptr<CodeCacheBundle> Prefetch(const GURL& origin_lock) {
+    base::ReadOnlySharedMemoryRegion result;
+    bool called = false;
+    prefetcher_->Prefetch(
+        origin_lock,
+        base::BindOnce(
+            [](base::ReadOnlySharedMemoryRegion* result, bool* called,
+               base::ReadOnlySharedMemoryRegion region) {
+              *result = std::move(region);
+              *called = true;
+            },
+            &result, &called));
+    task_environment_.RunUntilIdle();
+    EXPECT_TRUE(called);
+    if (!result.IsValid())
+      return nullptr;
+    return CodeCacheBundle::Create(std::move(result));
+  }
+
+ protected:
+  BrowserTaskEnvironment task_environment_;
+  base::test::ScopedFeatureList scoped_feature_list_;
+  base::ScopedTempDir cache_dir_;
+  std::unique_ptr<GeneratedCodeCache> code_cache_;
+  std::unique_ptr<CodeCacheBundlePrefetcher> prefetcher_;
+};
+
+TEST_F(CodeCacheBundlePrefetcherTest, PrefetchRecordedFetches) {
+  const GURL url1("https://example.com/script1.js");
+  const GURL url2("https://example.com/script2.js");
+  const GURL missing_url("https://example.com/missing.js");
+  Write(url1, "data1");
+  Write(url2, "data2");
+  task_environment_.RunUntilIdle();
+
+  EXPECT_FALSE(Prefetch(GURL(kOriginLock)));
+
+  prefetcher_->RecordFetch(GURL(kOriginLock), url1);
+  prefetcher_->RecordFetch(GURL(kOriginLock), missing_url);
+  std::unique_ptr<CodeCacheBundle> bundle = Prefetch(GURL(kOriginLock));
+  ASSERT_TRUE(bundle);
+  EXPECT_EQ(1u, bundle->size());
+  base::Time response_time;
+  mojo_base::BigBuffer data;
+  ASSERT_TRUE(bundle->TakeEntry(url1, &response_time, &data));
+  EXPECT_EQ("data1", std::string(data.data(), data.data() + data.size()));
+
+  // Fetches are recorded per origin lock.
+  EXPECT_FALSE(Prefetch(GURL(kOtherOriginLock)));
+}
+
+TEST_F(CodeCacheBundlePrefetcherTest, MaxURLs) {
+  std::vector<GURL> urls;
+  for (int i = 0; i < 3; ++i) {
+    urls.emplace_back("https://example.com/script" + base::NumberToString(i) +
+                      ".js");
+    Write(urls.back(), "data");
+  }
+  task_environment_.RunUntilIdle();
+
+  // Only the two most recently recorded URLs are kept. Recording a URL again
+  // makes it the most recent.
+  prefetcher_->RecordFetch(GURL(kOriginLock), urls[0]);
+  prefetcher_->RecordFetch(GURL(kOriginLock), urls[1]);
+  prefetcher_->RecordFetch(GURL(kOriginLock), urls[0]);
+  prefetcher_->RecordFetch(GURL(kOriginLock), urls[2]);
+
+  std::unique_ptr<CodeCacheBundle> bundle = Prefetch(GURL(kOriginLock));
+  ASSERT_TRUE(bundle);
+  EXPECT_EQ(2u, bundle->size());
+  base::Time response_time;
+  mojo_base::BigBuffer data;
+  EXPECT_TRUE(bundle->TakeEntry(urls[0], &response_time, &data));
+  EXPECT_FALSE(bundle->TakeEntry(urls[1], &response_time, &data));
+  EXPECT_TRUE(bundle->TakeEntry(urls[2], &response_time, &data));
+}
+
+}  // namespace
+
+}  // namespace content
@@ -17,8 +17,18 @@
 
 namespace content {
 
+const base::Feature kCodeCacheMemoryTier{"CodeCacheMemoryTier",
+                                         base::FEATURE_DISABLED_BY_DEFAULT};
+
 namespace {
 
+// The size budget of the memory tier of each cache, and of each origin lock
+// within it.
+constexpr base::FeatureParam<int> kCodeCacheMemoryTierMaxSizeKB{
+    &kCodeCacheMemoryTier, "max_size_kb", 16 * 1024};
+constexpr base::FeatureParam<int> kCodeCacheMemoryTierMaxOriginLockSizeKB{
+    &kCodeCacheMemoryTier, "max_origin_lock_size_kb", 4 * 1024};
+
 constexpr char kPrefix[] = "_key";
 constexpr char kSeparator[] = " \n";
 
@@ -71,6 +81,14 @@ std::string GetCacheKey(const GURL& resource_url, const GURL& origin_lock) {
   return key;
 }
 
+// Returns the origin lock part of a key generated by |GetCacheKey|, which is
+// used to shard the memory tier.
+std::string GetOriginLockFromKey(const std::string& key) {
+  const size_t separator_index = key.find(kSeparator);
+  DCHECK_NE(std::string::npos, separator_index);
+  return key.substr(separator_index + base::size(kSeparator) - 1);
+}
+
 constexpr size_t kResponseTimeSizeInBytes = sizeof(int64_t);
 constexpr size_t kDataSizeInBytes = sizeof(uint32_t);
 constexpr size_t kHeaderSizeInBytes =
@@ -212,6 +230,17 @@ void GeneratedCodeCache::CollectStatistics(
   }
 }
 
+void GeneratedCodeCache::CollectMemoryTierStatistics(bool hit) {
+  switch (cache_type_) {
+    case GeneratedCodeCache::CodeCacheType::kJavaScript:
+      UMA_HISTOGRAM_BOOLEAN("SiteIsolatedCodeCache.JS.MemoryTier.Hit", hit);
+      break;
+    case GeneratedCodeCache::CodeCacheType::kWebAssembly:
+      UMA_HISTOGRAM_BOOLEAN("SiteIsolatedCodeCache.WASM.MemoryTier.Hit", hit);
+      break;
+  }
+}
+
 // Stores the information about a pending request while disk backend is
 // being initialized or another request for the same key is live.
 class GeneratedCodeCache::PendingOperation {
@@ -280,6 +309,16 @@ class GeneratedCodeCache::PendingOperation {
     large_buffer_ = large_buffer;
   }
 
+  // The memory tier generation when a Fetch operation was created.
+  int memory_tier_generation() const {
+    DCHECK_EQ(Operation::kFetch, op_);
+    return memory_tier_generation_;
+  }
+  void set_memory_tier_generation(int generation) {
+    DCHECK_EQ(Operation::kFetch, op_);
+    memory_tier_generation_ = generation;
+  }
+
   // This returns the site-specific response time for merged code entries.
   const base::Time& response_time() const {
     DCHECK_EQ(Operation::kFetchWithSHAKey, op_);
@@ -310,6 +349,7 @@ class GeneratedCodeCache::PendingOperation {
   GetBackendCallback backend_callback_;
   int completions_ = 0;
   bool succeeded_ = true;
+  int memory_tier_generation_ = 0;
 };
 
 GeneratedCodeCache::PendingOperation::~PendingOperation() = default;
@@ -321,12 +361,25 @@ GeneratedCodeCache::GeneratedCodeCache(const base::FilePath& path,
       path_(path),
       max_size_bytes_(max_size_bytes),
       cache_type_(cache_type) {
+  if (base::FeatureList::IsEnabled(kCodeCacheMemoryTier)) {
+    memory_tier_ = std::make_unique<GeneratedCodeCacheMemoryTier>(
+        base::saturated_cast<size_t>(kCodeCacheMemoryTierMaxSizeKB.Get()) *
+            1024,
+        base::saturated_cast<size_t>(
+            kCodeCacheMemoryTierMaxOriginLockSizeKB.Get()) *
+            1024);
+    memory_pressure_listener_ = std::make_unique<base::MemoryPressureListener>(
+        base::BindRepeating(&GeneratedCodeCache::OnMemoryPressure,
+                            base::Unretained(this)));
+  }
   CreateBackend();
 }
 
 GeneratedCodeCache::~GeneratedCodeCache() = default;
 
 void GeneratedCodeCache::GetBackend(GetBackendCallback callback) {
+  // The caller may remove entries from the backend directly.
+  ClearMemoryTier();
   switch (backend_state_) {
     case kFailed:
       std::move(callback).Run(nullptr);
@@ -355,6 +408,18 @@ void GeneratedCodeCache::WriteEntry(const GURL& url,
   if (data.size() >= std::numeric_limits<int32_t>::max())
     return;
 
+  std::string key = GetCacheKey(url, origin_lock);
+  if (memory_tier_) {
+    // Very large data is deduplicated on disk, so it is not kept in memory
+    // once per origin lock.
+    if (data.size() <= GetLargeDataLimit()) {
+      memory_tier_->Put(GetOriginLockFromKey(key), key, response_time,
+                        base::make_span(data.data(), data.size()));
+    } else {
+      memory_tier_->Remove(GetOriginLockFromKey(key), key);
+    }
+  }
+
   scoped_refptr<net::IOBufferWithSize> small_buffer;
   scoped_refptr<BigIOBuffer> large_buffer;
   uint32_t data_size = static_cast<uint32_t>(data.size());
@@ -408,7 +473,6 @@ void GeneratedCodeCache::WriteEntry(const GURL& url,
   WriteCommonDataHeader(small_buffer, response_time, data_size);
 
   // Create the write operation.
-  std::string key = GetCacheKey(url, origin_lock);
   auto op = std::make_unique<PendingOperation>(Operation::kWrite, key,
                                                small_buffer, large_buffer);
   EnqueueOperation(std::move(op));
@@ -425,8 +489,22 @@ void GeneratedCodeCache::FetchEntry(const GURL& url,
   }
 
   std::string key = GetCacheKey(url, origin_lock);
+  if (memory_tier_) {
+    base::Time response_time;
+    mojo_base::BigBuffer data;
+    bool hit = memory_tier_->Get(GetOriginLockFromKey(key), key,
+                                 &response_time, &data);
+    CollectMemoryTierStatistics(hit);
+    if (hit) {
+      CollectStatistics(CacheEntryStatus::kHit);
+      std::move(read_data_callback).Run(response_time, std::move(data));
+      return;
+    }
+  }
+
   auto op = std::make_unique<PendingOperation>(Operation::kFetch, key,
                                                std::move(read_data_callback));
+  op->set_memory_tier_generation(memory_tier_generation_);
   EnqueueOperation(std::move(op));
 }
 
@@ -438,6 +516,8 @@ void GeneratedCodeCache::DeleteEntry(const GURL& url, const GURL& origin_lock) {
   }
 
   std::string key = GetCacheKey(url, origin_lock);
+  if (memory_tier_)
+    memory_tier_->Remove(GetOriginLockFromKey(key), key);
   auto op = std::make_unique<PendingOperation>(Operation::kDelete, key);
   EnqueueOperation(std::move(op));
 }
@@ -631,6 +711,8 @@ void GeneratedCodeCache::WriteComplete(PendingOperation* op) {
     // The write failed; record the failure and doom the entry here.
     CollectStatistics(CacheEntryStatus::kWriteFailed);
     DoomEntry(op);
+    if (memory_tier_ && op->operation() == Operation::kWrite)
+      memory_tier_->Remove(GetOriginLockFromKey(op->key()), op->key());
   }
   CloseOperationAndIssueNext(op);
 }
@@ -752,9 +834,16 @@ void GeneratedCodeCache::ReadComplete(PendingOperation* op) {
         mojo_base::BigBuffer data(data_size);
         memcpy(data.data(), op->small_buffer()->data() + kHeaderSizeInBytes,
                data_size);
+        MaybeAddToMemoryTier(op, response_time,
+                             base::make_span(data.data(), data.size()));
         op->TakeReadCallback().Run(response_time, std::move(data));
       } else if (data_size <= GetLargeDataLimit()) {
         // Large data below the merging threshold. Return the large buffer.
+        MaybeAddToMemoryTier(
+            op, response_time,
+            base::make_span(
+                reinterpret_cast<const uint8_t*>(op->large_buffer()->data()),
+                op->large_buffer()->size()));
         op->TakeReadCallback().Run(response_time,
                                    op->large_buffer()->TakeBuffer());
       } else {
@@ -854,6 +943,39 @@ void GeneratedCodeCache::DoPendingGetBackend(PendingOperation* op) {
   }
 }
 
+void GeneratedCodeCache::MaybeAddToMemoryTier(
+    PendingOperation* op,
+    const base::Time& response_time,
+    base::span<const uint8_t> data) {
+  DCHECK_EQ(Operation::kFetch, op->operation());
+  if (!memory_tier_ || op->memory_tier_generation() != memory_tier_generation_)
+    return;
+  // If a write or delete of the entry is queued behind |op|, the memory tier
+  // already reflects it and the data read by |op| is stale.
+  auto it = active_entries_map_.find(op->key());
+  DCHECK(it != active_entries_map_.end());
+  if (it->second.size() > 1)
+    return;
+  memory_tier_->Put(GetOriginLockFromKey(op->key()), op->key(), response_time,
+                    data);
+}
+
+void GeneratedCodeCache::ClearMemoryTier() {
+  if (!memory_tier_)
+    return;
+  memory_tier_->Clear();
+  memory_tier_generation_++;
+}
+
+void GeneratedCodeCache::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
+  if (memory_pressure_level <
+      base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE) {
+    return;
+  }
+  ClearMemoryTier();
+}
+
 void GeneratedCodeCache::SetLastUsedTimeForTest(
     const GURL& resource_url,
     const GURL& origin_lock,
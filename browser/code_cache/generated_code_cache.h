@@ -9,9 +9,12 @@
 
 #include "base/containers/queue.h"
 #include "base/containers/span.h"
+#include "base/feature_list.h"
 #include "base/files/file_path.h"
 #include "base/macros.h"
+#include "base/memory/memory_pressure_listener.h"
 #include "base/memory/weak_ptr.h"
+#include "content/browser/code_cache/generated_code_cache_memory_tier.h"
 #include "content/common/content_export.h"
 #include "mojo/public/cpp/base/big_buffer.h"
 #include "net/base/io_buffer.h"
@@ -20,6 +23,10 @@
 
 namespace content {
 
+// Keeps recently used entries of each GeneratedCodeCache in memory, in a
+// GeneratedCodeCacheMemoryTier in front of the disk backend.
+CONTENT_EXPORT extern const base::Feature kCodeCacheMemoryTier;
+
 // Cache for storing generated code from the renderer on the disk. This cache
 // uses |resource_url| + |origin_lock| as a key for storing the generated code.
 // |resource_url| is the url corresponding to the requested resource.
@@ -36,7 +43,9 @@ namespace content {
 // is safe to use only |resource_url| as the key in such cases.
 //
 // This uses a simple disk_cache backend. It just stores one data stream and
-// stores response_time + generated code as one data blob.
+// stores response_time + generated code as one data blob. When
+// kCodeCacheMemoryTier is enabled, entries that are not deduplicated are also
+// kept in memory once written or fetched, and fetched from there.
 //
 // There exists one cache per storage partition and is owned by the storage
 // partition. This cache is created, accessed and destroyed on the I/O
@@ -82,7 +91,7 @@ class CONTENT_EXPORT GeneratedCodeCache {
   // Runs the callback with a raw pointer to the backend. If we could not create
   // the backend then it will return a null. This runs the callback
   // synchronously if the backend is already open or asynchronously on the
-  // completion of a pending backend creation.
+  // completion of a pending backend creation. This clears the memory tier.
   void GetBackend(GetBackendCallback callback);
 
   // Writes data to the cache. If there is an entry corresponding to
@@ -184,6 +193,15 @@ class CONTENT_EXPORT GeneratedCodeCache {
       disk_cache::EntryResult result);
 
   void CollectStatistics(GeneratedCodeCache::CacheEntryStatus status);
+  void CollectMemoryTierStatistics(bool hit);
+
+  // Adds the data read by |op| to the memory tier, unless it may be stale.
+  void MaybeAddToMemoryTier(PendingOperation* op,
+                            const base::Time& response_time,
+                            base::span<const uint8_t> data);
+  void ClearMemoryTier();
+  void OnMemoryPressure(
+      base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level);
 
   std::unique_ptr<disk_cache::Backend> backend_;
   BackendState backend_state_;
@@ -199,6 +217,14 @@ class CONTENT_EXPORT GeneratedCodeCache {
   int max_size_bytes_;
   CodeCacheType cache_type_;
 
+  // Null unless kCodeCacheMemoryTier is enabled.
+  std::unique_ptr<GeneratedCodeCacheMemoryTier> memory_tier_;
+  std::unique_ptr<base::MemoryPressureListener> memory_pressure_listener_;
+  // Incremented each time the memory tier is cleared. A fetch that was issued
+  // before the tier was cleared may have read an entry that has since been
+  // removed from the backend, so its data is not added to the tier.
+  int memory_tier_generation_ = 0;
+
   base::WeakPtrFactory<GeneratedCodeCache> weak_ptr_factory_{this};
 
   DISALLOW_COPY_AND_ASSIGN(GeneratedCodeCache);
@@ -5,6 +5,7 @@
 #include "base/bind.h"
 #include "base/files/file_path.h"
 #include "base/task/post_task.h"
+#include "content/browser/code_cache/code_cache_bundle_prefetcher.h"
 #include "content/browser/code_cache/generated_code_cache.h"
 #include "content/public/browser/browser_task_traits.h"
 #include "content/public/browser/browser_thread.h"
@@ -27,10 +28,16 @@ void GeneratedCodeCacheContext::Initialize(const base::FilePath& path,
   generated_wasm_code_cache_.reset(
       new GeneratedCodeCache(path.AppendASCII("wasm"), max_bytes,
                              GeneratedCodeCache::CodeCacheType::kWebAssembly));
+
+  if (base::FeatureList::IsEnabled(kCodeCacheBundle)) {
+    code_cache_bundle_prefetcher_ = std::make_unique<CodeCacheBundlePrefetcher>(
+        generated_js_code_cache_.get());
+  }
 }
 
 void GeneratedCodeCacheContext::Shutdown() {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  code_cache_bundle_prefetcher_.reset();
   generated_js_code_cache_.reset();
   generated_wasm_code_cache_.reset();
 }
@@ -46,6 +53,12 @@ GeneratedCodeCache* GeneratedCodeCacheContext::generated_wasm_code_cache()
   return generated_wasm_code_cache_.get();
 }
 
+CodeCacheBundlePrefetcher*
+GeneratedCodeCacheContext::code_cache_bundle_prefetcher() const {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  return code_cache_bundle_prefetcher_.get();
+}
+
 GeneratedCodeCacheContext::~GeneratedCodeCacheContext() = default;
 
 }  // namespace content
@@ -12,6 +12,7 @@
 
 namespace content {
 
+class CodeCacheBundlePrefetcher;
 class GeneratedCodeCache;
 
 // One instance exists per disk-backed (non in-memory) storage contexts. This
@@ -34,6 +35,8 @@ class CONTENT_EXPORT GeneratedCodeCacheContext
 
   GeneratedCodeCache* generated_js_code_cache() const;
   GeneratedCodeCache* generated_wasm_code_cache() const;
+  // Null unless kCodeCacheBundle is enabled.
+  CodeCacheBundlePrefetcher* code_cache_bundle_prefetcher() const;
 
  private:
   friend class base::RefCountedThreadSafe<GeneratedCodeCacheContext>;
@@ -42,6 +45,7 @@ class CONTENT_EXPORT GeneratedCodeCacheContext
   // Created, used and deleted on the UI thread.
   std::unique_ptr<GeneratedCodeCache> generated_js_code_cache_;
   std::unique_ptr<GeneratedCodeCache> generated_wasm_code_cache_;
+  std::unique_ptr<CodeCacheBundlePrefetcher> code_cache_bundle_prefetcher_;
 
   DISALLOW_COPY_AND_ASSIGN(GeneratedCodeCacheContext);
 };
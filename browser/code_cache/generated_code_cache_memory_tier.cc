@@ -0,0 +1,123 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/code_cache/generated_code_cache_memory_tier.h"
+
+#include <utility>
+
+#include "base/check_op.h"
+
+namespace content {
+
+GeneratedCodeCacheMemoryTier::Entry::Entry(base::Time response_time,
+                                           base::span<const uint8_t> data)
+    : response_time(response_time), data(data.begin(), data.end()) {}
+
+GeneratedCodeCacheMemoryTier::Entry::Entry(Entry&& other) = default;
+
+GeneratedCodeCacheMemoryTier::Entry::~Entry() = default;
+
+GeneratedCodeCacheMemoryTier::Shard::Shard()
+    : entries(base::MRUCache<std::string, Entry>::NO_AUTO_EVICT) {}
+
+GeneratedCodeCacheMemoryTier::Shard::~Shard() = default;
+
+GeneratedCodeCacheMemoryTier::GeneratedCodeCacheMemoryTier(
+    size_t max_size_bytes,
+    size_t max_shard_size_bytes)
+    : max_size_bytes_(max_size_bytes),
+      max_shard_size_bytes_(max_shard_size_bytes),
+      shards_(ShardMap::NO_AUTO_EVICT) {}
+
+GeneratedCodeCacheMemoryTier::~GeneratedCodeCacheMemoryTier() = default;
+
+bool GeneratedCodeCacheMemoryTier::Get(const std::string& origin_lock,
+                                       const std::string& key,
+                                       base::Time* response_time,
+                                       mojo_base::BigBuffer* data) {
+  auto shard_it = shards_.Get(origin_lock);
+  if (shard_it == shards_.end())
+    return false;
+  auto it = shard_it->second->entries.Get(key);
+  if (it == shard_it->second->entries.end())
+    return false;
+
+  *response_time = it->second.response_time;
+  *data = mojo_base::BigBuffer(it->second.data);
+  return true;
+}
+
+void GeneratedCodeCacheMemoryTier::Put(const std::string& origin_lock,
+                                       const std::string& key,
+                                       base::Time response_time,
+                                       base::span<const uint8_t> data) {
+  Remove(origin_lock, key);
+
+  const size_t entry_size = key.size() + data.size();
+  if (entry_size > max_shard_size_bytes_ || entry_size > max_size_bytes_)
+    return;
+  Entry entry(response_time, data);
+
+  auto shard_it = shards_.Get(origin_lock);
+  if (shard_it == shards_.end())
+    shard_it = shards_.Put(origin_lock, std::make_unique<Shard>());
+  Shard* shard = shard_it->second.get();
+
+  // Make room in the shard. It is not left empty since the entry fits in it.
+  while (shard->size_bytes + entry_size > max_shard_size_bytes_)
+    EvictLeastRecentlyUsed(shard);
+  shard->entries.Put(key, std::move(entry));
+  shard->size_bytes += entry_size;
+  size_bytes_ += entry_size;
+
+  // Then make room in the tier, starting from the least recently used shard.
+  // The entry just added goes last, and fits on its own.
+  while (size_bytes_ > max_size_bytes_) {
+    auto lru_shard_it = shards_.rbegin();
+    EvictLeastRecentlyUsed(lru_shard_it->second.get());
+    if (lru_shard_it->second->entries.empty())
+      shards_.Erase(lru_shard_it);
+  }
+}
+
+void GeneratedCodeCacheMemoryTier::Remove(const std::string& origin_lock,
+                                          const std::string& key) {
+  auto shard_it = shards_.Peek(origin_lock);
+  if (shard_it == shards_.end())
+    return;
+  Shard* shard = shard_it->second.get();
+  auto it = shard->entries.Peek(key);
+  if (it == shard->entries.end())
+    return;
+
+  const size_t entry_size = EntrySize(it->first, it->second);
+  shard->entries.Erase(it);
+  shard->size_bytes -= entry_size;
+  size_bytes_ -= entry_size;
+  if (shard->entries.empty())
+    shards_.Erase(shard_it);
+}
+
+void GeneratedCodeCacheMemoryTier::Clear() {
+  shards_.Clear();
+  size_bytes_ = 0;
+}
+
+// static
+size_t GeneratedCodeCacheMemoryTier::EntrySize(const std::string& key,
+                                               const Entry& entry) {
+  return key.size() + entry.data.size();
+}
+
+void GeneratedCodeCacheMemoryTier::EvictLeastRecentlyUsed(Shard* shard) {
+  DCHECK(!shard->entries.empty());
+  auto it = shard->entries.rbegin();
+  const size_t entry_size = EntrySize(it->first, it->second);
+  shard->entries.Erase(it);
+  DCHECK_GE(shard->size_bytes, entry_size);
+  shard->size_bytes -= entry_size;
+  size_bytes_ -= entry_size;
+}
+
+}  // namespace content
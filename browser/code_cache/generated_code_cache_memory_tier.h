@@ -0,0 +1,93 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_CODE_CACHE_GENERATED_CODE_CACHE_MEMORY_TIER_H_
+#define CONTENT_BROWSER_CODE_CACHE_GENERATED_CODE_CACHE_MEMORY_TIER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/containers/mru_cache.h"
+#include "base/containers/span.h"
+#include "base/macros.h"
+#include "base/time/time.h"
+#include "content/common/content_export.h"
+#include "mojo/public/cpp/base/big_buffer.h"
+
+namespace content {
+
+// Keeps recently used code cache entries of a GeneratedCodeCache in memory, so
+// that fetching them again does not go through the disk backend.
+//
+// Entries are sharded by origin lock. Each shard has its own LRU list and its
+// own size budget, so that a site loading many scripts cannot evict the code
+// of every other site. When the total size is over its budget, entries are
+// evicted from the least recently used shard first.
+class CONTENT_EXPORT GeneratedCodeCacheMemoryTier {
+ public:
+  GeneratedCodeCacheMemoryTier(size_t max_size_bytes,
+                               size_t max_shard_size_bytes);
+  ~GeneratedCodeCacheMemoryTier();
+
+  // Returns true and fills |response_time| and |data| if there is an entry
+  // for |key| in the shard of |origin_lock|.
+  bool Get(const std::string& origin_lock,
+           const std::string& key,
+           base::Time* response_time,
+           mojo_base::BigBuffer* data);
+
+  // Adds or replaces the entry for |key|. An entry that does not fit in a
+  // shard is not kept, and the older entry for |key| is removed.
+  void Put(const std::string& origin_lock,
+           const std::string& key,
+           base::Time response_time,
+           base::span<const uint8_t> data);
+
+  void Remove(const std::string& origin_lock, const std::string& key);
+
+  void Clear();
+
+  size_t size_bytes() const { return size_bytes_; }
+
+ private:
+  struct Entry {
+    Entry(base::Time response_time, base::span<const uint8_t> data);
+    Entry(Entry&& other);
+    ~Entry();
+
+    base::Time response_time;
+    std::vector<uint8_t> data;
+  };
+
+  struct Shard {
+    Shard();
+    ~Shard();
+
+    base::MRUCache<std::string, Entry> entries;
+    size_t size_bytes = 0;
+  };
+
+  using ShardMap = base::MRUCache<std::string, std::unique_ptr<Shard>>;
+
+  static size_t EntrySize(const std::string& key, const Entry& entry);
+
+  // Removes the least recently used entry of |shard|, which must not be
+  // empty. The caller removes the shard once it is empty.
+  void EvictLeastRecentlyUsed(Shard* shard);
+
+  const size_t max_size_bytes_;
+  const size_t max_shard_size_bytes_;
+  size_t size_bytes_ = 0;
+  ShardMap shards_;
+
+  DISALLOW_COPY_AND_ASSIGN(GeneratedCodeCacheMemoryTier);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_CODE_CACHE_GENERATED_CODE_CACHE_MEMORY_TIER_H_
@@ -0,0 +1,108 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/code_cache/generated_code_cache_memory_tier.h"
+
+#include <string>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+
+namespace {
+
+constexpr char kOriginA[] = "https://a.com/";
+constexpr char kOriginB[] = "https://b.com/";
+
+// Keys are one byte long, so that each entry is one byte larger than its data.
+std::vector<uint8_t> Data(size_t size) {
+  return std::vector<uint8_t>(size, 'x');
+}
+
+bool Contains(GeneratedCodeCacheMemoryTier* tier,
+              const std::string& origin_lock,
+              const std::string& key) {
+  base::Time response_time;
+  mojo_base::BigBuffer data;
+  return tier->Get(origin_lock, key, &response_time, &data);
+}
+
+}  // namespace
+
+TEST(GeneratedCodeCacheMemoryTierTest, PutAndGet) {
+  GeneratedCodeCacheMemoryTier tier(100, 100);
+  const base::Time time = base::Time::Now();
+  tier.Put(kOriginA, "a", time, Data(9));
+  EXPECT_EQ(10u, tier.size_bytes());
+
+  base::Time response_time;
+  mojo_base::BigBuffer data;
+  ASSERT_TRUE(tier.Get(kOriginA, "a", &response_time, &data));
+  EXPECT_EQ(time, response_time);
+  EXPECT_EQ(9u, data.size());
+  // Entries are only found in the shard of their origin lock.
+  EXPECT_FALSE(Contains(&tier, kOriginB, "a"));
+
+  // Replacing the entry updates the size.
+  tier.Put(kOriginA, "a", time, Data(19));
+  EXPECT_EQ(20u, tier.size_bytes());
+
+  tier.Remove(kOriginA, "a");
+  EXPECT_FALSE(Contains(&tier, kOriginA, "a"));
+  EXPECT_EQ(0u, tier.size_bytes());
+}
+
+TEST(GeneratedCodeCacheMemoryTierTest, TooLarge) {
+  GeneratedCodeCacheMemoryTier tier(100, 50);
+  tier.Put(kOriginA, "a", base::Time(), Data(9));
+  // An entry larger than a shard replaces the older entry but is not kept.
+  tier.Put(kOriginA, "a", base::Time(), Data(50));
+  EXPECT_FALSE(Contains(&tier, kOriginA, "a"));
+  EXPECT_EQ(0u, tier.size_bytes());
+}
+
+TEST(GeneratedCodeCacheMemoryTierTest, EvictWithinShard) {
+  GeneratedCodeCacheMemoryTier tier(100, 30);
+  tier.Put(kOriginA, "a", base::Time(), Data(9));
+  tier.Put(kOriginA, "b", base::Time(), Data(9));
+  tier.Put(kOriginB, "c", base::Time(), Data(9));
+  // Use "a", so that "b" is the least recently used entry of its shard.
+  EXPECT_TRUE(Contains(&tier, kOriginA, "a"));
+
+  tier.Put(kOriginA, "d", base::Time(), Data(19));
+  EXPECT_TRUE(Contains(&tier, kOriginA, "a"));
+  EXPECT_FALSE(Contains(&tier, kOriginA, "b"));
+  EXPECT_TRUE(Contains(&tier, kOriginA, "d"));
+  // The other shard is left alone.
+  EXPECT_TRUE(Contains(&tier, kOriginB, "c"));
+  EXPECT_EQ(40u, tier.size_bytes());
+}
+
+TEST(GeneratedCodeCacheMemoryTierTest, EvictLeastRecentlyUsedShard) {
+  GeneratedCodeCacheMemoryTier tier(30, 30);
+  tier.Put(kOriginA, "a", base::Time(), Data(9));
+  tier.Put(kOriginB, "b", base::Time(), Data(9));
+  tier.Put(kOriginA, "c", base::Time(), Data(9));
+
+  // The shard of |kOriginB| is the least recently used one.
+  tier.Put(kOriginA, "d", base::Time(), Data(9));
+  EXPECT_FALSE(Contains(&tier, kOriginB, "b"));
+  EXPECT_TRUE(Contains(&tier, kOriginA, "a"));
+  EXPECT_TRUE(Contains(&tier, kOriginA, "c"));
+  EXPECT_TRUE(Contains(&tier, kOriginA, "d"));
+  EXPECT_EQ(30u, tier.size_bytes());
+}
+
+TEST(GeneratedCodeCacheMemoryTierTest, Clear) {
+  GeneratedCodeCacheMemoryTier tier(100, 100);
+  tier.Put(kOriginA, "a", base::Time(), Data(9));
+  tier.Put(kOriginB, "b", base::Time(), Data(9));
+  tier.Clear();
+  EXPECT_FALSE(Contains(&tier, kOriginA, "a"));
+  EXPECT_FALSE(Contains(&tier, kOriginB, "b"));
+  EXPECT_EQ(0u, tier.size_bytes());
+}
+
+}  // namespace content
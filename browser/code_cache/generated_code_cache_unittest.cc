@@ -7,6 +7,7 @@
 #include "base/bind.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/task_environment.h"
 #include "content/public/test/browser_task_environment.h"
 #include "content/public/test/test_utils.h"
@@ -666,4 +667,139 @@ TEST_F(GeneratedCodeCacheTest, TestFailedBackendOpening) {
   // We shouldn't receive any data.
   ASSERT_TRUE(received_null_);
 }
+
+class GeneratedCodeCacheMemoryTierTest : public GeneratedCodeCacheTest {
+ public:
+  GeneratedCodeCacheMemoryTierTest() {
+    scoped_feature_list_.InitAndEnableFeature(kCodeCacheMemoryTier);
+  }
+
+ private:
+  base::test::ScopedFeatureList scoped_feature_list_;
+};
+
+TEST_F(GeneratedCodeCacheMemoryTierTest, FetchWrittenEntryFromMemory) {
+  GURL url(kInitialUrl);
+  GURL origin_lock = GURL(kInitialOrigin);
+
+  InitializeCache(GeneratedCodeCache::CodeCacheType::kJavaScript);
+  // Remove the entry from the disk backend only.
+  DoomAll();
+  task_environment_.RunUntilIdle();
+
+  // The entry is still returned, synchronously.
+  FetchFromCache(url, origin_lock);
+  ASSERT_TRUE(received_);
+  EXPECT_EQ(kInitialData, received_data_);
+}
+
+TEST_F(GeneratedCodeCacheMemoryTierTest, FetchReadEntryFromMemory) {
+  GURL small_url(kInitialUrl);
+  GURL large_url("http://example.com/large.js");
+  GURL origin_lock = GURL(kInitialOrigin);
+
+  InitializeCache(GeneratedCodeCache::CodeCacheType::kJavaScript);
+  std::string large_data(kLargeSizeInBytes, 'x');
+  WriteToCache(large_url, origin_lock, large_data, base::Time());
+  task_environment_.RunUntilIdle();
+
+  // Reopen the cache, so that the memory tier starts empty.
+  generated_code_cache_ = std::make_unique<GeneratedCodeCache>(
+      cache_path_, kMaxSizeInBytes,
+      GeneratedCodeCache::CodeCacheType::kJavaScript);
+  generated_code_cache_->GetBackend(base::BindOnce(
+      &GeneratedCodeCacheTest::GetBackendCallback, base::Unretained(this)));
+  task_environment_.RunUntilIdle();
+
+  // The first fetches read the entries from disk, and keep them in memory.
+  FetchFromCache(small_url, origin_lock);
+  EXPECT_FALSE(received_);
+  task_environment_.RunUntilIdle();
+  ASSERT_TRUE(received_);
+  EXPECT_EQ(kInitialData, received_data_);
+  FetchFromCache(large_url, origin_lock);
+  EXPECT_FALSE(received_);
+  task_environment_.RunUntilIdle();
+  ASSERT_TRUE(received_);
+  EXPECT_EQ(large_data, received_data_);
+
+  DoomAll();
+  task_environment_.RunUntilIdle();
+
+  FetchFromCache(small_url, origin_lock);
+  ASSERT_TRUE(received_);
+  EXPECT_EQ(kInitialData, received_data_);
+  FetchFromCache(large_url, origin_lock);
+  ASSERT_TRUE(received_);
+  EXPECT_EQ(large_data, received_data_);
+}
+
+TEST_F(GeneratedCodeCacheMemoryTierTest, VeryLargeEntryNotInMemory) {
+  GURL url("http://example.com/very_large.js");
+  GURL origin_lock = GURL(kInitialOrigin);
+
+  InitializeCache(GeneratedCodeCache::CodeCacheType::kJavaScript);
+  std::string very_large_data(kVeryLargeSizeInBytes, 'x');
+  WriteToCache(url, origin_lock, very_large_data, base::Time());
+  task_environment_.RunUntilIdle();
+
+  FetchFromCache(url, origin_lock);
+  EXPECT_FALSE(received_);
+  task_environment_.RunUntilIdle();
+  ASSERT_TRUE(received_);
+  EXPECT_EQ(very_large_data, received_data_);
+}
+
+TEST_F(GeneratedCodeCacheMemoryTierTest, DeleteEntry) {
+  GURL url(kInitialUrl);
+  GURL origin_lock = GURL(kInitialOrigin);
+
+  InitializeCache(GeneratedCodeCache::CodeCacheType::kJavaScript);
+  DeleteFromCache(url, origin_lock);
+  FetchFromCache(url, origin_lock);
+  task_environment_.RunUntilIdle();
+
+  ASSERT_TRUE(received_);
+  EXPECT_TRUE(received_null_);
+}
+
+TEST_F(GeneratedCodeCacheMemoryTierTest, GetBackendClearsMemory) {
+  GURL url(kInitialUrl);
+  GURL origin_lock = GURL(kInitialOrigin);
+
+  InitializeCache(GeneratedCodeCache::CodeCacheType::kJavaScript);
+  // Clear the backend the way StoragePartitionCodeCacheDataRemover does.
+  generated_code_cache_->GetBackend(base::BindOnce(
+      &GeneratedCodeCacheTest::GetBackendCallback, base::Unretained(this)));
+  DoomAll();
+  task_environment_.RunUntilIdle();
+
+  FetchFromCache(url, origin_lock);
+  task_environment_.RunUntilIdle();
+  ASSERT_TRUE(received_);
+  EXPECT_TRUE(received_null_);
+}
+
+TEST_F(GeneratedCodeCacheMemoryTierTest, FetchDuringGetBackendNotInMemory) {
+  GURL url(kInitialUrl);
+  GURL origin_lock = GURL(kInitialOrigin);
+
+  InitializeCacheAndReOpen(GeneratedCodeCache::CodeCacheType::kJavaScript);
+  // The fetch is issued before the backend is cleared, and completes after.
+  FetchFromCache(url, origin_lock);
+  generated_code_cache_->GetBackend(base::BindOnce(
+      &GeneratedCodeCacheTest::GetBackendCallback, base::Unretained(this)));
+  task_environment_.RunUntilIdle();
+  ASSERT_TRUE(received_);
+  EXPECT_EQ(kInitialData, received_data_);
+
+  DoomAll();
+  task_environment_.RunUntilIdle();
+
+  FetchFromCache(url, origin_lock);
+  task_environment_.RunUntilIdle();
+  ASSERT_TRUE(received_);
+  EXPECT_TRUE(received_null_);
+}
+
 }  // namespace content
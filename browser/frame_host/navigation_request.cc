@@ -2897,6 +2897,14 @@ void NavigationRequest::CommitNavigation() {
         std::move(subresource_loader_params_->prefetched_signed_exchanges);
   }
 
+  // Prefetch the code cache of the scripts the document is expected to load,
+  // so that the renderer has it before the scripts arrive.
+  if (frame_tree_node_->IsMainFrame() &&
+      common_params_->url.SchemeIsHTTPOrHTTPS()) {
+    static_cast<RenderProcessHostImpl*>(render_frame_host_->GetProcess())
+        ->PrefetchCodeCacheBundle();
+  }
+
   render_frame_host_->CommitNavigation(
       this, std::move(common_params), std::move(commit_params),
       std::move(response_head), std::move(response_body_),
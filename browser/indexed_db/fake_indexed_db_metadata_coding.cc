@@ -26,6 +26,16 @@ leveldb::Status FakeIndexedDBMetadataCoding::ReadDatabaseNames(
   return Status::OK();
 }
 
+leveldb::Status FakeIndexedDBMetadataCoding::ReadDatabaseIdAndVersion(
+    TransactionalLevelDBDatabase* db,
+    const std::string& origin_identifier,
+    const base::string16& name,
+    int64_t* database_id,
+    int64_t* version,
+    bool* found) {
+  return Status::OK();
+}
+
 leveldb::Status FakeIndexedDBMetadataCoding::ReadMetadataForDatabaseName(
     TransactionalLevelDBDatabase* db,
     const std::string& origin_identifier,
@@ -37,6 +37,14 @@ class FakeIndexedDBMetadataCoding : public IndexedDBMetadataCoding {
       const std::string& origin_identifier,
       std::vector<base::string16>* names) override;
 
+  leveldb::Status ReadDatabaseIdAndVersion(
+      TransactionalLevelDBDatabase* db,
+      const std::string& origin_identifier,
+      const base::string16& name,
+      int64_t* database_id,
+      int64_t* version,
+      bool* found) override;
+
   leveldb::Status ReadMetadataForDatabaseName(
       TransactionalLevelDBDatabase* db,
       const std::string& origin_identifier,
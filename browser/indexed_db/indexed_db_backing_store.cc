@@ -5,6 +5,7 @@
 #include "content/browser/indexed_db/indexed_db_backing_store.h"
 
 #include <algorithm>
+#include <tuple>
 #include <utility>
 
 #include "base/bind.h"
@@ -19,6 +20,7 @@
 #include "base/memory/ptr_util.h"
 #include "base/metrics/histogram_functions.h"
 #include "base/optional.h"
+#include "base/stl_util.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
@@ -46,6 +48,7 @@
 #include "content/browser/indexed_db/indexed_db_reporting.h"
 #include "content/browser/indexed_db/indexed_db_tracing.h"
 #include "content/browser/indexed_db/indexed_db_value.h"
+#include "content/browser/indexed_db/indexed_db_value_compression.h"
 #include "mojo/public/cpp/bindings/pending_remote.h"
 #include "net/base/load_flags.h"
 #include "net/traffic_annotation/network_traffic_annotation.h"
@@ -62,6 +65,7 @@
 #include "third_party/blink/public/common/indexeddb/web_idb_types.h"
 #include "third_party/blink/public/mojom/blob/blob.mojom.h"
 #include "third_party/leveldatabase/env_chromium.h"
+#include "third_party/leveldatabase/src/include/leveldb/db.h"
 
 using base::FilePath;
 using base::ImportantFileWriter;
@@ -89,6 +93,10 @@ using indexed_db::PutInt;
 using indexed_db::PutString;
 using indexed_db::PutVarInt;
 using indexed_db::ReportOpenStatus;
+using indexed_db::VersionExists;
+
+const base::Feature kIndexedDBReadOnlySnapshots{
+    "IndexedDBReadOnlySnapshots", base::FEATURE_DISABLED_BY_DEFAULT};
 
 namespace {
 FilePath GetBlobDirectoryName(const FilePath& path_base, int64_t database_id) {
@@ -125,6 +133,24 @@ std::string ComputeOriginIdentifier(const Origin& origin) {
   return storage::GetIdentifierFromOrigin(origin) + "@1";
 }
 
+// Object store data values are stored as a version varint followed by the
+// value bits, which may be compressed. Decodes the version and moves the bits
+// out of |data| into |bits|. Uncompressed bits are shifted down over the
+// varint within |data|'s buffer, which is then swapped into |bits|: this still
+// moves every byte once, but avoids allocating and filling a second buffer.
+bool TakeObjectStoreDataValue(std::string* data,
+                              int64_t* version,
+                              std::string* bits) {
+  StringPiece slice(*data);
+  if (!DecodeVarInt(&slice, version))
+    return false;
+  if (indexed_db::IsCompressedValue(slice))
+    return indexed_db::DecompressValue(slice, bits);
+  data->erase(0, data->size() - slice.size());
+  bits->swap(*data);
+  return true;
+}
+
 // TODO(ericu): Error recovery. If we persistently can't read the
 // blob journal, the safe thing to do is to clear it and leak the blobs,
 // though that may be costly. Still, database/directory deletion should always
@@ -458,7 +484,7 @@ Status DeleteBlobsInObjectStore(IndexedDBBackingStore::Transaction* transaction,
 }
 
 bool ObjectStoreCursorOptions(
-    TransactionalLevelDBTransaction* transaction,
+    IndexedDBBackingStore::Transaction* transaction,
     int64_t database_id,
     int64_t object_store_id,
     const IndexedDBKeyRange& range,
@@ -526,7 +552,7 @@ bool ObjectStoreCursorOptions(
 }
 
 bool IndexCursorOptions(
-    TransactionalLevelDBTransaction* transaction,
+    IndexedDBBackingStore::Transaction* transaction,
     int64_t database_id,
     int64_t object_store_id,
     int64_t index_id,
@@ -621,7 +647,11 @@ IndexedDBBackingStore::IndexedDBBackingStore(
       idb_task_runner_(idb_task_runner),
       io_task_runner_(io_task_runner),
       db_(std::move(db)),
-      blob_files_cleaned_(std::move(blob_files_cleaned)) {
+      blob_files_cleaned_(std::move(blob_files_cleaned)),
+      value_compression_mode_(
+          base::FeatureList::IsEnabled(kIndexedDBValueCompression)
+              ? IndexedDBValueCompressionPolicy::Mode::kAdaptive
+              : IndexedDBValueCompressionPolicy::Mode::kDisabled) {
   DCHECK(idb_task_runner_->RunsTasksInCurrentSequence());
   if (backing_store_mode == Mode::kInMemory)
     blob_path_ = FilePath();
@@ -1059,8 +1089,8 @@ leveldb::Status IndexedDBBackingStore::GetCompleteMetadata(
   for (auto& name : names) {
     output->emplace_back();
     bool found = false;
-    status = metadata_coding.ReadMetadataForDatabaseName(
-        db_.get(), origin_identifier_, name, &output->back(), &found);
+    status = ReadMetadataForDatabaseName(&metadata_coding, name,
+                                         &output->back(), &found);
     output->back().name = std::move(name);
     if (!found)
       return Status::NotFound("Metadata not found for \"%s\".",
@@ -1072,6 +1102,39 @@ leveldb::Status IndexedDBBackingStore::GetCompleteMetadata(
   return status;
 }
 
+Status IndexedDBBackingStore::ReadMetadataForDatabaseName(
+    IndexedDBMetadataCoding* metadata_coding,
+    const base::string16& name,
+    IndexedDBDatabaseMetadata* metadata,
+    bool* found) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  int64_t database_id = 0;
+  int64_t version = 0;
+  Status s = metadata_coding->ReadDatabaseIdAndVersion(
+      db_.get(), origin_identifier_, name, &database_id, &version, found);
+  if (!s.ok())
+    return s;
+  if (!*found) {
+    metadata_cache_.Remove(name);
+    return s;
+  }
+
+  const bool cache_hit =
+      metadata_cache_.Get(name, database_id, version, metadata);
+  base::UmaHistogramBoolean("WebCore.IndexedDB.MetadataCache.Hit", cache_hit);
+  if (cache_hit)
+    return s;
+
+  s = metadata_coding->ReadMetadataForDatabaseName(
+      db_.get(), origin_identifier_, name, metadata, found);
+  if (s.ok() && *found) {
+    IndexedDBDatabaseMetadata cached = *metadata;
+    cached.name = name;
+    metadata_cache_.Put(cached);
+  }
+  return s;
+}
+
 // static
 bool IndexedDBBackingStore::RecordCorruptionInfo(const FilePath& path_base,
                                                  const Origin& origin,
@@ -1130,6 +1193,7 @@ Status IndexedDBBackingStore::DeleteDatabase(
   s = transaction->Remove(key);
   if (!s.ok())
     return s;
+  metadata_cache_.Remove(name);
 
   bool need_cleanup = false;
   bool database_has_blob_references =
@@ -1182,8 +1246,6 @@ Status IndexedDBBackingStore::GetRecord(
   IDB_TRACE("IndexedDBBackingStore::GetRecord");
   if (!KeyPrefix::ValidIds(database_id, object_store_id))
     return InvalidDBKeyStatus();
-  TransactionalLevelDBTransaction* leveldb_transaction =
-      transaction->transaction();
 
   const std::string leveldb_key =
       ObjectStoreDataKey::Encode(database_id, object_store_id, key);
@@ -1192,7 +1254,7 @@ Status IndexedDBBackingStore::GetRecord(
   record->clear();
 
   bool found = false;
-  Status s = leveldb_transaction->Get(leveldb_key, &data, &found);
+  Status s = transaction->Get(leveldb_key, &data, &found);
   if (!s.ok()) {
     INTERNAL_READ_ERROR(GET_RECORD);
     return s;
@@ -1205,17 +1267,53 @@ Status IndexedDBBackingStore::GetRecord(
   }
 
   int64_t version;
-  StringPiece slice(data);
-  if (!DecodeVarInt(&slice, &version)) {
+  if (!TakeObjectStoreDataValue(&data, &version, &record->bits)) {
     INTERNAL_READ_ERROR_UNTESTED(GET_RECORD);
     return InternalInconsistencyStatus();
   }
 
-  record->bits = slice.as_string();
   return transaction->GetExternalObjectsForRecord(database_id, leveldb_key,
                                                   record);
 }
 
+void IndexedDBBackingStore::SetValueCompressionModeForTesting(
+    IndexedDBValueCompressionPolicy::Mode mode) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  value_compression_mode_ = mode;
+  value_compression_policies_.clear();
+}
+
+void IndexedDBBackingStore::AppendObjectStoreDataValue(int64_t database_id,
+                                                       int64_t object_store_id,
+                                                       const std::string& bits,
+                                                       std::string* into) {
+  if (value_compression_mode_ ==
+      IndexedDBValueCompressionPolicy::Mode::kDisabled) {
+    into->append(bits);
+    return;
+  }
+  IndexedDBValueCompressionPolicy& policy =
+      value_compression_policies_
+          .emplace(std::piecewise_construct,
+                   std::forward_as_tuple(database_id, object_store_id),
+                   std::forward_as_tuple(value_compression_mode_))
+          .first->second;
+  if (!policy.ShouldCompress(bits.size())) {
+    into->append(bits);
+    return;
+  }
+  std::string compressed;
+  if (!indexed_db::CompressValue(
+          bits, indexed_db::ValueCompressionDictionary::kBuiltIn,
+          &compressed)) {
+    policy.RecordResult(bits.size(), bits.size());
+    into->append(bits);
+    return;
+  }
+  policy.RecordResult(bits.size(), compressed.size());
+  into->append(compressed);
+}
+
 int64_t IndexedDBBackingStore::GetInMemoryBlobSize() const {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
 
@@ -1260,8 +1358,9 @@ Status IndexedDBBackingStore::PutRecord(
       ObjectStoreDataKey::Encode(database_id, object_store_id, key);
 
   std::string v;
+  v.reserve(sizeof(int64_t) + value->bits.size());
   EncodeVarInt(version, &v);
-  v.append(value->bits);
+  AppendObjectStoreDataValue(database_id, object_store_id, value->bits, &v);
 
   s = leveldb_transaction->Put(object_store_data_key, &v);
   if (!s.ok())
@@ -1546,7 +1645,7 @@ Status IndexedDBBackingStore::KeyExistsInObjectStore(
       ObjectStoreDataKey::Encode(database_id, object_store_id, key);
   std::string data;
 
-  Status s = transaction->transaction()->Get(leveldb_key, &data, found);
+  Status s = transaction->Get(leveldb_key, &data, found);
   if (!s.ok()) {
     INTERNAL_READ_ERROR_UNTESTED(KEY_EXISTS_IN_OBJECT_STORE);
     return s;
@@ -1766,6 +1865,22 @@ void IndexedDBBackingStore::DidCommitTransaction() {
   }
 }
 
+void IndexedDBBackingStore::DidTakeSnapshot() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  ++snapshot_transaction_count_;
+}
+
+void IndexedDBBackingStore::DidReleaseSnapshot() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  DCHECK_GT(snapshot_transaction_count_, 0UL);
+  --snapshot_transaction_count_;
+  if (snapshot_transaction_count_ == 0 &&
+      execute_journal_cleaning_on_no_txns_) {
+    execute_journal_cleaning_on_no_txns_ = false;
+    CleanRecoveryJournalIgnoreReturn();
+  }
+}
+
 Status IndexedDBBackingStore::Transaction::GetExternalObjectsForRecord(
     int64_t database_id,
     const std::string& object_store_data_key,
@@ -1798,7 +1913,7 @@ Status IndexedDBBackingStore::Transaction::GetExternalObjectsForRecord(
   std::string encoded_key = blob_entry_key.Encode();
   bool found;
   std::string encoded_value;
-  Status s = transaction()->Get(encoded_key, &encoded_value, &found);
+  Status s = Get(encoded_key, &encoded_value, &found);
   if (!s.ok())
     return s;
   if (found) {
@@ -1835,8 +1950,9 @@ IndexedDBBackingStore::Transaction::AsWeakPtr() {
 
 void IndexedDBBackingStore::CleanRecoveryJournalIgnoreReturn() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
-  // While a transaction is busy it is not safe to clean the journal.
-  if (committing_transaction_count_ > 0) {
+  // While a transaction is busy it is not safe to clean the journal, and
+  // while a snapshot is held the files may still be read.
+  if (committing_transaction_count_ > 0 || snapshot_transaction_count_ > 0) {
     execute_journal_cleaning_on_no_txns_ = true;
     return;
   }
@@ -1921,12 +2037,10 @@ Status IndexedDBBackingStore::FindKeyInIndex(
   DCHECK(found_encoded_primary_key->empty());
   *found = false;
 
-  TransactionalLevelDBTransaction* leveldb_transaction =
-      transaction->transaction();
   const std::string leveldb_key =
       IndexDataKey::Encode(database_id, object_store_id, index_id, key);
   std::unique_ptr<TransactionalLevelDBIterator> it =
-      leveldb_transaction->CreateIterator();
+      transaction->CreateIterator();
   Status s = it->Seek(leveldb_key);
   if (!s.ok()) {
     INTERNAL_READ_ERROR_UNTESTED(FIND_KEY_IN_INDEX);
@@ -1949,16 +2063,18 @@ Status IndexedDBBackingStore::FindKeyInIndex(
     *found_encoded_primary_key = slice.as_string();
 
     bool exists = false;
-    s = indexed_db::VersionExists(leveldb_transaction, database_id,
-                                  object_store_id, version,
-                                  *found_encoded_primary_key, &exists);
+    s = VersionExists(transaction, database_id, object_store_id, version,
+                      *found_encoded_primary_key, &exists);
     if (!s.ok())
       return s;
     if (!exists) {
-      // Delete stale index data entry and continue.
-      s = leveldb_transaction->Remove(it->Key());
-      if (!s.ok())
-        return s;
+      // Delete stale index data entry and continue. Read-only transactions
+      // leave it for a later writer or the tombstone sweeper.
+      if (transaction->mode() != blink::mojom::IDBTransactionMode::ReadOnly) {
+        s = transaction->transaction()->Remove(it->Key());
+        if (!s.ok())
+          return s;
+      }
       s = it->Next();
       continue;
     }
@@ -2050,7 +2166,7 @@ IndexedDBBackingStore::Cursor::Cursor(
       current_key_(std::make_unique<IndexedDBKey>(*other->current_key_)) {
   DCHECK(transaction_);
   if (other->iterator_) {
-    iterator_ = transaction_->transaction()->CreateIterator();
+    iterator_ = transaction_->CreateIterator();
 
     if (other->iterator_->IsValid()) {
       Status s = iterator_->Seek(other->iterator_->Key());
@@ -2073,7 +2189,7 @@ IndexedDBBackingStore::Cursor::~Cursor() {}
 bool IndexedDBBackingStore::Cursor::FirstSeek(Status* s) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
   DCHECK(transaction_);
-  iterator_ = transaction_->transaction()->CreateIterator();
+  iterator_ = transaction_->CreateIterator();
   {
     IDB_TRACE("IndexedDBBackingStore::Cursor::FirstSeek::Seek");
     if (cursor_options_.forward)
@@ -2481,7 +2597,13 @@ bool ObjectStoreCursorImpl::LoadCurrentRow(Status* s) {
   if (!s->ok())
     return false;
 
-  current_value_.bits = value_slice.as_string();
+  if (!indexed_db::IsCompressedValue(value_slice)) {
+    current_value_.bits = value_slice.as_string();
+  } else if (!indexed_db::DecompressValue(value_slice, &current_value_.bits)) {
+    INTERNAL_READ_ERROR_UNTESTED(LOAD_CURRENT_ROW);
+    *s = InternalInconsistencyStatus();
+    return false;
+  }
   return true;
 }
 
@@ -2575,7 +2697,7 @@ bool IndexKeyCursorImpl::LoadCurrentRow(Status* s) {
 
   std::string result;
   bool found = false;
-  *s = transaction_->transaction()->Get(primary_leveldb_key, &result, &found);
+  *s = transaction_->Get(primary_leveldb_key, &result, &found);
   if (!s->ok()) {
     INTERNAL_READ_ERROR_UNTESTED(LOAD_CURRENT_ROW);
     return false;
@@ -2602,7 +2724,8 @@ bool IndexKeyCursorImpl::LoadCurrentRow(Status* s) {
   }
 
   if (object_store_data_version != index_data_version) {
-    *s = transaction_->transaction()->Remove(iterator_->Key());
+    if (cursor_options_.mode != blink::mojom::IDBTransactionMode::ReadOnly)
+      *s = transaction_->transaction()->Remove(iterator_->Key());
     return false;
   }
 
@@ -2703,7 +2826,7 @@ bool IndexCursorImpl::LoadCurrentRow(Status* s) {
 
   std::string result;
   bool found = false;
-  *s = transaction_->transaction()->Get(primary_leveldb_key_, &result, &found);
+  *s = transaction_->Get(primary_leveldb_key_, &result, &found);
   if (!s->ok()) {
     INTERNAL_READ_ERROR_UNTESTED(LOAD_CURRENT_ROW);
     return false;
@@ -2722,8 +2845,8 @@ bool IndexCursorImpl::LoadCurrentRow(Status* s) {
   }
 
   int64_t object_store_data_version;
-  slice = StringPiece(result);
-  if (!DecodeVarInt(&slice, &object_store_data_version)) {
+  std::string bits;
+  if (!TakeObjectStoreDataValue(&result, &object_store_data_version, &bits)) {
     INTERNAL_READ_ERROR_UNTESTED(LOAD_CURRENT_ROW);
     *s = InternalInconsistencyStatus();
     return false;
@@ -2738,7 +2861,7 @@ bool IndexCursorImpl::LoadCurrentRow(Status* s) {
     return false;
   }
 
-  current_value_.bits = slice.as_string();
+  current_value_.bits.swap(bits);
   *s = transaction_->GetExternalObjectsForRecord(
       database_id_, primary_leveldb_key_, &current_value_);
   return s->ok();
@@ -2754,14 +2877,11 @@ IndexedDBBackingStore::OpenObjectStoreCursor(
     Status* s) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
   IDB_TRACE("IndexedDBBackingStore::OpenObjectStoreCursor");
-  TransactionalLevelDBTransaction* leveldb_transaction =
-      transaction->transaction();
   IndexedDBBackingStore::Cursor::CursorOptions cursor_options;
   cursor_options.mode = transaction->mode();
   // TODO(cmumford): Handle this error (crbug.com/363397)
-  if (!ObjectStoreCursorOptions(leveldb_transaction, database_id,
-                                object_store_id, range, direction,
-                                &cursor_options, s)) {
+  if (!ObjectStoreCursorOptions(transaction, database_id, object_store_id,
+                                range, direction, &cursor_options, s)) {
     return nullptr;
   }
   std::unique_ptr<ObjectStoreCursorImpl> cursor(
@@ -2783,14 +2903,11 @@ IndexedDBBackingStore::OpenObjectStoreKeyCursor(
     Status* s) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
   IDB_TRACE("IndexedDBBackingStore::OpenObjectStoreKeyCursor");
-  TransactionalLevelDBTransaction* leveldb_transaction =
-      transaction->transaction();
   IndexedDBBackingStore::Cursor::CursorOptions cursor_options;
   cursor_options.mode = transaction->mode();
   // TODO(cmumford): Handle this error (crbug.com/363397)
-  if (!ObjectStoreCursorOptions(leveldb_transaction, database_id,
-                                object_store_id, range, direction,
-                                &cursor_options, s)) {
+  if (!ObjectStoreCursorOptions(transaction, database_id, object_store_id,
+                                range, direction, &cursor_options, s)) {
     return nullptr;
   }
   std::unique_ptr<ObjectStoreKeyCursorImpl> cursor(
@@ -2814,12 +2931,10 @@ IndexedDBBackingStore::OpenIndexKeyCursor(
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
   IDB_TRACE("IndexedDBBackingStore::OpenIndexKeyCursor");
   *s = Status::OK();
-  TransactionalLevelDBTransaction* leveldb_transaction =
-      transaction->transaction();
   IndexedDBBackingStore::Cursor::CursorOptions cursor_options;
   cursor_options.mode = transaction->mode();
-  if (!IndexCursorOptions(leveldb_transaction, database_id, object_store_id,
-                          index_id, range, direction, &cursor_options, s))
+  if (!IndexCursorOptions(transaction, database_id, object_store_id, index_id,
+                          range, direction, &cursor_options, s))
     return nullptr;
   std::unique_ptr<IndexKeyCursorImpl> cursor(
       std::make_unique<IndexKeyCursorImpl>(transaction->AsWeakPtr(),
@@ -2841,12 +2956,10 @@ IndexedDBBackingStore::OpenIndexCursor(
     Status* s) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
   IDB_TRACE("IndexedDBBackingStore::OpenIndexCursor");
-  TransactionalLevelDBTransaction* leveldb_transaction =
-      transaction->transaction();
   IndexedDBBackingStore::Cursor::CursorOptions cursor_options;
   cursor_options.mode = transaction->mode();
-  if (!IndexCursorOptions(leveldb_transaction, database_id, object_store_id,
-                          index_id, range, direction, &cursor_options, s))
+  if (!IndexCursorOptions(transaction, database_id, object_store_id, index_id,
+                          range, direction, &cursor_options, s))
     return nullptr;
   std::unique_ptr<IndexCursorImpl> cursor(new IndexCursorImpl(
       transaction->AsWeakPtr(), database_id, cursor_options));
@@ -2895,6 +3008,7 @@ IndexedDBBackingStore::Transaction::Transaction(
 IndexedDBBackingStore::Transaction::~Transaction() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
   DCHECK(!committing_);
+  ReleaseSnapshot();
 }
 
 void IndexedDBBackingStore::Transaction::Begin(std::vector<ScopeLock> locks) {
@@ -2902,6 +3016,18 @@ void IndexedDBBackingStore::Transaction::Begin(std::vector<ScopeLock> locks) {
   IDB_TRACE("IndexedDBBackingStore::Transaction::Begin");
   DCHECK(backing_store_);
   DCHECK(!transaction_.get());
+  if (mode_ == blink::mojom::IDBTransactionMode::ReadOnly &&
+      base::FeatureList::IsEnabled(kIndexedDBReadOnlySnapshots)) {
+    // All reads go to the snapshot, so only the database lock is still needed
+    // (to keep version changes and deletion out). Dropping the object store
+    // locks lets writers queued behind this transaction start. They are
+    // ordered after it, which matches what the snapshot observes.
+    snapshot_ = backing_store_->db_->db()->GetSnapshot();
+    backing_store_->DidTakeSnapshot();
+    base::EraseIf(locks, [](const ScopeLock& lock) {
+      return lock.level() != kDatabaseRangeLockLevel;
+    });
+  }
   transaction_ = transactional_leveldb_factory_->CreateLevelDBTransaction(
       backing_store_->db_.get(),
       backing_store_->db_->scopes()->CreateScope(
@@ -2913,6 +3039,48 @@ void IndexedDBBackingStore::Transaction::Begin(std::vector<ScopeLock> locks) {
     incognito_external_object_map_[iter.first] = iter.second->Clone();
 }
 
+Status IndexedDBBackingStore::Transaction::Get(const StringPiece& key,
+                                               std::string* value,
+                                               bool* found) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  if (!snapshot_)
+    return transaction_->Get(key, value, found);
+
+  DCHECK(backing_store_);
+  leveldb::ReadOptions options = backing_store_->db_->DefaultReadOptions();
+  options.snapshot = snapshot_;
+  *found = false;
+  Status s = backing_store_->db_->db()->Get(
+      options, leveldb_env::MakeSlice(key), value);
+  if (s.IsNotFound())
+    return Status::OK();
+  *found = s.ok();
+  return s;
+}
+
+std::unique_ptr<TransactionalLevelDBIterator>
+IndexedDBBackingStore::Transaction::CreateIterator() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  if (!snapshot_)
+    return transaction_->CreateIterator();
+
+  DCHECK(backing_store_);
+  leveldb::ReadOptions options = backing_store_->db_->DefaultReadOptions();
+  options.snapshot = snapshot_;
+  return backing_store_->db_->CreateIterator(options);
+}
+
+void IndexedDBBackingStore::Transaction::ReleaseSnapshot() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  if (!snapshot_)
+    return;
+  if (backing_store_) {
+    backing_store_->db_->db()->ReleaseSnapshot(snapshot_);
+    backing_store_->DidReleaseSnapshot();
+  }
+  snapshot_ = nullptr;
+}
+
 Status IndexedDBBackingStore::Transaction::HandleBlobPreTransaction() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
   DCHECK(backing_store_);
@@ -3181,6 +3349,14 @@ Status IndexedDBBackingStore::Transaction::CommitPhaseTwo() {
 
   DCHECK(!external_object_change_map_.empty());
 
+  // A snapshot may still read records that reference these files. They are
+  // already in the committed recovery journal, which is cleaned once no
+  // snapshots are held.
+  if (backing_store_->snapshot_transaction_count_ > 0) {
+    backing_store_->StartJournalCleaningTimer();
+    return Status::OK();
+  }
+
   s = backing_store_->CleanUpBlobJournalEntries(inactive_blobs);
   if (!s.ok()) {
     INTERNAL_WRITE_ERROR_UNTESTED(TRANSACTION_COMMIT_METHOD);
@@ -3339,6 +3515,7 @@ leveldb::Status IndexedDBBackingStore::Transaction::WriteNewBlobs(
 
 void IndexedDBBackingStore::Transaction::Reset() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(idb_sequence_checker_);
+  ReleaseSnapshot();
   backing_store_.reset();
   transaction_ = nullptr;
 }
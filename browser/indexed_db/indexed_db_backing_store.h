@@ -15,6 +15,7 @@
 #include <utility>
 #include <vector>
 
+#include "base/feature_list.h"
 #include "base/files/file_path.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
@@ -30,6 +31,8 @@
 #include "content/browser/indexed_db/indexed_db_external_object.h"
 #include "content/browser/indexed_db/indexed_db_external_object_storage.h"
 #include "content/browser/indexed_db/indexed_db_leveldb_coding.h"
+#include "content/browser/indexed_db/indexed_db_metadata_cache.h"
+#include "content/browser/indexed_db/indexed_db_value_compression.h"
 #include "content/common/content_export.h"
 #include "storage/browser/blob/blob_data_handle.h"
 #include "storage/browser/blob/mojom/blob_storage_context.mojom-forward.h"
@@ -44,6 +47,10 @@ namespace base {
 class SequencedTaskRunner;
 }
 
+namespace leveldb {
+class Snapshot;
+}
+
 namespace blink {
 class IndexedDBKeyRange;
 struct IndexedDBDatabaseMetadata;
@@ -51,6 +58,7 @@ struct IndexedDBDatabaseMetadata;
 
 namespace content {
 class IndexedDBActiveBlobRegistry;
+class IndexedDBMetadataCoding;
 class LevelDBWriteBatch;
 class TransactionalLevelDBDatabase;
 class TransactionalLevelDBFactory;
@@ -63,6 +71,11 @@ class IndexedDBBackingStoreTest;
 FORWARD_DECLARE_TEST(IndexedDBBackingStoreTest, ReadCorruptionInfo);
 }  // namespace indexed_db_backing_store_unittest
 
+// Read-only transactions read from a LevelDB snapshot taken when they begin,
+// and give up their object store locks so that writers queued behind them on
+// the same stores can start.
+CONTENT_EXPORT extern const base::Feature kIndexedDBReadOnlySnapshots;
+
 enum class V2SchemaCorruptionStatus {
   kUnknown = 0,  // Due to other unknown/critical errors.
   kNo = 1,
@@ -142,6 +155,15 @@ class CONTENT_EXPORT IndexedDBBackingStore {
       return transaction_.get();
     }
 
+    // Reads go through these rather than transaction(), so that read-only
+    // transactions holding a snapshot read the database as of Begin().
+    leveldb::Status Get(const base::StringPiece& key,
+                        std::string* value,
+                        bool* found) WARN_UNUSED_RESULT;
+    std::unique_ptr<TransactionalLevelDBIterator> CreateIterator();
+
+    bool has_snapshot() const { return snapshot_ != nullptr; }
+
     virtual uint64_t GetTransactionSize();
 
     leveldb::Status GetExternalObjectsForRecord(
@@ -177,6 +199,8 @@ class CONTENT_EXPORT IndexedDBBackingStore {
     void PartitionBlobsToRemove(BlobJournalType* dead_blobs,
                                 BlobJournalType* live_blobs) const;
 
+    void ReleaseSnapshot();
+
     SEQUENCE_CHECKER(idb_sequence_checker_);
 
     // This does NOT mean that this class can outlive the IndexedDBBackingStore.
@@ -218,6 +242,10 @@ class CONTENT_EXPORT IndexedDBBackingStore {
     blink::mojom::IDBTransactionDurability durability_;
     const blink::mojom::IDBTransactionMode mode_;
 
+    // Set between Begin() and Reset() for read-only transactions when
+    // kIndexedDBReadOnlySnapshots is enabled.
+    const leveldb::Snapshot* snapshot_ = nullptr;
+
     base::WeakPtrFactory<Transaction> ptr_factory_{this};
 
     DISALLOW_COPY_AND_ASSIGN(Transaction);
@@ -357,6 +385,17 @@ class CONTENT_EXPORT IndexedDBBackingStore {
   IndexedDBActiveBlobRegistry* active_blob_registry() {
     return active_blob_registry_.get();
   }
+  IndexedDBMetadataCache* metadata_cache() { return &metadata_cache_; }
+
+  // Reads the metadata for the database named |name| through
+  // |metadata_coding|, reusing the decoded copy in the metadata cache if the
+  // database id and version on disk still match it. Only the id and version
+  // are read on a cache hit.
+  leveldb::Status ReadMetadataForDatabaseName(
+      IndexedDBMetadataCoding* metadata_coding,
+      const base::string16& name,
+      blink::IndexedDBDatabaseMetadata* metadata,
+      bool* found);
 
   // Compact is public for testing.
   virtual void Compact();
@@ -487,6 +526,12 @@ class CONTENT_EXPORT IndexedDBBackingStore {
 
   int64_t GetInMemoryBlobSize() const;
 
+  // Overrides the value compression mode, which otherwise follows
+  // kIndexedDBValueCompression, for all object stores. Values already written
+  // stay readable whatever the mode.
+  void SetValueCompressionModeForTesting(
+      IndexedDBValueCompressionPolicy::Mode mode);
+
 #if DCHECK_IS_ON()
   int NumBlobFilesDeletedForTesting() { return num_blob_files_deleted_; }
   int NumAggregatedJournalCleaningRequestsForTesting() const {
@@ -559,6 +604,13 @@ class CONTENT_EXPORT IndexedDBBackingStore {
       std::string* found_encoded_primary_key,
       bool* found);
 
+  // Appends the stored form of |bits|, compressed if the object store's
+  // compression policy asks for it and it helps, to |into|.
+  void AppendObjectStoreDataValue(int64_t database_id,
+                                  int64_t object_store_id,
+                                  const std::string& bits,
+                                  std::string* into);
+
   // Remove the blob directory for the specified database and all contained
   // blob files.
   bool RemoveBlobDirectory(int64_t database_id) const;
@@ -578,6 +630,10 @@ class CONTENT_EXPORT IndexedDBBackingStore {
   // Can run a journal cleaning job if one is pending.
   void DidCommitTransaction();
 
+  void DidTakeSnapshot();
+  // Can run a journal cleaning job if one is pending.
+  void DidReleaseSnapshot();
+
   SEQUENCE_CHECKER(idb_sequence_checker_);
 
   Mode backing_store_mode_;
@@ -624,11 +680,27 @@ class CONTENT_EXPORT IndexedDBBackingStore {
   // indexed_db_factory_ will hold a reference to this backing store.
   std::unique_ptr<IndexedDBActiveBlobRegistry> active_blob_registry_;
 
+  // Decoded database metadata, validated against the database id and version
+  // on every read.
+  IndexedDBMetadataCache metadata_cache_;
+
+  // Per object store compression decisions, keyed by database id and object
+  // store id.
+  IndexedDBValueCompressionPolicy::Mode value_compression_mode_;
+  std::map<std::pair<int64_t, int64_t>, IndexedDBValueCompressionPolicy>
+      value_compression_policies_;
+
   // Incremented whenever a transaction starts committing, decremented when
   // complete. While > 0, temporary journal entries may exist so out-of-band
   // journal cleaning must be deferred.
   size_t committing_transaction_count_ = 0;
 
+  // Number of transactions reading from a snapshot. Records deleted by other
+  // transactions stay visible to them, so while > 0 dead blob files are left
+  // in the recovery journal instead of being deleted on commit, and journal
+  // cleaning is deferred.
+  size_t snapshot_transaction_count_ = 0;
+
 #if DCHECK_IS_ON()
   bool initialized_ = false;
 #endif
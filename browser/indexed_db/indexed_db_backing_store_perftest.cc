@@ -0,0 +1,616 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "base/macros.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/test/bind_test_util.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/test/task_environment.h"
+#include "base/time/default_clock.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/services/storage/indexed_db/scopes/disjoint_range_lock_manager.h"
+#include "components/services/storage/indexed_db/transactional_leveldb/transactional_leveldb_transaction.h"
+#include "content/browser/indexed_db/indexed_db_backing_store.h"
+#include "content/browser/indexed_db/indexed_db_class_factory.h"
+#include "content/browser/indexed_db/indexed_db_context_impl.h"
+#include "content/browser/indexed_db/indexed_db_factory_impl.h"
+#include "content/browser/indexed_db/indexed_db_leveldb_coding.h"
+#include "content/browser/indexed_db/indexed_db_metadata_cache.h"
+#include "content/browser/indexed_db/indexed_db_metadata_coding.h"
+#include "content/browser/indexed_db/indexed_db_origin_state.h"
+#include "content/browser/indexed_db/indexed_db_origin_state_handle.h"
+#include "content/browser/indexed_db/indexed_db_value.h"
+#include "content/browser/indexed_db/indexed_db_value_compression.h"
+#include "mojo/public/cpp/bindings/pending_remote.h"
+#include "storage/browser/test/mock_quota_manager_proxy.h"
+#include "storage/browser/test/mock_special_storage_policy.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "third_party/blink/public/common/indexeddb/indexeddb_key.h"
+#include "third_party/blink/public/common/indexeddb/indexeddb_key_path.h"
+#include "third_party/blink/public/common/indexeddb/indexeddb_metadata.h"
+#include "third_party/blink/public/mojom/indexeddb/indexeddb.mojom.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+
+using base::ASCIIToUTF16;
+using blink::IndexedDBDatabaseMetadata;
+using blink::IndexedDBIndexMetadata;
+using blink::IndexedDBKey;
+using blink::IndexedDBKeyPath;
+using blink::IndexedDBObjectStoreMetadata;
+
+namespace content {
+namespace {
+
+constexpr char kMetricPrefixBackingStore[] = "IndexedDBBackingStore.";
+constexpr char kMetricPutTimeMs[] = "put_time";
+constexpr char kMetricGetTimeMs[] = "get_time";
+constexpr char kMetricPutThroughput[] = "put_throughput";
+constexpr char kMetricGetThroughput[] = "get_throughput";
+constexpr char kMetricWriterLockWaitMs[] = "writer_lock_wait";
+constexpr char kMetricMixedThroughput[] = "mixed_throughput";
+constexpr char kMetricOpenTimeMs[] = "open_time";
+constexpr char kMetricStoredBytes[] = "stored_bytes";
+constexpr char kMetricWriteAmplification[] = "write_amplification";
+constexpr char kMetricDecodeTimeMs[] = "decode_time";
+
+constexpr int64_t kDatabaseId = 1;
+constexpr int64_t kObjectStoreId = 1;
+constexpr size_t kRecordCount = 10000;
+constexpr size_t kValueSize = 256;
+// Value sizes for the size sweep, from small values up to the medium values
+// that are stored inline in leveldb rather than wrapped in blobs.
+constexpr size_t kSweepValueSizes[] = {1024,       16 * 1024,  64 * 1024,
+                                       256 * 1024, 512 * 1024, 1024 * 1024};
+// Bytes written and read per value size in the sweep, up to kRecordCount
+// records.
+constexpr size_t kSweepTotalSize = 32 * 1024 * 1024;
+// Shape of the mixed load: each round is one read-only transaction with a
+// writer queued behind it on the same object store.
+constexpr size_t kMixedRounds = 20;
+constexpr size_t kMixedReadsPerRound = 1000;
+constexpr size_t kMixedWritesPerRound = 100;
+
+// Schema for the open latency test, and how many times every database is
+// reopened.
+constexpr size_t kOpenDatabaseCount = 20;
+constexpr size_t kOpenObjectStoreCount = 10;
+constexpr size_t kOpenIndexCount = 5;
+constexpr size_t kOpenRounds = 50;
+
+// Records and dictionary size used by the value compression test.
+constexpr size_t kCompressionRecordCount = 2000;
+constexpr size_t kTrainedDictionarySize = 4 * 1024;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixBackingStore, story);
+  reporter.RegisterImportantMetric(kMetricPutTimeMs, "ms");
+  reporter.RegisterImportantMetric(kMetricGetTimeMs, "ms");
+  return reporter;
+}
+
+// Measures IndexedDBBackingStore record operations on an in-memory backing
+// store.
+class IndexedDBBackingStorePerfTest : public testing::Test {
+ public:
+  IndexedDBBackingStorePerfTest()
+      : special_storage_policy_(
+            base::MakeRefCounted<storage::MockSpecialStoragePolicy>()),
+        quota_manager_proxy_(
+            base::MakeRefCounted<storage::MockQuotaManagerProxy>(nullptr,
+                                                                 nullptr)) {}
+
+  void SetUp() override {
+    special_storage_policy_->SetAllUnlimited(true);
+    // An empty data path makes the context (and backing store) in-memory so
+    // the measurements are not dominated by disk I/O.
+    idb_context_ = base::MakeRefCounted<IndexedDBContextImpl>(
+        base::FilePath(), special_storage_policy_, quota_manager_proxy_,
+        base::DefaultClock::GetInstance(),
+        /*blob_storage_context=*/mojo::NullRemote(),
+        /*native_file_system_context=*/mojo::NullRemote(),
+        base::SequencedTaskRunnerHandle::Get(),
+        base::SequencedTaskRunnerHandle::Get());
+    idb_factory_ = std::make_unique<IndexedDBFactoryImpl>(
+        idb_context_.get(), IndexedDBClassFactory::Get(),
+        base::DefaultClock::GetInstance());
+
+    leveldb::Status s;
+    std::tie(origin_state_handle_, s, std::ignore, std::ignore, std::ignore) =
+        idb_factory_->GetOrOpenOriginFactory(
+            url::Origin::Create(GURL("http://localhost:81")),
+            idb_context_->data_path(), /*create_if_missing=*/true);
+    ASSERT_TRUE(origin_state_handle_.IsHeld()) << s.ToString();
+
+    for (size_t i = 0; i < kRecordCount; ++i) {
+      keys_.emplace_back(static_cast<double>(i),
+                         blink::mojom::IDBKeyType::Number);
+      values_.emplace_back(std::string(kValueSize, 'x'),
+                           std::vector<IndexedDBExternalObject>());
+    }
+  }
+
+  void TearDown() override {
+    quota_manager_proxy_->SimulateQuotaManagerDestroyed();
+    origin_state_handle_.Release();
+    idb_factory_.reset();
+    idb_context_.reset();
+    base::RunLoop().RunUntilIdle();
+  }
+
+  IndexedDBBackingStore* backing_store() {
+    return origin_state_handle_.origin_state()->backing_store();
+  }
+
+  std::unique_ptr<IndexedDBBackingStore::Transaction> BeginTransaction() {
+    base::RunLoop loop;
+    ScopesLocksHolder locks_receiver;
+    EXPECT_TRUE(
+        origin_state_handle_.origin_state()->lock_manager()->AcquireLocks(
+            {{0, {"01", "11"}, ScopesLockManager::LockType::kExclusive}},
+            locks_receiver.AsWeakPtr(),
+            base::BindLambdaForTesting([&loop]() { loop.Quit(); })));
+    loop.Run();
+    auto transaction = backing_store()->CreateTransaction(
+        blink::mojom::IDBTransactionDurability::Relaxed,
+        blink::mojom::IDBTransactionMode::ReadWrite);
+    transaction->Begin(std::move(locks_receiver.locks));
+    return transaction;
+  }
+
+  // Acquires a shared database lock and a |type| lock on the object store, as
+  // IndexedDBDatabase does for a transaction. Sets |*acquired| once granted.
+  std::unique_ptr<ScopesLocksHolder> AcquireObjectStoreLocks(
+      ScopesLockManager::LockType type,
+      bool* acquired) {
+    auto locks_receiver = std::make_unique<ScopesLocksHolder>();
+    EXPECT_TRUE(
+        origin_state_handle_.origin_state()->lock_manager()->AcquireLocks(
+            {{kDatabaseRangeLockLevel, GetDatabaseLockRange(kDatabaseId),
+              ScopesLockManager::LockType::kShared},
+             {kObjectStoreRangeLockLevel,
+              GetObjectStoreLockRange(kDatabaseId, kObjectStoreId), type}},
+            locks_receiver->AsWeakPtr(),
+            base::BindLambdaForTesting([acquired]() { *acquired = true; })));
+    base::RunLoop().RunUntilIdle();
+    return locks_receiver;
+  }
+
+  void Commit(IndexedDBBackingStore::Transaction* transaction) {
+    EXPECT_TRUE(transaction
+                    ->CommitPhaseOne(base::BindOnce([](BlobWriteResult result) {
+                      return leveldb::Status::OK();
+                    }))
+                    .ok());
+    EXPECT_TRUE(transaction->CommitPhaseTwo().ok());
+  }
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+  scoped_refptr<storage::MockSpecialStoragePolicy> special_storage_policy_;
+  scoped_refptr<storage::MockQuotaManagerProxy> quota_manager_proxy_;
+  scoped_refptr<IndexedDBContextImpl> idb_context_;
+  std::unique_ptr<IndexedDBFactoryImpl> idb_factory_;
+  IndexedDBOriginStateHandle origin_state_handle_;
+
+  std::vector<IndexedDBKey> keys_;
+  std::vector<IndexedDBValue> values_;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(IndexedDBBackingStorePerfTest);
+};
+
+TEST_F(IndexedDBBackingStorePerfTest, PerRecordLoop) {
+  auto reporter = SetUpReporter("per_record_" +
+                                base::NumberToString(kRecordCount));
+  {
+    auto transaction = BeginTransaction();
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < kRecordCount; ++i) {
+      IndexedDBBackingStore::RecordIdentifier record;
+      ASSERT_TRUE(backing_store()
+                      ->PutRecord(transaction.get(), kDatabaseId,
+                                  kObjectStoreId, keys_[i], &values_[i],
+                                  &record)
+                      .ok());
+    }
+    Commit(transaction.get());
+    reporter.AddResult(kMetricPutTimeMs, timer.Elapsed());
+  }
+  {
+    auto transaction = BeginTransaction();
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < kRecordCount; ++i) {
+      IndexedDBValue value;
+      ASSERT_TRUE(backing_store()
+                      ->GetRecord(transaction.get(), kDatabaseId,
+                                  kObjectStoreId, keys_[i], &value)
+                      .ok());
+    }
+    Commit(transaction.get());
+    reporter.AddResult(kMetricGetTimeMs, timer.Elapsed());
+  }
+}
+
+// Measures the browser side of a put and a get for a range of value sizes:
+// the copy out of the Mojo value, PutRecord, GetRecord, and the conversion
+// back to a Mojo value.
+TEST_F(IndexedDBBackingStorePerfTest, ValueSizeSweep) {
+  for (size_t value_size : kSweepValueSizes) {
+    const size_t record_count =
+        std::min(kSweepTotalSize / value_size, keys_.size());
+    const double megabytes =
+        static_cast<double>(record_count * value_size) / (1024 * 1024);
+    perf_test::PerfResultReporter reporter(
+        kMetricPrefixBackingStore,
+        "value_size_" + base::NumberToString(value_size));
+    reporter.RegisterImportantMetric(kMetricPutThroughput, "MB/s");
+    reporter.RegisterImportantMetric(kMetricGetThroughput, "MB/s");
+
+    std::vector<blink::mojom::IDBValuePtr> mojo_values;
+    mojo_values.reserve(record_count);
+    for (size_t i = 0; i < record_count; ++i) {
+      mojo_values.push_back(blink::mojom::IDBValue::New());
+      mojo_values.back()->bits.assign(value_size, 'x');
+    }
+
+    {
+      auto transaction = BeginTransaction();
+      base::ElapsedTimer timer;
+      for (size_t i = 0; i < record_count; ++i) {
+        // Mirrors TransactionImpl::Put.
+        IndexedDBValue value;
+        value.bits = std::string(mojo_values[i]->bits.begin(),
+                                 mojo_values[i]->bits.end());
+        mojo_values[i].reset();
+        IndexedDBBackingStore::RecordIdentifier record;
+        ASSERT_TRUE(backing_store()
+                        ->PutRecord(transaction.get(), kDatabaseId,
+                                    kObjectStoreId, keys_[i], &value, &record)
+                        .ok());
+      }
+      Commit(transaction.get());
+      reporter.AddResult(kMetricPutThroughput,
+                         megabytes / timer.Elapsed().InSecondsF());
+    }
+    {
+      auto transaction = BeginTransaction();
+      base::ElapsedTimer timer;
+      size_t total_size = 0;
+      for (size_t i = 0; i < record_count; ++i) {
+        IndexedDBValue value;
+        ASSERT_TRUE(backing_store()
+                        ->GetRecord(transaction.get(), kDatabaseId,
+                                    kObjectStoreId, keys_[i], &value)
+                        .ok());
+        blink::mojom::IDBValuePtr mojo_value =
+            IndexedDBValue::ConvertAndEraseValue(&value);
+        total_size += mojo_value->bits.size();
+      }
+      Commit(transaction.get());
+      reporter.AddResult(kMetricGetThroughput,
+                         megabytes / timer.Elapsed().InSecondsF());
+      EXPECT_EQ(record_count * value_size, total_size);
+    }
+  }
+}
+
+// Runs rounds of a long read-only transaction with a writer queued behind it
+// on the same object store, with and without read-only snapshots. Without
+// snapshots the writer waits for the whole read; with them it starts as soon
+// as the reader has begun.
+TEST_F(IndexedDBBackingStorePerfTest, MixedReadWrite) {
+  {
+    auto transaction = BeginTransaction();
+    for (size_t i = 0; i < kRecordCount; ++i) {
+      IndexedDBBackingStore::RecordIdentifier record;
+      ASSERT_TRUE(backing_store()
+                      ->PutRecord(transaction.get(), kDatabaseId,
+                                  kObjectStoreId, keys_[i], &values_[i],
+                                  &record)
+                      .ok());
+    }
+    Commit(transaction.get());
+  }
+
+  for (bool snapshots : {false, true}) {
+    base::test::ScopedFeatureList feature_list;
+    feature_list.InitWithFeatureState(kIndexedDBReadOnlySnapshots, snapshots);
+    perf_test::PerfResultReporter reporter(
+        kMetricPrefixBackingStore,
+        snapshots ? "mixed_snapshot" : "mixed_locking");
+    reporter.RegisterImportantMetric(kMetricWriterLockWaitMs, "ms");
+    reporter.RegisterImportantMetric(kMetricMixedThroughput, "ops/s");
+
+    base::TimeDelta total_writer_wait;
+    base::ElapsedTimer total_timer;
+    for (size_t round = 0; round < kMixedRounds; ++round) {
+      bool reader_acquired = false;
+      auto reader_locks = AcquireObjectStoreLocks(
+          ScopesLockManager::LockType::kShared, &reader_acquired);
+      ASSERT_TRUE(reader_acquired);
+      auto reader = backing_store()->CreateTransaction(
+          blink::mojom::IDBTransactionDurability::Relaxed,
+          blink::mojom::IDBTransactionMode::ReadOnly);
+      reader->Begin(std::move(reader_locks->locks));
+
+      bool writer_acquired = false;
+      base::ElapsedTimer writer_wait_timer;
+      auto writer_locks = AcquireObjectStoreLocks(
+          ScopesLockManager::LockType::kExclusive, &writer_acquired);
+      bool writer_done = false;
+      auto run_writer = [&]() {
+        total_writer_wait += writer_wait_timer.Elapsed();
+        auto writer = backing_store()->CreateTransaction(
+            blink::mojom::IDBTransactionDurability::Relaxed,
+            blink::mojom::IDBTransactionMode::ReadWrite);
+        writer->Begin(std::move(writer_locks->locks));
+        for (size_t i = 0; i < kMixedWritesPerRound; ++i) {
+          const size_t index =
+              (round * kMixedWritesPerRound + i) % keys_.size();
+          IndexedDBValue value = values_[index];
+          IndexedDBBackingStore::RecordIdentifier record;
+          ASSERT_TRUE(backing_store()
+                          ->PutRecord(writer.get(), kDatabaseId,
+                                      kObjectStoreId, keys_[index], &value,
+                                      &record)
+                          .ok());
+        }
+        Commit(writer.get());
+        writer_done = true;
+      };
+      if (writer_acquired)
+        run_writer();
+
+      for (size_t i = 0; i < kMixedReadsPerRound; ++i) {
+        const size_t index = (round * kMixedReadsPerRound + i) % keys_.size();
+        IndexedDBValue value;
+        ASSERT_TRUE(backing_store()
+                        ->GetRecord(reader.get(), kDatabaseId, kObjectStoreId,
+                                    keys_[index], &value)
+                        .ok());
+      }
+      Commit(reader.get());
+      reader.reset();
+
+      base::RunLoop().RunUntilIdle();
+      ASSERT_TRUE(writer_acquired);
+      if (!writer_done)
+        run_writer();
+    }
+    const size_t total_ops =
+        kMixedRounds * (kMixedReadsPerRound + kMixedWritesPerRound);
+    reporter.AddResult(kMetricWriterLockWaitMs,
+                       total_writer_wait / kMixedRounds);
+    reporter.AddResult(kMetricMixedThroughput,
+                       total_ops / total_timer.Elapsed().InSecondsF());
+  }
+}
+
+TEST_F(IndexedDBBackingStorePerfTest, OpenLatency) {
+  IndexedDBMetadataCoding metadata_coding;
+  std::vector<base::string16> names;
+  for (size_t db = 0; db < kOpenDatabaseCount; ++db) {
+    names.push_back(ASCIIToUTF16("db" + base::NumberToString(db)));
+    IndexedDBDatabaseMetadata database;
+    ASSERT_TRUE(metadata_coding
+                    .CreateDatabase(backing_store()->db(),
+                                    backing_store()->origin_identifier(),
+                                    names.back(), /*version=*/1, &database)
+                    .ok());
+    auto transaction = BeginTransaction();
+    for (size_t os = 1; os <= kOpenObjectStoreCount; ++os) {
+      const std::string os_name = "store" + base::NumberToString(os);
+      IndexedDBObjectStoreMetadata object_store;
+      ASSERT_TRUE(metadata_coding
+                      .CreateObjectStore(transaction->transaction(),
+                                         database.id, os, ASCIIToUTF16(os_name),
+                                         IndexedDBKeyPath(ASCIIToUTF16("id")),
+                                         /*auto_increment=*/false,
+                                         &object_store)
+                      .ok());
+      for (size_t index = 0; index < kOpenIndexCount; ++index) {
+        const std::string field = "field" + base::NumberToString(index);
+        IndexedDBIndexMetadata index_metadata;
+        ASSERT_TRUE(
+            metadata_coding
+                .CreateIndex(transaction->transaction(), database.id, os,
+                             IndexedDBObjectStoreMetadata::kMinimumIndexId +
+                                 index,
+                             ASCIIToUTF16(field),
+                             IndexedDBKeyPath(ASCIIToUTF16(field)),
+                             /*unique=*/false, /*multi_entry=*/false,
+                             &index_metadata)
+                .ok());
+      }
+    }
+    Commit(transaction.get());
+  }
+
+  IndexedDBMetadataCache* cache = backing_store()->metadata_cache();
+  auto open_all = [&]() {
+    for (const base::string16& name : names) {
+      IndexedDBDatabaseMetadata metadata;
+      bool found = false;
+      ASSERT_TRUE(backing_store()
+                      ->ReadMetadataForDatabaseName(&metadata_coding, name,
+                                                    &metadata, &found)
+                      .ok());
+      ASSERT_TRUE(found);
+      ASSERT_EQ(kOpenObjectStoreCount, metadata.object_stores.size());
+    }
+  };
+  open_all();
+  const std::string snapshot = cache->Serialize();
+
+  // "cold" decodes everything from LevelDB, "snapshot" restores a serialized
+  // cache as after the origin was closed and reopened, and "cached" reopens
+  // with a warm cache.
+  for (const char* mode : {"cold", "snapshot", "cached"}) {
+    const std::string mode_name = mode;
+    perf_test::PerfResultReporter reporter(
+        kMetricPrefixBackingStore,
+        "open_" + mode_name + "_" + base::NumberToString(kOpenDatabaseCount));
+    reporter.RegisterImportantMetric(kMetricOpenTimeMs, "ms");
+
+    base::TimeDelta total;
+    for (size_t round = 0; round < kOpenRounds; ++round) {
+      base::ElapsedTimer timer;
+      if (mode_name == "cold")
+        cache->Clear();
+      else if (mode_name == "snapshot")
+        ASSERT_TRUE(cache->Deserialize(snapshot));
+      open_all();
+      total += timer.Elapsed();
+    }
+    reporter.AddResult(kMetricOpenTimeMs, total / kOpenRounds);
+  }
+}
+
+// Returns a structured clone of a JSON-like object, the kind of payload the
+// compression layer targets. Values differ in their ids and counters only.
+std::string CreateStructuredCloneValue(size_t seed) {
+  std::string bits = "\xFF\x13\xFF\x0D" "A";
+  for (size_t item = 0; item < 16; ++item) {
+    const std::string id = base::NumberToString(seed * 16 + item);
+    bits += "o\"\x02id\"";
+    bits.push_back(static_cast<char>(id.size()));
+    bits += id;
+    bits += "\"\x04name\"\x0Cuser profile\"\x06status\"\x06" "active";
+    bits += "\"\x09updatedAt\"\x18" "2020-06-01T12:00:00.000Z";
+    bits += "\"\x04tags\"A\x02\"\x04news\"\x06" "sports$";
+    bits.push_back('\0');
+    bits.push_back('\x02');
+    bits += "\"\x05count\"I";
+    bits.push_back(static_cast<char>((seed + item) % 64));
+    bits += "{\x06";
+  }
+  return bits;
+}
+
+// Measures the stored size of structured clone values (the sum of the
+// LevelDB value sizes, before LevelDB's own block compression), the ratio of
+// stored to logical bytes, and the time to read the values back, without
+// compression, with the built-in dictionary, and with a dictionary trained on
+// the values themselves.
+TEST_F(IndexedDBBackingStorePerfTest, ValueCompression) {
+  std::vector<IndexedDBValue> values;
+  std::vector<std::string> samples;
+  size_t logical_bytes = 0;
+  for (size_t i = 0; i < kCompressionRecordCount; ++i) {
+    values.emplace_back(CreateStructuredCloneValue(i),
+                        std::vector<IndexedDBExternalObject>());
+    logical_bytes += values.back().bits.size();
+    if (i % 10 == 0)
+      samples.push_back(values.back().bits);
+  }
+
+  const struct {
+    const char* name;
+    IndexedDBValueCompressionPolicy::Mode mode;
+  } kModes[] = {
+      {"none", IndexedDBValueCompressionPolicy::Mode::kDisabled},
+      {"built_in", IndexedDBValueCompressionPolicy::Mode::kAlways},
+  };
+  int64_t object_store_id = kObjectStoreId;
+  for (const auto& mode : kModes) {
+    perf_test::PerfResultReporter reporter(
+        kMetricPrefixBackingStore,
+        std::string("compression_") + mode.name + "_" +
+            base::NumberToString(kCompressionRecordCount));
+    reporter.RegisterImportantMetric(kMetricStoredBytes, "bytes");
+    reporter.RegisterImportantMetric(kMetricWriteAmplification, "ratio");
+    reporter.RegisterImportantMetric(kMetricDecodeTimeMs, "ms");
+    backing_store()->SetValueCompressionModeForTesting(mode.mode);
+    ++object_store_id;
+
+    {
+      auto transaction = BeginTransaction();
+      for (size_t i = 0; i < kCompressionRecordCount; ++i) {
+        IndexedDBValue value = values[i];
+        IndexedDBBackingStore::RecordIdentifier record;
+        ASSERT_TRUE(backing_store()
+                        ->PutRecord(transaction.get(), kDatabaseId,
+                                    object_store_id, keys_[i], &value, &record)
+                        .ok());
+      }
+      Commit(transaction.get());
+    }
+    {
+      auto transaction = BeginTransaction();
+      size_t stored_bytes = 0;
+      for (size_t i = 0; i < kCompressionRecordCount; ++i) {
+        std::string data;
+        bool found = false;
+        ASSERT_TRUE(transaction->transaction()
+                        ->Get(ObjectStoreDataKey::Encode(
+                                  kDatabaseId, object_store_id, keys_[i]),
+                              &data, &found)
+                        .ok());
+        ASSERT_TRUE(found);
+        stored_bytes += data.size();
+      }
+
+      base::ElapsedTimer timer;
+      for (size_t i = 0; i < kCompressionRecordCount; ++i) {
+        IndexedDBValue value;
+        ASSERT_TRUE(backing_store()
+                        ->GetRecord(transaction.get(), kDatabaseId,
+                                    object_store_id, keys_[i], &value)
+                        .ok());
+        ASSERT_EQ(values[i].bits.size(), value.bits.size());
+      }
+      reporter.AddResult(kMetricDecodeTimeMs, timer.Elapsed());
+      Commit(transaction.get());
+
+      reporter.AddResult(kMetricStoredBytes, stored_bytes);
+      reporter.AddResult(kMetricWriteAmplification,
+                         static_cast<double>(stored_bytes) / logical_bytes);
+    }
+  }
+
+  // A trained dictionary is not stored with the values, so the backing store
+  // cannot use one; measure the values on their own for comparison.
+  perf_test::PerfResultReporter reporter(
+      kMetricPrefixBackingStore,
+      "compression_trained_" + base::NumberToString(kCompressionRecordCount));
+  reporter.RegisterImportantMetric(kMetricStoredBytes, "bytes");
+  reporter.RegisterImportantMetric(kMetricWriteAmplification, "ratio");
+  reporter.RegisterImportantMetric(kMetricDecodeTimeMs, "ms");
+  const std::string dictionary = indexed_db::TrainValueCompressionDictionary(
+      samples, kTrainedDictionarySize);
+  std::vector<std::string> compressed(kCompressionRecordCount);
+  size_t stored_bytes = 0;
+  for (size_t i = 0; i < kCompressionRecordCount; ++i) {
+    ASSERT_TRUE(indexed_db::CompressValueWithDictionary(
+        values[i].bits, dictionary, &compressed[i]));
+    stored_bytes += compressed[i].size();
+  }
+  base::ElapsedTimer timer;
+  for (size_t i = 0; i < kCompressionRecordCount; ++i) {
+    std::string bits;
+    ASSERT_TRUE(indexed_db::DecompressValueWithDictionary(compressed[i],
+                                                          dictionary, &bits));
+  }
+  reporter.AddResult(kMetricDecodeTimeMs, timer.Elapsed());
+  reporter.AddResult(kMetricStoredBytes, stored_bytes);
+  reporter.AddResult(kMetricWriteAmplification,
+                     static_cast<double>(stored_bytes) / logical_bytes);
+}
+
+}  // namespace
+}  // namespace content
@@ -29,12 +29,15 @@
 #include "base/task/post_task.h"
 #include "base/task/thread_pool.h"
 #include "base/test/bind_test_util.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/task_environment.h"
 #include "base/time/default_clock.h"
 #include "components/services/storage/indexed_db/scopes/disjoint_range_lock_manager.h"
 #include "components/services/storage/indexed_db/scopes/varint_coding.h"
 #include "components/services/storage/indexed_db/transactional_leveldb/leveldb_write_batch.h"
 #include "components/services/storage/indexed_db/transactional_leveldb/transactional_leveldb_database.h"
+#include "components/services/storage/indexed_db/transactional_leveldb/transactional_leveldb_transaction.h"
 #include "components/services/storage/public/mojom/indexed_db_control.mojom-test-utils.h"
 #include "content/browser/indexed_db/indexed_db_class_factory.h"
 #include "content/browser/indexed_db/indexed_db_context_impl.h"
@@ -813,6 +816,112 @@ TEST_F(IndexedDBBackingStoreTest, PutGetConsistency) {
   CycleIDBTaskRunner();
 }
 
+TEST_F(IndexedDBBackingStoreTest, ReadOnlySnapshotRunsWithWriter) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeature(kIndexedDBReadOnlySnapshots);
+
+  // Acquires the dummy database lock plus a lock on object store 1.
+  auto acquire_locks = [&](ScopesLockManager::LockType store_lock_type,
+                           bool* acquired) {
+    auto locks_receiver = std::make_unique<ScopesLocksHolder>();
+    EXPECT_TRUE(lock_manager_->AcquireLocks(
+        {{0, {"01", "11"}, ScopesLockManager::LockType::kShared},
+         {kObjectStoreRangeLockLevel, GetObjectStoreLockRange(1, 1),
+          store_lock_type}},
+        locks_receiver->AsWeakPtr(),
+        base::BindLambdaForTesting([acquired]() { *acquired = true; })));
+    base::RunLoop().RunUntilIdle();
+    return locks_receiver;
+  };
+  auto commit = [](IndexedDBBackingStore::Transaction* transaction) {
+    bool succeeded = false;
+    EXPECT_TRUE(
+        transaction->CommitPhaseOne(CreateBlobWriteCallback(&succeeded)).ok());
+    EXPECT_TRUE(succeeded);
+    EXPECT_TRUE(transaction->CommitPhaseTwo().ok());
+  };
+
+  base::RunLoop loop;
+  idb_context_->IDBTaskRunner()->PostTask(
+      FROM_HERE, base::BindLambdaForTesting([&]() {
+        IndexedDBValue value = value1_;
+        IndexedDBBackingStore::RecordIdentifier record;
+        {
+          IndexedDBBackingStore::Transaction transaction(
+              backing_store()->AsWeakPtr(),
+              blink::mojom::IDBTransactionDurability::Relaxed,
+              blink::mojom::IDBTransactionMode::ReadWrite);
+          transaction.Begin(CreateDummyLock());
+          EXPECT_TRUE(backing_store()
+                          ->PutRecord(&transaction, 1, 1, key1_, &value,
+                                      &record)
+                          .ok());
+          commit(&transaction);
+        }
+
+        bool reader_acquired = false;
+        auto reader_locks = acquire_locks(
+            ScopesLockManager::LockType::kShared, &reader_acquired);
+        ASSERT_TRUE(reader_acquired);
+        IndexedDBBackingStore::Transaction reader(
+            backing_store()->AsWeakPtr(),
+            blink::mojom::IDBTransactionDurability::Relaxed,
+            blink::mojom::IDBTransactionMode::ReadOnly);
+        reader.Begin(std::move(reader_locks->locks));
+        EXPECT_TRUE(reader.has_snapshot());
+
+        // The writer is not blocked by the reader's object store lock.
+        bool writer_acquired = false;
+        auto writer_locks = acquire_locks(
+            ScopesLockManager::LockType::kExclusive, &writer_acquired);
+        ASSERT_TRUE(writer_acquired);
+        {
+          IndexedDBBackingStore::Transaction writer(
+              backing_store()->AsWeakPtr(),
+              blink::mojom::IDBTransactionDurability::Relaxed,
+              blink::mojom::IDBTransactionMode::ReadWrite);
+          writer.Begin(std::move(writer_locks->locks));
+          value = value2_;
+          EXPECT_TRUE(backing_store()
+                          ->PutRecord(&writer, 1, 1, key1_, &value, &record)
+                          .ok());
+          EXPECT_TRUE(backing_store()
+                          ->PutRecord(&writer, 1, 1, key2_, &value, &record)
+                          .ok());
+          commit(&writer);
+        }
+
+        // The reader still sees the database as of its Begin().
+        IndexedDBValue result;
+        EXPECT_TRUE(
+            backing_store()->GetRecord(&reader, 1, 1, key1_, &result).ok());
+        EXPECT_EQ(value1_.bits, result.bits);
+        EXPECT_TRUE(
+            backing_store()->GetRecord(&reader, 1, 1, key2_, &result).ok());
+        EXPECT_TRUE(result.empty());
+        commit(&reader);
+        reader.Reset();
+        EXPECT_FALSE(reader.has_snapshot());
+
+        {
+          IndexedDBBackingStore::Transaction transaction(
+              backing_store()->AsWeakPtr(),
+              blink::mojom::IDBTransactionDurability::Relaxed,
+              blink::mojom::IDBTransactionMode::ReadOnly);
+          transaction.Begin(CreateDummyLock());
+          EXPECT_TRUE(backing_store()
+                          ->GetRecord(&transaction, 1, 1, key1_, &result)
+                          .ok());
+          EXPECT_EQ(value2_.bits, result.bits);
+          commit(&transaction);
+        }
+        loop.Quit();
+      }));
+  loop.Run();
+
+  CycleIDBTaskRunner();
+}
+
 TEST_P(IndexedDBBackingStoreTestWithExternalObjects, PutGetConsistency) {
   // Initiate transaction1 - writing blobs.
   std::unique_ptr<IndexedDBBackingStore::Transaction> transaction1 =
@@ -1318,6 +1427,80 @@ TEST_F(IndexedDBBackingStoreTest, HighIds) {
   CycleIDBTaskRunner();
 }
 
+TEST_F(IndexedDBBackingStoreTest, CompressedValuesRoundTrip) {
+  const int64_t database_id = 1;
+  const int64_t object_store_id = 1;
+  std::string bits = "\xFF\x13\xFF\x0Do";
+  for (int i = 0; i < 200; ++i)
+    bits += "\"\x04name\"\x05value";
+  IndexedDBValue value(bits, {});
+
+  backing_store()->SetValueCompressionModeForTesting(
+      IndexedDBValueCompressionPolicy::Mode::kAlways);
+  {
+    IndexedDBBackingStore::Transaction transaction(
+        backing_store()->AsWeakPtr(),
+        blink::mojom::IDBTransactionDurability::Relaxed,
+        blink::mojom::IDBTransactionMode::ReadWrite);
+    transaction.Begin(CreateDummyLock());
+    IndexedDBBackingStore::RecordIdentifier record;
+    EXPECT_TRUE(backing_store()
+                    ->PutRecord(&transaction, database_id, object_store_id,
+                                key1_, &value, &record)
+                    .ok());
+
+    std::string data;
+    bool found = false;
+    EXPECT_TRUE(transaction.transaction()
+                    ->Get(ObjectStoreDataKey::Encode(database_id,
+                                                     object_store_id, key1_),
+                          &data, &found)
+                    .ok());
+    EXPECT_TRUE(found);
+    EXPECT_LT(data.size(), bits.size());
+
+    bool succeeded = false;
+    EXPECT_TRUE(
+        transaction.CommitPhaseOne(CreateBlobWriteCallback(&succeeded)).ok());
+    EXPECT_TRUE(succeeded);
+    EXPECT_TRUE(transaction.CommitPhaseTwo().ok());
+  }
+
+  // Compressed values stay readable when compression is turned off.
+  backing_store()->SetValueCompressionModeForTesting(
+      IndexedDBValueCompressionPolicy::Mode::kDisabled);
+  {
+    IndexedDBBackingStore::Transaction transaction(
+        backing_store()->AsWeakPtr(),
+        blink::mojom::IDBTransactionDurability::Relaxed,
+        blink::mojom::IDBTransactionMode::ReadOnly);
+    transaction.Begin(CreateDummyLock());
+    IndexedDBValue result;
+    EXPECT_TRUE(backing_store()
+                    ->GetRecord(&transaction, database_id, object_store_id,
+                                key1_, &result)
+                    .ok());
+    EXPECT_EQ(bits, result.bits);
+
+    leveldb::Status s;
+    std::unique_ptr<IndexedDBBackingStore::Cursor> cursor =
+        backing_store()->OpenObjectStoreCursor(
+            &transaction, database_id, object_store_id, IndexedDBKeyRange(),
+            blink::mojom::IDBCursorDirection::Next, &s);
+    ASSERT_TRUE(cursor);
+    EXPECT_TRUE(s.ok());
+    EXPECT_EQ(bits, cursor->value()->bits);
+
+    bool succeeded = false;
+    EXPECT_TRUE(
+        transaction.CommitPhaseOne(CreateBlobWriteCallback(&succeeded)).ok());
+    EXPECT_TRUE(succeeded);
+    EXPECT_TRUE(transaction.CommitPhaseTwo().ok());
+  }
+
+  CycleIDBTaskRunner();
+}
+
 // Make sure that other invalid ids do not crash.
 TEST_F(IndexedDBBackingStoreTest, InvalidIds) {
   base::RunLoop loop;
@@ -1494,6 +1677,90 @@ TEST_F(IndexedDBBackingStoreTest, CreateDatabase) {
   }
 }
 
+TEST_F(IndexedDBBackingStoreTest, ReadMetadataUsesCacheUntilVersionChanges) {
+  base::RunLoop loop;
+  idb_context_->IDBTaskRunner()->PostTask(
+      FROM_HERE, base::BindLambdaForTesting([&]() {
+        base::HistogramTester histogram_tester;
+        const base::string16 database_name(ASCIIToUTF16("db1"));
+        const int64_t object_store_id = 99;
+        IndexedDBMetadataCoding metadata_coding;
+
+        IndexedDBDatabaseMetadata database;
+        leveldb::Status s = metadata_coding.CreateDatabase(
+            backing_store()->db(), backing_store()->origin_identifier(),
+            database_name, /*version=*/1, &database);
+        EXPECT_TRUE(s.ok());
+        {
+          IndexedDBBackingStore::Transaction transaction(
+              backing_store()->AsWeakPtr(),
+              blink::mojom::IDBTransactionDurability::Relaxed,
+              blink::mojom::IDBTransactionMode::ReadWrite);
+          transaction.Begin(CreateDummyLock());
+          IndexedDBObjectStoreMetadata object_store;
+          s = metadata_coding.CreateObjectStore(
+              transaction.transaction(), database.id, object_store_id,
+              ASCIIToUTF16("object_store1"),
+              IndexedDBKeyPath(ASCIIToUTF16("key")),
+              /*auto_increment=*/false, &object_store);
+          EXPECT_TRUE(s.ok());
+          bool succeeded = false;
+          EXPECT_TRUE(
+              transaction.CommitPhaseOne(CreateBlobWriteCallback(&succeeded))
+                  .ok());
+          EXPECT_TRUE(transaction.CommitPhaseTwo().ok());
+        }
+
+        // The first read decodes and caches the metadata, the second is served
+        // from the cache.
+        for (int i = 0; i < 2; ++i) {
+          IndexedDBDatabaseMetadata metadata;
+          bool found = false;
+          s = backing_store()->ReadMetadataForDatabaseName(
+              &metadata_coding, database_name, &metadata, &found);
+          EXPECT_TRUE(s.ok());
+          EXPECT_TRUE(found);
+          EXPECT_EQ(database.id, metadata.id);
+          EXPECT_EQ(1u, metadata.object_stores.size());
+          EXPECT_EQ(ASCIIToUTF16("object_store1"),
+                    metadata.object_stores[object_store_id].name);
+        }
+        histogram_tester.ExpectBucketCount(
+            "WebCore.IndexedDB.MetadataCache.Hit", false, 1);
+        histogram_tester.ExpectBucketCount(
+            "WebCore.IndexedDB.MetadataCache.Hit", true, 1);
+
+        // A version change invalidates the cached copy.
+        {
+          IndexedDBBackingStore::Transaction transaction(
+              backing_store()->AsWeakPtr(),
+              blink::mojom::IDBTransactionDurability::Relaxed,
+              blink::mojom::IDBTransactionMode::VersionChange);
+          transaction.Begin(CreateDummyLock());
+          s = metadata_coding.SetDatabaseVersion(transaction.transaction(),
+                                                 database.id, /*version=*/2,
+                                                 &database);
+          EXPECT_TRUE(s.ok());
+          bool succeeded = false;
+          EXPECT_TRUE(
+              transaction.CommitPhaseOne(CreateBlobWriteCallback(&succeeded))
+                  .ok());
+          EXPECT_TRUE(transaction.CommitPhaseTwo().ok());
+        }
+        IndexedDBDatabaseMetadata metadata;
+        bool found = false;
+        s = backing_store()->ReadMetadataForDatabaseName(
+            &metadata_coding, database_name, &metadata, &found);
+        EXPECT_TRUE(s.ok());
+        EXPECT_TRUE(found);
+        EXPECT_EQ(2, metadata.version);
+        histogram_tester.ExpectBucketCount(
+            "WebCore.IndexedDB.MetadataCache.Hit", false, 2);
+        loop.Quit();
+      }));
+  loop.Run();
+}
+
 TEST_F(IndexedDBBackingStoreTest, GetDatabaseNames) {
   const base::string16 db1_name(ASCIIToUTF16("db1"));
   const int64_t db1_version = 1LL;
@@ -4,13 +4,22 @@
 
 #include "content/browser/indexed_db/indexed_db_compaction_task.h"
 
+#include <utility>
+
+#include "base/metrics/histogram_functions.h"
 #include "third_party/leveldatabase/src/include/leveldb/db.h"
+#include "third_party/leveldatabase/src/include/leveldb/slice.h"
 
 namespace content {
 
 IndexedDBCompactionTask::IndexedDBCompactionTask(leveldb::DB* database)
     : IndexedDBPreCloseTaskQueue::PreCloseTask(database) {}
 
+IndexedDBCompactionTask::IndexedDBCompactionTask(leveldb::DB* database,
+                                                 std::vector<Range> ranges)
+    : IndexedDBPreCloseTaskQueue::PreCloseTask(database),
+      ranges_(std::move(ranges)) {}
+
 IndexedDBCompactionTask::~IndexedDBCompactionTask() = default;
 
 bool IndexedDBCompactionTask::RequiresMetadata() const {
@@ -18,11 +27,43 @@ bool IndexedDBCompactionTask::RequiresMetadata() const {
 }
 
 void IndexedDBCompactionTask::Stop(
-    IndexedDBPreCloseTaskQueue::StopReason reason) {}
+    IndexedDBPreCloseTaskQueue::StopReason reason) {
+  if (next_range_ > 0)
+    RecordReclaimedSize();
+}
 
 bool IndexedDBCompactionTask::RunRound() {
-  database()->CompactRange(nullptr, nullptr);
+  if (ranges_.empty()) {
+    database()->CompactRange(nullptr, nullptr);
+    return true;
+  }
+
+  const Range& range = ranges_[next_range_++];
+  uint64_t size_before = ApproximateSize(range);
+  leveldb::Slice begin(range.begin);
+  leveldb::Slice end(range.end);
+  database()->CompactRange(&begin, &end);
+  uint64_t size_after = ApproximateSize(range);
+  if (size_before > size_after)
+    reclaimed_size_ += size_before - size_after;
+
+  if (next_range_ < ranges_.size())
+    return false;
+  RecordReclaimedSize();
   return true;
 }
 
+uint64_t IndexedDBCompactionTask::ApproximateSize(const Range& range) {
+  leveldb::Range leveldb_range(range.begin, range.end);
+  uint64_t size = 0;
+  database()->GetApproximateSizes(&leveldb_range, 1, &size);
+  return size;
+}
+
+void IndexedDBCompactionTask::RecordReclaimedSize() {
+  base::UmaHistogramMemoryKB(
+      "WebCore.IndexedDB.CompactionTask.RangeReclaimedSize",
+      static_cast<int>(reclaimed_size_ / 1024));
+}
+
 }  // namespace content
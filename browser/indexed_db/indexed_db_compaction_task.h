@@ -5,7 +5,14 @@
 #ifndef CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_COMPACTION_TASK_H_
 #define CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_COMPACTION_TASK_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
 #include "content/browser/indexed_db/indexed_db_pre_close_task_queue.h"
+#include "content/common/content_export.h"
 
 namespace leveldb {
 class DB;
@@ -13,10 +20,19 @@ class DB;
 
 namespace content {
 
-class IndexedDBCompactionTask
+class CONTENT_EXPORT IndexedDBCompactionTask
     : public IndexedDBPreCloseTaskQueue::PreCloseTask {
  public:
+  // An inclusive range of encoded leveldb keys.
+  struct Range {
+    std::string begin;
+    std::string end;
+  };
+
+  // Compacts the whole database in a single round.
   explicit IndexedDBCompactionTask(leveldb::DB* database);
+  // Compacts one of |ranges| per round, in order.
+  IndexedDBCompactionTask(leveldb::DB* database, std::vector<Range> ranges);
   ~IndexedDBCompactionTask() override;
 
   bool RequiresMetadata() const override;
@@ -24,6 +40,17 @@ class IndexedDBCompactionTask
   void Stop(IndexedDBPreCloseTaskQueue::StopReason reason) override;
 
   bool RunRound() override;
+
+  // Estimated bytes freed so far by range compactions.
+  uint64_t reclaimed_size() const { return reclaimed_size_; }
+
+ private:
+  uint64_t ApproximateSize(const Range& range);
+  void RecordReclaimedSize();
+
+  const std::vector<Range> ranges_;
+  size_t next_range_ = 0;
+  uint64_t reclaimed_size_ = 0;
 };
 
 }  // namespace content
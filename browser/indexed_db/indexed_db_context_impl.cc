@@ -15,6 +15,7 @@
 #include "base/files/file_enumerator.h"
 #include "base/files/file_util.h"
 #include "base/files/scoped_temp_dir.h"
+#include "base/metrics/field_trial_params.h"
 #include "base/metrics/histogram_functions.h"
 #include "base/sequenced_task_runner.h"
 #include "base/strings/string_util.h"
@@ -37,6 +38,7 @@
 #include "content/browser/indexed_db/indexed_db_origin_state.h"
 #include "content/browser/indexed_db/indexed_db_origin_state_handle.h"
 #include "content/browser/indexed_db/indexed_db_quota_client.h"
+#include "content/browser/indexed_db/indexed_db_task_runner_pool.h"
 #include "content/browser/indexed_db/indexed_db_tracing.h"
 #include "content/browser/indexed_db/indexed_db_transaction.h"
 #include "content/browser/indexed_db/mock_browsertest_indexed_db_class_factory.h"
@@ -53,11 +55,24 @@ using storage::DatabaseUtil;
 using url::Origin;
 
 namespace content {
+const base::Feature kIndexedDBOffloadDiskUsageReads{
+    "IndexedDBOffloadDiskUsageReads", base::FEATURE_DISABLED_BY_DEFAULT};
+
 const base::FilePath::CharType IndexedDBContextImpl::kIndexedDBDirectory[] =
     FILE_PATH_LITERAL("IndexedDB");
 
 namespace {
 
+const base::FeatureParam<int> kIndexedDBDiskUsageReadTaskRunnerCount{
+    &kIndexedDBOffloadDiskUsageReads, "task_runner_count", 4};
+
+int64_t ComputeOriginDiskUsage(const std::vector<base::FilePath>& paths) {
+  int64_t total_size = 0;
+  for (const base::FilePath& path : paths)
+    total_size += base::ComputeDirectorySize(path);
+  return total_size;
+}
+
 static MockBrowserTestIndexedDBClassFactory* GetTestClassFactory() {
   static ::base::LazyInstance<MockBrowserTestIndexedDBClassFactory>::Leaky
       s_factory = LAZY_INSTANCE_INITIALIZER;
@@ -223,6 +238,9 @@ void IndexedDBContextImpl::DeleteForOrigin(const Origin& origin,
   if (success) {
     GetOriginSet()->erase(origin);
     origin_size_map_.erase(origin);
+    // Drop the result of any read that started before the deletion.
+    pending_usage_queries_.erase(origin);
+    ++usage_query_generations_[origin];
   }
   std::move(callback).Run(success);
 }
@@ -458,6 +476,7 @@ void IndexedDBContextImpl::GetFilePathForTesting(
 void IndexedDBContextImpl::ResetCachesForTesting(base::OnceClosure callback) {
   origin_set_.reset();
   origin_size_map_.clear();
+  pending_usage_queries_.clear();
   std::move(callback).Run();
 }
 
@@ -743,13 +762,13 @@ void IndexedDBContextImpl::ConnectionClosed(const Origin& origin,
       origin, blink::mojom::StorageType::kTemporary);
   if (indexeddb_factory_.get() &&
       indexeddb_factory_->GetConnectionCount(origin) == 0)
-    QueryDiskAndUpdateQuotaUsage(origin);
+    ScheduleQueryDiskAndUpdateQuotaUsage(origin);
 }
 
 void IndexedDBContextImpl::TransactionComplete(const Origin& origin) {
   DCHECK(!indexeddb_factory_.get() ||
          indexeddb_factory_->GetConnectionCount(origin) > 0);
-  QueryDiskAndUpdateQuotaUsage(origin);
+  ScheduleQueryDiskAndUpdateQuotaUsage(origin);
 }
 
 void IndexedDBContextImpl::DatabaseDeleted(const Origin& origin) {
@@ -845,10 +864,7 @@ int64_t IndexedDBContextImpl::ReadUsageFromDisk(const Origin& origin) const {
     return indexeddb_factory_->GetInMemoryDBSize(origin);
   }
 
-  int64_t total_size = 0;
-  for (const base::FilePath& path : GetStoragePaths(origin))
-    total_size += base::ComputeDirectorySize(path);
-  return total_size;
+  return ComputeOriginDiskUsage(GetStoragePaths(origin));
 }
 
 void IndexedDBContextImpl::EnsureDiskUsageCacheInitialized(
@@ -858,8 +874,67 @@ void IndexedDBContextImpl::EnsureDiskUsageCacheInitialized(
 }
 
 void IndexedDBContextImpl::QueryDiskAndUpdateQuotaUsage(const Origin& origin) {
+  // Any read in flight is older than this one.
+  ++usage_query_generations_[origin];
+  UpdateOriginDiskUsage(origin, ReadUsageFromDisk(origin));
+}
+
+void IndexedDBContextImpl::ScheduleQueryDiskAndUpdateQuotaUsage(
+    const Origin& origin) {
+  DCHECK(IDBTaskRunner()->RunsTasksInCurrentSequence());
+  if (is_incognito() ||
+      !base::FeatureList::IsEnabled(kIndexedDBOffloadDiskUsageReads)) {
+    QueryDiskAndUpdateQuotaUsage(origin);
+    return;
+  }
+
+  auto it = pending_usage_queries_.find(origin);
+  if (it != pending_usage_queries_.end()) {
+    // The in-flight read may have missed the change that triggered this one.
+    it->second.needs_requery = true;
+    return;
+  }
+  const uint64_t generation = usage_query_generations_[origin];
+  pending_usage_queries_[origin].generation = generation;
+
+  if (!disk_usage_task_runner_pool_) {
+    disk_usage_task_runner_pool_ = std::make_unique<IndexedDBTaskRunnerPool>(
+        std::max(kIndexedDBDiskUsageReadTaskRunnerCount.Get(), 1),
+        base::TaskTraits{base::MayBlock(), base::TaskPriority::USER_VISIBLE,
+                         base::TaskShutdownBehavior::SKIP_ON_SHUTDOWN});
+  }
+  disk_usage_task_runner_pool_->PostTaskAndReplyWithResult(
+      origin, FROM_HERE,
+      base::BindOnce(&ComputeOriginDiskUsage, GetStoragePaths(origin)),
+      base::BindOnce(&IndexedDBContextImpl::OnOriginDiskUsageRead,
+                     base::WrapRefCounted(this), origin, generation));
+}
+
+void IndexedDBContextImpl::OnOriginDiskUsageRead(const Origin& origin,
+                                                 uint64_t generation,
+                                                 int64_t disk_usage) {
+  DCHECK(IDBTaskRunner()->RunsTasksInCurrentSequence());
+  auto it = pending_usage_queries_.find(origin);
+  // The origin was deleted or the caches were reset while reading. The entry
+  // may also belong to a read started after the deletion, which is left to
+  // its own reply.
+  if (it == pending_usage_queries_.end() ||
+      it->second.generation != generation) {
+    return;
+  }
+  bool needs_requery = it->second.needs_requery;
+  pending_usage_queries_.erase(it);
+
+  // A synchronous query ran while reading, and its result is newer.
+  if (usage_query_generations_[origin] == generation)
+    UpdateOriginDiskUsage(origin, disk_usage);
+  if (needs_requery)
+    ScheduleQueryDiskAndUpdateQuotaUsage(origin);
+}
+
+void IndexedDBContextImpl::UpdateOriginDiskUsage(const Origin& origin,
+                                                 int64_t current_disk_usage) {
   int64_t former_disk_usage = origin_size_map_[origin];
-  int64_t current_disk_usage = ReadUsageFromDisk(origin);
   int64_t difference = current_disk_usage - former_disk_usage;
   if (difference) {
     origin_size_map_[origin] = current_disk_usage;
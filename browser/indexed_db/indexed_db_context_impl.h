@@ -14,6 +14,7 @@
 #include <vector>
 
 #include "base/compiler_specific.h"
+#include "base/feature_list.h"
 #include "base/files/file_path.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
@@ -47,6 +48,11 @@ class Origin;
 namespace content {
 class IndexedDBConnection;
 class IndexedDBFactoryImpl;
+class IndexedDBTaskRunnerPool;
+
+// Moves the origin disk usage reads that follow transactions and connection
+// closes off the IDB task runner, onto a small pool of blocking task runners.
+CONTENT_EXPORT extern const base::Feature kIndexedDBOffloadDiskUsageReads;
 
 class CONTENT_EXPORT IndexedDBContextImpl
     : public base::RefCountedDeleteOnSequence<IndexedDBContextImpl>,
@@ -226,6 +232,16 @@ class CONTENT_EXPORT IndexedDBContextImpl
   // is a difference, it updates |origin_size_map_| and notifies the quota
   // system.
   void QueryDiskAndUpdateQuotaUsage(const url::Origin& origin);
+  // Like QueryDiskAndUpdateQuotaUsage, but when
+  // kIndexedDBOffloadDiskUsageReads is enabled the disk is read on
+  // |disk_usage_task_runner_pool_|. Used after transactions and connection
+  // closes, where the quota update does not need to be immediate.
+  void ScheduleQueryDiskAndUpdateQuotaUsage(const url::Origin& origin);
+  void OnOriginDiskUsageRead(const url::Origin& origin,
+                             uint64_t generation,
+                             int64_t disk_usage);
+  void UpdateOriginDiskUsage(const url::Origin& origin,
+                             int64_t current_disk_usage);
   base::Time GetOriginLastModified(const url::Origin& origin);
 
   // Returns |origin_set_| (this context's in-memory cache of origins with
@@ -251,6 +267,21 @@ class CONTENT_EXPORT IndexedDBContextImpl
   scoped_refptr<base::SequencedTaskRunner> io_task_runner_;
   std::unique_ptr<std::set<url::Origin>> origin_set_;
   std::map<url::Origin, int64_t> origin_size_map_;
+  // Created on first use when kIndexedDBOffloadDiskUsageReads is enabled.
+  std::unique_ptr<IndexedDBTaskRunnerPool> disk_usage_task_runner_pool_;
+  struct PendingUsageQuery {
+    // The value of |usage_query_generations_| when the read was started.
+    uint64_t generation = 0;
+    // True if another read was requested meanwhile, in which case the
+    // in-flight result may be stale and the read is repeated.
+    bool needs_requery = false;
+  };
+  // Origins with a disk usage read in flight on |disk_usage_task_runner_pool_|.
+  std::map<url::Origin, PendingUsageQuery> pending_usage_queries_;
+  // Bumped when an origin is deleted and on every synchronous disk usage
+  // query, so that the result of a read started before is dropped rather
+  // than applied over a newer value.
+  std::map<url::Origin, uint64_t> usage_query_generations_;
   base::Clock* clock_;
 
   mojo::ReceiverSet<storage::mojom::IndexedDBControl> receivers_;
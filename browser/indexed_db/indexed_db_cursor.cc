@@ -267,9 +267,7 @@ leveldb::Status IndexedDBCursor::CursorPrefetchIterationOperation(
   std::vector<IndexedDBValue> found_values;
 
   saved_cursor_.reset();
-  // TODO(cmumford): Use IPC::Channel::kMaximumMessageSize
-  const size_t max_size_estimate = 10 * 1024 * 1024;
-  size_t size_estimate = 0;
+  number_to_fetch = prefetch_sizer_.BeginBatch(number_to_fetch);
 
   // TODO(cmumford): Handle this error (crbug.com/363397). Although this will
   //                 properly fail, caller will not know why, and any corruption
@@ -301,6 +299,7 @@ leveldb::Status IndexedDBCursor::CursorPrefetchIterationOperation(
     found_keys.push_back(cursor_->key());
     found_primary_keys.push_back(cursor_->primary_key());
 
+    size_t size_estimate = 0;
     switch (cursor_type_) {
       case indexed_db::CURSOR_KEY_ONLY:
         found_values.push_back(IndexedDBValue());
@@ -318,7 +317,7 @@ leveldb::Status IndexedDBCursor::CursorPrefetchIterationOperation(
     size_estimate += cursor_->key().size_estimate();
     size_estimate += cursor_->primary_key().size_estimate();
 
-    if (size_estimate > max_size_estimate)
+    if (!prefetch_sizer_.AddRecord(size_estimate))
       break;
   }
 
@@ -350,6 +349,7 @@ leveldb::Status IndexedDBCursor::CursorPrefetchIterationOperation(
 leveldb::Status IndexedDBCursor::PrefetchReset(int used_prefetches,
                                                int /* unused_prefetches */) {
   IDB_TRACE("IndexedDBCursor::PrefetchReset");
+  prefetch_sizer_.OnReset(used_prefetches);
   cursor_.swap(saved_cursor_);
   saved_cursor_.reset();
   leveldb::Status s;
@@ -14,6 +14,7 @@
 #include "base/memory/ref_counted.h"
 #include "base/memory/weak_ptr.h"
 #include "content/browser/indexed_db/indexed_db_backing_store.h"
+#include "content/browser/indexed_db/indexed_db_cursor_prefetch_sizer.h"
 #include "content/browser/indexed_db/indexed_db_database.h"
 #include "content/browser/indexed_db/indexed_db_transaction.h"
 #include "third_party/blink/public/common/indexeddb/web_idb_types.h"
@@ -87,6 +88,8 @@ class CONTENT_EXPORT IndexedDBCursor {
   // Must be destroyed before transaction_.
   std::unique_ptr<IndexedDBBackingStore::Cursor> saved_cursor_;
 
+  IndexedDBCursorPrefetchSizer prefetch_sizer_;
+
   base::OnceClosure remove_binding_cb_;
 
   bool closed_;
@@ -0,0 +1,64 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_cursor_prefetch_sizer.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "base/check_op.h"
+
+namespace content {
+
+constexpr const size_t IndexedDBCursorPrefetchSizer::kMaxBatchSizeEstimate;
+constexpr const size_t IndexedDBCursorPrefetchSizer::kMinBatchSizeEstimate;
+constexpr const int IndexedDBCursorPrefetchSizer::kMinBatchCount;
+
+IndexedDBCursorPrefetchSizer::IndexedDBCursorPrefetchSizer()
+    : count_limit_(std::numeric_limits<int>::max()) {}
+
+IndexedDBCursorPrefetchSizer::~IndexedDBCursorPrefetchSizer() = default;
+
+int IndexedDBCursorPrefetchSizer::BeginBatch(int requested) {
+  // A new request without an intervening reset means every record of the
+  // previous batch was used, so the cursor is being scanned sequentially.
+  if (batch_pending_) {
+    if (count_limit_ <= std::numeric_limits<int>::max() / 2)
+      count_limit_ *= 2;
+    else
+      count_limit_ = std::numeric_limits<int>::max();
+    byte_limit_ = std::min(byte_limit_ * 2, kMaxBatchSizeEstimate);
+  }
+  batch_record_sizes_.clear();
+  batch_size_estimate_ = 0;
+  batch_pending_ = true;
+  return std::min(requested, count_limit_);
+}
+
+bool IndexedDBCursorPrefetchSizer::AddRecord(size_t size_estimate) {
+  DCHECK(batch_pending_);
+  batch_record_sizes_.push_back(size_estimate);
+  batch_size_estimate_ += size_estimate;
+  return batch_size_estimate_ <= byte_limit_;
+}
+
+void IndexedDBCursorPrefetchSizer::OnReset(int used_prefetches) {
+  batch_pending_ = false;
+  const size_t used =
+      std::min(static_cast<size_t>(std::max(used_prefetches, 0)),
+               batch_record_sizes_.size());
+  if (used == batch_record_sizes_.size())
+    return;
+
+  size_t used_size_estimate = 0;
+  for (size_t i = 0; i < used; ++i)
+    used_size_estimate += batch_record_sizes_[i];
+
+  count_limit_ = std::max(static_cast<int>(used) * 2, kMinBatchCount);
+  byte_limit_ =
+      std::max(std::min(used_size_estimate * 2, kMaxBatchSizeEstimate),
+               kMinBatchSizeEstimate);
+}
+
+}  // namespace content
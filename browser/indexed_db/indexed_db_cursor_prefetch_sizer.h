@@ -0,0 +1,72 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_CURSOR_PREFETCH_SIZER_H_
+#define CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_CURSOR_PREFETCH_SIZER_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "base/macros.h"
+#include "content/common/content_export.h"
+
+namespace content {
+
+// Sizes the batches returned by IndexedDBCursor's prefetch operation from
+// how the previous batches were consumed.
+//
+// The renderer asks for |number_to_fetch| records and grows that number on
+// its own heuristics. Only the browser knows how large the records are and,
+// through PrefetchReset, how many of the prefetched records were thrown away.
+// This class uses both to limit the next batch:
+//  * A batch that was fully consumed (the next prefetch request arrived
+//    without a reset) doubles the count and byte limits.
+//  * A reset shrinks the limits to twice what was actually used, so cursors
+//    that are repeatedly interrupted by writes stop reading records that will
+//    only be discarded.
+// The byte limit is always capped at kMaxBatchSizeEstimate, which bounds the
+// size of the IPC message.
+class CONTENT_EXPORT IndexedDBCursorPrefetchSizer {
+ public:
+  // TODO(cmumford): Use IPC::Channel::kMaximumMessageSize
+  static constexpr size_t kMaxBatchSizeEstimate = 10 * 1024 * 1024;
+  static constexpr size_t kMinBatchSizeEstimate = 64 * 1024;
+  // Matches the renderer's initial prefetch amount.
+  static constexpr int kMinBatchCount = 5;
+
+  IndexedDBCursorPrefetchSizer();
+  ~IndexedDBCursorPrefetchSizer();
+
+  // Called at the start of every prefetch operation. Returns the number of
+  // records to read, which is at most |requested|.
+  int BeginBatch(int requested);
+  // Called for every record added to the current batch. Returns false once
+  // the batch has reached the byte limit and no more records should be read.
+  bool AddRecord(size_t size_estimate);
+  // Called when the renderer discards the unused tail of the last batch.
+  void OnReset(int used_prefetches);
+
+  int last_batch_count() const {
+    return static_cast<int>(batch_record_sizes_.size());
+  }
+  int count_limit() const { return count_limit_; }
+  size_t byte_limit() const { return byte_limit_; }
+
+ private:
+  int count_limit_;
+  size_t byte_limit_ = kMaxBatchSizeEstimate;
+  size_t batch_size_estimate_ = 0;
+
+  // The size estimate of each record in the current (or last) batch, used to
+  // work out how many bytes were consumed on reset.
+  std::vector<size_t> batch_record_sizes_;
+  bool batch_pending_ = false;
+
+  DISALLOW_COPY_AND_ASSIGN(IndexedDBCursorPrefetchSizer);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_CURSOR_PREFETCH_SIZER_H_
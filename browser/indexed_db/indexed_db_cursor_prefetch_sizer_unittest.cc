@@ -0,0 +1,80 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_cursor_prefetch_sizer.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+
+using Sizer = IndexedDBCursorPrefetchSizer;
+
+TEST(IndexedDBCursorPrefetchSizerTest, UnlimitedByDefault) {
+  Sizer sizer;
+  EXPECT_EQ(100, sizer.BeginBatch(100));
+  for (int i = 0; i < 100; ++i)
+    EXPECT_TRUE(sizer.AddRecord(1024));
+  EXPECT_EQ(100, sizer.last_batch_count());
+}
+
+TEST(IndexedDBCursorPrefetchSizerTest, ByteLimitStopsBatch) {
+  Sizer sizer;
+  sizer.BeginBatch(100);
+  EXPECT_TRUE(sizer.AddRecord(Sizer::kMaxBatchSizeEstimate / 2));
+  EXPECT_TRUE(sizer.AddRecord(Sizer::kMaxBatchSizeEstimate / 2));
+  EXPECT_FALSE(sizer.AddRecord(1));
+}
+
+TEST(IndexedDBCursorPrefetchSizerTest, ResetShrinksLimits) {
+  Sizer sizer;
+  sizer.BeginBatch(50);
+  for (int i = 0; i < 50; ++i)
+    sizer.AddRecord(100 * 1024);
+  sizer.OnReset(/*used_prefetches=*/4);
+
+  EXPECT_EQ(8, sizer.count_limit());
+  EXPECT_EQ(800u * 1024, sizer.byte_limit());
+  EXPECT_EQ(8, sizer.BeginBatch(50));
+}
+
+TEST(IndexedDBCursorPrefetchSizerTest, ResetHonorsMinimums) {
+  Sizer sizer;
+  sizer.BeginBatch(20);
+  for (int i = 0; i < 20; ++i)
+    sizer.AddRecord(10);
+  sizer.OnReset(/*used_prefetches=*/1);
+
+  EXPECT_EQ(Sizer::kMinBatchCount, sizer.count_limit());
+  EXPECT_EQ(Sizer::kMinBatchSizeEstimate, sizer.byte_limit());
+}
+
+TEST(IndexedDBCursorPrefetchSizerTest, FullyUsedResetKeepsLimits) {
+  Sizer sizer;
+  sizer.BeginBatch(20);
+  for (int i = 0; i < 20; ++i)
+    sizer.AddRecord(10);
+  sizer.OnReset(/*used_prefetches=*/20);
+
+  EXPECT_EQ(20, sizer.BeginBatch(20));
+  EXPECT_EQ(Sizer::kMaxBatchSizeEstimate, sizer.byte_limit());
+}
+
+TEST(IndexedDBCursorPrefetchSizerTest, ConsumedBatchesGrowLimits) {
+  Sizer sizer;
+  sizer.BeginBatch(50);
+  for (int i = 0; i < 50; ++i)
+    sizer.AddRecord(100 * 1024);
+  sizer.OnReset(/*used_prefetches=*/4);
+  EXPECT_EQ(8, sizer.BeginBatch(50));
+  for (int i = 0; i < 8; ++i)
+    sizer.AddRecord(100 * 1024);
+
+  // The next request arrives without a reset, so the whole batch was used.
+  EXPECT_EQ(16, sizer.BeginBatch(50));
+  EXPECT_EQ(1600u * 1024, sizer.byte_limit());
+  EXPECT_EQ(32, sizer.BeginBatch(50));
+  EXPECT_EQ(50, sizer.BeginBatch(50));
+}
+
+}  // namespace content
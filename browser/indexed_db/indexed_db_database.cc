@@ -334,6 +334,10 @@ void IndexedDBDatabase::TransactionFinished(
   // connections to close, or the actual upgrade transaction from an active
   // request. Notify the active request if it's the latter.
   if (mode == blink::mojom::IDBTransactionMode::VersionChange) {
+    // The upgrade may have changed the schema. Keep the cached copy in step so
+    // that the next open of this database does not have to decode it again.
+    if (committed)
+      backing_store_->metadata_cache()->Put(metadata_);
     connection_coordinator_.OnUpgradeTransactionFinished(committed);
   }
 }
@@ -1603,9 +1607,8 @@ void IndexedDBDatabase::CallUpgradeTransactionStartedForTesting(
 
 Status IndexedDBDatabase::OpenInternal() {
   bool found = false;
-  Status s = metadata_coding_->ReadMetadataForDatabaseName(
-      backing_store_->db(), backing_store_->origin_identifier(), metadata_.name,
-      &metadata_, &found);
+  Status s = backing_store_->ReadMetadataForDatabaseName(
+      metadata_coding_.get(), metadata_.name, &metadata_, &found);
   DCHECK(found == (metadata_.id != kInvalidId))
       << "found = " << found << " id = " << metadata_.id;
   if (!s.ok() || found)
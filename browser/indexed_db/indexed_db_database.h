@@ -160,6 +160,9 @@ class CONTENT_EXPORT IndexedDBDatabase {
     return connection_coordinator_.PendingOpenDeleteCount();
   }
 
+  // Number of transactions that have been created and not yet finished.
+  int64_t transaction_count() const { return transaction_count_; }
+
   // The following methods are all of the ones actually scheduled asynchronously
   // within transctions:
 
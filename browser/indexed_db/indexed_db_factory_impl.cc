@@ -63,6 +63,8 @@ namespace content {
 
 namespace {
 constexpr static const int kNumOpenTries = 2;
+// Bounds the number of closed origins whose metadata snapshot is kept.
+constexpr static const size_t kMaxMetadataSnapshots = 64;
 
 leveldb::Status GetDBSizeFromEnv(leveldb::Env* env,
                                  const std::string& path,
@@ -506,6 +508,7 @@ std::vector<IndexedDBDatabase*> IndexedDBFactoryImpl::GetOpenDatabasesForOrigin(
 void IndexedDBFactoryImpl::ForceClose(const Origin& origin,
                                       bool delete_in_memory_store) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  metadata_snapshots_.erase(origin);
   auto it = factories_per_origin_.find(origin);
   if (it == factories_per_origin_.end())
     return;
@@ -559,6 +562,7 @@ void IndexedDBFactoryImpl::ContextDestroyed() {
     pair.second->ForceClose();
   }
   factories_per_origin_.clear();
+  metadata_snapshots_.clear();
 }
 
 void IndexedDBFactoryImpl::ReportOutstandingBlobs(const Origin& origin,
@@ -782,6 +786,16 @@ IndexedDBFactoryImpl::GetOrOpenOriginFactory(
   if (!is_incognito_and_in_memory)
     ReportOpenStatus(indexed_db::INDEXED_DB_BACKING_STORE_OPEN_SUCCESS, origin);
 
+  // Entries restored from the snapshot are still checked against the
+  // database id and version before use, but a snapshot is never trusted for a
+  // backing store that had to be recreated.
+  auto snapshot_it = metadata_snapshots_.find(origin);
+  if (snapshot_it != metadata_snapshots_.end()) {
+    if (data_loss_info.status == blink::mojom::IDBDataLoss::None)
+      backing_store->metadata_cache()->Deserialize(snapshot_it->second);
+    metadata_snapshots_.erase(snapshot_it);
+  }
+
   auto run_tasks_callback = base::BindRepeating(
       &IndexedDBFactoryImpl::MaybeRunTasksForOrigin,
       origin_state_destruction_weak_factory_.GetWeakPtr(), origin);
@@ -1039,11 +1053,28 @@ void IndexedDBFactoryImpl::RunTasksForOrigin(
       OnDatabaseError(origin_state->origin(), status, nullptr);
       return;
     case IndexedDBOriginState::RunTasksResult::kCanBeDestroyed:
+      MaybeSaveMetadataSnapshot(origin_state.get());
       factories_per_origin_.erase(origin_state->origin());
       return;
   }
 }
 
+void IndexedDBFactoryImpl::MaybeSaveMetadataSnapshot(
+    IndexedDBOriginState* origin_state) {
+  IndexedDBBackingStore* backing_store = origin_state->backing_store();
+  if (origin_state->was_force_closed() || !backing_store ||
+      backing_store->is_incognito() ||
+      backing_store->metadata_cache()->size() == 0) {
+    return;
+  }
+  if (metadata_snapshots_.size() >= kMaxMetadataSnapshots &&
+      !base::Contains(metadata_snapshots_, origin_state->origin())) {
+    metadata_snapshots_.erase(metadata_snapshots_.begin());
+  }
+  metadata_snapshots_[origin_state->origin()] =
+      backing_store->metadata_cache()->Serialize();
+}
+
 bool IndexedDBFactoryImpl::IsDatabaseOpen(const Origin& origin,
                                           const base::string16& name) const {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
@@ -7,8 +7,10 @@
 
 #include <stddef.h>
 
+#include <map>
 #include <memory>
 #include <set>
+#include <string>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -207,6 +209,9 @@ class CONTENT_EXPORT IndexedDBFactoryImpl
 
   void MaybeRunTasksForOrigin(const url::Origin& origin);
   void RunTasksForOrigin(base::WeakPtr<IndexedDBOriginState> origin_state);
+  // Keeps the metadata cache of |origin_state|'s backing store, which is about
+  // to be destroyed after closing normally, for the next open of the origin.
+  void MaybeSaveMetadataSnapshot(IndexedDBOriginState* origin_state);
 
   // Testing helpers, so unit tests don't need to grovel through internal
   // state.
@@ -230,6 +235,11 @@ class CONTENT_EXPORT IndexedDBFactoryImpl
 
   std::set<url::Origin> backends_opened_since_startup_;
 
+  // Serialized metadata caches of backing stores that closed normally, used
+  // to seed the cache when the origin is opened again. Dropped whenever the
+  // origin is force closed, since its data may be deleted or recreated.
+  std::map<url::Origin, std::string> metadata_snapshots_;
+
   // Weak pointers from this factory are used to bind the RemoveOriginState()
   // function, which deletes the IndexedDBOriginState object. This allows those
   // weak pointers to be invalidated during force close & shutdown to prevent
@@ -14,6 +14,7 @@
 #include "components/services/storage/indexed_db/transactional_leveldb/transactional_leveldb_database.h"
 #include "components/services/storage/indexed_db/transactional_leveldb/transactional_leveldb_iterator.h"
 #include "components/services/storage/indexed_db/transactional_leveldb/transactional_leveldb_transaction.h"
+#include "content/browser/indexed_db/indexed_db_backing_store.h"
 #include "content/browser/indexed_db/indexed_db_data_format_version.h"
 #include "content/browser/indexed_db/indexed_db_data_loss_info.h"
 #include "content/browser/indexed_db/indexed_db_leveldb_env.h"
@@ -363,7 +364,8 @@ Status SetMaxIndexId(TransactionalLevelDBTransaction* transaction,
   return PutInt(transaction, max_index_id_key, index_id);
 }
 
-Status VersionExists(TransactionalLevelDBTransaction* transaction,
+template <typename DBOrTransaction>
+Status VersionExists(DBOrTransaction* transaction,
                      int64_t database_id,
                      int64_t object_store_id,
                      int64_t version,
@@ -389,6 +391,21 @@ Status VersionExists(TransactionalLevelDBTransaction* transaction,
   return s;
 }
 
+template Status VersionExists<TransactionalLevelDBTransaction>(
+    TransactionalLevelDBTransaction* transaction,
+    int64_t database_id,
+    int64_t object_store_id,
+    int64_t version,
+    const std::string& encoded_primary_key,
+    bool* exists);
+template Status VersionExists<IndexedDBBackingStore::Transaction>(
+    IndexedDBBackingStore::Transaction* transaction,
+    int64_t database_id,
+    int64_t object_store_id,
+    int64_t version,
+    const std::string& encoded_primary_key,
+    bool* exists);
+
 template Status GetNewDatabaseId<LevelDBDirectTransaction>(
     LevelDBDirectTransaction* transaction,
     int64_t* new_id);
@@ -460,11 +477,11 @@ bool CheckIndexAndMetaDataKey(const TransactionalLevelDBIterator* it,
   return true;
 }
 
-bool FindGreatestKeyLessThanOrEqual(
-    TransactionalLevelDBTransaction* transaction,
-    const std::string& target,
-    std::string* found_key,
-    Status* s) {
+template <typename DBOrTransaction>
+bool FindGreatestKeyLessThanOrEqual(DBOrTransaction* transaction,
+                                    const std::string& target,
+                                    std::string* found_key,
+                                    Status* s) {
   std::unique_ptr<TransactionalLevelDBIterator> it =
       transaction->CreateIterator();
   *s = it->Seek(target);
@@ -493,6 +510,18 @@ bool FindGreatestKeyLessThanOrEqual(
   return true;
 }
 
+template bool FindGreatestKeyLessThanOrEqual<TransactionalLevelDBTransaction>(
+    TransactionalLevelDBTransaction* transaction,
+    const std::string& target,
+    std::string* found_key,
+    Status* s);
+template bool FindGreatestKeyLessThanOrEqual<
+    IndexedDBBackingStore::Transaction>(
+    IndexedDBBackingStore::Transaction* transaction,
+    const std::string& target,
+    std::string* found_key,
+    Status* s);
+
 bool GetBlobNumberGeneratorCurrentNumber(
     LevelDBDirectTransaction* leveldb_transaction,
     int64_t database_id,
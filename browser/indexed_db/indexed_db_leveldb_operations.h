@@ -164,8 +164,9 @@ WARN_UNUSED_RESULT leveldb::Status SetMaxIndexId(
     int64_t object_store_id,
     int64_t index_id);
 
+template <typename DBOrTransaction>
 WARN_UNUSED_RESULT leveldb::Status VersionExists(
-    TransactionalLevelDBTransaction* transaction,
+    DBOrTransaction* transaction,
     int64_t database_id,
     int64_t object_store_id,
     int64_t version,
@@ -188,8 +189,9 @@ WARN_UNUSED_RESULT bool CheckIndexAndMetaDataKey(
     int64_t index_id,
     unsigned char meta_data_type);
 
+template <typename DBOrTransaction>
 WARN_UNUSED_RESULT bool FindGreatestKeyLessThanOrEqual(
-    TransactionalLevelDBTransaction* transaction,
+    DBOrTransaction* transaction,
     const std::string& target,
     std::string* found_key,
     leveldb::Status* s);
@@ -0,0 +1,120 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_maintenance_scheduler.h"
+
+#include <utility>
+
+#include "base/bind.h"
+#include "base/metrics/histogram_functions.h"
+#include "base/timer/elapsed_timer.h"
+#include "third_party/blink/public/common/indexeddb/indexeddb_metadata.h"
+#include "third_party/leveldatabase/env_chromium.h"
+
+namespace content {
+
+using StopReason = IndexedDBPreCloseTaskQueue::StopReason;
+
+IndexedDBMaintenanceScheduler::IndexedDBMaintenanceScheduler(
+    std::list<std::unique_ptr<PreCloseTask>> tasks,
+    IdleCallback is_idle,
+    base::TimeDelta slice_budget,
+    base::TimeDelta slice_interval,
+    std::unique_ptr<base::RepeatingTimer> timer)
+    : tasks_(std::move(tasks)),
+      is_idle_(std::move(is_idle)),
+      slice_budget_(slice_budget),
+      slice_interval_(slice_interval),
+      timer_(std::move(timer)) {}
+
+IndexedDBMaintenanceScheduler::~IndexedDBMaintenanceScheduler() = default;
+
+void IndexedDBMaintenanceScheduler::Start(
+    IndexedDBPreCloseTaskQueue::MetadataFetcher metadata_fetcher) {
+  DCHECK(!started_);
+  started_ = true;
+  if (tasks_.empty()) {
+    OnComplete();
+    return;
+  }
+  metadata_fetcher_ = std::move(metadata_fetcher);
+  // Unretained is safe because |timer_| is owned by this object.
+  timer_->Start(FROM_HERE, slice_interval_,
+                base::BindRepeating(&IndexedDBMaintenanceScheduler::RunSlice,
+                                    base::Unretained(this)));
+}
+
+void IndexedDBMaintenanceScheduler::StopForClosing() {
+  if (!started_ || done_)
+    return;
+  while (!tasks_.empty()) {
+    tasks_.front()->Stop(StopReason::ORIGIN_CLOSING);
+    tasks_.pop_front();
+  }
+  OnComplete();
+}
+
+void IndexedDBMaintenanceScheduler::RunSlice() {
+  DCHECK(started_);
+  if (done_)
+    return;
+  // Tasks write to leveldb directly, so never interleave them with a
+  // transaction. The slice is retried at the next interval.
+  if (!is_idle_.Run())
+    return;
+
+  base::ElapsedTimer slice_timer;
+  do {
+    PreCloseTask* task = tasks_.front().get();
+    if (task->RequiresMetadata() && !task->set_metadata_was_called_) {
+      if (!has_metadata_) {
+        leveldb::Status status = std::move(metadata_fetcher_).Run(&metadata_);
+        has_metadata_ = true;
+        if (!status.ok()) {
+          base::UmaHistogramEnumeration(
+              "WebCore.IndexedDB.MaintenanceScheduler.MetadataError",
+              leveldb_env::GetLevelDBStatusUMAValue(status),
+              leveldb_env::LEVELDB_STATUS_MAX);
+          while (!tasks_.empty()) {
+            tasks_.front()->Stop(StopReason::METADATA_ERROR);
+            tasks_.pop_front();
+          }
+          break;
+        }
+      }
+      task->SetMetadata(&metadata_);
+      task->set_metadata_was_called_ = true;
+    }
+    if (task->RunRound()) {
+      std::unique_ptr<PreCloseTask> follow_up = task->TakeFollowUpTask();
+      tasks_.pop_front();
+      if (follow_up)
+        tasks_.push_front(std::move(follow_up));
+    }
+  } while (!tasks_.empty() && slice_timer.Elapsed() < slice_budget_);
+
+  base::TimeDelta slice_time = slice_timer.Elapsed();
+  base::UmaHistogramTimes("WebCore.IndexedDB.MaintenanceScheduler.SliceTime",
+                          slice_time);
+  ++slice_count_;
+  total_slice_time_ += slice_time;
+
+  if (tasks_.empty()) {
+    base::UmaHistogramCounts1000(
+        "WebCore.IndexedDB.MaintenanceScheduler.SliceCount", slice_count_);
+    base::UmaHistogramMediumTimes(
+        "WebCore.IndexedDB.MaintenanceScheduler.TotalSliceTime",
+        total_slice_time_);
+    OnComplete();
+  }
+}
+
+void IndexedDBMaintenanceScheduler::OnComplete() {
+  DCHECK(started_);
+  DCHECK(!done_);
+  timer_->Stop();
+  done_ = true;
+}
+
+}  // namespace content
@@ -0,0 +1,87 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_MAINTENANCE_SCHEDULER_H_
+#define CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_MAINTENANCE_SCHEDULER_H_
+
+#include <list>
+#include <memory>
+#include <vector>
+
+#include "base/callback.h"
+#include "base/macros.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "content/browser/indexed_db/indexed_db_pre_close_task_queue.h"
+#include "content/common/content_export.h"
+
+namespace blink {
+struct IndexedDBDatabaseMetadata;
+}
+
+namespace content {
+
+// Runs PreCloseTasks (tombstone sweeps and range compactions) while an origin
+// is still open, so origins that are never closed are maintained too.
+//
+// Work is done in slices: every |slice_interval| the scheduler asks
+// |is_idle| whether the origin has any running transactions, and if not,
+// runs task rounds until |slice_budget| is used up. A slice always runs at
+// least one round. The time spent in each slice is the latency that
+// maintenance can add to a transaction that arrives during it, and is
+// recorded to UMA.
+//
+// Owned by IndexedDBOriginState.
+class CONTENT_EXPORT IndexedDBMaintenanceScheduler {
+ public:
+  using PreCloseTask = IndexedDBPreCloseTaskQueue::PreCloseTask;
+  // Returns true if no transactions are running on the origin.
+  using IdleCallback = base::RepeatingCallback<bool()>;
+
+  IndexedDBMaintenanceScheduler(std::list<std::unique_ptr<PreCloseTask>> tasks,
+                                IdleCallback is_idle,
+                                base::TimeDelta slice_budget,
+                                base::TimeDelta slice_interval,
+                                std::unique_ptr<base::RepeatingTimer> timer);
+  ~IndexedDBMaintenanceScheduler();
+
+  bool started() const { return started_; }
+
+  // Tasks are all complete or they have been stopped.
+  bool done() const { return done_; }
+
+  // Starts the slice timer. Can only be called once. The metadata is fetched
+  // in the first slice that runs a task requiring it.
+  void Start(IndexedDBPreCloseTaskQueue::MetadataFetcher metadata_fetcher);
+
+  // Stops and destroys all remaining tasks. Called when the origin starts
+  // closing, which hands maintenance over to IndexedDBPreCloseTaskQueue.
+  void StopForClosing();
+
+ private:
+  void RunSlice();
+  void OnComplete();
+
+  bool has_metadata_ = false;
+  IndexedDBPreCloseTaskQueue::MetadataFetcher metadata_fetcher_;
+  std::vector<blink::IndexedDBDatabaseMetadata> metadata_;
+
+  bool started_ = false;
+  bool done_ = false;
+  std::list<std::unique_ptr<PreCloseTask>> tasks_;
+  const IdleCallback is_idle_;
+
+  const base::TimeDelta slice_budget_;
+  const base::TimeDelta slice_interval_;
+  std::unique_ptr<base::RepeatingTimer> timer_;
+
+  int slice_count_ = 0;
+  base::TimeDelta total_slice_time_;
+
+  DISALLOW_COPY_AND_ASSIGN(IndexedDBMaintenanceScheduler);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_MAINTENANCE_SCHEDULER_H_
@@ -0,0 +1,239 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_maintenance_scheduler.h"
+
+#include <list>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/ptr_util.h"
+#include "base/strings/string16.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/task_environment.h"
+#include "base/time/time.h"
+#include "base/timer/mock_timer.h"
+#include "testing/gmock/include/gmock/gmock.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/common/indexeddb/indexeddb_metadata.h"
+
+using blink::IndexedDBDatabaseMetadata;
+
+namespace content {
+
+using PreCloseTask = IndexedDBPreCloseTaskQueue::PreCloseTask;
+using StopReason = IndexedDBPreCloseTaskQueue::StopReason;
+
+namespace {
+constexpr base::TimeDelta kTestSliceInterval =
+    base::TimeDelta::FromMilliseconds(500);
+const base::string16 kDBName = base::ASCIIToUTF16("TestDBName");
+constexpr int64_t kDBId = 1;
+constexpr int64_t kDBVersion = 2;
+constexpr int64_t kDBMaxObjectStoreId = 29;
+
+class MockPreCloseTask : public PreCloseTask {
+ public:
+  MockPreCloseTask() : PreCloseTask(nullptr) {}
+  ~MockPreCloseTask() override = default;
+
+  bool RequiresMetadata() const override { return true; }
+
+  std::unique_ptr<PreCloseTask> TakeFollowUpTask() override {
+    return std::move(follow_up_);
+  }
+
+  void set_follow_up(std::unique_ptr<PreCloseTask> follow_up) {
+    follow_up_ = std::move(follow_up);
+  }
+
+  MOCK_METHOD1(SetMetadata,
+               void(const std::vector<IndexedDBDatabaseMetadata>* metadata));
+
+  MOCK_METHOD1(Stop, void(StopReason reason));
+
+  MOCK_METHOD0(RunRound, bool());
+
+ private:
+  std::unique_ptr<PreCloseTask> follow_up_;
+};
+
+leveldb::Status MetadataFetcher(
+    bool* called,
+    leveldb::Status return_status,
+    std::vector<IndexedDBDatabaseMetadata>* metadata,
+    std::vector<IndexedDBDatabaseMetadata>* output_metadata) {
+  *called = true;
+  *output_metadata = *metadata;
+  return return_status;
+}
+
+bool ReturnBool(const bool* value) {
+  return *value;
+}
+
+class IndexedDBMaintenanceSchedulerTest : public testing::Test {
+ public:
+  IndexedDBMaintenanceSchedulerTest() {
+    metadata_.push_back(IndexedDBDatabaseMetadata(kDBName, kDBId, kDBVersion,
+                                                  kDBMaxObjectStoreId));
+  }
+  ~IndexedDBMaintenanceSchedulerTest() override = default;
+
+  // A zero budget runs exactly one round per slice.
+  std::unique_ptr<IndexedDBMaintenanceScheduler> CreateScheduler(
+      std::list<std::unique_ptr<PreCloseTask>> tasks) {
+    fake_timer_ = new base::MockRepeatingTimer;
+    return std::make_unique<IndexedDBMaintenanceScheduler>(
+        std::move(tasks), base::BindRepeating(&ReturnBool, &idle_),
+        base::TimeDelta(), kTestSliceInterval, base::WrapUnique(fake_timer_));
+  }
+
+ protected:
+  std::vector<IndexedDBDatabaseMetadata> metadata_;
+  base::test::TaskEnvironment task_environment_;
+  base::HistogramTester histogram_tester_;
+  bool idle_ = true;
+  base::MockRepeatingTimer* fake_timer_ = nullptr;
+};
+
+TEST_F(IndexedDBMaintenanceSchedulerTest, NoTasks) {
+  bool metadata_called = false;
+  auto scheduler = CreateScheduler(std::list<std::unique_ptr<PreCloseTask>>());
+  scheduler->Start(base::BindOnce(&MetadataFetcher, &metadata_called,
+                                  leveldb::Status::OK(), &metadata_));
+
+  EXPECT_FALSE(metadata_called);
+  EXPECT_TRUE(scheduler->done());
+  EXPECT_FALSE(fake_timer_->IsRunning());
+}
+
+TEST_F(IndexedDBMaintenanceSchedulerTest, OneRoundPerSlice) {
+  bool metadata_called = false;
+  MockPreCloseTask* task = new testing::StrictMock<MockPreCloseTask>();
+  EXPECT_CALL(*task,
+              SetMetadata(testing::Pointee(testing::ContainerEq(metadata_))));
+
+  std::list<std::unique_ptr<PreCloseTask>> tasks;
+  tasks.push_back(base::WrapUnique(task));
+  auto scheduler = CreateScheduler(std::move(tasks));
+  scheduler->Start(base::BindOnce(&MetadataFetcher, &metadata_called,
+                                  leveldb::Status::OK(), &metadata_));
+  EXPECT_TRUE(fake_timer_->IsRunning());
+  EXPECT_EQ(kTestSliceInterval, fake_timer_->GetCurrentDelay());
+
+  EXPECT_CALL(*task, RunRound()).WillOnce(testing::Return(false));
+  fake_timer_->Fire();
+  EXPECT_TRUE(metadata_called);
+  EXPECT_FALSE(scheduler->done());
+  testing::Mock::VerifyAndClearExpectations(task);
+
+  EXPECT_CALL(*task, RunRound()).WillOnce(testing::Return(true));
+  fake_timer_->Fire();
+  EXPECT_TRUE(scheduler->done());
+  EXPECT_FALSE(fake_timer_->IsRunning());
+
+  histogram_tester_.ExpectTotalCount(
+      "WebCore.IndexedDB.MaintenanceScheduler.SliceTime", 2);
+  histogram_tester_.ExpectUniqueSample(
+      "WebCore.IndexedDB.MaintenanceScheduler.SliceCount", 2, 1);
+}
+
+TEST_F(IndexedDBMaintenanceSchedulerTest, SkipsSlicesWhileBusy) {
+  bool metadata_called = false;
+  MockPreCloseTask* task = new testing::StrictMock<MockPreCloseTask>();
+
+  std::list<std::unique_ptr<PreCloseTask>> tasks;
+  tasks.push_back(base::WrapUnique(task));
+  auto scheduler = CreateScheduler(std::move(tasks));
+  scheduler->Start(base::BindOnce(&MetadataFetcher, &metadata_called,
+                                  leveldb::Status::OK(), &metadata_));
+
+  idle_ = false;
+  fake_timer_->Fire();
+  EXPECT_FALSE(metadata_called);
+  EXPECT_FALSE(scheduler->done());
+  EXPECT_TRUE(fake_timer_->IsRunning());
+  histogram_tester_.ExpectTotalCount(
+      "WebCore.IndexedDB.MaintenanceScheduler.SliceTime", 0);
+
+  idle_ = true;
+  EXPECT_CALL(*task, SetMetadata(testing::_));
+  EXPECT_CALL(*task, RunRound()).WillOnce(testing::Return(true));
+  fake_timer_->Fire();
+  EXPECT_TRUE(scheduler->done());
+}
+
+TEST_F(IndexedDBMaintenanceSchedulerTest, FollowUpTaskRunsNext) {
+  bool metadata_called = false;
+  MockPreCloseTask* task1 = new testing::StrictMock<MockPreCloseTask>();
+  MockPreCloseTask* task2 = new testing::StrictMock<MockPreCloseTask>();
+  MockPreCloseTask* follow_up = new testing::StrictMock<MockPreCloseTask>();
+  task1->set_follow_up(base::WrapUnique(follow_up));
+
+  std::list<std::unique_ptr<PreCloseTask>> tasks;
+  tasks.push_back(base::WrapUnique(task1));
+  tasks.push_back(base::WrapUnique(task2));
+  auto scheduler = CreateScheduler(std::move(tasks));
+  scheduler->Start(base::BindOnce(&MetadataFetcher, &metadata_called,
+                                  leveldb::Status::OK(), &metadata_));
+
+  {
+    testing::InSequence sequence_enforcer;
+    EXPECT_CALL(*task1, SetMetadata(testing::_));
+    EXPECT_CALL(*task1, RunRound()).WillOnce(testing::Return(true));
+    EXPECT_CALL(*follow_up, SetMetadata(testing::_));
+    EXPECT_CALL(*follow_up, RunRound()).WillOnce(testing::Return(true));
+    EXPECT_CALL(*task2, SetMetadata(testing::_));
+    EXPECT_CALL(*task2, RunRound()).WillOnce(testing::Return(true));
+  }
+  fake_timer_->Fire();
+  fake_timer_->Fire();
+  fake_timer_->Fire();
+  EXPECT_TRUE(scheduler->done());
+}
+
+TEST_F(IndexedDBMaintenanceSchedulerTest, StopForClosing) {
+  bool metadata_called = false;
+  MockPreCloseTask* task1 = new testing::StrictMock<MockPreCloseTask>();
+  MockPreCloseTask* task2 = new testing::StrictMock<MockPreCloseTask>();
+
+  std::list<std::unique_ptr<PreCloseTask>> tasks;
+  tasks.push_back(base::WrapUnique(task1));
+  tasks.push_back(base::WrapUnique(task2));
+  auto scheduler = CreateScheduler(std::move(tasks));
+  scheduler->Start(base::BindOnce(&MetadataFetcher, &metadata_called,
+                                  leveldb::Status::OK(), &metadata_));
+
+  EXPECT_CALL(*task1, Stop(StopReason::ORIGIN_CLOSING));
+  EXPECT_CALL(*task2, Stop(StopReason::ORIGIN_CLOSING));
+  scheduler->StopForClosing();
+
+  EXPECT_FALSE(metadata_called);
+  EXPECT_TRUE(scheduler->done());
+  EXPECT_FALSE(fake_timer_->IsRunning());
+}
+
+TEST_F(IndexedDBMaintenanceSchedulerTest, MetadataError) {
+  bool metadata_called = false;
+  MockPreCloseTask* task = new testing::StrictMock<MockPreCloseTask>();
+
+  std::list<std::unique_ptr<PreCloseTask>> tasks;
+  tasks.push_back(base::WrapUnique(task));
+  auto scheduler = CreateScheduler(std::move(tasks));
+  scheduler->Start(base::BindOnce(&MetadataFetcher, &metadata_called,
+                                  leveldb::Status::IOError(""), &metadata_));
+
+  EXPECT_CALL(*task, Stop(StopReason::METADATA_ERROR));
+  fake_timer_->Fire();
+
+  EXPECT_TRUE(metadata_called);
+  EXPECT_TRUE(scheduler->done());
+}
+
+}  // namespace
+}  // namespace content
@@ -0,0 +1,185 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_metadata_cache.h"
+
+#include <utility>
+
+#include "components/services/storage/indexed_db/scopes/varint_coding.h"
+#include "content/browser/indexed_db/indexed_db_leveldb_coding.h"
+
+using base::StringPiece;
+using blink::IndexedDBDatabaseMetadata;
+using blink::IndexedDBIndexMetadata;
+using blink::IndexedDBKeyPath;
+using blink::IndexedDBObjectStoreMetadata;
+
+namespace content {
+namespace {
+
+// Bumped whenever the snapshot layout changes; snapshots with another version
+// are discarded.
+constexpr int64_t kSnapshotFormatVersion = 1;
+
+// Versions are stored offset by one so that NO_VERSION (-1) encodes as a
+// non-negative varint.
+void EncodeVersion(int64_t version, std::string* into) {
+  EncodeVarInt(version - IndexedDBDatabaseMetadata::NO_VERSION, into);
+}
+
+bool DecodeVersion(StringPiece* slice, int64_t* version) {
+  if (!DecodeVarInt(slice, version))
+    return false;
+  *version += IndexedDBDatabaseMetadata::NO_VERSION;
+  return true;
+}
+
+bool DecodeIndex(StringPiece* slice, IndexedDBIndexMetadata* index) {
+  return DecodeVarInt(slice, &index->id) &&
+         DecodeStringWithLength(slice, &index->name) &&
+         DecodeIDBKeyPath(slice, &index->key_path) &&
+         DecodeBool(slice, &index->unique) &&
+         DecodeBool(slice, &index->multi_entry);
+}
+
+bool DecodeObjectStore(StringPiece* slice,
+                       IndexedDBObjectStoreMetadata* object_store) {
+  int64_t index_count;
+  if (!DecodeVarInt(slice, &object_store->id) ||
+      !DecodeStringWithLength(slice, &object_store->name) ||
+      !DecodeIDBKeyPath(slice, &object_store->key_path) ||
+      !DecodeBool(slice, &object_store->auto_increment) ||
+      !DecodeVarInt(slice, &object_store->max_index_id) ||
+      !DecodeVarInt(slice, &index_count)) {
+    return false;
+  }
+  for (int64_t i = 0; i < index_count; ++i) {
+    IndexedDBIndexMetadata index;
+    if (!DecodeIndex(slice, &index))
+      return false;
+    const int64_t index_id = index.id;
+    object_store->indexes[index_id] = std::move(index);
+  }
+  return true;
+}
+
+bool DecodeDatabase(StringPiece* slice, IndexedDBDatabaseMetadata* database) {
+  int64_t object_store_count;
+  if (!DecodeStringWithLength(slice, &database->name) ||
+      !DecodeVarInt(slice, &database->id) ||
+      !DecodeVersion(slice, &database->version) ||
+      !DecodeVarInt(slice, &database->max_object_store_id) ||
+      !DecodeVarInt(slice, &object_store_count)) {
+    return false;
+  }
+  for (int64_t i = 0; i < object_store_count; ++i) {
+    IndexedDBObjectStoreMetadata object_store;
+    if (!DecodeObjectStore(slice, &object_store))
+      return false;
+    const int64_t object_store_id = object_store.id;
+    database->object_stores[object_store_id] = std::move(object_store);
+  }
+  return true;
+}
+
+}  // namespace
+
+IndexedDBMetadataCache::IndexedDBMetadataCache() = default;
+
+IndexedDBMetadataCache::~IndexedDBMetadataCache() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+}
+
+bool IndexedDBMetadataCache::Get(const base::string16& name,
+                                 int64_t database_id,
+                                 int64_t version,
+                                 IndexedDBDatabaseMetadata* metadata) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  auto it = entries_.find(name);
+  if (it == entries_.end())
+    return false;
+  if (it->second.id != database_id || it->second.version != version) {
+    entries_.erase(it);
+    return false;
+  }
+  *metadata = it->second;
+  return true;
+}
+
+void IndexedDBMetadataCache::Put(const IndexedDBDatabaseMetadata& metadata) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  entries_[metadata.name] = metadata;
+}
+
+void IndexedDBMetadataCache::Remove(const base::string16& name) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  entries_.erase(name);
+}
+
+void IndexedDBMetadataCache::Clear() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  entries_.clear();
+}
+
+std::string IndexedDBMetadataCache::Serialize() const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  std::string snapshot;
+  EncodeVarInt(kSnapshotFormatVersion, &snapshot);
+  EncodeVarInt(entries_.size(), &snapshot);
+  for (const auto& entry : entries_) {
+    const IndexedDBDatabaseMetadata& database = entry.second;
+    EncodeStringWithLength(database.name, &snapshot);
+    EncodeVarInt(database.id, &snapshot);
+    EncodeVersion(database.version, &snapshot);
+    EncodeVarInt(database.max_object_store_id, &snapshot);
+    EncodeVarInt(database.object_stores.size(), &snapshot);
+    for (const auto& store_entry : database.object_stores) {
+      const IndexedDBObjectStoreMetadata& object_store = store_entry.second;
+      EncodeVarInt(object_store.id, &snapshot);
+      EncodeStringWithLength(object_store.name, &snapshot);
+      EncodeIDBKeyPath(object_store.key_path, &snapshot);
+      EncodeBool(object_store.auto_increment, &snapshot);
+      EncodeVarInt(object_store.max_index_id, &snapshot);
+      EncodeVarInt(object_store.indexes.size(), &snapshot);
+      for (const auto& index_entry : object_store.indexes) {
+        const IndexedDBIndexMetadata& index = index_entry.second;
+        EncodeVarInt(index.id, &snapshot);
+        EncodeStringWithLength(index.name, &snapshot);
+        EncodeIDBKeyPath(index.key_path, &snapshot);
+        EncodeBool(index.unique, &snapshot);
+        EncodeBool(index.multi_entry, &snapshot);
+      }
+    }
+  }
+  return snapshot;
+}
+
+bool IndexedDBMetadataCache::Deserialize(StringPiece snapshot) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  entries_.clear();
+
+  int64_t format_version;
+  int64_t database_count;
+  if (!DecodeVarInt(&snapshot, &format_version) ||
+      format_version != kSnapshotFormatVersion ||
+      !DecodeVarInt(&snapshot, &database_count)) {
+    return false;
+  }
+  for (int64_t i = 0; i < database_count; ++i) {
+    IndexedDBDatabaseMetadata database;
+    if (!DecodeDatabase(&snapshot, &database)) {
+      entries_.clear();
+      return false;
+    }
+    base::string16 name = database.name;
+    entries_[std::move(name)] = std::move(database);
+  }
+  if (!snapshot.empty()) {
+    entries_.clear();
+    return false;
+  }
+  return true;
+}
+
+}  // namespace content
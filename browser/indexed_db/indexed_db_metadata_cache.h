@@ -0,0 +1,74 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_METADATA_CACHE_H_
+#define CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_METADATA_CACHE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <string>
+
+#include "base/macros.h"
+#include "base/sequence_checker.h"
+#include "base/strings/string16.h"
+#include "base/strings/string_piece.h"
+#include "content/common/content_export.h"
+#include "third_party/blink/public/common/indexeddb/indexeddb_metadata.h"
+
+namespace content {
+
+// Holds the decoded metadata (object stores, indexes and their key paths) of
+// the databases in one backing store, so that opening a database does not
+// have to range-scan and decode its metadata again.
+//
+// Entries are keyed by database name and are only returned while the database
+// id and version they were decoded at still match what is on disk. Schema
+// changes only happen in version change transactions, which always change the
+// version, and a deleted and re-created database gets a new id, so a matching
+// id and version means the entry is current.
+//
+// The cache can be written to a compact snapshot with Serialize() and restored
+// with Deserialize(), so that the decoded metadata outlives the backing store
+// that produced it.
+class CONTENT_EXPORT IndexedDBMetadataCache {
+ public:
+  IndexedDBMetadataCache();
+  ~IndexedDBMetadataCache();
+
+  // Copies the cached metadata for |name| into |metadata| and returns true if
+  // it was decoded at |database_id| and |version|. A mismatched entry is
+  // stale and is dropped.
+  bool Get(const base::string16& name,
+           int64_t database_id,
+           int64_t version,
+           blink::IndexedDBDatabaseMetadata* metadata);
+
+  // Caches |metadata|, replacing any entry for the same name.
+  void Put(const blink::IndexedDBDatabaseMetadata& metadata);
+
+  void Remove(const base::string16& name);
+  void Clear();
+
+  size_t size() const { return entries_.size(); }
+
+  // Returns the cache contents in a compact binary form.
+  std::string Serialize() const;
+
+  // Replaces the cache contents with a snapshot produced by Serialize().
+  // Returns false and leaves the cache empty if |snapshot| is malformed.
+  bool Deserialize(base::StringPiece snapshot);
+
+ private:
+  std::map<base::string16, blink::IndexedDBDatabaseMetadata> entries_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  DISALLOW_COPY_AND_ASSIGN(IndexedDBMetadataCache);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_METADATA_CACHE_H_
@@ -0,0 +1,119 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_metadata_cache.h"
+
+#include <string>
+
+#include "base/strings/utf_string_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/common/indexeddb/indexeddb_key_path.h"
+
+using base::ASCIIToUTF16;
+using blink::IndexedDBDatabaseMetadata;
+using blink::IndexedDBIndexMetadata;
+using blink::IndexedDBKeyPath;
+using blink::IndexedDBObjectStoreMetadata;
+
+namespace content {
+namespace {
+
+IndexedDBDatabaseMetadata CreateMetadata(const std::string& name,
+                                         int64_t id,
+                                         int64_t version) {
+  IndexedDBDatabaseMetadata metadata(ASCIIToUTF16(name), id, version,
+                                     /*max_object_store_id=*/2);
+  IndexedDBObjectStoreMetadata store(
+      ASCIIToUTF16("store"), /*id=*/1, IndexedDBKeyPath(ASCIIToUTF16("id")),
+      /*auto_increment=*/true, /*max_index_id=*/31);
+  store.indexes[30] = IndexedDBIndexMetadata(
+      ASCIIToUTF16("by_tags"), /*id=*/30,
+      IndexedDBKeyPath(std::vector<base::string16>{ASCIIToUTF16("a"),
+                                                   ASCIIToUTF16("b.c")}),
+      /*unique=*/false, /*multi_entry=*/true);
+  metadata.object_stores[1] = store;
+  metadata.object_stores[2] = IndexedDBObjectStoreMetadata(
+      ASCIIToUTF16("no_key_path"), /*id=*/2, IndexedDBKeyPath(),
+      /*auto_increment=*/false, /*max_index_id=*/29);
+  return metadata;
+}
+
+void ExpectMetadataEq(const IndexedDBDatabaseMetadata& expected,
+                      const IndexedDBDatabaseMetadata& actual) {
+  EXPECT_EQ(expected.name, actual.name);
+  EXPECT_EQ(expected.id, actual.id);
+  EXPECT_EQ(expected.version, actual.version);
+  EXPECT_EQ(expected.max_object_store_id, actual.max_object_store_id);
+  EXPECT_EQ(expected.object_stores, actual.object_stores);
+}
+
+TEST(IndexedDBMetadataCacheTest, GetRequiresMatchingIdAndVersion) {
+  IndexedDBMetadataCache cache;
+  const IndexedDBDatabaseMetadata db = CreateMetadata("db", 1, 3);
+  cache.Put(db);
+
+  IndexedDBDatabaseMetadata result;
+  ASSERT_TRUE(cache.Get(db.name, 1, 3, &result));
+  ExpectMetadataEq(db, result);
+
+  // A newer version means the schema may have changed; the entry is dropped.
+  EXPECT_FALSE(cache.Get(db.name, 1, 4, &result));
+  EXPECT_EQ(0u, cache.size());
+
+  // A recreated database gets a new id.
+  cache.Put(db);
+  EXPECT_FALSE(cache.Get(db.name, 2, 3, &result));
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(IndexedDBMetadataCacheTest, RemoveAndClear) {
+  IndexedDBMetadataCache cache;
+  cache.Put(CreateMetadata("a", 1, 1));
+  cache.Put(CreateMetadata("b", 2, 1));
+  EXPECT_EQ(2u, cache.size());
+
+  cache.Remove(ASCIIToUTF16("a"));
+  IndexedDBDatabaseMetadata result;
+  EXPECT_FALSE(cache.Get(ASCIIToUTF16("a"), 1, 1, &result));
+  EXPECT_TRUE(cache.Get(ASCIIToUTF16("b"), 2, 1, &result));
+
+  cache.Clear();
+  EXPECT_EQ(0u, cache.size());
+}
+
+TEST(IndexedDBMetadataCacheTest, SerializeRoundTrip) {
+  IndexedDBMetadataCache cache;
+  const IndexedDBDatabaseMetadata a = CreateMetadata("a", 1, 7);
+  const IndexedDBDatabaseMetadata b =
+      CreateMetadata("b", 5, IndexedDBDatabaseMetadata::NO_VERSION);
+  cache.Put(a);
+  cache.Put(b);
+
+  IndexedDBMetadataCache restored;
+  ASSERT_TRUE(restored.Deserialize(cache.Serialize()));
+  EXPECT_EQ(2u, restored.size());
+
+  IndexedDBDatabaseMetadata result;
+  ASSERT_TRUE(restored.Get(a.name, a.id, a.version, &result));
+  ExpectMetadataEq(a, result);
+  ASSERT_TRUE(restored.Get(b.name, b.id, b.version, &result));
+  ExpectMetadataEq(b, result);
+}
+
+TEST(IndexedDBMetadataCacheTest, DeserializeRejectsMalformedSnapshots) {
+  IndexedDBMetadataCache cache;
+  cache.Put(CreateMetadata("a", 1, 1));
+  const std::string snapshot = cache.Serialize();
+
+  IndexedDBMetadataCache restored;
+  EXPECT_FALSE(restored.Deserialize(snapshot.substr(0, snapshot.size() - 1)));
+  EXPECT_EQ(0u, restored.size());
+  EXPECT_FALSE(restored.Deserialize(snapshot + "x"));
+  EXPECT_EQ(0u, restored.size());
+  EXPECT_FALSE(restored.Deserialize(std::string()));
+  EXPECT_EQ(0u, restored.size());
+}
+
+}  // namespace
+}  // namespace content
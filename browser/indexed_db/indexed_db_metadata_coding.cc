@@ -392,20 +392,18 @@ Status ReadDatabaseNamesAndVersionsInternal(
   return s;
 }
 
-// TODO(jsbell): This should do some error handling rather than
-// plowing ahead when bad data is encountered.
 template <typename DatabaseOrTransaction>
-Status ReadMetadataForDatabaseNameInternal(
+Status ReadDatabaseIdAndVersionInternal(
     DatabaseOrTransaction* db_or_transaction,
     const std::string& origin_identifier,
     const base::string16& name,
-    IndexedDBDatabaseMetadata* metadata,
+    int64_t* database_id,
+    int64_t* version,
     bool* found) {
-  IDB_TRACE("IndexedDBMetadataCoding::ReadMetadataForDatabaseName");
   const std::string key = DatabaseNameKey::Encode(origin_identifier, name);
   *found = false;
 
-  Status s = GetInt(db_or_transaction, key, &metadata->id, found);
+  Status s = GetInt(db_or_transaction, key, database_id, found);
   if (!s.ok()) {
     INTERNAL_READ_ERROR(GET_IDBDATABASE_METADATA);
     return s;
@@ -414,9 +412,9 @@ Status ReadMetadataForDatabaseNameInternal(
     return Status::OK();
 
   s = GetVarInt(db_or_transaction,
-                DatabaseMetaDataKey::Encode(metadata->id,
+                DatabaseMetaDataKey::Encode(*database_id,
                                             DatabaseMetaDataKey::USER_VERSION),
-                &metadata->version, found);
+                version, found);
   if (!s.ok()) {
     INTERNAL_READ_ERROR_UNTESTED(GET_IDBDATABASE_METADATA);
     return s;
@@ -426,8 +424,26 @@ Status ReadMetadataForDatabaseNameInternal(
     return InternalInconsistencyStatus();
   }
 
-  if (metadata->version == IndexedDBDatabaseMetadata::DEFAULT_VERSION)
-    metadata->version = IndexedDBDatabaseMetadata::NO_VERSION;
+  if (*version == IndexedDBDatabaseMetadata::DEFAULT_VERSION)
+    *version = IndexedDBDatabaseMetadata::NO_VERSION;
+  return s;
+}
+
+// TODO(jsbell): This should do some error handling rather than
+// plowing ahead when bad data is encountered.
+template <typename DatabaseOrTransaction>
+Status ReadMetadataForDatabaseNameInternal(
+    DatabaseOrTransaction* db_or_transaction,
+    const std::string& origin_identifier,
+    const base::string16& name,
+    IndexedDBDatabaseMetadata* metadata,
+    bool* found) {
+  IDB_TRACE("IndexedDBMetadataCoding::ReadMetadataForDatabaseName");
+  Status s = ReadDatabaseIdAndVersionInternal(
+      db_or_transaction, origin_identifier, name, &metadata->id,
+      &metadata->version, found);
+  if (!s.ok() || !*found)
+    return s;
 
   s = indexed_db::GetMaxObjectStoreId(db_or_transaction, metadata->id,
                                       &metadata->max_object_store_id);
@@ -500,6 +516,17 @@ Status IndexedDBMetadataCoding::ReadDatabaseNames(
   return s;
 }
 
+Status IndexedDBMetadataCoding::ReadDatabaseIdAndVersion(
+    TransactionalLevelDBDatabase* db,
+    const std::string& origin_identifier,
+    const base::string16& name,
+    int64_t* database_id,
+    int64_t* version,
+    bool* found) {
+  return ReadDatabaseIdAndVersionInternal(db, origin_identifier, name,
+                                          database_id, version, found);
+}
+
 Status IndexedDBMetadataCoding::ReadMetadataForDatabaseName(
     TransactionalLevelDBDatabase* db,
     const std::string& origin_identifier,
@@ -54,6 +54,16 @@ class CONTENT_EXPORT IndexedDBMetadataCoding {
       const std::string& origin_identifier,
       std::vector<blink::mojom::IDBNameAndVersionPtr>* names_and_versions);
 
+  // Reads only the id and version of the database named |name|, which is
+  // enough to tell whether previously decoded metadata is still current.
+  virtual leveldb::Status ReadDatabaseIdAndVersion(
+      TransactionalLevelDBDatabase* db,
+      const std::string& origin_identifier,
+      const base::string16& name,
+      int64_t* database_id,
+      int64_t* version,
+      bool* found);
+
   // Reads in metadata for the database and all object stores & indices.
   // Note: the database name is not populated in |metadata|.
   virtual leveldb::Status ReadMetadataForDatabaseName(
@@ -4,6 +4,7 @@
 
 #include "content/browser/indexed_db/indexed_db_origin_state.h"
 
+#include <limits>
 #include <list>
 #include <utility>
 #include <vector>
@@ -26,6 +27,7 @@
 #include "content/browser/indexed_db/indexed_db_factory_impl.h"
 #include "content/browser/indexed_db/indexed_db_leveldb_coding.h"
 #include "content/browser/indexed_db/indexed_db_leveldb_operations.h"
+#include "content/browser/indexed_db/indexed_db_maintenance_scheduler.h"
 #include "content/browser/indexed_db/indexed_db_pre_close_task_queue.h"
 #include "content/browser/indexed_db/indexed_db_tombstone_sweeper.h"
 #include "content/browser/indexed_db/indexed_db_transaction.h"
@@ -42,6 +44,17 @@ const int64_t kRunningPreCloseTasksMaxRunPeriodSeconds = 60;
 const int kTombstoneSweeperRoundIterations = 1000;
 // The maximum total iterations for the tombstone sweeper.
 const int kTombstoneSweeperMaxIterations = 10 * 1000 * 1000;
+// Time after an origin is opened before maintenance starts, so that it does
+// not compete with the page's initial reads.
+const int64_t kMaintenanceStartDelaySeconds = 30;
+// The maximum time a maintenance slice should hold up the origin's
+// transactions. A slice always runs at least one round.
+const int64_t kMaintenanceSliceBudgetMilliseconds = 10;
+// Time between maintenance slices.
+const int64_t kMaintenanceSliceIntervalMilliseconds = 500;
+// Indexes with fewer bytes of tombstones than this are not compacted after
+// an open-origin sweep.
+const uint64_t kMaintenanceMinCompactionSize = 1024 * 1024;
 
 constexpr const base::TimeDelta kMinEarliestOriginSweepFromNow =
     base::TimeDelta::FromDays(1);
@@ -78,6 +91,9 @@ base::Time GenerateNextGlobalSweepTime(base::Time now) {
 const base::Feature kCompactIDBOnClose{"CompactIndexedDBOnClose",
                                        base::FEATURE_ENABLED_BY_DEFAULT};
 
+const base::Feature kIDBOpenOriginMaintenance{
+    "IndexedDBOpenOriginMaintenance", base::FEATURE_DISABLED_BY_DEFAULT};
+
 constexpr const base::TimeDelta
     IndexedDBOriginState::kMaxEarliestGlobalSweepFromNow;
 constexpr const base::TimeDelta
@@ -110,6 +126,9 @@ IndexedDBOriginState::IndexedDBOriginState(
 
 IndexedDBOriginState::~IndexedDBOriginState() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  // The maintenance tasks hold leveldb iterators, which must be destroyed
+  // before the database.
+  maintenance_scheduler_.reset();
   if (!backing_store_)
     return;
   if (backing_store_->IsBlobCleanupPending())
@@ -246,6 +265,20 @@ IndexedDBOriginStateHandle IndexedDBOriginState::CreateHandle() {
       pre_close_task_queue_.reset();
     }
   }
+  if (open_handles_ == 1 && !maintenance_scheduler_ &&
+      !backing_store_->is_incognito() &&
+      base::FeatureList::IsEnabled(kIDBOpenOriginMaintenance)) {
+    maintenance_start_timer_.Start(
+        FROM_HERE, base::TimeDelta::FromSeconds(kMaintenanceStartDelaySeconds),
+        base::BindOnce(
+            [](base::WeakPtr<IndexedDBOriginState> factory) {
+              if (!factory || factory->IsClosing() ||
+                  factory->maintenance_scheduler_)
+                return;
+              factory->StartMaintenance();
+            },
+            weak_factory_.GetWeakPtr()));
+  }
   return IndexedDBOriginStateHandle(weak_factory_.GetWeakPtr());
 }
 
@@ -274,6 +307,8 @@ void IndexedDBOriginState::StartClosing() {
   DCHECK(CanCloseFactory());
   DCHECK(!IsClosing());
 
+  StopMaintenance();
+
   if (skip_closing_sequence_ ||
       base::CommandLine::ForCurrentProcess()->HasSwitch(
           kIDBCloseImmediatelySwitch)) {
@@ -342,6 +377,59 @@ void IndexedDBOriginState::StartPreCloseTasks() {
   }
 }
 
+void IndexedDBOriginState::StartMaintenance() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(!IsClosing());
+  DCHECK(!maintenance_scheduler_);
+
+  // ShouldRunTombstoneSweeper() pushes out the next sweep time, so the
+  // pre-close sequence will not sweep again after this sweep.
+  if (!ShouldRunTombstoneSweeper())
+    return;
+
+  auto sweeper = std::make_unique<IndexedDBTombstoneSweeper>(
+      kTombstoneSweeperRoundIterations, kTombstoneSweeperMaxIterations,
+      backing_store_->db()->db());
+  // The compaction kill switch also disables the follow-up range compaction.
+  sweeper->EnableOpenOriginMode(ShouldRunCompaction()
+                                    ? kMaintenanceMinCompactionSize
+                                    : std::numeric_limits<uint64_t>::max());
+
+  std::list<std::unique_ptr<IndexedDBPreCloseTaskQueue::PreCloseTask>> tasks;
+  tasks.push_back(std::move(sweeper));
+  // Unretained is safe because |maintenance_scheduler_| is owned by this.
+  maintenance_scheduler_ = std::make_unique<IndexedDBMaintenanceScheduler>(
+      std::move(tasks),
+      base::BindRepeating(&IndexedDBOriginState::IsIdleForMaintenance,
+                          base::Unretained(this)),
+      base::TimeDelta::FromMilliseconds(kMaintenanceSliceBudgetMilliseconds),
+      base::TimeDelta::FromMilliseconds(kMaintenanceSliceIntervalMilliseconds),
+      std::make_unique<base::RepeatingTimer>());
+  maintenance_scheduler_->Start(
+      base::BindOnce(&IndexedDBBackingStore::GetCompleteMetadata,
+                     base::Unretained(backing_store_.get())));
+}
+
+void IndexedDBOriginState::StopMaintenance() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  maintenance_start_timer_.AbandonAndStop();
+  if (maintenance_scheduler_) {
+    maintenance_scheduler_->StopForClosing();
+    maintenance_scheduler_.reset();
+  }
+}
+
+bool IndexedDBOriginState::IsIdleForMaintenance() const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (running_tasks_)
+    return false;
+  for (const auto& pair : databases_) {
+    if (pair.second->transaction_count() > 0)
+      return false;
+  }
+  return true;
+}
+
 bool IndexedDBOriginState::ShouldRunTombstoneSweeper() {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   base::Time now = clock_->Now();
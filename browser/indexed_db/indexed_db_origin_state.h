@@ -27,6 +27,7 @@ namespace content {
 class IndexedDBBackingStore;
 class IndexedDBDatabase;
 class IndexedDBFactoryImpl;
+class IndexedDBMaintenanceScheduler;
 class IndexedDBPreCloseTaskQueue;
 class TransactionalLevelDBFactory;
 
@@ -36,6 +37,10 @@ constexpr const char kIDBCloseImmediatelySwitch[] = "idb-close-immediately";
 // shut off.
 CONTENT_EXPORT extern const base::Feature kCompactIDBOnClose;
 
+// Runs tombstone sweeps and range compactions in time-sliced rounds while the
+// origin is open, instead of only in the pre-close sequence.
+CONTENT_EXPORT extern const base::Feature kIDBOpenOriginMaintenance;
+
 // IndexedDBOriginState manages the per-origin IndexedDB state, and contains the
 // backing store for the origin.
 //
@@ -127,6 +132,10 @@ class CONTENT_EXPORT IndexedDBOriginState {
     DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
     return pre_close_task_queue_.get();
   }
+  IndexedDBMaintenanceScheduler* maintenance_scheduler() const {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+    return maintenance_scheduler_.get();
+  }
   TasksAvailableCallback notify_tasks_callback() {
     DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
     return notify_tasks_callback_;
@@ -135,6 +144,10 @@ class CONTENT_EXPORT IndexedDBOriginState {
   // Note: calling this callback will destroy the IndexedDBOriginState.
   const TearDownCallback& tear_down_callback() { return tear_down_callback_; }
 
+  // True once ForceClose() has run, e.g. because the origin's data is being
+  // deleted or was found to be corrupt.
+  bool was_force_closed() const { return skip_closing_sequence_; }
+
   bool is_running_tasks() const { return running_tasks_; }
   bool is_task_run_scheduled() const { return task_run_scheduled_; }
   void set_task_run_scheduled() { task_run_scheduled_ = true; }
@@ -179,6 +192,13 @@ class CONTENT_EXPORT IndexedDBOriginState {
   void StartClosing();
   void StartPreCloseTasks();
 
+  // Starts |maintenance_scheduler_| if there is work to do for the open
+  // origin. Stopped again by StartClosing().
+  void StartMaintenance();
+  void StopMaintenance();
+  // Returns true if no database in this origin has a running transaction.
+  bool IsIdleForMaintenance() const;
+
   void CloseAndDestruct();
 
   // Executes database operations, and if |true| is returned by this function,
@@ -223,6 +243,9 @@ class CONTENT_EXPORT IndexedDBOriginState {
 
   std::unique_ptr<IndexedDBPreCloseTaskQueue> pre_close_task_queue_;
 
+  base::OneShotTimer maintenance_start_timer_;
+  std::unique_ptr<IndexedDBMaintenanceScheduler> maintenance_scheduler_;
+
   TasksAvailableCallback notify_tasks_callback_;
   TearDownCallback tear_down_callback_;
 
@@ -28,6 +28,11 @@ bool IndexedDBPreCloseTaskQueue::PreCloseTask::RequiresMetadata() const {
 void IndexedDBPreCloseTaskQueue::PreCloseTask::SetMetadata(
     const std::vector<blink::IndexedDBDatabaseMetadata>* metadata) {}
 
+std::unique_ptr<IndexedDBPreCloseTaskQueue::PreCloseTask>
+IndexedDBPreCloseTaskQueue::PreCloseTask::TakeFollowUpTask() {
+  return nullptr;
+}
+
 IndexedDBPreCloseTaskQueue::IndexedDBPreCloseTaskQueue(
     std::list<std::unique_ptr<IndexedDBPreCloseTaskQueue::PreCloseTask>> tasks,
     base::OnceClosure on_complete,
@@ -128,7 +133,10 @@ void IndexedDBPreCloseTaskQueue::RunLoop() {
   }
   bool done = task->RunRound();
   if (done) {
+    std::unique_ptr<PreCloseTask> follow_up = task->TakeFollowUpTask();
     tasks_.pop_front();
+    if (follow_up)
+      tasks_.push_front(std::move(follow_up));
     if (tasks_.empty()) {
       OnComplete();
       return;
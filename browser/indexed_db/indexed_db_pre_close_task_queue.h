@@ -48,6 +48,9 @@ class CONTENT_EXPORT IndexedDBPreCloseTaskQueue {
     TIMEOUT,
     // There was an error reading the database metadata.
     METADATA_ERROR,
+    // The origin started closing while IndexedDBMaintenanceScheduler was
+    // still running tasks on the open origin.
+    ORIGIN_CLOSING,
   };
 
   // Defines a task that will be run after closing an IndexedDB backing store
@@ -79,7 +82,12 @@ class CONTENT_EXPORT IndexedDBPreCloseTaskQueue {
     // small. Returns if the task is complete and can be destroyed.
     virtual bool RunRound() = 0;
 
+    // Called once RunRound() has returned true. A returned task is run next,
+    // before any other queued task, and shares this task's metadata.
+    virtual std::unique_ptr<PreCloseTask> TakeFollowUpTask();
+
    private:
+    friend class IndexedDBMaintenanceScheduler;
     friend class IndexedDBPreCloseTaskQueue;
 
     bool set_metadata_was_called_ = false;
@@ -0,0 +1,67 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_task_runner_pool.h"
+
+#include <string>
+
+#include "base/check_op.h"
+#include "base/hash/hash.h"
+#include "base/metrics/histogram_functions.h"
+#include "base/task/thread_pool.h"
+#include "url/origin.h"
+
+namespace content {
+
+IndexedDBTaskRunnerPool::IndexedDBTaskRunnerPool(
+    size_t shard_count,
+    const base::TaskTraits& traits)
+    : queue_depths_(shard_count, 0) {
+  DCHECK_GT(shard_count, 0u);
+  task_runners_.reserve(shard_count);
+  for (size_t i = 0; i < shard_count; ++i) {
+    task_runners_.push_back(
+        base::ThreadPool::CreateSequencedTaskRunner(traits));
+  }
+}
+
+IndexedDBTaskRunnerPool::~IndexedDBTaskRunnerPool() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+}
+
+size_t IndexedDBTaskRunnerPool::ShardForOrigin(
+    const url::Origin& origin) const {
+  // PersistentHash is stable across runs, which keeps shard assignment (and
+  // the per-shard metrics) comparable between sessions.
+  return base::PersistentHash(origin.Serialize()) % task_runners_.size();
+}
+
+int IndexedDBTaskRunnerPool::queue_depth(size_t shard) const {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK_LT(shard, queue_depths_.size());
+  return queue_depths_[shard];
+}
+
+size_t IndexedDBTaskRunnerPool::BeginTask(const url::Origin& origin) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  size_t shard = ShardForOrigin(origin);
+  base::UmaHistogramCounts100("WebCore.IndexedDB.DiskUsageRead.QueueDepth",
+                              queue_depths_[shard]);
+  ++queue_depths_[shard];
+  return shard;
+}
+
+void IndexedDBTaskRunnerPool::EndTask(size_t shard) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK_GT(queue_depths_[shard], 0);
+  --queue_depths_[shard];
+}
+
+// static
+void IndexedDBTaskRunnerPool::RecordQueueTime(base::TimeDelta queue_time) {
+  base::UmaHistogramTimes("WebCore.IndexedDB.DiskUsageRead.QueueTime",
+                          queue_time);
+}
+
+}  // namespace content
@@ -0,0 +1,104 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_TASK_RUNNER_POOL_H_
+#define CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_TASK_RUNNER_POOL_H_
+
+#include <stddef.h>
+
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/location.h"
+#include "base/macros.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/sequence_checker.h"
+#include "base/sequenced_task_runner.h"
+#include "base/task/task_traits.h"
+#include "base/task_runner_util.h"
+#include "base/time/time.h"
+#include "content/common/content_export.h"
+
+namespace url {
+class Origin;
+}
+
+namespace content {
+
+// A fixed pool of sequenced task runners that per-origin work is sharded
+// across, so that slow work for one origin (e.g. walking a large origin
+// directory) does not hold up other origins.
+//
+// An origin always maps to the same shard, so tasks posted for one origin run
+// in posting order and their replies arrive in posting order. Tasks must not
+// touch state owned by the posting sequence; that belongs in the reply.
+//
+// The pool itself lives on a single sequence (the IDB task runner), and
+// tracks per-shard queue depth as the number of tasks that have been posted
+// but whose reply has not yet run.
+class CONTENT_EXPORT IndexedDBTaskRunnerPool {
+ public:
+  IndexedDBTaskRunnerPool(size_t shard_count, const base::TaskTraits& traits);
+  ~IndexedDBTaskRunnerPool();
+
+  size_t shard_count() const { return task_runners_.size(); }
+
+  size_t ShardForOrigin(const url::Origin& origin) const;
+
+  // Number of tasks posted to |shard| whose reply has not run yet.
+  int queue_depth(size_t shard) const;
+
+  // Runs |task| on |origin|'s shard, then |reply| with its result on the
+  // calling sequence. |reply| is not run if the pool has been destroyed.
+  template <typename ReturnType>
+  void PostTaskAndReplyWithResult(const url::Origin& origin,
+                                  const base::Location& from_here,
+                                  base::OnceCallback<ReturnType()> task,
+                                  base::OnceCallback<void(ReturnType)> reply) {
+    const size_t shard = BeginTask(origin);
+    base::PostTaskAndReplyWithResult(
+        task_runners_[shard].get(), from_here,
+        base::BindOnce(
+            [](base::TimeTicks post_time,
+               base::OnceCallback<ReturnType()> task) {
+              RecordQueueTime(base::TimeTicks::Now() - post_time);
+              return std::move(task).Run();
+            },
+            base::TimeTicks::Now(), std::move(task)),
+        base::BindOnce(
+            [](base::WeakPtr<IndexedDBTaskRunnerPool> pool, size_t shard,
+               base::OnceCallback<void(ReturnType)> reply,
+               ReturnType result) {
+              if (!pool)
+                return;
+              pool->EndTask(shard);
+              std::move(reply).Run(std::move(result));
+            },
+            weak_factory_.GetWeakPtr(), shard, std::move(reply)));
+  }
+
+ private:
+  // Returns the shard for |origin| and records its queue depth.
+  size_t BeginTask(const url::Origin& origin);
+  void EndTask(size_t shard);
+
+  // Called on the shard sequence, so only records thread-safe histograms.
+  static void RecordQueueTime(base::TimeDelta queue_time);
+
+  std::vector<scoped_refptr<base::SequencedTaskRunner>> task_runners_;
+  std::vector<int> queue_depths_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  base::WeakPtrFactory<IndexedDBTaskRunnerPool> weak_factory_{this};
+
+  DISALLOW_COPY_AND_ASSIGN(IndexedDBTaskRunnerPool);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_TASK_RUNNER_POOL_H_
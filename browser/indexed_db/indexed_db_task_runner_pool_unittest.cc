@@ -0,0 +1,79 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_task_runner_pool.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/bind_test_util.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+
+namespace content {
+namespace {
+
+constexpr size_t kShardCount = 4;
+
+url::Origin CreateOrigin(int i) {
+  return url::Origin::Create(
+      GURL("https://host" + base::NumberToString(i) + ".example"));
+}
+
+class IndexedDBTaskRunnerPoolTest : public testing::Test {
+ public:
+  IndexedDBTaskRunnerPoolTest() : pool_(kShardCount, {base::MayBlock()}) {}
+
+ protected:
+  base::test::TaskEnvironment task_environment_;
+  IndexedDBTaskRunnerPool pool_;
+};
+
+TEST_F(IndexedDBTaskRunnerPoolTest, OriginsMapToStableShards) {
+  EXPECT_EQ(kShardCount, pool_.shard_count());
+  for (int i = 0; i < 64; ++i) {
+    const url::Origin origin = CreateOrigin(i);
+    size_t shard = pool_.ShardForOrigin(origin);
+    EXPECT_LT(shard, kShardCount);
+    EXPECT_EQ(shard, pool_.ShardForOrigin(origin));
+  }
+}
+
+TEST_F(IndexedDBTaskRunnerPoolTest, RepliesInOrderAndTracksQueueDepth) {
+  base::HistogramTester histogram_tester;
+  const url::Origin origin = CreateOrigin(0);
+  const size_t shard = pool_.ShardForOrigin(origin);
+
+  constexpr int kTaskCount = 10;
+  std::vector<int> replies;
+  base::RunLoop loop;
+  for (int i = 0; i < kTaskCount; ++i) {
+    pool_.PostTaskAndReplyWithResult(
+        origin, FROM_HERE, base::BindOnce([](int value) { return value; }, i),
+        base::BindLambdaForTesting([&](int value) {
+          replies.push_back(value);
+          if (replies.size() == static_cast<size_t>(kTaskCount))
+            loop.Quit();
+        }));
+  }
+  EXPECT_EQ(kTaskCount, pool_.queue_depth(shard));
+  loop.Run();
+
+  ASSERT_EQ(static_cast<size_t>(kTaskCount), replies.size());
+  for (int i = 0; i < kTaskCount; ++i)
+    EXPECT_EQ(i, replies[i]);
+  EXPECT_EQ(0, pool_.queue_depth(shard));
+  histogram_tester.ExpectTotalCount(
+      "WebCore.IndexedDB.DiskUsageRead.QueueDepth", kTaskCount);
+  histogram_tester.ExpectTotalCount(
+      "WebCore.IndexedDB.DiskUsageRead.QueueTime", kTaskCount);
+}
+
+}  // namespace
+}  // namespace content
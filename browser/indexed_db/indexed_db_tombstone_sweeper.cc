@@ -4,7 +4,9 @@
 
 #include "content/browser/indexed_db/indexed_db_tombstone_sweeper.h"
 
+#include <algorithm>
 #include <string>
+#include <utility>
 
 #include "base/metrics/histogram_functions.h"
 #include "base/rand_util.h"
@@ -14,6 +16,7 @@
 #include "base/time/tick_clock.h"
 #include "components/services/storage/indexed_db/scopes/varint_coding.h"
 #include "content/browser/indexed_db/indexed_db_backing_store.h"
+#include "content/browser/indexed_db/indexed_db_compaction_task.h"
 #include "third_party/blink/public/common/indexeddb/indexeddb_key.h"
 #include "third_party/blink/public/common/indexeddb/indexeddb_metadata.h"
 #include "third_party/leveldatabase/env_chromium.h"
@@ -118,6 +121,11 @@ bool IndexedDBTombstoneSweeper::RunRound() {
                                      : base::TimeTicks::Now();
   }
 
+  // Transactions may have committed since the last round, so start from a
+  // fresh snapshot. The sweep position is kept in |sweep_state_|.
+  if (open_origin_mode_)
+    iterator_.reset();
+
   leveldb::Status s;
   Status status = DoSweep(&s);
 
@@ -130,10 +138,46 @@ bool IndexedDBTombstoneSweeper::RunRound() {
   if (status == Status::SWEEPING)
     return false;
 
+  sweep_finished_ = status != Status::DONE_ERROR;
   RecordUMAStats(base::nullopt, status, s);
   return true;
 }
 
+std::unique_ptr<IndexedDBPreCloseTaskQueue::PreCloseTask>
+IndexedDBTombstoneSweeper::TakeFollowUpTask() {
+  if (!open_origin_mode_ || !sweep_finished_)
+    return nullptr;
+
+  std::vector<std::pair<uint64_t, std::tuple<int64_t, int64_t, int64_t>>>
+      dense_indexes;
+  for (const auto& pair : metrics_.tombstones_size_per_index) {
+    if (pair.second >= min_compaction_size_)
+      dense_indexes.emplace_back(pair.second, pair.first);
+  }
+  if (dense_indexes.empty())
+    return nullptr;
+  std::sort(dense_indexes.begin(), dense_indexes.end(),
+            [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  std::vector<IndexedDBCompactionTask::Range> ranges;
+  ranges.reserve(dense_indexes.size());
+  for (const auto& dense_index : dense_indexes) {
+    int64_t database_id, object_store_id, index_id;
+    std::tie(database_id, object_store_id, index_id) = dense_index.second;
+    ranges.push_back(
+        {IndexDataKey::EncodeMinKey(database_id, object_store_id, index_id),
+         IndexDataKey::EncodeMaxKey(database_id, object_store_id, index_id)});
+  }
+  return std::make_unique<IndexedDBCompactionTask>(database(),
+                                                   std::move(ranges));
+}
+
+void IndexedDBTombstoneSweeper::EnableOpenOriginMode(
+    uint64_t min_compaction_size) {
+  open_origin_mode_ = true;
+  min_compaction_size_ = min_compaction_size;
+}
+
 void IndexedDBTombstoneSweeper::RecordUMAStats(
     base::Optional<StopReason> stop_reason,
     base::Optional<IndexedDBTombstoneSweeper::Status> status,
@@ -160,6 +204,10 @@ void IndexedDBTombstoneSweeper::RecordUMAStats(
         uma_count_label.append("TimeoutReached");
         uma_size_label.append("TimeoutReached");
         break;
+      case StopReason::ORIGIN_CLOSING:
+        uma_count_label.append("OriginClosing");
+        uma_size_label.append("OriginClosing");
+        break;
       case StopReason::METADATA_ERROR:
         NOTREACHED();
         break;
@@ -444,6 +492,10 @@ bool IndexedDBTombstoneSweeper::IterateIndex(
       round_deletion_batch_.Delete(key_slice);
       ++metrics_.seen_tombstones;
       metrics_.seen_tombstones_size += entry_size;
+      if (open_origin_mode_) {
+        metrics_.tombstones_size_per_index[std::make_tuple(
+            database_id, object_store_id, index.id)] += entry_size;
+      }
     }
 
     iterator_->Next();
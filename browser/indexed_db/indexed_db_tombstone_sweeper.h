@@ -7,6 +7,7 @@
 
 #include <map>
 #include <memory>
+#include <tuple>
 #include <vector>
 
 #include "base/callback.h"
@@ -93,6 +94,17 @@ class CONTENT_EXPORT IndexedDBTombstoneSweeper
 
   bool RunRound() override;
 
+  std::unique_ptr<IndexedDBPreCloseTaskQueue::PreCloseTask> TakeFollowUpTask()
+      override;
+
+  // Prepares the sweeper to run while the origin is open (see
+  // IndexedDBMaintenanceScheduler). Every round reads from a new snapshot, so
+  // index entries rewritten by transactions between rounds are never compared
+  // against a stale value. Once the sweep finishes, the indexes that held at
+  // least |min_compaction_size| bytes of tombstones are compacted, densest
+  // first, by the follow-up task.
+  void EnableOpenOriginMode(uint64_t min_compaction_size);
+
  private:
   using DatabaseMetadataVector = std::vector<blink::IndexedDBDatabaseMetadata>;
   using ObjectStoreMetadataMap =
@@ -131,6 +143,11 @@ class CONTENT_EXPORT IndexedDBTombstoneSweeper
 
     int seen_tombstones = 0;
     uint64_t seen_tombstones_size = 0;
+
+    // Only populated in open origin mode. Keyed by (database id, object store
+    // id, index id).
+    std::map<std::tuple<int64_t, int64_t, int64_t>, uint64_t>
+        tombstones_size_per_index;
   };
 
   void SetStartSeedsForTesting(size_t database_seed,
@@ -176,6 +193,10 @@ class CONTENT_EXPORT IndexedDBTombstoneSweeper
   int indices_scanned_ = 0;
   int total_indices_ = 0;
 
+  bool open_origin_mode_ = false;
+  uint64_t min_compaction_size_ = 0;
+  bool sweep_finished_ = false;
+
   // Used to measure total time of the task.
   const base::TickClock* clock_for_testing_ = nullptr;
   base::Optional<base::TimeTicks> start_time_;
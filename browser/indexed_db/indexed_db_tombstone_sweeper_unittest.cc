@@ -495,6 +495,52 @@ TEST_F(IndexedDBTombstoneSweeperTest, SimpleRealDBWithTombstones) {
   }
 }
 
+TEST_F(IndexedDBTombstoneSweeperTest, OpenOriginModeCompactsDenseIndexes) {
+  PopulateSingleIndexDBMetadata();
+  SetupRealDB();
+  sweeper_->SetMetadata(&metadata_);
+  sweeper_->EnableOpenOriginMode(/*min_compaction_size=*/1);
+
+  for (int i = 0; i < kRoundIterations + 1; i++) {
+    auto index_key = IndexedDBKey(i, blink::mojom::IDBKeyType::Number);
+    auto primary_key = IndexedDBKey(i + 1, blink::mojom::IDBKeyType::Number);
+    std::string value_str;
+    EncodeVarInt(1, &value_str);
+    EncodeIDBKey(primary_key, &value_str);
+    in_memory_db_->Put(
+        IndexDataKey::Encode(kDb1, kOs1, kIndex1, index_key, primary_key),
+        &value_str);
+
+    std::string exists_value;
+    std::string encoded_primary_key;
+    EncodeIDBKey(primary_key, &encoded_primary_key);
+    EncodeVarInt(i % 2 ? 2 : 1, &exists_value);
+    in_memory_db_->Put(ExistsEntryKey::Encode(kDb1, kOs1, encoded_primary_key),
+                       &exists_value);
+  }
+
+  ASSERT_FALSE(sweeper_->RunRound());
+  ASSERT_TRUE(sweeper_->RunRound());
+
+  std::unique_ptr<IndexedDBPreCloseTaskQueue::PreCloseTask> compaction =
+      sweeper_->TakeFollowUpTask();
+  ASSERT_TRUE(compaction);
+  EXPECT_FALSE(compaction->RequiresMetadata());
+  // The single index with tombstones is compacted in one round.
+  EXPECT_TRUE(compaction->RunRound());
+  histogram_tester_.ExpectTotalCount(
+      "WebCore.IndexedDB.CompactionTask.RangeReclaimedSize", 1);
+}
+
+TEST_F(IndexedDBTombstoneSweeperTest, NoFollowUpTaskByDefault) {
+  PopulateSingleIndexDBMetadata();
+  SetupRealDB();
+  sweeper_->SetMetadata(&metadata_);
+
+  ASSERT_TRUE(sweeper_->RunRound());
+  EXPECT_FALSE(sweeper_->TakeFollowUpTask());
+}
+
 TEST_F(IndexedDBTombstoneSweeperTest, HitMaxIters) {
   PopulateSingleIndexDBMetadata();
   SetupRealDB();
@@ -19,8 +19,9 @@ blink::mojom::IDBValuePtr IndexedDBValue::ConvertAndEraseValue(
     const char* value_data = value->bits.data();
     mojo_value->bits =
         std::vector<uint8_t>(value_data, value_data + value->bits.length());
-    // Release value->bits std::string.
-    value->bits.clear();
+    // Release value->bits std::string. clear() would keep its allocation
+    // until |value| is destroyed.
+    std::string().swap(value->bits);
   }
   IndexedDBExternalObject::ConvertToMojo(value->external_objects,
                                          &mojo_value->external_objects);
@@ -0,0 +1,310 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_value_compression.h"
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <utility>
+
+#include "base/check_op.h"
+#include "base/no_destructor.h"
+#include "base/numerics/safe_conversions.h"
+#include "base/stl_util.h"
+#include "components/services/storage/indexed_db/scopes/varint_coding.h"
+#include "third_party/zlib/zlib.h"
+
+using base::StringPiece;
+
+namespace content {
+
+const base::Feature kIndexedDBValueCompression{
+    "IndexedDBValueCompression", base::FEATURE_DISABLED_BY_DEFAULT};
+const base::FeatureParam<int> kIndexedDBValueCompressionMinSize{
+    &kIndexedDBValueCompression, "min_size", 512};
+
+namespace indexed_db {
+namespace {
+
+constexpr char kCompressedValueMagic[] = {'\0', 'Z'};
+constexpr uint8_t kCompressedValueFormatVersion = 1;
+constexpr size_t kCompressedValueHeaderSize =
+    sizeof(kCompressedValueMagic) + 2;
+
+// Bounds the allocation made for a value claiming a huge uncompressed size.
+// Values are already limited to well below this by the IPC message size.
+constexpr int64_t kMaxUncompressedSize = 256 * 1024 * 1024;
+
+// Raw deflate (no zlib header) with the largest window, so a preset
+// dictionary of up to 32 KB is fully usable.
+constexpr int kWindowBits = -15;
+
+// Segment length used when training dictionaries.
+constexpr size_t kTrainingSegmentSize = 16;
+
+// The one-byte string encoding of |name| in V8's serialization format, which
+// is how property names appear inside structured clone payloads.
+void AppendSerializedString(StringPiece name, std::string* into) {
+  into->push_back('"');
+  into->push_back(static_cast<char>(name.size()));
+  into->append(name.data(), name.size());
+}
+
+std::string BuildBuiltInDictionary() {
+  // Property names and markers that recur across structured clone payloads
+  // of JSON-like application data. The result must never change, since
+  // stored values refer to it; changes need a new dictionary id.
+  static const char* const kPropertyNames[] = {
+      "updatedAt", "createdAt", "timestamp", "modified", "created",
+      "version",   "payload",   "message",   "content",  "status",
+      "value",     "title",     "label",     "items",    "state",
+      "email",     "count",     "order",     "color",    "width",
+      "height",    "date",      "time",      "user",     "data",
+      "text",      "body",      "tags",      "meta",     "size",
+      "type",      "kind",      "name",      "url",      "key",
+      "uid",       "id",
+  };
+  std::string dictionary;
+  // Blink and V8 version envelopes.
+  dictionary.append("\xFF\x13\xFF\x0Do");
+  for (const char* name : kPropertyNames) {
+    dictionary.append("o");
+    AppendSerializedString(name, &dictionary);
+    dictionary.append("\"\x00", 2);
+    AppendSerializedString(name, &dictionary);
+    dictionary.append("I\x00", 2);
+    AppendSerializedString(name, &dictionary);
+    dictionary.append("N");
+  }
+  dictionary.append("TF0_A$\x00{\x01", 9);
+  return dictionary;
+}
+
+StringPiece GetDictionary(ValueCompressionDictionary dictionary) {
+  switch (dictionary) {
+    case ValueCompressionDictionary::kNone:
+    case ValueCompressionDictionary::kExternal:
+      return StringPiece();
+    case ValueCompressionDictionary::kBuiltIn:
+      return GetBuiltInValueCompressionDictionary();
+  }
+  return StringPiece();
+}
+
+bool Compress(StringPiece bits,
+              ValueCompressionDictionary dictionary,
+              StringPiece dictionary_bytes,
+              std::string* compressed) {
+  z_stream stream = {};
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, kWindowBits,
+                   /*memLevel=*/8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+  if (!dictionary_bytes.empty() &&
+      deflateSetDictionary(
+          &stream, reinterpret_cast<const Bytef*>(dictionary_bytes.data()),
+          base::checked_cast<uInt>(dictionary_bytes.size())) != Z_OK) {
+    deflateEnd(&stream);
+    return false;
+  }
+
+  compressed->clear();
+  compressed->append(kCompressedValueMagic, sizeof(kCompressedValueMagic));
+  compressed->push_back(static_cast<char>(kCompressedValueFormatVersion));
+  compressed->push_back(static_cast<char>(dictionary));
+  EncodeVarInt(bits.size(), compressed);
+  const size_t header_size = compressed->size();
+
+  const size_t bound =
+      deflateBound(&stream, base::checked_cast<uLong>(bits.size()));
+  compressed->resize(header_size + bound);
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(bits.data()));
+  stream.avail_in = base::checked_cast<uInt>(bits.size());
+  stream.next_out = reinterpret_cast<Bytef*>(&(*compressed)[header_size]);
+  stream.avail_out = base::checked_cast<uInt>(bound);
+  const int result = deflate(&stream, Z_FINISH);
+  const size_t compressed_size = header_size + stream.total_out;
+  deflateEnd(&stream);
+  if (result != Z_STREAM_END || compressed_size >= bits.size())
+    return false;
+  compressed->resize(compressed_size);
+  return true;
+}
+
+bool Decompress(StringPiece compressed,
+                ValueCompressionDictionary dictionary,
+                StringPiece dictionary_bytes,
+                std::string* bits) {
+  if (!IsCompressedValue(compressed) ||
+      static_cast<uint8_t>(compressed[2]) != kCompressedValueFormatVersion ||
+      static_cast<uint8_t>(compressed[3]) !=
+          static_cast<uint8_t>(dictionary)) {
+    return false;
+  }
+  compressed.remove_prefix(kCompressedValueHeaderSize);
+  int64_t size;
+  if (!DecodeVarInt(&compressed, &size) || size < 0 ||
+      size > kMaxUncompressedSize) {
+    return false;
+  }
+
+  z_stream stream = {};
+  if (inflateInit2(&stream, kWindowBits) != Z_OK)
+    return false;
+  if (!dictionary_bytes.empty() &&
+      inflateSetDictionary(
+          &stream, reinterpret_cast<const Bytef*>(dictionary_bytes.data()),
+          base::checked_cast<uInt>(dictionary_bytes.size())) != Z_OK) {
+    inflateEnd(&stream);
+    return false;
+  }
+
+  bits->resize(static_cast<size_t>(size));
+  stream.next_in =
+      reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+  stream.avail_in = base::checked_cast<uInt>(compressed.size());
+  stream.next_out = reinterpret_cast<Bytef*>(base::data(*bits));
+  stream.avail_out = base::checked_cast<uInt>(size);
+  const int result = inflate(&stream, Z_FINISH);
+  const bool ok = result == Z_STREAM_END &&
+                  stream.total_out == static_cast<uLong>(size) &&
+                  stream.avail_in == 0;
+  inflateEnd(&stream);
+  if (!ok)
+    bits->clear();
+  return ok;
+}
+
+}  // namespace
+
+bool IsCompressedValue(StringPiece bits) {
+  return bits.size() >= kCompressedValueHeaderSize &&
+         bits[0] == kCompressedValueMagic[0] &&
+         bits[1] == kCompressedValueMagic[1];
+}
+
+bool CompressValue(StringPiece bits,
+                   ValueCompressionDictionary dictionary,
+                   std::string* compressed) {
+  DCHECK(dictionary != ValueCompressionDictionary::kExternal);
+  return Compress(bits, dictionary, GetDictionary(dictionary), compressed);
+}
+
+bool DecompressValue(StringPiece compressed, std::string* bits) {
+  if (!IsCompressedValue(compressed))
+    return false;
+  const auto dictionary =
+      static_cast<ValueCompressionDictionary>(compressed[3]);
+  if (dictionary != ValueCompressionDictionary::kNone &&
+      dictionary != ValueCompressionDictionary::kBuiltIn) {
+    return false;
+  }
+  return Decompress(compressed, dictionary, GetDictionary(dictionary), bits);
+}
+
+bool CompressValueWithDictionary(StringPiece bits,
+                                 StringPiece dictionary,
+                                 std::string* compressed) {
+  return Compress(bits, ValueCompressionDictionary::kExternal, dictionary,
+                  compressed);
+}
+
+bool DecompressValueWithDictionary(StringPiece compressed,
+                                   StringPiece dictionary,
+                                   std::string* bits) {
+  return Decompress(compressed, ValueCompressionDictionary::kExternal,
+                    dictionary, bits);
+}
+
+std::string TrainValueCompressionDictionary(
+    const std::vector<std::string>& samples,
+    size_t max_size) {
+  // Count, for each segment, the number of samples it appears in. Segments
+  // shared by many values are the ones a preset dictionary pays off for.
+  std::map<StringPiece, int> sample_counts;
+  for (const std::string& sample : samples) {
+    std::set<StringPiece> seen;
+    for (size_t pos = 0; pos + kTrainingSegmentSize <= sample.size(); ++pos)
+      seen.insert(StringPiece(sample).substr(pos, kTrainingSegmentSize));
+    for (StringPiece segment : seen)
+      ++sample_counts[segment];
+  }
+
+  std::vector<std::pair<int, StringPiece>> ranked;
+  for (const auto& entry : sample_counts) {
+    if (entry.second > 1)
+      ranked.emplace_back(entry.second, entry.first);
+  }
+  std::stable_sort(
+      ranked.begin(), ranked.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  // Deflate reaches the end of the dictionary with the shortest distances, so
+  // the most common segments go last.
+  std::vector<StringPiece> chosen;
+  size_t total_size = 0;
+  for (const auto& entry : ranked) {
+    if (total_size + entry.second.size() > max_size)
+      break;
+    chosen.push_back(entry.second);
+    total_size += entry.second.size();
+  }
+  std::string dictionary;
+  dictionary.reserve(total_size);
+  for (auto it = chosen.rbegin(); it != chosen.rend(); ++it)
+    dictionary.append(it->data(), it->size());
+  return dictionary;
+}
+
+StringPiece GetBuiltInValueCompressionDictionary() {
+  static const base::NoDestructor<std::string> dictionary(
+      BuildBuiltInDictionary());
+  return *dictionary;
+}
+
+}  // namespace indexed_db
+
+IndexedDBValueCompressionPolicy::IndexedDBValueCompressionPolicy(Mode mode)
+    : mode_(mode) {}
+
+IndexedDBValueCompressionPolicy::~IndexedDBValueCompressionPolicy() = default;
+
+bool IndexedDBValueCompressionPolicy::ShouldCompress(size_t value_size) {
+  if (mode_ == Mode::kDisabled)
+    return false;
+  if (value_size <
+      static_cast<size_t>(kIndexedDBValueCompressionMinSize.Get())) {
+    return false;
+  }
+  if (mode_ == Mode::kAlways)
+    return true;
+  if (values_to_skip_ > 0) {
+    --values_to_skip_;
+    return false;
+  }
+  return true;
+}
+
+void IndexedDBValueCompressionPolicy::RecordResult(size_t original_size,
+                                                   size_t compressed_size) {
+  DCHECK_LE(compressed_size, original_size);
+  if (mode_ != Mode::kAdaptive)
+    return;
+  ++probed_values_;
+  probed_original_bytes_ += original_size;
+  probed_compressed_bytes_ += compressed_size;
+  if (probed_values_ < kProbeCount)
+    return;
+
+  const double ratio = static_cast<double>(probed_compressed_bytes_) /
+                       static_cast<double>(probed_original_bytes_);
+  if (ratio > kMaxUsefulRatio)
+    values_to_skip_ = kSkipCount;
+  probed_values_ = 0;
+  probed_original_bytes_ = 0;
+  probed_compressed_bytes_ = 0;
+}
+
+}  // namespace content
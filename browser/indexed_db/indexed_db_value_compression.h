@@ -0,0 +1,124 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_VALUE_COMPRESSION_H_
+#define CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_VALUE_COMPRESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/compiler_specific.h"
+#include "base/feature_list.h"
+#include "base/metrics/field_trial_params.h"
+#include "base/strings/string_piece.h"
+#include "content/common/content_export.h"
+
+namespace content {
+
+// Compresses object store values before they are written to LevelDB. Disabled
+// by default. Values written while enabled can only be read by versions that
+// know the compressed value format.
+CONTENT_EXPORT extern const base::Feature kIndexedDBValueCompression;
+// Values smaller than this are never compressed.
+CONTENT_EXPORT extern const base::FeatureParam<int>
+    kIndexedDBValueCompressionMinSize;
+
+namespace indexed_db {
+
+// A compressed value starts with a header that Blink values cannot start
+// with (they always begin with the SerializedScriptValue version tag, 0xFF):
+//
+//   0x00 'Z' <format version> <dictionary id> <varint uncompressed size>
+//
+// followed by a raw deflate stream. Values without the header are stored
+// uncompressed.
+enum class ValueCompressionDictionary : uint8_t {
+  kNone = 0,
+  // Built into the browser, made of the tokens that recur in structured clone
+  // payloads, so it is always available to decode values.
+  kBuiltIn = 1,
+  // Supplied by the caller, who has to supply it again to decompress. Only
+  // used to evaluate trained dictionaries; never written by the backing store.
+  kExternal = 0xFF,
+};
+
+CONTENT_EXPORT bool IsCompressedValue(base::StringPiece bits);
+
+// Compresses |bits| into |compressed| with the given built-in dictionary.
+// Returns false, leaving |compressed| unspecified, if the result would not be
+// smaller.
+CONTENT_EXPORT bool CompressValue(base::StringPiece bits,
+                                  ValueCompressionDictionary dictionary,
+                                  std::string* compressed);
+
+// Decompresses a value produced by CompressValue(). Returns false if
+// |compressed| is malformed.
+CONTENT_EXPORT bool DecompressValue(base::StringPiece compressed,
+                                    std::string* bits) WARN_UNUSED_RESULT;
+
+// As above, with a caller supplied |dictionary|.
+CONTENT_EXPORT bool CompressValueWithDictionary(base::StringPiece bits,
+                                                base::StringPiece dictionary,
+                                                std::string* compressed);
+CONTENT_EXPORT bool DecompressValueWithDictionary(
+    base::StringPiece compressed,
+    base::StringPiece dictionary,
+    std::string* bits) WARN_UNUSED_RESULT;
+
+// Builds a deflate preset dictionary of at most |max_size| bytes out of the
+// byte sequences that recur across the most |samples|, so that benchmarks can
+// compare the built-in dictionary against one trained on their own payloads.
+CONTENT_EXPORT std::string TrainValueCompressionDictionary(
+    const std::vector<std::string>& samples,
+    size_t max_size);
+
+// Returns the built-in dictionary.
+CONTENT_EXPORT base::StringPiece GetBuiltInValueCompressionDictionary();
+
+}  // namespace indexed_db
+
+// Decides, per object store, whether to compress values. In adaptive mode,
+// stores whose values do not compress well (e.g. already compressed images)
+// stop paying for compression attempts, and are probed again now and then in
+// case their contents change.
+class CONTENT_EXPORT IndexedDBValueCompressionPolicy {
+ public:
+  enum class Mode {
+    kDisabled,
+    kAdaptive,
+    kAlways,
+  };
+
+  // Number of values observed before the compression ratio is judged.
+  static constexpr int kProbeCount = 16;
+  // Number of values stored uncompressed before a skipped store is probed
+  // again.
+  static constexpr int kSkipCount = 256;
+  // Stores compressing worse than this (compressed / original) are skipped.
+  static constexpr double kMaxUsefulRatio = 0.9;
+
+  explicit IndexedDBValueCompressionPolicy(Mode mode);
+  ~IndexedDBValueCompressionPolicy();
+
+  Mode mode() const { return mode_; }
+
+  bool ShouldCompress(size_t value_size);
+  // Records the outcome of a compression attempt. |compressed_size| equals
+  // |original_size| if compression did not help.
+  void RecordResult(size_t original_size, size_t compressed_size);
+
+ private:
+  Mode mode_;
+  int probed_values_ = 0;
+  uint64_t probed_original_bytes_ = 0;
+  uint64_t probed_compressed_bytes_ = 0;
+  int values_to_skip_ = 0;
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_INDEXED_DB_INDEXED_DB_VALUE_COMPRESSION_H_
@@ -0,0 +1,143 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/indexed_db/indexed_db_value_compression.h"
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+namespace indexed_db {
+namespace {
+
+// A structured clone of an array of JSON-like objects.
+std::string CreateRepetitiveValue(int count) {
+  std::string bits = "\xFF\x13\xFF\x0D" "A";
+  for (int i = 0; i < count; ++i) {
+    const std::string id = base::NumberToString(i);
+    bits += "o\"\x02id\"";
+    bits.push_back(static_cast<char>(id.size()));
+    bits += id;
+    bits += "\"\x04name\"\x0Bsome person\"\x05state\"\x06" "active{\x03";
+  }
+  return bits;
+}
+
+TEST(IndexedDBValueCompressionTest, RoundTrip) {
+  const std::string bits = CreateRepetitiveValue(100);
+  for (ValueCompressionDictionary dictionary :
+       {ValueCompressionDictionary::kNone,
+        ValueCompressionDictionary::kBuiltIn}) {
+    std::string compressed;
+    ASSERT_TRUE(CompressValue(bits, dictionary, &compressed));
+    EXPECT_TRUE(IsCompressedValue(compressed));
+    EXPECT_LT(compressed.size(), bits.size());
+
+    std::string decompressed;
+    ASSERT_TRUE(DecompressValue(compressed, &decompressed));
+    EXPECT_EQ(bits, decompressed);
+  }
+}
+
+TEST(IndexedDBValueCompressionTest, SerializedValuesAreNotCompressed) {
+  EXPECT_FALSE(IsCompressedValue(CreateRepetitiveValue(1)));
+  EXPECT_FALSE(IsCompressedValue(std::string()));
+}
+
+TEST(IndexedDBValueCompressionTest, IncompressibleValuesAreRejected) {
+  std::string bits;
+  uint32_t state = 1;
+  for (int i = 0; i < 4096; ++i) {
+    state = state * 1103515245 + 12345;
+    bits.push_back(static_cast<char>(state >> 24));
+  }
+  std::string compressed;
+  EXPECT_FALSE(CompressValue(bits, ValueCompressionDictionary::kBuiltIn,
+                             &compressed));
+}
+
+TEST(IndexedDBValueCompressionTest, MalformedValuesFailToDecompress) {
+  std::string compressed;
+  ASSERT_TRUE(CompressValue(CreateRepetitiveValue(100),
+                            ValueCompressionDictionary::kBuiltIn,
+                            &compressed));
+  std::string decompressed;
+  EXPECT_FALSE(DecompressValue(compressed.substr(0, compressed.size() - 1),
+                               &decompressed));
+  EXPECT_FALSE(DecompressValue(compressed + "x", &decompressed));
+
+  // Unknown format version.
+  std::string bad_version = compressed;
+  bad_version[2] = 2;
+  EXPECT_FALSE(DecompressValue(bad_version, &decompressed));
+
+  // Unknown dictionary.
+  std::string bad_dictionary = compressed;
+  bad_dictionary[3] = 7;
+  EXPECT_FALSE(DecompressValue(bad_dictionary, &decompressed));
+}
+
+TEST(IndexedDBValueCompressionTest, TrainedDictionary) {
+  std::vector<std::string> samples;
+  for (int i = 0; i < 20; ++i)
+    samples.push_back(CreateRepetitiveValue(i + 1));
+  const std::string dictionary =
+      TrainValueCompressionDictionary(samples, /*max_size=*/256);
+  EXPECT_FALSE(dictionary.empty());
+  EXPECT_LE(dictionary.size(), 256u);
+
+  const std::string bits = CreateRepetitiveValue(5);
+  std::string compressed;
+  ASSERT_TRUE(CompressValueWithDictionary(bits, dictionary, &compressed));
+
+  // The dictionary is not stored, so it is needed to decompress.
+  std::string decompressed;
+  EXPECT_FALSE(DecompressValue(compressed, &decompressed));
+  ASSERT_TRUE(
+      DecompressValueWithDictionary(compressed, dictionary, &decompressed));
+  EXPECT_EQ(bits, decompressed);
+}
+
+TEST(IndexedDBValueCompressionTest, AdaptivePolicySkipsIncompressibleStores) {
+  IndexedDBValueCompressionPolicy policy(
+      IndexedDBValueCompressionPolicy::Mode::kAdaptive);
+  const size_t size = 64 * 1024;
+  EXPECT_FALSE(policy.ShouldCompress(1));
+
+  for (int i = 0; i < IndexedDBValueCompressionPolicy::kProbeCount; ++i) {
+    ASSERT_TRUE(policy.ShouldCompress(size));
+    policy.RecordResult(size, size);
+  }
+  for (int i = 0; i < IndexedDBValueCompressionPolicy::kSkipCount; ++i)
+    EXPECT_FALSE(policy.ShouldCompress(size));
+
+  // Probed again, and kept compressing once the values compress well.
+  for (int i = 0; i < IndexedDBValueCompressionPolicy::kProbeCount; ++i) {
+    ASSERT_TRUE(policy.ShouldCompress(size));
+    policy.RecordResult(size, size / 4);
+  }
+  EXPECT_TRUE(policy.ShouldCompress(size));
+}
+
+TEST(IndexedDBValueCompressionTest, DisabledAndAlwaysPolicies) {
+  const size_t size = 64 * 1024;
+  IndexedDBValueCompressionPolicy disabled(
+      IndexedDBValueCompressionPolicy::Mode::kDisabled);
+  EXPECT_FALSE(disabled.ShouldCompress(size));
+
+  IndexedDBValueCompressionPolicy always(
+      IndexedDBValueCompressionPolicy::Mode::kAlways);
+  for (int i = 0; i < IndexedDBValueCompressionPolicy::kProbeCount; ++i) {
+    EXPECT_TRUE(always.ShouldCompress(size));
+    always.RecordResult(size, size);
+  }
+  EXPECT_TRUE(always.ShouldCompress(size));
+}
+
+}  // namespace
+}  // namespace indexed_db
+}  // namespace content
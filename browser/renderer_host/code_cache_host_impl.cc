@@ -16,6 +16,7 @@
 #include "content/browser/cache_storage/cache_storage_context_impl.h"
 #include "content/browser/cache_storage/cache_storage_manager.h"
 #include "content/browser/child_process_security_policy_impl.h"
+#include "content/browser/code_cache/code_cache_bundle_prefetcher.h"
 #include "content/browser/code_cache/generated_code_cache.h"
 #include "content/browser/code_cache/generated_code_cache_context.h"
 #include "content/browser/renderer_host/render_process_host_impl.h"
@@ -52,11 +53,7 @@ void NoOpCacheStorageErrorCallback(CacheStorageCacheHandle cache_handle,
 // key.
 // Case 3: origin_lock if the scheme of origin_lock is Http/Https/chrome.
 // Case 4. base::nullopt otherwise.
-base::Optional<GURL> GetSecondaryKeyForCodeCache(const GURL& resource_url,
-                                                 int render_process_id) {
-  if (!resource_url.is_valid() || !resource_url.SchemeIsHTTPOrHTTPS())
-    return base::nullopt;
-
+base::Optional<GURL> GetSecondaryKeyForRenderProcess(int render_process_id) {
   GURL origin_lock =
       ChildProcessSecurityPolicyImpl::GetInstance()->GetOriginLock(
           render_process_id);
@@ -94,6 +91,16 @@ base::Optional<GURL> GetSecondaryKeyForCodeCache(const GURL& resource_url,
   return base::nullopt;
 }
 
+// Returns the secondary key for |resource_url| requested by the renderer
+// |render_process_id|, or base::nullopt if its code should not be cached.
+base::Optional<GURL> GetSecondaryKeyForCodeCache(const GURL& resource_url,
+                                                 int render_process_id) {
+  if (!resource_url.is_valid() || !resource_url.SchemeIsHTTPOrHTTPS())
+    return base::nullopt;
+
+  return GetSecondaryKeyForRenderProcess(render_process_id);
+}
+
 }  // namespace
 
 CodeCacheHostImpl::CodeCacheHostImpl(
@@ -110,6 +117,26 @@ CodeCacheHostImpl::~CodeCacheHostImpl() {
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
 }
 
+// static
+void CodeCacheHostImpl::PrefetchCodeCacheBundle(
+    int render_process_id,
+    GeneratedCodeCacheContext* generated_code_cache_context,
+    CodeCacheBundlePrefetcher::PrefetchCallback callback) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  CodeCacheBundlePrefetcher* prefetcher =
+      generated_code_cache_context
+          ? generated_code_cache_context->code_cache_bundle_prefetcher()
+          : nullptr;
+  base::Optional<GURL> origin_lock =
+      GetSecondaryKeyForRenderProcess(render_process_id);
+  // Fetches of processes that are not locked to an origin are not recorded.
+  if (!prefetcher || !origin_lock || origin_lock->is_empty()) {
+    std::move(callback).Run(base::ReadOnlySharedMemoryRegion());
+    return;
+  }
+  prefetcher->Prefetch(*origin_lock, std::move(callback));
+}
+
 void CodeCacheHostImpl::SetCacheStorageContextForTesting(
     scoped_refptr<CacheStorageContextImpl> context) {
   cache_storage_context_ = std::move(context);
@@ -156,6 +183,13 @@ void CodeCacheHostImpl::FetchCachedCode(blink::mojom::CodeCacheType cache_type,
     return;
   }
 
+  CodeCacheBundlePrefetcher* prefetcher =
+      generated_code_cache_context_->code_cache_bundle_prefetcher();
+  if (prefetcher && cache_type == blink::mojom::CodeCacheType::kJavascript &&
+      !origin_lock->is_empty()) {
+    prefetcher->RecordFetch(*origin_lock, url);
+  }
+
   auto read_callback = base::BindRepeating(
       &CodeCacheHostImpl::OnReceiveCachedCode, weak_ptr_factory_.GetWeakPtr(),
       base::Passed(&callback));
@@ -12,6 +12,7 @@
 #include "base/strings/string16.h"
 #include "build/build_config.h"
 #include "content/browser/cache_storage/cache_storage_cache_handle.h"
+#include "content/browser/code_cache/code_cache_bundle_prefetcher.h"
 #include "content/common/content_export.h"
 #include "mojo/public/cpp/base/big_buffer.h"
 #include "mojo/public/cpp/bindings/pending_receiver.h"
@@ -47,6 +48,16 @@ class CONTENT_EXPORT CodeCacheHostImpl : public blink::mojom::CodeCacheHost {
       mojo::PendingReceiver<blink::mojom::CodeCacheHost> receiver);
   ~CodeCacheHostImpl() override;
 
+  // Prefetches the JavaScript code cache entries that the renderer
+  // |render_process_id| is expected to fetch, using the
+  // CodeCacheBundlePrefetcher of |generated_code_cache_context|. This does not
+  // need a CodeCacheHostImpl, which the renderer may not have created yet
+  // when a navigation commits.
+  static void PrefetchCodeCacheBundle(
+      int render_process_id,
+      GeneratedCodeCacheContext* generated_code_cache_context,
+      CodeCacheBundlePrefetcher::PrefetchCallback callback);
+
   mojo::Receiver<blink::mojom::CodeCacheHost>& receiver() { return receiver_; }
 
   void SetCacheStorageContextForTesting(
@@ -344,6 +344,13 @@ std::vector<RenderProcessHostCreationObserver*>& GetAllCreationObservers() {
   return *s_all_creation_observers;
 }
 
+// The processes kept in the warm pools of ServiceWorkerProcessManagers.
+std::set<RenderProcessHost*>& GetServiceWorkerWarmPoolHosts() {
+  static base::NoDestructor<std::set<RenderProcessHost*>>
+      s_service_worker_warm_pool_hosts;
+  return *s_service_worker_warm_pool_hosts;
+}
+
 // Map of site to process, to ensure we only have one RenderProcessHost per
 // site in process-per-site mode.  Each map is specific to a BrowserContext.
 class SiteProcessMap : public base::SupportsUserData::Data {
@@ -2594,6 +2601,28 @@ void RenderProcessHostImpl::CreateCodeCacheHost(
   }
 }
 
+void RenderProcessHostImpl::PrefetchCodeCacheBundle() {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  CodeCacheHostImpl::PrefetchCodeCacheBundle(
+      GetID(), storage_partition_impl_->GetGeneratedCodeCacheContext(),
+      base::BindOnce(&RenderProcessHostImpl::OnCodeCacheBundlePrefetched,
+                     weak_factory_.GetWeakPtr(),
+                     ++code_cache_bundle_prefetch_sequence_));
+}
+
+void RenderProcessHostImpl::OnCodeCacheBundlePrefetched(
+    uint64_t prefetch_sequence,
+    base::ReadOnlySharedMemoryRegion bundle) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  // A later navigation started its own prefetch, and sending this bundle
+  // would replace the one the renderer may already be using for it.
+  if (prefetch_sequence != code_cache_bundle_prefetch_sequence_)
+    return;
+  if (!bundle.IsValid() || !IsInitializedAndNotDead())
+    return;
+  GetRendererInterface()->SetCodeCacheBundle(std::move(bundle));
+}
+
 void RenderProcessHostImpl::BindVideoDecoderService(
     mojo::PendingReceiver<media::mojom::InterfaceFactory> receiver) {
   if (!video_decoder_proxy_)
@@ -4222,7 +4251,8 @@ RenderProcessHost* RenderProcessHostImpl::GetExistingProcessHost(
 
 // static
 RenderProcessHost* RenderProcessHostImpl::GetUnusedProcessHostForServiceWorker(
-    SiteInstanceImpl* site_instance) {
+    SiteInstanceImpl* site_instance,
+    bool warm_pool_only) {
   DCHECK(site_instance->is_for_service_worker());
   if (site_instance->process_reuse_policy() !=
       SiteInstanceImpl::ProcessReusePolicy::REUSE_PENDING_OR_COMMITTED_SITE) {
@@ -4241,8 +4271,12 @@ RenderProcessHost* RenderProcessHostImpl::GetUnusedProcessHostForServiceWorker(
     // suitable process, the spare can still be chosen when
     // MaybeTakeSpareRenderProcessHost() is called later.
     bool is_spare = (host == spare_process_manager.spare_render_process_host());
+    bool is_excluded =
+        warm_pool_only &&
+        !base::Contains(GetServiceWorkerWarmPoolHosts(), host);
 
-    if (!is_spare && iter.GetCurrentValue()->MayReuseHost() &&
+    if (!is_spare && !is_excluded &&
+        iter.GetCurrentValue()->MayReuseHost() &&
         iter.GetCurrentValue()->IsUnused() &&
         RenderProcessHostImpl::IsSuitableHost(
             iter.GetCurrentValue(), site_instance->GetIsolationContext(),
@@ -4317,6 +4351,18 @@ RenderProcessHost* RenderProcessHostImpl::GetSoleProcessHostForSite(
   return host;
 }
 
+// static
+void RenderProcessHostImpl::AddToServiceWorkerWarmPool(
+    RenderProcessHost* host) {
+  GetServiceWorkerWarmPoolHosts().insert(host);
+}
+
+// static
+void RenderProcessHostImpl::RemoveFromServiceWorkerWarmPool(
+    RenderProcessHost* host) {
+  GetServiceWorkerWarmPoolHosts().erase(host);
+}
+
 void RenderProcessHostImpl::RegisterSoleProcessHostForSite(
     RenderProcessHost* process,
     SiteInstanceImpl* site_instance) {
@@ -4393,11 +4439,17 @@ RenderProcessHost* RenderProcessHostImpl::GetProcessHostForSiteInstance(
   // If a process hasn't been selected yet, and the site instance is for a
   // service worker, try to use an unused process host. One might have been
   // created for a navigation and this will let the navigation and the service
-  // worker share the same process.
-  if (base::FeatureList::IsEnabled(
-          features::kServiceWorkerPrefersUnusedProcess) &&
-      !render_process_host && is_unmatched_service_worker) {
-    render_process_host = GetUnusedProcessHostForServiceWorker(site_instance);
+  // worker share the same process. Otherwise, only a process from a
+  // ServiceWorkerProcessManager's warm pool is chosen.
+  if (!render_process_host && is_unmatched_service_worker) {
+    if (base::FeatureList::IsEnabled(
+            features::kServiceWorkerPrefersUnusedProcess)) {
+      render_process_host = GetUnusedProcessHostForServiceWorker(
+          site_instance, false /* warm_pool_only */);
+    } else if (!GetServiceWorkerWarmPoolHosts().empty()) {
+      render_process_host = GetUnusedProcessHostForServiceWorker(
+          site_instance, true /* warm_pool_only */);
+    }
   }
 
   // See if the spare RenderProcessHost can be used.
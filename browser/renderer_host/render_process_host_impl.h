@@ -21,6 +21,7 @@
 #include "base/containers/flat_set.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
+#include "base/memory/read_only_shared_memory_region.h"
 #include "base/memory/ref_counted.h"
 #include "base/observer_list.h"
 #include "base/optional.h"
@@ -375,6 +376,12 @@ class CONTENT_EXPORT RenderProcessHostImpl
   static void RegisterSoleProcessHostForSite(RenderProcessHost* process,
                                              SiteInstanceImpl* site_instance);
 
+  // Marks |host| as kept in a ServiceWorkerProcessManager's warm pool, which
+  // lets GetProcessHostForSiteInstance() choose it for a service worker while
+  // it is unused. The pool must remove |host| before it is destroyed.
+  static void AddToServiceWorkerWarmPool(RenderProcessHost* host);
+  static void RemoveFromServiceWorkerWarmPool(RenderProcessHost* host);
+
   // Returns a suitable RenderProcessHost to use for |site_instance|. Depending
   // on the SiteInstance's ProcessReusePolicy and its url, this may be an
   // existing RenderProcessHost or a new one.
@@ -470,6 +477,11 @@ class CONTENT_EXPORT RenderProcessHostImpl
   static void SetCodeCacheHostReceiverHandlerForTesting(
       CodeCacheHostReceiverHandler handler);
 
+  // Prefetches the code cache entries that the renderer is expected to fetch
+  // for a navigation it is committing, and sends them to the renderer in a
+  // CodeCacheBundle. Does nothing unless kCodeCacheBundle is enabled.
+  void PrefetchCodeCacheBundle();
+
   RenderFrameMessageFilter* render_frame_message_filter_for_testing() const {
     return render_frame_message_filter_.get();
   }
@@ -869,9 +881,11 @@ class CONTENT_EXPORT RenderProcessHostImpl
   // Tab Page use a SiteInstance with an empty URL by design in order to choose
   // the NTP process, and do not go through the typical matching algorithm. The
   // goal of this function is to return the NTP process so the service worker
-  // can also use it.
+  // can also use it. If |warm_pool_only| is true, only processes in a
+  // ServiceWorkerProcessManager's warm pool are considered.
   static RenderProcessHost* GetUnusedProcessHostForServiceWorker(
-      SiteInstanceImpl* site_instance);
+      SiteInstanceImpl* site_instance,
+      bool warm_pool_only);
 
   // Returns a RenderProcessHost that is rendering a URL corresponding to
   // |site_instance| in one of its frames, or that is expecting a navigation to
@@ -891,6 +905,8 @@ class CONTENT_EXPORT RenderProcessHostImpl
 #endif  // BUILDFLAG(ENABLE_MDNS)
 
   void NotifyRendererIfLockedToSite();
+  void OnCodeCacheBundlePrefetched(uint64_t prefetch_sequence,
+                                   base::ReadOnlySharedMemoryRegion bundle);
   void PopulateTerminationInfoRendererFields(ChildProcessTerminationInfo* info);
 
   static void OnMojoError(int render_process_id, const std::string& error);
@@ -1196,6 +1212,10 @@ class CONTENT_EXPORT RenderProcessHostImpl
   // Fields for recording MediaStream UMA.
   bool has_recorded_media_stream_frame_depth_metric_ = false;
 
+  // Incremented by each PrefetchCodeCacheBundle(), so that only the bundle of
+  // the latest navigation is sent to the renderer.
+  uint64_t code_cache_bundle_prefetch_sequence_ = 0;
+
   // If the RenderProcessHost is being shutdown via Shutdown(), this records the
   // exit code.
   int shutdown_exit_code_;
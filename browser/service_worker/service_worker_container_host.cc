@@ -14,6 +14,7 @@
 #include "content/browser/service_worker/service_worker_consts.h"
 #include "content/browser/service_worker/service_worker_context_core.h"
 #include "content/browser/service_worker/service_worker_context_wrapper.h"
+#include "content/browser/service_worker/service_worker_navigation_predictor.h"
 #include "content/browser/service_worker/service_worker_object_host.h"
 #include "content/browser/service_worker/service_worker_registration_object_host.h"
 #include "content/browser/web_contents/frame_tree_node_id_registry.h"
@@ -743,6 +744,11 @@ void ServiceWorkerContainerHost::OnBeginNavigationCommit(
   DCHECK_NE(MSG_ROUTING_NONE, container_frame_id);
   frame_id_ = container_frame_id;
 
+  if (context_ && context_->navigation_predictor()) {
+    context_->navigation_predictor()->OnNavigationCommitted(
+        frame_tree_node_id_, url_);
+  }
+
   DCHECK(!cross_origin_embedder_policy_.has_value());
   cross_origin_embedder_policy_ = cross_origin_embedder_policy;
   coep_reporter_.Bind(std::move(coep_reporter));
@@ -12,6 +12,7 @@
 #include "base/bind.h"
 #include "base/bind_helpers.h"
 #include "base/callback_helpers.h"
+#include "base/feature_list.h"
 #include "base/files/file_path.h"
 #include "base/location.h"
 #include "base/macros.h"
@@ -30,6 +31,7 @@
 #include "content/browser/service_worker/service_worker_context_wrapper.h"
 #include "content/browser/service_worker/service_worker_info.h"
 #include "content/browser/service_worker/service_worker_job_coordinator.h"
+#include "content/browser/service_worker/service_worker_navigation_predictor.h"
 #include "content/browser/service_worker/service_worker_offline_capability_checker.h"
 #include "content/browser/service_worker/service_worker_process_manager.h"
 #include "content/browser/service_worker/service_worker_register_job.h"
@@ -304,6 +306,11 @@ ServiceWorkerContextCore::ServiceWorkerContextCore(
   container_host_receivers_->set_disconnect_handler(base::BindRepeating(
       &ServiceWorkerContextCore::OnContainerHostReceiverDisconnected,
       base::Unretained(this)));
+
+  if (base::FeatureList::IsEnabled(kServiceWorkerNavigationPredictor)) {
+    navigation_predictor_ =
+        std::make_unique<ServiceWorkerNavigationPredictor>(this);
+  }
 }
 
 ServiceWorkerContextCore::ServiceWorkerContextCore(
@@ -327,6 +334,11 @@ ServiceWorkerContextCore::ServiceWorkerContextCore(
   container_host_receivers_->set_disconnect_handler(base::BindRepeating(
       &ServiceWorkerContextCore::OnContainerHostReceiverDisconnected,
       base::Unretained(this)));
+
+  if (base::FeatureList::IsEnabled(kServiceWorkerNavigationPredictor)) {
+    navigation_predictor_ =
+        std::make_unique<ServiceWorkerNavigationPredictor>(this);
+  }
 }
 
 ServiceWorkerContextCore::~ServiceWorkerContextCore() {
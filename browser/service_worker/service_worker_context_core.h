@@ -46,6 +46,7 @@ namespace content {
 class ServiceWorkerContextCoreObserver;
 class ServiceWorkerContextWrapper;
 class ServiceWorkerJobCoordinator;
+class ServiceWorkerNavigationPredictor;
 class ServiceWorkerRegistration;
 class URLLoaderFactoryGetter;
 
@@ -171,6 +172,10 @@ class CONTENT_EXPORT ServiceWorkerContextCore
   ServiceWorkerJobCoordinator* job_coordinator() {
     return job_coordinator_.get();
   }
+  // Null unless kServiceWorkerNavigationPredictor is enabled.
+  ServiceWorkerNavigationPredictor* navigation_predictor() {
+    return navigation_predictor_.get();
+  }
 
   // Returns a ContainerHost iterator for all service worker clients for the
   // |origin|. If |include_reserved_clients| is true, this includes clients that
@@ -412,6 +417,7 @@ class CONTENT_EXPORT ServiceWorkerContextCore
 
   std::unique_ptr<ServiceWorkerRegistry> registry_;
   std::unique_ptr<ServiceWorkerJobCoordinator> job_coordinator_;
+  std::unique_ptr<ServiceWorkerNavigationPredictor> navigation_predictor_;
   // TODO(bashi): Move |live_registrations_| to ServiceWorkerRegistry as
   // ServiceWorkerRegistry is a better place to manage in-memory representation
   // of registrations.
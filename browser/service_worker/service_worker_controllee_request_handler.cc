@@ -18,6 +18,7 @@
 #include "content/browser/service_worker/service_worker_context_wrapper.h"
 #include "content/browser/service_worker/service_worker_metrics.h"
 #include "content/browser/service_worker/service_worker_navigation_loader.h"
+#include "content/browser/service_worker/service_worker_navigation_predictor.h"
 #include "content/browser/service_worker/service_worker_object_host.h"
 #include "content/browser/service_worker/service_worker_registration.h"
 #include "content/common/service_worker/service_worker_utils.h"
@@ -248,6 +249,12 @@ void ServiceWorkerControlleeRequestHandler::ContinueWithRegistration(
   ServiceWorkerMetrics::RecordLookupRegistrationTime(
       status, base::TimeTicks::Now() - registration_lookup_start_time_);
 
+  if (context_ && context_->navigation_predictor() && container_host_ &&
+      resource_type_ == blink::mojom::ResourceType::kMainFrame) {
+    context_->navigation_predictor()->OnMainFrameRegistrationLookup(
+        container_host_->frame_tree_node_id(), registration.get());
+  }
+
   if (status != blink::ServiceWorkerStatusCode::kOk) {
     TRACE_EVENT_WITH_FLOW1(
         "ServiceWorker",
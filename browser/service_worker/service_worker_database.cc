@@ -5,6 +5,7 @@
 #include "content/browser/service_worker/service_worker_database.h"
 
 #include "base/command_line.h"
+#include "base/feature_list.h"
 #include "base/files/file_util.h"
 #include "base/location.h"
 #include "base/logging.h"
@@ -16,6 +17,7 @@
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "content/browser/service_worker/service_worker_database.pb.h"
+#include "content/browser/service_worker/service_worker_flat_record.h"
 #include "third_party/blink/public/mojom/service_worker/service_worker_database.mojom.h"
 #include "third_party/leveldatabase/env_chromium.h"
 #include "third_party/leveldatabase/leveldb_chrome.h"
@@ -89,6 +91,19 @@
 //   OBSOLETE: https://crbug.com/788604
 //   key: "INITDATA_FOREIGN_FETCH_ORIGIN:" + <GURL 'origin'>
 //   value: <empty>
+//
+// Version 3
+//
+//   key: "REG:" + <GURL 'origin'> + '\x00' + <int64_t 'registration_id'>
+//   value: <ServiceWorkerRegistrationData serialized as a string> or
+//          <registration record in the flat layout>
+//
+//   key: "RES:" + <int64_t 'version_id'> + '\x00' + <int64_t 'resource_id'>
+//   value: <ServiceWorkerResourceRecord serialized as a string> or
+//          <resource record in the flat layout>
+//     - The flat layout is described in service_worker_flat_record.h. Flat
+//       records are only written when kServiceWorkerFlatDatabaseRecords is
+//       enabled, but are always read.
 namespace content {
 
 namespace service_worker_internals {
@@ -109,7 +124,12 @@ const char kKeySeparator = '\x00';
 const char kUncommittedResIdKeyPrefix[] = "URES:";
 const char kPurgeableResIdKeyPrefix[] = "PRES:";
 
-const int64_t kCurrentSchemaVersion = 2;
+const int64_t kCurrentSchemaVersion = 3;
+
+// The schema version of databases whose records are all protobufs. New
+// databases get it while kServiceWorkerFlatDatabaseRecords is disabled, so
+// that versions of Chrome without flat records can still open them.
+const int64_t kProtobufRecordsSchemaVersion = 2;
 
 }  // namespace service_worker_internals
 
@@ -130,6 +150,10 @@ class ServiceWorkerEnv : public leveldb_env::ChromiumEnv {
   }
 };
 
+bool FlatRecordsEnabled() {
+  return base::FeatureList::IsEnabled(kServiceWorkerFlatDatabaseRecords);
+}
+
 bool RemovePrefix(const std::string& str,
                   const std::string& prefix,
                   std::string* out) {
@@ -409,7 +433,9 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::GetRegistrationsForOrigin(
         break;
 
       storage::mojom::ServiceWorkerRegistrationDataPtr registration;
-      status = ParseRegistrationData(itr->value().ToString(), &registration);
+      status = ParseRegistrationData(
+          base::StringPiece(itr->value().data(), itr->value().size()),
+          &registration);
       if (status != Status::kOk) {
         registrations->clear();
         if (opt_resources_list)
@@ -476,7 +502,9 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::GetAllRegistrations(
         break;
 
       storage::mojom::ServiceWorkerRegistrationDataPtr registration;
-      status = ParseRegistrationData(itr->value().ToString(), &registration);
+      status = ParseRegistrationData(
+          base::StringPiece(itr->value().data(), itr->value().size()),
+          &registration);
       if (status != Status::kOk) {
         registrations->clear();
         break;
@@ -489,6 +517,66 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::GetAllRegistrations(
   return status;
 }
 
+ServiceWorkerDatabase::Status ServiceWorkerDatabase::GetAllRegistrationScopes(
+    std::map<int64_t, GURL>* scopes) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(scopes->empty());
+
+  Status status = LazyOpen(false);
+  if (IsNewOrNonexistentDatabase(status))
+    return Status::kOk;
+  if (status != Status::kOk)
+    return status;
+
+  {
+    std::unique_ptr<leveldb::Iterator> itr(
+        db_->NewIterator(leveldb::ReadOptions()));
+    for (itr->Seek(service_worker_internals::kRegKeyPrefix); itr->Valid();
+         itr->Next()) {
+      status = LevelDBStatusToServiceWorkerDBStatus(itr->status());
+      if (status != Status::kOk) {
+        scopes->clear();
+        break;
+      }
+
+      if (!RemovePrefix(itr->key().ToString(),
+                        service_worker_internals::kRegKeyPrefix, nullptr))
+        break;
+
+      base::StringPiece value(itr->value().data(), itr->value().size());
+      if (!service_worker_flat_record::IsFlatRecord(value)) {
+        storage::mojom::ServiceWorkerRegistrationDataPtr registration;
+        status = ParseRegistrationData(value, &registration);
+        if (status != Status::kOk) {
+          scopes->clear();
+          break;
+        }
+        (*scopes)[registration->registration_id] = registration->scope;
+        continue;
+      }
+
+      // Only the fixed-size fields and the URLs of flat records are read.
+      service_worker_flat_record::RegistrationReader reader(value);
+      if (!reader.Init() ||
+          reader.registration_id() >= next_avail_registration_id_) {
+        status = Status::kErrorCorrupted;
+        scopes->clear();
+        break;
+      }
+      GURL scope(reader.scope());
+      if (!scope.is_valid()) {
+        status = Status::kErrorCorrupted;
+        scopes->clear();
+        break;
+      }
+      (*scopes)[reader.registration_id()] = std::move(scope);
+    }
+  }
+
+  HandleReadResult(FROM_HERE, status);
+  return status;
+}
+
 ServiceWorkerDatabase::Status ServiceWorkerDatabase::ReadRegistration(
     int64_t registration_id,
     const GURL& origin,
@@ -1393,6 +1481,11 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::LazyOpen(
       Disable(FROM_HERE, status);
       return status;
     case 2:
+      state_ = DATABASE_STATE_INITIALIZED;
+      if (FlatRecordsEnabled())
+        return UpgradeToFlatRecords();
+      return Status::kOk;
+    case 3:
       DCHECK_EQ(db_version, service_worker_internals::kCurrentSchemaVersion);
       state_ = DATABASE_STATE_INITIALIZED;
       return Status::kOk;
@@ -1461,12 +1554,15 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::ReadRegistrationData(
 }
 
 ServiceWorkerDatabase::Status ServiceWorkerDatabase::ParseRegistrationData(
-    const std::string& serialized,
+    base::StringPiece serialized,
     storage::mojom::ServiceWorkerRegistrationDataPtr* out) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   DCHECK(out);
+  if (service_worker_flat_record::IsFlatRecord(serialized))
+    return ParseFlatRegistrationData(serialized, out);
+
   ServiceWorkerRegistrationData data;
-  if (!data.ParseFromString(serialized))
+  if (!data.ParseFromArray(serialized.data(), serialized.size()))
     return Status::kErrorCorrupted;
 
   GURL scope_url(data.scope_url());
@@ -1585,6 +1681,42 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::ParseRegistrationData(
   return Status::kOk;
 }
 
+ServiceWorkerDatabase::Status
+ServiceWorkerDatabase::ParseFlatRegistrationData(
+    base::StringPiece serialized,
+    storage::mojom::ServiceWorkerRegistrationDataPtr* out) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(out);
+  service_worker_flat_record::RegistrationReader reader(serialized);
+  if (!reader.Init())
+    return Status::kErrorCorrupted;
+
+  if (reader.registration_id() >= next_avail_registration_id_ ||
+      reader.version_id() >= next_avail_version_id_) {
+    // The stored registration should not have the higher registration id or
+    // version id than the next available id.
+    DLOG(ERROR) << "Registration id " << reader.registration_id()
+                << " and/or version id " << reader.version_id()
+                << " is higher than the next available id.";
+    return Status::kErrorCorrupted;
+  }
+
+  storage::mojom::ServiceWorkerRegistrationDataPtr registration;
+  if (!reader.ReadRegistration(&registration))
+    return Status::kErrorCorrupted;
+
+  if (!registration->scope.is_valid() || !registration->script.is_valid() ||
+      registration->scope.GetOrigin() != registration->script.GetOrigin()) {
+    DLOG(ERROR) << "Scope URL '" << reader.scope() << "' and/or script url '"
+                << reader.script()
+                << "' are invalid or have mismatching origins.";
+    return Status::kErrorCorrupted;
+  }
+
+  *out = std::move(registration);
+  return Status::kOk;
+}
+
 void ServiceWorkerDatabase::WriteRegistrationDataInBatch(
     const storage::mojom::ServiceWorkerRegistrationData& registration,
     leveldb::WriteBatch* batch) {
@@ -1595,6 +1727,13 @@ void ServiceWorkerDatabase::WriteRegistrationDataInBatch(
   DCHECK_GT(next_avail_registration_id_, registration.registration_id);
   DCHECK_GT(next_avail_version_id_, registration.version_id);
 
+  if (FlatRecordsEnabled()) {
+    batch->Put(CreateRegistrationKey(registration.registration_id,
+                                     registration.scope.GetOrigin()),
+               service_worker_flat_record::EncodeRegistration(registration));
+    return;
+  }
+
   // Convert RegistrationData to ServiceWorkerRegistrationData.
   ServiceWorkerRegistrationData data;
   data.set_registration_id(registration.registration_id);
@@ -1691,7 +1830,9 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::ReadResourceRecords(
         break;
 
       storage::mojom::ServiceWorkerResourceRecordPtr resource;
-      status = ParseResourceRecord(itr->value().ToString(), &resource);
+      status = ParseResourceRecord(
+          base::StringPiece(itr->value().data(), itr->value().size()),
+          &resource);
       if (status != Status::kOk) {
         resources->clear();
         break;
@@ -1717,12 +1858,15 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::ReadResourceRecords(
 }
 
 ServiceWorkerDatabase::Status ServiceWorkerDatabase::ParseResourceRecord(
-    const std::string& serialized,
+    base::StringPiece serialized,
     storage::mojom::ServiceWorkerResourceRecordPtr* out) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
   DCHECK(out);
+  if (service_worker_flat_record::IsFlatRecord(serialized))
+    return ParseFlatResourceRecord(serialized, out);
+
   ServiceWorkerResourceRecord record;
-  if (!record.ParseFromString(serialized))
+  if (!record.ParseFromArray(serialized.data(), serialized.size()))
     return Status::kErrorCorrupted;
 
   GURL url(record.url());
@@ -1743,6 +1887,32 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::ParseResourceRecord(
   return Status::kOk;
 }
 
+ServiceWorkerDatabase::Status ServiceWorkerDatabase::ParseFlatResourceRecord(
+    base::StringPiece serialized,
+    storage::mojom::ServiceWorkerResourceRecordPtr* out) {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK(out);
+  service_worker_flat_record::ResourceReader reader(serialized);
+  if (!reader.Init())
+    return Status::kErrorCorrupted;
+
+  GURL url(reader.url());
+  if (!url.is_valid())
+    return Status::kErrorCorrupted;
+
+  if (reader.resource_id() >= next_avail_resource_id_) {
+    // The stored resource should not have a higher resource id than the next
+    // available resource id.
+    return Status::kErrorCorrupted;
+  }
+
+  *out = storage::mojom::ServiceWorkerResourceRecord::New();
+  (*out)->resource_id = reader.resource_id();
+  (*out)->url = std::move(url);
+  (*out)->size_bytes = reader.size_bytes();
+  return Status::kOk;
+}
+
 void ServiceWorkerDatabase::WriteResourceRecordInBatch(
     const storage::mojom::ServiceWorkerResourceRecord& resource,
     int64_t version_id,
@@ -1759,6 +1929,12 @@ void ServiceWorkerDatabase::WriteResourceRecordInBatch(
   // uncommitted resource ids before writing a registration.
   BumpNextResourceIdIfNeeded(resource.resource_id, batch);
 
+  if (FlatRecordsEnabled()) {
+    batch->Put(CreateResourceRecordKey(version_id, resource.resource_id),
+               service_worker_flat_record::EncodeResource(resource));
+    return;
+  }
+
   // Convert ResourceRecord to ServiceWorkerResourceRecord.
   ServiceWorkerResourceRecord data;
   data.set_resource_id(resource.resource_id);
@@ -1958,6 +2134,80 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::ReadDatabaseVersion(
   return status;
 }
 
+ServiceWorkerDatabase::Status ServiceWorkerDatabase::UpgradeToFlatRecords() {
+  DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  DCHECK_EQ(DATABASE_STATE_INITIALIZED, state_);
+
+  // The records are checked against the next available ids while they are
+  // parsed, so read them first.
+  Status status = ReadNextAvailableId(service_worker_internals::kNextRegIdKey,
+                                      &next_avail_registration_id_);
+  if (status != Status::kOk)
+    return status;
+  status = ReadNextAvailableId(service_worker_internals::kNextVerIdKey,
+                               &next_avail_version_id_);
+  if (status != Status::kOk)
+    return status;
+  status = ReadNextAvailableId(service_worker_internals::kNextResIdKey,
+                               &next_avail_resource_id_);
+  if (status != Status::kOk)
+    return status;
+
+  leveldb::WriteBatch batch;
+  {
+    std::unique_ptr<leveldb::Iterator> itr(
+        db_->NewIterator(leveldb::ReadOptions()));
+    for (itr->Seek(service_worker_internals::kRegKeyPrefix); itr->Valid();
+         itr->Next()) {
+      status = LevelDBStatusToServiceWorkerDBStatus(itr->status());
+      if (status != Status::kOk)
+        break;
+
+      const std::string key = itr->key().ToString();
+      if (!RemovePrefix(key, service_worker_internals::kRegKeyPrefix, nullptr))
+        break;
+
+      storage::mojom::ServiceWorkerRegistrationDataPtr registration;
+      status = ParseRegistrationData(
+          base::StringPiece(itr->value().data(), itr->value().size()),
+          &registration);
+      if (status != Status::kOk)
+        break;
+      batch.Put(key,
+                service_worker_flat_record::EncodeRegistration(*registration));
+    }
+
+    for (itr->Seek(service_worker_internals::kResKeyPrefix);
+         status == Status::kOk && itr->Valid(); itr->Next()) {
+      status = LevelDBStatusToServiceWorkerDBStatus(itr->status());
+      if (status != Status::kOk)
+        break;
+
+      const std::string key = itr->key().ToString();
+      if (!RemovePrefix(key, service_worker_internals::kResKeyPrefix, nullptr))
+        break;
+
+      storage::mojom::ServiceWorkerResourceRecordPtr resource;
+      status = ParseResourceRecord(
+          base::StringPiece(itr->value().data(), itr->value().size()),
+          &resource);
+      if (status != Status::kOk)
+        break;
+      batch.Put(key, service_worker_flat_record::EncodeResource(*resource));
+    }
+  }
+
+  if (status != Status::kOk) {
+    HandleReadResult(FROM_HERE, status);
+    return status;
+  }
+
+  batch.Put(
+      service_worker_internals::kDatabaseVersionKey,
+      base::NumberToString(service_worker_internals::kCurrentSchemaVersion));
+  return WriteBatch(&batch);
+}
+
 ServiceWorkerDatabase::Status ServiceWorkerDatabase::WriteBatch(
     leveldb::WriteBatch* batch) {
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
@@ -1966,9 +2216,12 @@ ServiceWorkerDatabase::Status ServiceWorkerDatabase::WriteBatch(
 
   if (state_ == DATABASE_STATE_UNINITIALIZED) {
     // Write database default values.
-    batch->Put(
-        service_worker_internals::kDatabaseVersionKey,
-        base::NumberToString(service_worker_internals::kCurrentSchemaVersion));
+    batch->Put(service_worker_internals::kDatabaseVersionKey,
+               base::NumberToString(
+                   FlatRecordsEnabled()
+                       ? service_worker_internals::kCurrentSchemaVersion
+                       : service_worker_internals::
+                             kProtobufRecordsSchemaVersion));
     state_ = DATABASE_STATE_INITIALIZED;
   }
 
@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -19,6 +20,7 @@
 #include "base/macros.h"
 #include "base/optional.h"
 #include "base/sequence_checker.h"
+#include "base/strings/string_piece.h"
 #include "base/time/time.h"
 #include "components/services/storage/public/mojom/service_worker_database.mojom.h"
 #include "components/services/storage/public/mojom/service_worker_storage_control.mojom.h"
@@ -102,6 +104,12 @@ class CONTENT_EXPORT ServiceWorkerDatabase {
       std::vector<storage::mojom::ServiceWorkerRegistrationDataPtr>*
           registrations);
 
+  // Reads the scopes of all registrations from the database, keyed by
+  // registration id. Cheaper than GetAllRegistrations() for flat records,
+  // which are not fully decoded. Returns OK if successfully read or not
+  // found. Otherwise, returns an error.
+  Status GetAllRegistrationScopes(std::map<int64_t, GURL>* scopes);
+
   // Saving, retrieving, and updating registration data.
   // (will bump next_avail_xxxx_ids as needed)
   // (resource ids will be added/removed from the uncommitted/purgeable
@@ -297,7 +305,13 @@ class CONTENT_EXPORT ServiceWorkerDatabase {
 
   // Parses |serialized| as a RegistrationData object and pushes it into |out|.
   ServiceWorkerDatabase::Status ParseRegistrationData(
-      const std::string& serialized,
+      base::StringPiece serialized,
+      storage::mojom::ServiceWorkerRegistrationDataPtr* out);
+
+  // Same as ParseRegistrationData(), for a record in the flat layout of
+  // service_worker_flat_record.h.
+  ServiceWorkerDatabase::Status ParseFlatRegistrationData(
+      base::StringPiece serialized,
       storage::mojom::ServiceWorkerRegistrationDataPtr* out);
 
   // Populates |batch| with operations to write |registration|. It does not
@@ -315,7 +329,13 @@ class CONTENT_EXPORT ServiceWorkerDatabase {
 
   // Parses |serialized| as a ResourceRecord object and pushes it into |out|.
   ServiceWorkerDatabase::Status ParseResourceRecord(
-      const std::string& serialized,
+      base::StringPiece serialized,
+      storage::mojom::ServiceWorkerResourceRecordPtr* out);
+
+  // Same as ParseResourceRecord(), for a record in the flat layout of
+  // service_worker_flat_record.h.
+  ServiceWorkerDatabase::Status ParseFlatResourceRecord(
+      base::StringPiece serialized,
       storage::mojom::ServiceWorkerResourceRecordPtr* out);
 
   void WriteResourceRecordInBatch(
@@ -357,6 +377,11 @@ class CONTENT_EXPORT ServiceWorkerDatabase {
   // been written anything yet, sets |db_version| to 0 and returns OK.
   Status ReadDatabaseVersion(int64_t* db_version);
 
+  // Rewrites the registration and resource records of a database of schema
+  // version 2 in the flat layout, and bumps its schema version to 3. Returns
+  // OK on success. Otherwise, writes nothing and returns an error.
+  Status UpgradeToFlatRecords();
+
   // Writes a batch into the database.
   // NOTE: You must call this when you want to put something into the database
   // because this initializes the database if needed.
@@ -412,6 +437,9 @@ class CONTENT_EXPORT ServiceWorkerDatabase {
   FRIEND_TEST_ALL_PREFIXES(ServiceWorkerDatabaseTest, InvalidWebFeature);
   FRIEND_TEST_ALL_PREFIXES(ServiceWorkerDatabaseTest,
                            NoCrossOriginEmbedderPolicyValue);
+  FRIEND_TEST_ALL_PREFIXES(ServiceWorkerDatabaseTest, FlatRecords_ReadWrite);
+  FRIEND_TEST_ALL_PREFIXES(ServiceWorkerDatabaseTest,
+                           FlatRecords_UpgradeFromSchemaVersion2);
 
   DISALLOW_COPY_AND_ASSIGN(ServiceWorkerDatabase);
 };
@@ -0,0 +1,175 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/timer/elapsed_timer.h"
+#include "content/browser/service_worker/service_worker_database.h"
+#include "content/browser/service_worker/service_worker_flat_record.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "third_party/blink/public/mojom/service_worker/navigation_preload_state.mojom.h"
+#include "third_party/blink/public/mojom/web_feature/web_feature.mojom.h"
+#include "url/gurl.h"
+
+namespace content {
+namespace {
+
+using Status = ServiceWorkerDatabase::Status;
+
+constexpr char kMetricPrefixDatabase[] = "ServiceWorkerDatabase.";
+constexpr char kMetricRegistrationLoadTimeUs[] = "registration_load_time";
+constexpr char kMetricResourceListReadTimeUs[] = "resource_list_read_time";
+constexpr char kMetricScopeLoadTimeUs[] = "scope_load_time";
+
+constexpr char kOrigin[] = "https://example.com/";
+// Registrations of the origin for the registration load.
+constexpr int kRegistrationCount = 50;
+constexpr int kResourcesPerRegistration = 10;
+// Resources of the large worker for the resource list read, as for a worker
+// precaching an application shell.
+constexpr int kLargeWorkerResourceCount = 1000;
+constexpr int kPasses = 20;
+
+// Writes the registrations to read into an in-memory database, in the
+// layout selected by |flat_records|.
+class ServiceWorkerDatabasePerfTest : public testing::TestWithParam<bool> {
+ public:
+  void SetUp() override {
+    if (flat_records()) {
+      scoped_feature_list_.InitAndEnableFeature(
+          kServiceWorkerFlatDatabaseRecords);
+    } else {
+      scoped_feature_list_.InitAndDisableFeature(
+          kServiceWorkerFlatDatabaseRecords);
+    }
+    database_ = std::make_unique<ServiceWorkerDatabase>(base::FilePath());
+
+    int64_t resource_id = 1;
+    for (int i = 0; i < kRegistrationCount; ++i) {
+      WriteRegistration(i + 1, "/scope" + base::NumberToString(i) + "/",
+                        kResourcesPerRegistration, &resource_id);
+    }
+    WriteRegistration(kRegistrationCount + 1, "/large/",
+                      kLargeWorkerResourceCount, &resource_id);
+  }
+
+  bool flat_records() const { return GetParam(); }
+  const char* story() const { return flat_records() ? "flat" : "protobuf"; }
+
+ protected:
+  void WriteRegistration(int64_t id,
+                         const std::string& scope_path,
+                         int resource_count,
+                         int64_t* resource_id) {
+    const GURL origin(kOrigin);
+    storage::mojom::ServiceWorkerRegistrationData data;
+    data.registration_id = id;
+    data.version_id = id;
+    data.scope = origin.Resolve(scope_path);
+    data.script = data.scope.Resolve("sw.js");
+    data.is_active = true;
+    data.has_fetch_handler = true;
+    data.last_update_check = base::Time::Now();
+    data.script_response_time = base::Time::Now();
+    data.used_features = {blink::mojom::WebFeature::kFetch,
+                          blink::mojom::WebFeature::kBackgroundSync};
+    data.navigation_preload_state =
+        blink::mojom::NavigationPreloadState::New(true, "true");
+
+    std::vector<storage::mojom::ServiceWorkerResourceRecordPtr> resources;
+    resources.push_back(storage::mojom::ServiceWorkerResourceRecord::New(
+        (*resource_id)++, data.script, 1000));
+    for (int i = 1; i < resource_count; ++i) {
+      resources.push_back(storage::mojom::ServiceWorkerResourceRecord::New(
+          (*resource_id)++,
+          data.scope.Resolve("assets/resource" + base::NumberToString(i) +
+                             ".js"),
+          1000));
+    }
+    data.resources_total_size_bytes = 1000 * resource_count;
+
+    ServiceWorkerDatabase::DeletedVersion deleted_version;
+    ASSERT_EQ(Status::kOk,
+              database_->WriteRegistration(data, resources, &deleted_version));
+  }
+
+  base::test::ScopedFeatureList scoped_feature_list_;
+  std::unique_ptr<ServiceWorkerDatabase> database_;
+};
+
+// Loads all registrations of an origin with their resource lists, as
+// ServiceWorkerStorage does to find the registration for a client URL.
+TEST_P(ServiceWorkerDatabasePerfTest, RegistrationLoad) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixDatabase, story());
+  reporter.RegisterImportantMetric(kMetricRegistrationLoadTimeUs, "us");
+
+  base::ElapsedTimer timer;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    std::vector<storage::mojom::ServiceWorkerRegistrationDataPtr>
+        registrations;
+    std::vector<std::vector<storage::mojom::ServiceWorkerResourceRecordPtr>>
+        resources_list;
+    ASSERT_EQ(Status::kOk,
+              database_->GetRegistrationsForOrigin(
+                  GURL(kOrigin), &registrations, &resources_list));
+    ASSERT_EQ(static_cast<size_t>(kRegistrationCount + 1),
+              registrations.size());
+  }
+  reporter.AddResult(kMetricRegistrationLoadTimeUs,
+                     timer.Elapsed().InMicrosecondsF() / kPasses);
+}
+
+// Reads the resource list of a worker with many resources, as
+// ServiceWorkerStorage does to start it.
+TEST_P(ServiceWorkerDatabasePerfTest, ResourceListRead) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixDatabase, story());
+  reporter.RegisterImportantMetric(kMetricResourceListReadTimeUs, "us");
+
+  base::ElapsedTimer timer;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    storage::mojom::ServiceWorkerRegistrationDataPtr registration;
+    std::vector<storage::mojom::ServiceWorkerResourceRecordPtr> resources;
+    ASSERT_EQ(Status::kOk,
+              database_->ReadRegistration(kRegistrationCount + 1,
+                                          GURL(kOrigin), &registration,
+                                          &resources));
+    ASSERT_EQ(static_cast<size_t>(kLargeWorkerResourceCount),
+              resources.size());
+  }
+  reporter.AddResult(kMetricResourceListReadTimeUs,
+                     timer.Elapsed().InMicrosecondsF() / kPasses);
+}
+
+// Reads the scopes of all registrations, as ServiceWorkerStorage does at
+// startup when kServiceWorkerScopeTrie is enabled.
+TEST_P(ServiceWorkerDatabasePerfTest, ScopeLoad) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixDatabase, story());
+  reporter.RegisterImportantMetric(kMetricScopeLoadTimeUs, "us");
+
+  base::ElapsedTimer timer;
+  for (int pass = 0; pass < kPasses; ++pass) {
+    std::map<int64_t, GURL> scopes;
+    ASSERT_EQ(Status::kOk, database_->GetAllRegistrationScopes(&scopes));
+    ASSERT_EQ(static_cast<size_t>(kRegistrationCount + 1), scopes.size());
+  }
+  reporter.AddResult(kMetricScopeLoadTimeUs,
+                     timer.Elapsed().InMicrosecondsF() / kPasses);
+}
+
+INSTANTIATE_TEST_SUITE_P(All,
+                         ServiceWorkerDatabasePerfTest,
+                         testing::Bool());
+
+}  // namespace
+}  // namespace content
@@ -7,14 +7,18 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <map>
 #include <string>
 
 #include "base/files/file_util.h"
 #include "base/files/scoped_temp_dir.h"
 #include "base/stl_util.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
 #include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "content/browser/service_worker/service_worker_database.pb.h"
+#include "content/browser/service_worker/service_worker_flat_record.h"
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/blink/public/mojom/service_worker/service_worker_object.mojom.h"
@@ -2295,4 +2299,128 @@ TEST(ServiceWorkerDatabaseTest, NoCrossOriginEmbedderPolicyValue) {
             registration->cross_origin_embedder_policy.value);
 }
 
+TEST(ServiceWorkerDatabaseTest, FlatRecords_ReadWrite) {
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(kServiceWorkerFlatDatabaseRecords);
+  std::unique_ptr<ServiceWorkerDatabase> database(CreateDatabaseInMemory());
+
+  GURL origin("https://example.com");
+  RegistrationData data;
+  data.registration_id = 100;
+  data.scope = URL(origin, "/foo");
+  data.script = URL(origin, "/script.js");
+  data.version_id = 200;
+  data.is_active = true;
+  data.last_update_check = base::Time::Now();
+  data.script_response_time = base::Time::Now();
+  data.used_features = {blink::mojom::WebFeature::kFetch,
+                        blink::mojom::WebFeature::kBackgroundSync};
+  data.resources_total_size_bytes = 10 + 11;
+  data.cross_origin_embedder_policy = CrossOriginEmbedderPolicyRequireCorp();
+  data.cross_origin_embedder_policy.reporting_endpoint = "endpoint";
+  data.origin_trial_tokens = ServiceWorkerDatabase::FeatureToTokensMap(
+      {{"Feature", {"token1", "token2"}}});
+  data.navigation_preload_state =
+      blink::mojom::NavigationPreloadState::New(true, "header");
+
+  std::vector<ResourceRecordPtr> resources;
+  resources.push_back(CreateResource(1, data.script, 10));
+  resources.push_back(CreateResource(2, URL(origin, "/resource"), 11));
+
+  ServiceWorkerDatabase::DeletedVersion deleted_version;
+  ASSERT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->WriteRegistration(data, resources, &deleted_version));
+
+  int64_t db_version = -1;
+  ASSERT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->ReadDatabaseVersion(&db_version));
+  EXPECT_EQ(3, db_version);
+
+  std::string value;
+  ASSERT_TRUE(database->db_
+                  ->Get(leveldb::ReadOptions(),
+                        base::StringPrintf("REG:https://example.com/%c100",
+                                           '\x00'),
+                        &value)
+                  .ok());
+  EXPECT_TRUE(service_worker_flat_record::IsFlatRecord(value));
+
+  RegistrationDataPtr data_out;
+  std::vector<ResourceRecordPtr> resources_out;
+  EXPECT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->ReadRegistration(data.registration_id, origin,
+                                       &data_out, &resources_out));
+  VerifyRegistrationData(data, *data_out);
+  EXPECT_EQ(data.origin_trial_tokens, data_out->origin_trial_tokens);
+  EXPECT_TRUE(
+      data.navigation_preload_state.Equals(data_out->navigation_preload_state));
+  VerifyResourceRecords(resources, resources_out);
+
+  std::map<int64_t, GURL> scopes;
+  EXPECT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->GetAllRegistrationScopes(&scopes));
+  EXPECT_EQ((std::map<int64_t, GURL>{{data.registration_id, data.scope}}),
+            scopes);
+}
+
+TEST(ServiceWorkerDatabaseTest, FlatRecords_UpgradeFromSchemaVersion2) {
+  base::ScopedTempDir database_dir;
+  ASSERT_TRUE(database_dir.CreateUniqueTempDir());
+  std::unique_ptr<ServiceWorkerDatabase> database(
+      CreateDatabase(database_dir.GetPath()));
+
+  // Without flat records, the database gets schema version 2.
+  GURL origin("https://example.com");
+  RegistrationData data;
+  data.registration_id = 100;
+  data.scope = URL(origin, "/foo");
+  data.script = URL(origin, "/script.js");
+  data.version_id = 200;
+  data.resources_total_size_bytes = 10;
+  std::vector<ResourceRecordPtr> resources;
+  resources.push_back(CreateResource(1, data.script, 10));
+  ServiceWorkerDatabase::DeletedVersion deleted_version;
+  ASSERT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->WriteRegistration(data, resources, &deleted_version));
+  int64_t db_version = -1;
+  ASSERT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->ReadDatabaseVersion(&db_version));
+  EXPECT_EQ(2, db_version);
+
+  // Opening the database with flat records rewrites its records.
+  base::test::ScopedFeatureList scoped_feature_list;
+  scoped_feature_list.InitAndEnableFeature(kServiceWorkerFlatDatabaseRecords);
+  database.reset(CreateDatabase(database_dir.GetPath()));
+  ASSERT_EQ(ServiceWorkerDatabase::Status::kOk, database->LazyOpen(false));
+  ASSERT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->ReadDatabaseVersion(&db_version));
+  EXPECT_EQ(3, db_version);
+
+  std::string value;
+  ASSERT_TRUE(database->db_
+                  ->Get(leveldb::ReadOptions(),
+                        base::StringPrintf("RES:200%c1", '\x00'), &value)
+                  .ok());
+  EXPECT_TRUE(service_worker_flat_record::IsFlatRecord(value));
+
+  RegistrationDataPtr data_out;
+  std::vector<ResourceRecordPtr> resources_out;
+  EXPECT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->ReadRegistration(data.registration_id, origin,
+                                       &data_out, &resources_out));
+  VerifyRegistrationData(data, *data_out);
+  VerifyResourceRecords(resources, resources_out);
+
+  // Flat records are still read once the feature is disabled again.
+  scoped_feature_list.Reset();
+  database.reset(CreateDatabase(database_dir.GetPath()));
+  data_out.reset();
+  resources_out.clear();
+  EXPECT_EQ(ServiceWorkerDatabase::Status::kOk,
+            database->ReadRegistration(data.registration_id, origin,
+                                       &data_out, &resources_out));
+  VerifyRegistrationData(data, *data_out);
+  VerifyResourceRecords(resources, resources_out);
+}
+
 }  // namespace content
@@ -0,0 +1,328 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/service_worker/service_worker_flat_record.h"
+
+#include <utility>
+#include <vector>
+
+#include "base/big_endian.h"
+#include "base/containers/flat_map.h"
+#include "base/time/time.h"
+#include "services/network/public/mojom/cross_origin_embedder_policy.mojom.h"
+#include "third_party/blink/public/mojom/service_worker/navigation_preload_state.mojom.h"
+#include "third_party/blink/public/mojom/service_worker/service_worker_registration_options.mojom.h"
+#include "third_party/blink/public/mojom/web_feature/web_feature.mojom.h"
+#include "url/gurl.h"
+
+namespace content {
+
+const base::Feature kServiceWorkerFlatDatabaseRecords{
+    "ServiceWorkerFlatDatabaseRecords", base::FEATURE_DISABLED_BY_DEFAULT};
+
+namespace service_worker_flat_record {
+
+namespace {
+
+constexpr uint8_t kFlatRecordMarker = 0;
+constexpr uint8_t kLayoutVersion = 1;
+
+// Bits of the flags of a registration record.
+enum RegistrationFlags : uint8_t {
+  kIsActive = 1 << 0,
+  kHasFetchHandler = 1 << 1,
+  kNavigationPreloadEnabled = 1 << 2,
+  kHasNavigationPreloadHeader = 1 << 3,
+  kHasCoepReportingEndpoint = 1 << 4,
+  kHasCoepReportOnlyReportingEndpoint = 1 << 5,
+  kHasOriginTrialTokens = 1 << 6,
+};
+
+// The values the cross-origin embedder policies are stored as. They match
+// the values of ServiceWorkerRegistrationData in the protobuf layout.
+constexpr uint8_t kCoepNone = 0;
+constexpr uint8_t kCoepRequireCorp = 1;
+
+template <typename T>
+void AppendInt(T value, std::string* out) {
+  char buffer[sizeof(T)];
+  base::WriteBigEndian(buffer, value);
+  out->append(buffer, sizeof(T));
+}
+
+void AppendString(base::StringPiece value, std::string* out) {
+  AppendInt(static_cast<uint32_t>(value.size()), out);
+  out->append(value.data(), value.size());
+}
+
+void AppendHeader(std::string* out) {
+  AppendInt(kFlatRecordMarker, out);
+  AppendInt(kLayoutVersion, out);
+}
+
+int64_t TimeToMicroseconds(base::Time time) {
+  return time.ToDeltaSinceWindowsEpoch().InMicroseconds();
+}
+
+base::Time MicrosecondsToTime(int64_t microseconds) {
+  return base::Time::FromDeltaSinceWindowsEpoch(
+      base::TimeDelta::FromMicroseconds(microseconds));
+}
+
+uint8_t EncodeCoepValue(network::mojom::CrossOriginEmbedderPolicyValue value) {
+  return value == network::mojom::CrossOriginEmbedderPolicyValue::kRequireCorp
+             ? kCoepRequireCorp
+             : kCoepNone;
+}
+
+network::mojom::CrossOriginEmbedderPolicyValue DecodeCoepValue(uint8_t value) {
+  return value == kCoepRequireCorp
+             ? network::mojom::CrossOriginEmbedderPolicyValue::kRequireCorp
+             : network::mojom::CrossOriginEmbedderPolicyValue::kNone;
+}
+
+bool ReadHeader(base::BigEndianReader* reader) {
+  uint8_t marker;
+  uint8_t version;
+  return reader->ReadU8(&marker) && marker == kFlatRecordMarker &&
+         reader->ReadU8(&version) && version == kLayoutVersion;
+}
+
+bool ReadInt64(base::BigEndianReader* reader, int64_t* out) {
+  uint64_t value;
+  if (!reader->ReadU64(&value))
+    return false;
+  *out = static_cast<int64_t>(value);
+  return true;
+}
+
+bool ReadString(base::BigEndianReader* reader, base::StringPiece* out) {
+  uint32_t size;
+  return reader->ReadU32(&size) && reader->ReadPiece(out, size);
+}
+
+}  // namespace
+
+bool IsFlatRecord(base::StringPiece record) {
+  return !record.empty() &&
+         static_cast<uint8_t>(record[0]) == kFlatRecordMarker;
+}
+
+std::string EncodeRegistration(
+    const storage::mojom::ServiceWorkerRegistrationData& registration) {
+  const blink::mojom::NavigationPreloadState* navigation_preload_state =
+      registration.navigation_preload_state.get();
+  const network::CrossOriginEmbedderPolicy& coep =
+      registration.cross_origin_embedder_policy;
+
+  uint8_t flags = 0;
+  if (registration.is_active)
+    flags |= kIsActive;
+  if (registration.has_fetch_handler)
+    flags |= kHasFetchHandler;
+  if (navigation_preload_state) {
+    flags |= kHasNavigationPreloadHeader;
+    if (navigation_preload_state->enabled)
+      flags |= kNavigationPreloadEnabled;
+  }
+  if (coep.reporting_endpoint)
+    flags |= kHasCoepReportingEndpoint;
+  if (coep.report_only_reporting_endpoint)
+    flags |= kHasCoepReportOnlyReportingEndpoint;
+  if (registration.origin_trial_tokens)
+    flags |= kHasOriginTrialTokens;
+
+  std::string out;
+  AppendHeader(&out);
+  AppendInt(static_cast<uint64_t>(registration.registration_id), &out);
+  AppendInt(static_cast<uint64_t>(registration.version_id), &out);
+  AppendInt(static_cast<uint64_t>(registration.resources_total_size_bytes),
+            &out);
+  AppendInt(static_cast<uint64_t>(
+                TimeToMicroseconds(registration.last_update_check)),
+            &out);
+  AppendInt(static_cast<uint64_t>(
+                TimeToMicroseconds(registration.script_response_time)),
+            &out);
+  AppendInt(flags, &out);
+  AppendInt(static_cast<uint8_t>(registration.script_type), &out);
+  AppendInt(static_cast<uint8_t>(registration.update_via_cache), &out);
+  AppendInt(EncodeCoepValue(coep.value), &out);
+  AppendInt(EncodeCoepValue(coep.report_only_value), &out);
+  AppendString(registration.scope.spec(), &out);
+  AppendString(registration.script.spec(), &out);
+
+  if (navigation_preload_state)
+    AppendString(navigation_preload_state->header, &out);
+  if (coep.reporting_endpoint)
+    AppendString(*coep.reporting_endpoint, &out);
+  if (coep.report_only_reporting_endpoint)
+    AppendString(*coep.report_only_reporting_endpoint, &out);
+
+  AppendInt(static_cast<uint32_t>(registration.used_features.size()), &out);
+  for (blink::mojom::WebFeature feature : registration.used_features)
+    AppendInt(static_cast<uint32_t>(feature), &out);
+
+  if (registration.origin_trial_tokens) {
+    AppendInt(static_cast<uint32_t>(registration.origin_trial_tokens->size()),
+              &out);
+    for (const auto& feature : *registration.origin_trial_tokens) {
+      AppendString(feature.first, &out);
+      AppendInt(static_cast<uint32_t>(feature.second.size()), &out);
+      for (const std::string& token : feature.second)
+        AppendString(token, &out);
+    }
+  }
+  return out;
+}
+
+std::string EncodeResource(
+    const storage::mojom::ServiceWorkerResourceRecord& resource) {
+  const std::string& url = resource.url.spec();
+  std::string out;
+  out.reserve(2 + 2 * sizeof(uint64_t) + url.size());
+  AppendHeader(&out);
+  AppendInt(static_cast<uint64_t>(resource.resource_id), &out);
+  AppendInt(static_cast<uint64_t>(resource.size_bytes), &out);
+  out.append(url);
+  return out;
+}
+
+RegistrationReader::RegistrationReader(base::StringPiece record)
+    : record_(record) {}
+
+RegistrationReader::~RegistrationReader() = default;
+
+bool RegistrationReader::Init() {
+  base::BigEndianReader reader(record_.data(), record_.size());
+  if (!ReadHeader(&reader) || !ReadInt64(&reader, &registration_id_) ||
+      !ReadInt64(&reader, &version_id_) ||
+      !reader.ReadU64(&resources_total_size_bytes_) ||
+      !ReadInt64(&reader, &last_update_check_) ||
+      !ReadInt64(&reader, &script_response_time_) ||
+      !reader.ReadU8(&flags_) || !reader.ReadU8(&script_type_) ||
+      !reader.ReadU8(&update_via_cache_) || !reader.ReadU8(&coep_value_) ||
+      !reader.ReadU8(&coep_report_only_value_) ||
+      !ReadString(&reader, &scope_) || !ReadString(&reader, &script_)) {
+    return false;
+  }
+  rest_ = base::StringPiece(reader.ptr(), reader.remaining());
+  return true;
+}
+
+bool RegistrationReader::ReadRegistration(
+    storage::mojom::ServiceWorkerRegistrationDataPtr* out) const {
+  auto script_type = static_cast<blink::mojom::ScriptType>(script_type_);
+  auto update_via_cache =
+      static_cast<blink::mojom::ServiceWorkerUpdateViaCache>(
+          update_via_cache_);
+  if (!IsKnownEnumValue(script_type) || !IsKnownEnumValue(update_via_cache))
+    return false;
+
+  auto registration = storage::mojom::ServiceWorkerRegistrationData::New();
+  registration->registration_id = registration_id_;
+  registration->scope = GURL(scope_);
+  registration->script = GURL(script_);
+  registration->version_id = version_id_;
+  registration->is_active = flags_ & kIsActive;
+  registration->has_fetch_handler = flags_ & kHasFetchHandler;
+  registration->last_update_check = MicrosecondsToTime(last_update_check_);
+  registration->script_response_time =
+      MicrosecondsToTime(script_response_time_);
+  registration->resources_total_size_bytes = resources_total_size_bytes_;
+  registration->script_type = script_type;
+  registration->update_via_cache = update_via_cache;
+  registration->cross_origin_embedder_policy.value =
+      DecodeCoepValue(coep_value_);
+  registration->cross_origin_embedder_policy.report_only_value =
+      DecodeCoepValue(coep_report_only_value_);
+
+  base::BigEndianReader reader(rest_.data(), rest_.size());
+  base::StringPiece piece;
+
+  registration->navigation_preload_state =
+      blink::mojom::NavigationPreloadState::New();
+  registration->navigation_preload_state->enabled =
+      flags_ & kNavigationPreloadEnabled;
+  if (flags_ & kHasNavigationPreloadHeader) {
+    if (!ReadString(&reader, &piece))
+      return false;
+    registration->navigation_preload_state->header = piece.as_string();
+  }
+  if (flags_ & kHasCoepReportingEndpoint) {
+    if (!ReadString(&reader, &piece))
+      return false;
+    registration->cross_origin_embedder_policy.reporting_endpoint =
+        piece.as_string();
+  }
+  if (flags_ & kHasCoepReportOnlyReportingEndpoint) {
+    if (!ReadString(&reader, &piece))
+      return false;
+    registration->cross_origin_embedder_policy.report_only_reporting_endpoint =
+        piece.as_string();
+  }
+
+  uint32_t feature_count;
+  if (!reader.ReadU32(&feature_count) ||
+      feature_count > reader.remaining() / sizeof(uint32_t)) {
+    return false;
+  }
+  registration->used_features.reserve(feature_count);
+  for (uint32_t i = 0; i < feature_count; ++i) {
+    uint32_t feature;
+    if (!reader.ReadU32(&feature))
+      return false;
+    auto web_feature = static_cast<blink::mojom::WebFeature>(feature);
+    if (IsKnownEnumValue(web_feature))
+      registration->used_features.push_back(web_feature);
+  }
+
+  if (flags_ & kHasOriginTrialTokens) {
+    std::vector<std::pair<std::string, std::vector<std::string>>> features;
+    uint32_t trial_feature_count;
+    if (!reader.ReadU32(&trial_feature_count))
+      return false;
+    for (uint32_t i = 0; i < trial_feature_count; ++i) {
+      uint32_t token_count;
+      if (!ReadString(&reader, &piece) || !reader.ReadU32(&token_count))
+        return false;
+      std::vector<std::string> tokens;
+      for (uint32_t j = 0; j < token_count; ++j) {
+        base::StringPiece token;
+        if (!ReadString(&reader, &token))
+          return false;
+        tokens.push_back(token.as_string());
+      }
+      features.emplace_back(piece.as_string(), std::move(tokens));
+    }
+    registration->origin_trial_tokens =
+        base::flat_map<std::string, std::vector<std::string>>(
+            std::move(features));
+  }
+
+  // Trailing bytes mean that the record is not what it claims to be.
+  if (reader.remaining() != 0)
+    return false;
+
+  *out = std::move(registration);
+  return true;
+}
+
+ResourceReader::ResourceReader(base::StringPiece record) : record_(record) {}
+
+ResourceReader::~ResourceReader() = default;
+
+bool ResourceReader::Init() {
+  base::BigEndianReader reader(record_.data(), record_.size());
+  if (!ReadHeader(&reader) || !ReadInt64(&reader, &resource_id_) ||
+      !ReadInt64(&reader, &size_bytes_)) {
+    return false;
+  }
+  url_ = base::StringPiece(reader.ptr(), reader.remaining());
+  return true;
+}
+
+}  // namespace service_worker_flat_record
+
+}  // namespace content
@@ -0,0 +1,154 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_FLAT_RECORD_H_
+#define CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_FLAT_RECORD_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/feature_list.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+#include "components/services/storage/public/mojom/service_worker_database.mojom.h"
+#include "content/common/content_export.h"
+
+namespace content {
+
+// Makes ServiceWorkerDatabase write registration and resource records in the
+// flat layout below instead of as protobufs, and migrate the records it has
+// to it. Disabled by default.
+CONTENT_EXPORT extern const base::Feature kServiceWorkerFlatDatabaseRecords;
+
+// Flat layout of the registration and resource records of
+// ServiceWorkerDatabase. Unlike protobufs, the records are read in place: the
+// fixed-size fields are at fixed offsets and strings are read as pieces of
+// the record, so looking at a few fields of a record costs no more than
+// finding them.
+//
+// A flat record starts with a zero byte, which cannot start a protobuf since
+// field number 0 is invalid, and the version of the layout. Integers are big
+// endian, and strings are prefixed with their uint32_t length.
+//
+// Registration record, layout version 1:
+//   uint8_t  0
+//   uint8_t  1
+//   int64_t  registration_id
+//   int64_t  version_id
+//   uint64_t resources_total_size_bytes
+//   int64_t  last_update_check, in microseconds since the Windows epoch
+//   int64_t  script_response_time, in microseconds since the Windows epoch
+//   uint8_t  flags, see RegistrationFlags in the .cc file
+//   uint8_t  script_type
+//   uint8_t  update_via_cache
+//   uint8_t  cross_origin_embedder_policy.value
+//   uint8_t  cross_origin_embedder_policy.report_only_value
+//   string   scope
+//   string   script
+//   -- The fields above are read by RegistrationReader::Init(). --
+//   string   navigation_preload_state.header, if flagged
+//   string   cross_origin_embedder_policy.reporting_endpoint, if flagged
+//   string   cross_origin_embedder_policy.report_only_reporting_endpoint, if
+//            flagged
+//   uint32_t number of used features, followed by the features as uint32_t
+//   uint32_t number of origin trial features, if flagged, each followed by
+//            its string name, the uint32_t number of its tokens and the
+//            string tokens
+//
+// Resource record, layout version 1:
+//   uint8_t  0
+//   uint8_t  1
+//   int64_t  resource_id
+//   int64_t  size_bytes
+//   bytes    url, up to the end of the record
+namespace service_worker_flat_record {
+
+// Returns true if |record| is a flat record rather than a protobuf. It may
+// still be malformed.
+CONTENT_EXPORT bool IsFlatRecord(base::StringPiece record);
+
+CONTENT_EXPORT std::string EncodeRegistration(
+    const storage::mojom::ServiceWorkerRegistrationData& registration);
+
+CONTENT_EXPORT std::string EncodeResource(
+    const storage::mojom::ServiceWorkerResourceRecord& resource);
+
+// Reads a flat registration record in place. The record must outlive the
+// reader.
+class CONTENT_EXPORT RegistrationReader {
+ public:
+  explicit RegistrationReader(base::StringPiece record);
+  ~RegistrationReader();
+
+  // Reads the fields up to the script URL. Returns false if the record is
+  // malformed or of an unknown layout version. The accessors below must only
+  // be called after this returned true.
+  bool Init();
+
+  int64_t registration_id() const { return registration_id_; }
+  int64_t version_id() const { return version_id_; }
+  uint64_t resources_total_size_bytes() const {
+    return resources_total_size_bytes_;
+  }
+  base::StringPiece scope() const { return scope_; }
+  base::StringPiece script() const { return script_; }
+
+  // Decodes the whole record into |out|, leaving out the used features that
+  // are not known WebFeature values, as ServiceWorkerDatabase does for
+  // protobufs. Returns false if the record is malformed. The URLs are not
+  // checked.
+  bool ReadRegistration(
+      storage::mojom::ServiceWorkerRegistrationDataPtr* out) const;
+
+ private:
+  const base::StringPiece record_;
+
+  int64_t registration_id_ = 0;
+  int64_t version_id_ = 0;
+  uint64_t resources_total_size_bytes_ = 0;
+  int64_t last_update_check_ = 0;
+  int64_t script_response_time_ = 0;
+  uint8_t flags_ = 0;
+  uint8_t script_type_ = 0;
+  uint8_t update_via_cache_ = 0;
+  uint8_t coep_value_ = 0;
+  uint8_t coep_report_only_value_ = 0;
+  base::StringPiece scope_;
+  base::StringPiece script_;
+  // The part of |record_| after the script URL.
+  base::StringPiece rest_;
+
+  DISALLOW_COPY_AND_ASSIGN(RegistrationReader);
+};
+
+// Reads a flat resource record in place. The record must outlive the reader.
+class CONTENT_EXPORT ResourceReader {
+ public:
+  explicit ResourceReader(base::StringPiece record);
+  ~ResourceReader();
+
+  // Returns false if the record is malformed or of an unknown layout version.
+  // The accessors below must only be called after this returned true.
+  bool Init();
+
+  int64_t resource_id() const { return resource_id_; }
+  int64_t size_bytes() const { return size_bytes_; }
+  base::StringPiece url() const { return url_; }
+
+ private:
+  const base::StringPiece record_;
+
+  int64_t resource_id_ = 0;
+  int64_t size_bytes_ = 0;
+  base::StringPiece url_;
+
+  DISALLOW_COPY_AND_ASSIGN(ResourceReader);
+};
+
+}  // namespace service_worker_flat_record
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_FLAT_RECORD_H_
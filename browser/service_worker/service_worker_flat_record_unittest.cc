@@ -0,0 +1,147 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/service_worker/service_worker_flat_record.h"
+
+#include <string>
+#include <vector>
+
+#include "base/containers/flat_map.h"
+#include "base/time/time.h"
+#include "content/browser/service_worker/service_worker_database.pb.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/mojom/service_worker/navigation_preload_state.mojom.h"
+#include "third_party/blink/public/mojom/web_feature/web_feature.mojom.h"
+#include "url/gurl.h"
+
+namespace content {
+
+namespace service_worker_flat_record {
+
+namespace {
+
+storage::mojom::ServiceWorkerRegistrationDataPtr CreateRegistration() {
+  auto registration = storage::mojom::ServiceWorkerRegistrationData::New();
+  registration->registration_id = 1;
+  registration->scope = GURL("https://example.com/scope/");
+  registration->script = GURL("https://example.com/scope/sw.js");
+  registration->version_id = 2;
+  registration->is_active = true;
+  registration->has_fetch_handler = true;
+  registration->last_update_check =
+      base::Time::FromDeltaSinceWindowsEpoch(base::TimeDelta::FromDays(1));
+  registration->script_response_time =
+      base::Time::FromDeltaSinceWindowsEpoch(base::TimeDelta::FromDays(2));
+  registration->resources_total_size_bytes = 12345;
+  registration->used_features = {blink::mojom::WebFeature::kFetch,
+                                 blink::mojom::WebFeature::kNetInfoType};
+  registration->script_type = blink::mojom::ScriptType::kModule;
+  registration->update_via_cache =
+      blink::mojom::ServiceWorkerUpdateViaCache::kAll;
+  registration->navigation_preload_state =
+      blink::mojom::NavigationPreloadState::New(true, "header");
+  registration->cross_origin_embedder_policy.value =
+      network::mojom::CrossOriginEmbedderPolicyValue::kRequireCorp;
+  registration->cross_origin_embedder_policy.report_only_reporting_endpoint =
+      "endpoint";
+  registration->origin_trial_tokens =
+      base::flat_map<std::string, std::vector<std::string>>(
+          {{"Feature1", {"token1", "token2"}}, {"Feature2", {}}});
+  return registration;
+}
+
+}  // namespace
+
+TEST(ServiceWorkerFlatRecordTest, Registration) {
+  storage::mojom::ServiceWorkerRegistrationDataPtr registration =
+      CreateRegistration();
+  std::string record = EncodeRegistration(*registration);
+  EXPECT_TRUE(IsFlatRecord(record));
+
+  RegistrationReader reader(record);
+  ASSERT_TRUE(reader.Init());
+  EXPECT_EQ(1, reader.registration_id());
+  EXPECT_EQ(2, reader.version_id());
+  EXPECT_EQ(12345u, reader.resources_total_size_bytes());
+  EXPECT_EQ("https://example.com/scope/", reader.scope());
+  EXPECT_EQ("https://example.com/scope/sw.js", reader.script());
+
+  storage::mojom::ServiceWorkerRegistrationDataPtr out;
+  ASSERT_TRUE(reader.ReadRegistration(&out));
+  EXPECT_TRUE(registration.Equals(out));
+
+  // Optional fields are left out.
+  registration->navigation_preload_state = nullptr;
+  registration->cross_origin_embedder_policy =
+      network::CrossOriginEmbedderPolicy();
+  registration->origin_trial_tokens = base::nullopt;
+  registration->used_features.clear();
+  record = EncodeRegistration(*registration);
+  RegistrationReader short_reader(record);
+  ASSERT_TRUE(short_reader.Init());
+  ASSERT_TRUE(short_reader.ReadRegistration(&out));
+  EXPECT_TRUE(blink::mojom::NavigationPreloadState::New().Equals(
+      out->navigation_preload_state));
+  EXPECT_FALSE(out->origin_trial_tokens);
+  EXPECT_EQ(network::CrossOriginEmbedderPolicy(),
+            out->cross_origin_embedder_policy);
+  EXPECT_TRUE(out->used_features.empty());
+}
+
+TEST(ServiceWorkerFlatRecordTest, Resource) {
+  auto resource = storage::mojom::ServiceWorkerResourceRecord::New(
+      42, GURL("https://example.com/script.js"), 100);
+  std::string record = EncodeResource(*resource);
+  EXPECT_TRUE(IsFlatRecord(record));
+
+  ResourceReader reader(record);
+  ASSERT_TRUE(reader.Init());
+  EXPECT_EQ(42, reader.resource_id());
+  EXPECT_EQ(100, reader.size_bytes());
+  EXPECT_EQ("https://example.com/script.js", reader.url());
+}
+
+TEST(ServiceWorkerFlatRecordTest, Protobuf) {
+  ServiceWorkerResourceRecord record;
+  record.set_resource_id(1);
+  record.set_url("https://example.com/script.js");
+  record.set_size_bytes(100);
+  std::string value;
+  ASSERT_TRUE(record.SerializeToString(&value));
+  EXPECT_FALSE(IsFlatRecord(value));
+  EXPECT_FALSE(ResourceReader(value).Init());
+  EXPECT_FALSE(IsFlatRecord(std::string()));
+}
+
+TEST(ServiceWorkerFlatRecordTest, Malformed) {
+  const std::string record = EncodeRegistration(*CreateRegistration());
+  storage::mojom::ServiceWorkerRegistrationDataPtr out;
+
+  // Every truncation of the record is rejected, either by Init() or by
+  // ReadRegistration().
+  for (size_t size = 0; size < record.size(); ++size) {
+    RegistrationReader reader(base::StringPiece(record.data(), size));
+    EXPECT_FALSE(reader.Init() && reader.ReadRegistration(&out)) << size;
+  }
+
+  // So are trailing bytes.
+  {
+    const std::string longer = record + "x";
+    RegistrationReader reader(longer);
+    ASSERT_TRUE(reader.Init());
+    EXPECT_FALSE(reader.ReadRegistration(&out));
+  }
+
+  // So is an unknown layout version.
+  {
+    std::string newer = record;
+    newer[1] = 2;
+    EXPECT_TRUE(IsFlatRecord(newer));
+    EXPECT_FALSE(RegistrationReader(newer).Init());
+  }
+}
+
+}  // namespace service_worker_flat_record
+
+}  // namespace content
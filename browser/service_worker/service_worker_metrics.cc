@@ -42,6 +42,8 @@ const char* StartSituationToSuffix(
       return ".ExistingUnreadyProcess";
     case ServiceWorkerMetrics::StartSituation::EXISTING_READY_PROCESS:
       return ".ExistingReadyProcess";
+    case ServiceWorkerMetrics::StartSituation::WARM_POOL_PROCESS:
+      return ".WarmPoolProcess";
   }
   NOTREACHED() << static_cast<int>(situation);
   return ".Unknown";
@@ -64,6 +66,8 @@ const char* StartSituationToDeprecatedSuffix(
       return "_ExistingUnreadyProcess";
     case ServiceWorkerMetrics::StartSituation::EXISTING_READY_PROCESS:
       return "_ExistingReadyProcess";
+    case ServiceWorkerMetrics::StartSituation::WARM_POOL_PROCESS:
+      return "_WarmPoolProcess";
   }
   NOTREACHED() << static_cast<int>(situation);
   return "_Unknown";
@@ -199,6 +203,8 @@ const char* ServiceWorkerMetrics::StartSituationToString(
       return "Existing unready process";
     case StartSituation::EXISTING_READY_PROCESS:
       return "Existing ready process";
+    case StartSituation::WARM_POOL_PROCESS:
+      return "Warm pool process";
   }
   NOTREACHED() << "Got unexpected start situation: "
                << static_cast<int>(start_situation);
@@ -443,6 +449,10 @@ void ServiceWorkerMetrics::RecordProcessCreated(bool is_new_process) {
                         is_new_process);
 }
 
+void ServiceWorkerMetrics::RecordWarmPoolResult(bool hit) {
+  UMA_HISTOGRAM_BOOLEAN("ServiceWorker.WarmPool.Hit", hit);
+}
+
 void ServiceWorkerMetrics::RecordStartWorkerTiming(const StartTimes& times,
                                                    StartSituation situation) {
   if (!ServiceWorkerContext::IsServiceWorkerOnUIEnabled()) {
@@ -570,6 +580,22 @@ void ServiceWorkerMetrics::RecordStartServiceWorkerForNavigationHintResult(
                             result);
 }
 
+void ServiceWorkerMetrics::RecordNavigationPredictionUsed(bool used) {
+  UMA_HISTOGRAM_BOOLEAN("ServiceWorker.NavigationPredictor.PredictionUsed",
+                        used);
+}
+
+void ServiceWorkerMetrics::RecordNavigationPredicted(bool predicted) {
+  UMA_HISTOGRAM_BOOLEAN("ServiceWorker.NavigationPredictor.NavigationPredicted",
+                        predicted);
+}
+
+void ServiceWorkerMetrics::RecordNavigationPredictionTimeSaved(
+    base::TimeDelta time) {
+  UMA_HISTOGRAM_MEDIUM_TIMES("ServiceWorker.NavigationPredictor.TimeSaved",
+                             time);
+}
+
 void ServiceWorkerMetrics::RecordRegisteredOriginCount(size_t origin_count) {
   UMA_HISTOGRAM_COUNTS_1M("ServiceWorker.RegisteredOriginCount", origin_count);
 }
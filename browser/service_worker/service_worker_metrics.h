@@ -131,7 +131,10 @@ class ServiceWorkerMetrics {
     // established yet.)
     EXISTING_UNREADY_PROCESS,
     // The service worker started up in an existing ready process.
-    EXISTING_READY_PROCESS
+    EXISTING_READY_PROCESS,
+    // The service worker started up in a process taken from the warm pool of
+    // ServiceWorkerProcessManager.
+    WARM_POOL_PROCESS
   };
 
   // Used for UMA. Append only.
@@ -226,6 +229,10 @@ class ServiceWorkerMetrics {
 
   static void RecordProcessCreated(bool is_new_process);
 
+  // Records whether a worker start that needed a new process got one from the
+  // warm pool.
+  static void RecordWarmPoolResult(bool hit);
+
   CONTENT_EXPORT static void RecordStartWorkerTiming(const StartTimes& times,
                                                      StartSituation situation);
   static void RecordStartWorkerTimingClockConsistency(
@@ -247,6 +254,16 @@ class ServiceWorkerMetrics {
   static void RecordStartServiceWorkerForNavigationHintResult(
       StartServiceWorkerForNavigationHintResult result);
 
+  // Records whether a worker started by ServiceWorkerNavigationPredictor was
+  // needed by the next navigation of its frame (precision).
+  static void RecordNavigationPredictionUsed(bool used);
+  // Records whether a navigation that needed a worker had it started by
+  // ServiceWorkerNavigationPredictor (recall).
+  static void RecordNavigationPredicted(bool predicted);
+  // Records how much of a worker's startup a used prediction took out of the
+  // navigation.
+  static void RecordNavigationPredictionTimeSaved(base::TimeDelta time);
+
   // Records the number of origins with a registered service worker.
   static void RecordRegisteredOriginCount(size_t origin_count);
 
@@ -0,0 +1,331 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/service_worker/service_worker_navigation_predictor.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "base/bind.h"
+#include "base/memory/memory_pressure_monitor.h"
+#include "base/trace_event/trace_event.h"
+#include "content/browser/service_worker/embedded_worker_status.h"
+#include "content/browser/service_worker/service_worker_context_core.h"
+#include "content/browser/service_worker/service_worker_metrics.h"
+#include "content/browser/service_worker/service_worker_registration.h"
+#include "content/browser/service_worker/service_worker_registry.h"
+#include "content/browser/service_worker/service_worker_version.h"
+
+namespace content {
+
+namespace {
+
+// An origin's transitions are only used once this many navigations away from
+// it were seen.
+constexpr int kMinNavigationCount = 3;
+
+// Bounds on the memory the predictor uses. The least recently used entries
+// are dropped first.
+constexpr size_t kMaxOriginCount = 256;
+constexpr size_t kMaxScopesPerOrigin = 8;
+constexpr size_t kMaxFrameCount = 64;
+
+// The window over which kServiceWorkerNavigationPredictorStartupBudgetMs
+// applies.
+constexpr base::TimeDelta kStartupBudgetWindow =
+    base::TimeDelta::FromMinutes(1);
+
+template <typename Map>
+void EvictLeastRecentlyUsed(Map* map, size_t max_size) {
+  if (map->size() <= max_size)
+    return;
+  auto oldest = std::min_element(
+      map->begin(), map->end(), [](const auto& a, const auto& b) {
+        return a.second.last_used < b.second.last_used;
+      });
+  map->erase(oldest);
+}
+
+bool NeedsWorker(ServiceWorkerRegistration* registration) {
+  return registration && registration->active_version() &&
+         registration->active_version()->fetch_handler_existence() ==
+             ServiceWorkerVersion::FetchHandlerExistence::EXISTS;
+}
+
+}  // namespace
+
+const base::Feature kServiceWorkerNavigationPredictor{
+    "ServiceWorkerNavigationPredictor", base::FEATURE_DISABLED_BY_DEFAULT};
+const base::FeatureParam<double>
+    kServiceWorkerNavigationPredictorMinProbability{
+        &kServiceWorkerNavigationPredictor, "min_probability", 0.3};
+const base::FeatureParam<int> kServiceWorkerNavigationPredictorMaxStarts{
+    &kServiceWorkerNavigationPredictor, "max_starts", 2};
+const base::FeatureParam<int>
+    kServiceWorkerNavigationPredictorMaxRunningWorkers{
+        &kServiceWorkerNavigationPredictor, "max_running_workers", 8};
+const base::FeatureParam<int> kServiceWorkerNavigationPredictorStartupBudgetMs{
+    &kServiceWorkerNavigationPredictor, "startup_budget_ms", 3000};
+
+ServiceWorkerNavigationPredictor::Transitions::Transitions() = default;
+ServiceWorkerNavigationPredictor::Transitions::Transitions(
+    const Transitions& other) = default;
+ServiceWorkerNavigationPredictor::Transitions::~Transitions() = default;
+
+ServiceWorkerNavigationPredictor::FrameState::FrameState() = default;
+ServiceWorkerNavigationPredictor::FrameState::FrameState(
+    const FrameState& other) = default;
+ServiceWorkerNavigationPredictor::FrameState::~FrameState() = default;
+
+ServiceWorkerNavigationPredictor::ServiceWorkerNavigationPredictor(
+    ServiceWorkerContextCore* context)
+    : context_(context) {}
+
+ServiceWorkerNavigationPredictor::~ServiceWorkerNavigationPredictor() = default;
+
+void ServiceWorkerNavigationPredictor::OnMainFrameRegistrationLookup(
+    int frame_tree_node_id,
+    ServiceWorkerRegistration* registration) {
+  FrameState& frame = GetFrameState(frame_tree_node_id);
+  frame.has_pending_navigation = true;
+  frame.pending_scope = NeedsWorker(registration) ? registration->scope()
+                                                  : GURL();
+  frame.pending_lookup_time = base::TimeTicks::Now();
+}
+
+void ServiceWorkerNavigationPredictor::OnNavigationCommitted(
+    int frame_tree_node_id,
+    const GURL& url) {
+  auto found = frames_.find(frame_tree_node_id);
+  if (found == frames_.end() || !found->second.has_pending_navigation)
+    return;
+  FrameState& frame = found->second;
+  frame.last_used = ++use_counter_;
+
+  RecordResults(frame);
+  if (frame.origin)
+    Learn(*frame.origin, frame.pending_scope);
+
+  frame.predictions.clear();
+  frame.has_pending_navigation = false;
+  frame.pending_scope = GURL();
+  frame.origin = url::Origin::Create(url);
+  frame.navigation_sequence = ++last_navigation_sequence_;
+  StartWorkers(frame_tree_node_id, frame.navigation_sequence, *frame.origin);
+}
+
+std::vector<GURL> ServiceWorkerNavigationPredictor::PredictScopes(
+    const url::Origin& origin) const {
+  auto found = transitions_.find(origin);
+  if (found == transitions_.end() ||
+      found->second.navigation_count < kMinNavigationCount) {
+    return {};
+  }
+  const Transitions& transitions = found->second;
+
+  std::vector<std::pair<int, GURL>> candidates;
+  for (const auto& scope_count : transitions.scope_counts) {
+    double probability = static_cast<double>(scope_count.second) /
+                         transitions.navigation_count;
+    if (probability >= kServiceWorkerNavigationPredictorMinProbability.Get())
+      candidates.emplace_back(scope_count.second, scope_count.first);
+  }
+  std::stable_sort(
+      candidates.begin(), candidates.end(),
+      [](const auto& a, const auto& b) { return a.first > b.first; });
+
+  size_t max_starts = static_cast<size_t>(
+      std::max(kServiceWorkerNavigationPredictorMaxStarts.Get(), 0));
+  if (candidates.size() > max_starts)
+    candidates.resize(max_starts);
+
+  std::vector<GURL> scopes;
+  for (const auto& candidate : candidates)
+    scopes.push_back(candidate.second);
+  return scopes;
+}
+
+ServiceWorkerNavigationPredictor::FrameState&
+ServiceWorkerNavigationPredictor::GetFrameState(int frame_tree_node_id) {
+  auto inserted = frames_.emplace(frame_tree_node_id, FrameState());
+  inserted.first->second.last_used = ++use_counter_;
+  if (inserted.second)
+    EvictLeastRecentlyUsed(&frames_, kMaxFrameCount);
+  return frames_[frame_tree_node_id];
+}
+
+void ServiceWorkerNavigationPredictor::RecordResults(const FrameState& frame) {
+  bool predicted = false;
+  for (const Prediction& prediction : frame.predictions) {
+    bool used = prediction.scope == frame.pending_scope;
+    ServiceWorkerMetrics::RecordNavigationPredictionUsed(used);
+    if (!used)
+      continue;
+    predicted = true;
+    // The navigation needed the worker at the lookup, so only the part of
+    // the startup before it was saved.
+    base::TimeTicks end = frame.pending_lookup_time;
+    if (!prediction.ready_time.is_null())
+      end = std::min(end, prediction.ready_time);
+    ServiceWorkerMetrics::RecordNavigationPredictionTimeSaved(
+        std::max(base::TimeDelta(), end - prediction.start_time));
+  }
+  if (!frame.pending_scope.is_empty())
+    ServiceWorkerMetrics::RecordNavigationPredicted(predicted);
+}
+
+void ServiceWorkerNavigationPredictor::Learn(const url::Origin& origin,
+                                             const GURL& scope) {
+  auto inserted = transitions_.emplace(origin, Transitions());
+  Transitions& transitions = inserted.first->second;
+  transitions.last_used = ++use_counter_;
+  ++transitions.navigation_count;
+  if (!scope.is_empty()) {
+    ++transitions.scope_counts[scope];
+    if (transitions.scope_counts.size() > kMaxScopesPerOrigin) {
+      // Drop the least frequent scope other than the one just counted.
+      auto rarest = transitions.scope_counts.end();
+      for (auto it = transitions.scope_counts.begin();
+           it != transitions.scope_counts.end(); ++it) {
+        if (it->first != scope && (rarest == transitions.scope_counts.end() ||
+                                   it->second < rarest->second)) {
+          rarest = it;
+        }
+      }
+      transitions.scope_counts.erase(rarest);
+    }
+  }
+  if (inserted.second)
+    EvictLeastRecentlyUsed(&transitions_, kMaxOriginCount);
+}
+
+base::TimeDelta ServiceWorkerNavigationPredictor::GetRecentStartupTime() {
+  base::TimeTicks window_start = base::TimeTicks::Now() - kStartupBudgetWindow;
+  while (!recent_startup_times_.empty() &&
+         recent_startup_times_.front().first < window_start) {
+    recent_startup_times_.pop_front();
+  }
+  base::TimeDelta total;
+  for (const auto& startup_time : recent_startup_times_)
+    total += startup_time.second;
+  return total;
+}
+
+bool ServiceWorkerNavigationPredictor::CanStartWorkers() {
+  if (!context_ || starting_worker_count_ > 0)
+    return false;
+
+  if (GetRecentStartupTime() >=
+      base::TimeDelta::FromMilliseconds(
+          kServiceWorkerNavigationPredictorStartupBudgetMs.Get())) {
+    return false;
+  }
+
+  auto* memory_monitor = base::MemoryPressureMonitor::Get();
+  if (memory_monitor &&
+      memory_monitor->GetCurrentPressureLevel() >=
+          base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE) {
+    return false;
+  }
+
+  int running_worker_count = 0;
+  for (const auto& version : context_->GetLiveVersions()) {
+    if (version.second->running_status() != EmbeddedWorkerStatus::STOPPED)
+      ++running_worker_count;
+  }
+  return running_worker_count <
+         kServiceWorkerNavigationPredictorMaxRunningWorkers.Get();
+}
+
+void ServiceWorkerNavigationPredictor::StartWorkers(
+    int frame_tree_node_id,
+    uint64_t navigation_sequence,
+    const url::Origin& origin) {
+  if (!CanStartWorkers())
+    return;
+  for (const GURL& scope : PredictScopes(origin)) {
+    TRACE_EVENT1("ServiceWorker",
+                 "ServiceWorkerNavigationPredictor::StartWorkers", "scope",
+                 scope.spec());
+    ++starting_worker_count_;
+    context_->registry()->FindRegistrationForScope(
+        scope,
+        base::BindOnce(&ServiceWorkerNavigationPredictor::DidFindRegistration,
+                       weak_factory_.GetWeakPtr(), frame_tree_node_id,
+                       navigation_sequence));
+  }
+}
+
+ServiceWorkerNavigationPredictor::FrameState*
+ServiceWorkerNavigationPredictor::GetCurrentFrameState(
+    int frame_tree_node_id,
+    uint64_t navigation_sequence) {
+  auto found = frames_.find(frame_tree_node_id);
+  if (found == frames_.end() ||
+      found->second.navigation_sequence != navigation_sequence) {
+    return nullptr;
+  }
+  return &found->second;
+}
+
+void ServiceWorkerNavigationPredictor::DidFindRegistration(
+    int frame_tree_node_id,
+    uint64_t navigation_sequence,
+    blink::ServiceWorkerStatusCode status,
+    scoped_refptr<ServiceWorkerRegistration> registration) {
+  // The frame navigated again while looking up, so the worker was predicted
+  // for a navigation that already happened.
+  FrameState* frame =
+      GetCurrentFrameState(frame_tree_node_id, navigation_sequence);
+  if (!frame || status != blink::ServiceWorkerStatusCode::kOk ||
+      !NeedsWorker(registration.get()) ||
+      registration->active_version()->running_status() !=
+          EmbeddedWorkerStatus::STOPPED) {
+    --starting_worker_count_;
+    return;
+  }
+
+  Prediction prediction;
+  prediction.scope = registration->scope();
+  prediction.start_time = base::TimeTicks::Now();
+  frame->predictions.push_back(prediction);
+  registration->active_version()->StartWorker(
+      ServiceWorkerMetrics::EventType::NAVIGATION_HINT,
+      base::BindOnce(&ServiceWorkerNavigationPredictor::DidStartWorker,
+                     weak_factory_.GetWeakPtr(), frame_tree_node_id,
+                     navigation_sequence, prediction.scope,
+                     prediction.start_time));
+}
+
+void ServiceWorkerNavigationPredictor::DidStartWorker(
+    int frame_tree_node_id,
+    uint64_t navigation_sequence,
+    const GURL& scope,
+    base::TimeTicks start_time,
+    blink::ServiceWorkerStatusCode status) {
+  --starting_worker_count_;
+  // Charged even if the prediction is stale or failed, as the CPU was spent
+  // all the same.
+  base::TimeTicks now = base::TimeTicks::Now();
+  recent_startup_times_.emplace_back(now, now - start_time);
+
+  FrameState* frame =
+      GetCurrentFrameState(frame_tree_node_id, navigation_sequence);
+  if (!frame)
+    return;
+  std::vector<Prediction>& predictions = frame->predictions;
+  auto prediction = std::find_if(
+      predictions.begin(), predictions.end(),
+      [&scope](const Prediction& p) { return p.scope == scope; });
+  if (prediction == predictions.end())
+    return;
+  if (status != blink::ServiceWorkerStatusCode::kOk) {
+    // Failed starts are neither right nor wrong predictions.
+    predictions.erase(prediction);
+    return;
+  }
+  prediction->ready_time = now;
+}
+
+}  // namespace content
@@ -0,0 +1,180 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_NAVIGATION_PREDICTOR_H_
+#define CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_NAVIGATION_PREDICTOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "base/containers/circular_deque.h"
+#include "base/feature_list.h"
+#include "base/macros.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/memory/weak_ptr.h"
+#include "base/metrics/field_trial_params.h"
+#include "base/optional.h"
+#include "base/time/time.h"
+#include "content/common/content_export.h"
+#include "third_party/blink/public/common/service_worker/service_worker_status_code.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+
+namespace content {
+
+class ServiceWorkerContextCore;
+class ServiceWorkerRegistration;
+
+// Starts service workers ahead of the navigations that are predicted to need
+// them, based on the navigations seen so far. Disabled by default.
+CONTENT_EXPORT extern const base::Feature kServiceWorkerNavigationPredictor;
+// A worker is only started if at least this fraction of the navigations away
+// from the current origin went to its scope.
+CONTENT_EXPORT extern const base::FeatureParam<double>
+    kServiceWorkerNavigationPredictorMinProbability;
+// The most workers started after one navigation.
+CONTENT_EXPORT extern const base::FeatureParam<int>
+    kServiceWorkerNavigationPredictorMaxStarts;
+// No worker is started while this many workers are running.
+CONTENT_EXPORT extern const base::FeatureParam<int>
+    kServiceWorkerNavigationPredictorMaxRunningWorkers;
+// No worker is started once predicted starts took this many milliseconds in
+// total over the last minute. Startup time stands in for the CPU they use.
+CONTENT_EXPORT extern const base::FeatureParam<int>
+    kServiceWorkerNavigationPredictorStartupBudgetMs;
+
+// Learns which service worker registrations follow which navigations, and
+// starts the registrations' active workers speculatively.
+//
+// For each main frame, the predictor remembers the origin of the document it
+// committed. The registration that ServiceWorkerControlleeRequestHandler
+// finds for the frame's next navigation is counted as a transition from that
+// origin once the navigation commits. Right after a commit, the workers of
+// the scopes that the committed origin most often transitions to are started
+// with ServiceWorkerVersion::StartWorker(), as a navigation hint would. A
+// worker that ends up unused stops on its idle timeout.
+//
+// Predictions are not made under memory pressure, while many workers are
+// running, while earlier predicted starts are still in progress, or once
+// predicted starts used up their startup time budget.
+//
+// Precision, recall, and the startup time taken out of navigations are
+// recorded by ServiceWorkerMetrics when the next navigation commits.
+//
+// Lives on the service worker core thread and is owned by
+// ServiceWorkerContextCore. Nothing is persisted.
+class CONTENT_EXPORT ServiceWorkerNavigationPredictor {
+ public:
+  // |context| may be null in tests, in which case no worker is started.
+  explicit ServiceWorkerNavigationPredictor(ServiceWorkerContextCore* context);
+  ~ServiceWorkerNavigationPredictor();
+
+  // Called when the registration lookup for a main frame navigation in
+  // |frame_tree_node_id| completes. |registration| is null if none matched.
+  // Called again on redirects; the last lookup counts.
+  void OnMainFrameRegistrationLookup(int frame_tree_node_id,
+                                     ServiceWorkerRegistration* registration);
+
+  // Called when a main frame navigation in |frame_tree_node_id| commits
+  // |url|. Ignored unless OnMainFrameRegistrationLookup() was called first.
+  void OnNavigationCommitted(int frame_tree_node_id, const GURL& url);
+
+  // Returns the scopes whose workers would be started after committing a
+  // document of |origin|, most likely first.
+  std::vector<GURL> PredictScopes(const url::Origin& origin) const;
+
+ private:
+  // The navigations away from one origin.
+  struct Transitions {
+    Transitions();
+    Transitions(const Transitions& other);
+    ~Transitions();
+
+    // Navigations counted, and how many of them needed the worker of each
+    // scope.
+    int navigation_count = 0;
+    std::map<GURL, int> scope_counts;
+    uint64_t last_used = 0;
+  };
+
+  // A worker started for the frame's next navigation.
+  struct Prediction {
+    GURL scope;
+    base::TimeTicks start_time;
+    // Null until the worker has started.
+    base::TimeTicks ready_time;
+  };
+
+  struct FrameState {
+    FrameState();
+    FrameState(const FrameState& other);
+    ~FrameState();
+
+    // The origin of the last committed document, if any.
+    base::Optional<url::Origin> origin;
+    // Set by a lookup and cleared by the commit that follows it.
+    bool has_pending_navigation = false;
+    // The scope of the worker the pending navigation needs, or empty.
+    GURL pending_scope;
+    base::TimeTicks pending_lookup_time;
+    std::vector<Prediction> predictions;
+    // Identifies the last commit. Replies for workers started after an
+    // earlier commit carry an older value and are dropped.
+    uint64_t navigation_sequence = 0;
+    uint64_t last_used = 0;
+  };
+
+  FrameState& GetFrameState(int frame_tree_node_id);
+  void RecordResults(const FrameState& frame);
+  void Learn(const url::Origin& origin, const GURL& scope);
+  // Returns the time predicted starts took over the last minute.
+  base::TimeDelta GetRecentStartupTime();
+  bool CanStartWorkers();
+  void StartWorkers(int frame_tree_node_id,
+                    uint64_t navigation_sequence,
+                    const url::Origin& origin);
+  // Returns the frame if its last commit is |navigation_sequence|.
+  FrameState* GetCurrentFrameState(int frame_tree_node_id,
+                                   uint64_t navigation_sequence);
+  void DidFindRegistration(
+      int frame_tree_node_id,
+      uint64_t navigation_sequence,
+      blink::ServiceWorkerStatusCode status,
+      scoped_refptr<ServiceWorkerRegistration> registration);
+  void DidStartWorker(int frame_tree_node_id,
+                      uint64_t navigation_sequence,
+                      const GURL& scope,
+                      base::TimeTicks start_time,
+                      blink::ServiceWorkerStatusCode status);
+
+  ServiceWorkerContextCore* const context_;
+
+  std::map<url::Origin, Transitions> transitions_;
+  std::map<int /* frame_tree_node_id */, FrameState> frames_;
+  // Orders entries of the maps above by recency, for eviction.
+  uint64_t use_counter_ = 0;
+  // Source of FrameState::navigation_sequence. Shared by all frames so that
+  // a frame evicted and seen again does not reuse a sequence number.
+  uint64_t last_navigation_sequence_ = 0;
+
+  // Predicted starts that have not completed yet.
+  int starting_worker_count_ = 0;
+
+  // When each predicted start over the last minute completed, and how long
+  // it took.
+  base::circular_deque<std::pair<base::TimeTicks, base::TimeDelta>>
+      recent_startup_times_;
+
+  base::WeakPtrFactory<ServiceWorkerNavigationPredictor> weak_factory_{this};
+
+  DISALLOW_COPY_AND_ASSIGN(ServiceWorkerNavigationPredictor);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_NAVIGATION_PREDICTOR_H_
@@ -0,0 +1,201 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/service_worker/service_worker_navigation_predictor.h"
+
+#include <memory>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/run_loop.h"
+#include "base/test/bind_test_util.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
+#include "content/browser/service_worker/embedded_worker_status.h"
+#include "content/browser/service_worker/embedded_worker_test_helper.h"
+#include "content/browser/service_worker/service_worker_context_core.h"
+#include "content/browser/service_worker/service_worker_registration.h"
+#include "content/browser/service_worker/service_worker_test_utils.h"
+#include "content/browser/service_worker/service_worker_version.h"
+#include "content/public/test/browser_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/mojom/service_worker/service_worker_registration.mojom.h"
+#include "url/gurl.h"
+#include "url/origin.h"
+
+namespace content {
+
+namespace {
+
+constexpr int kFrameTreeNodeId = 1;
+
+}  // namespace
+
+class ServiceWorkerNavigationPredictorTest : public testing::Test {
+ public:
+  ServiceWorkerNavigationPredictorTest()
+      : task_environment_(BrowserTaskEnvironment::IO_MAINLOOP) {}
+
+  void SetUp() override {
+    helper_ = std::make_unique<EmbeddedWorkerTestHelper>(base::FilePath());
+    scope_ = GURL("https://host/scope/");
+    script_url_ = GURL("https://host/scope/sw.js");
+
+    blink::mojom::ServiceWorkerRegistrationOptions options;
+    options.scope = scope_;
+    registration_ =
+        CreateNewServiceWorkerRegistration(context()->registry(), options);
+    version_ = CreateNewServiceWorkerVersion(
+        context()->registry(), registration_, script_url_,
+        blink::mojom::ScriptType::kClassic);
+    std::vector<storage::mojom::ServiceWorkerResourceRecordPtr> records;
+    records.push_back(WriteToDiskCacheSync(
+        context()->storage(), script_url_, {} /* headers */, "I'm a body",
+        "I'm a meta data"));
+    version_->script_cache_map()->SetResources(records);
+    version_->SetMainScriptResponse(
+        EmbeddedWorkerTestHelper::CreateMainScriptResponse());
+    version_->set_fetch_handler_existence(
+        ServiceWorkerVersion::FetchHandlerExistence::EXISTS);
+    version_->SetStatus(ServiceWorkerVersion::ACTIVATED);
+    registration_->SetActiveVersion(version_);
+
+    base::RunLoop loop;
+    context()->registry()->StoreRegistration(
+        registration_.get(), version_.get(),
+        base::BindLambdaForTesting([&](blink::ServiceWorkerStatusCode status) {
+          ASSERT_EQ(blink::ServiceWorkerStatusCode::kOk, status);
+          loop.Quit();
+        }));
+    loop.Run();
+  }
+
+  void TearDown() override {
+    version_ = nullptr;
+    registration_ = nullptr;
+    helper_.reset();
+  }
+
+  ServiceWorkerContextCore* context() { return helper_->context(); }
+
+  // Navigates between |source_url| and |scope_| until the predictor starts
+  // the worker after committing |source_url|.
+  void Train(ServiceWorkerNavigationPredictor* predictor,
+             const GURL& source_url) {
+    for (int i = 0; i < 3; ++i) {
+      Navigate(predictor, source_url, nullptr);
+      Navigate(predictor, scope_, registration_.get());
+    }
+  }
+
+  // Simulates a main frame navigation to |url|, which needs the worker of
+  // |registration| if it is not null.
+  void Navigate(ServiceWorkerNavigationPredictor* predictor,
+                const GURL& url,
+                ServiceWorkerRegistration* registration) {
+    predictor->OnMainFrameRegistrationLookup(kFrameTreeNodeId, registration);
+    predictor->OnNavigationCommitted(kFrameTreeNodeId, url);
+  }
+
+ protected:
+  BrowserTaskEnvironment task_environment_;
+  std::unique_ptr<EmbeddedWorkerTestHelper> helper_;
+  GURL scope_;
+  GURL script_url_;
+  scoped_refptr<ServiceWorkerRegistration> registration_;
+  scoped_refptr<ServiceWorkerVersion> version_;
+};
+
+TEST_F(ServiceWorkerNavigationPredictorTest, PredictScopes) {
+  ServiceWorkerNavigationPredictor predictor(nullptr /* context */);
+  const GURL kSourceUrl("https://source.example/");
+  const GURL kOtherUrl("https://other.example/");
+  const url::Origin kSource = url::Origin::Create(kSourceUrl);
+
+  // A commit without a lookup is not a navigation the predictor knows of.
+  predictor.OnNavigationCommitted(kFrameTreeNodeId, kSourceUrl);
+
+  Navigate(&predictor, kSourceUrl, nullptr);
+  Navigate(&predictor, scope_, registration_.get());
+  Navigate(&predictor, kSourceUrl, nullptr);
+  Navigate(&predictor, scope_, registration_.get());
+  // Too few navigations away from |kSource| were seen.
+  EXPECT_TRUE(predictor.PredictScopes(kSource).empty());
+
+  Navigate(&predictor, kSourceUrl, nullptr);
+  Navigate(&predictor, kOtherUrl, nullptr);
+  EXPECT_EQ(std::vector<GURL>({scope_}), predictor.PredictScopes(kSource));
+
+  // Navigations away from |kSource| which need no worker make the scope less
+  // likely, down to below the minimum probability.
+  for (int i = 0; i < 4; ++i) {
+    Navigate(&predictor, kSourceUrl, nullptr);
+    Navigate(&predictor, kOtherUrl, nullptr);
+  }
+  EXPECT_TRUE(predictor.PredictScopes(kSource).empty());
+  EXPECT_TRUE(predictor.PredictScopes(url::Origin::Create(scope_)).empty());
+}
+
+TEST_F(ServiceWorkerNavigationPredictorTest, StartWorker) {
+  ServiceWorkerNavigationPredictor predictor(context());
+  const GURL kSourceUrl("https://source.example/");
+
+  Train(&predictor, kSourceUrl);
+  EXPECT_EQ(EmbeddedWorkerStatus::STOPPED, version_->running_status());
+
+  // Committing |kSourceUrl| starts the worker ahead of the navigation.
+  base::HistogramTester histogram_tester;
+  Navigate(&predictor, kSourceUrl, nullptr);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(EmbeddedWorkerStatus::RUNNING, version_->running_status());
+
+  Navigate(&predictor, scope_, registration_.get());
+  histogram_tester.ExpectUniqueSample(
+      "ServiceWorker.NavigationPredictor.PredictionUsed", true, 1);
+  histogram_tester.ExpectUniqueSample(
+      "ServiceWorker.NavigationPredictor.NavigationPredicted", true, 1);
+  histogram_tester.ExpectTotalCount(
+      "ServiceWorker.NavigationPredictor.TimeSaved", 1);
+}
+
+// A registration lookup that completes after the frame navigated again was
+// for a navigation that already happened, so it starts no worker and is not
+// counted against the next navigation.
+TEST_F(ServiceWorkerNavigationPredictorTest, StaleLookupIsDropped) {
+  ServiceWorkerNavigationPredictor predictor(context());
+  const GURL kSourceUrl("https://source.example/");
+  const GURL kOtherUrl("https://other.example/");
+
+  Train(&predictor, kSourceUrl);
+  base::HistogramTester histogram_tester;
+  Navigate(&predictor, kSourceUrl, nullptr);
+  // Navigate away before the lookup started above completes.
+  Navigate(&predictor, kOtherUrl, nullptr);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(EmbeddedWorkerStatus::STOPPED, version_->running_status());
+
+  Navigate(&predictor, scope_, registration_.get());
+  histogram_tester.ExpectTotalCount(
+      "ServiceWorker.NavigationPredictor.PredictionUsed", 0);
+  histogram_tester.ExpectUniqueSample(
+      "ServiceWorker.NavigationPredictor.NavigationPredicted", false, 1);
+}
+
+TEST_F(ServiceWorkerNavigationPredictorTest, StartupBudget) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(
+      kServiceWorkerNavigationPredictor, {{"startup_budget_ms", "0"}});
+  ServiceWorkerNavigationPredictor predictor(context());
+  const GURL kSourceUrl("https://source.example/");
+
+  // The scope is predicted, but the budget leaves no room to start it.
+  Train(&predictor, kSourceUrl);
+  Navigate(&predictor, kSourceUrl, nullptr);
+  EXPECT_FALSE(
+      predictor.PredictScopes(url::Origin::Create(kSourceUrl)).empty());
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(EmbeddedWorkerStatus::STOPPED, version_->running_status());
+}
+
+}  // namespace content
@@ -9,6 +9,9 @@
 #include <algorithm>
 #include <utility>
 
+#include "base/bind.h"
+#include "base/memory/memory_pressure_monitor.h"
+#include "base/stl_util.h"
 #include "base/task/post_task.h"
 #include "content/browser/renderer_host/render_process_host_impl.h"
 #include "content/browser/service_worker/service_worker_context_wrapper.h"
@@ -22,6 +25,11 @@
 
 namespace content {
 
+const base::Feature kServiceWorkerWarmPool{"ServiceWorkerWarmPool",
+                                           base::FEATURE_DISABLED_BY_DEFAULT};
+const base::FeatureParam<int> kServiceWorkerWarmPoolSize{
+    &kServiceWorkerWarmPool, "pool_size", 1};
+
 ServiceWorkerProcessManager::ServiceWorkerProcessManager(
     BrowserContext* browser_context)
     : browser_context_(browser_context),
@@ -32,6 +40,11 @@ ServiceWorkerProcessManager::ServiceWorkerProcessManager(
   DCHECK_CURRENTLY_ON(BrowserThread::UI);
   DCHECK(browser_context);
   weak_this_ = weak_this_factory_.GetWeakPtr();
+  if (base::FeatureList::IsEnabled(kServiceWorkerWarmPool)) {
+    memory_pressure_listener_ = std::make_unique<base::MemoryPressureListener>(
+        base::BindRepeating(&ServiceWorkerProcessManager::OnMemoryPressure,
+                            base::Unretained(this)));
+  }
 }
 
 ServiceWorkerProcessManager::~ServiceWorkerProcessManager() {
@@ -43,6 +56,7 @@ ServiceWorkerProcessManager::~ServiceWorkerProcessManager() {
   // Temporary checks to verify that ServiceWorkerProcessManager doesn't prevent
   // render process hosts from shutting down: crbug.com/639193
   CHECK(worker_process_map_.empty());
+  DCHECK(warm_pool_.empty());
 }
 
 BrowserContext* ServiceWorkerProcessManager::browser_context() {
@@ -58,6 +72,7 @@ void ServiceWorkerProcessManager::Shutdown() {
     base::AutoLock lock(browser_context_lock_);
     browser_context_ = nullptr;
   }
+  DrainWarmPool();
 
   // In single-process mode, Shutdown() is called when deleting the default
   // browser context, which is itself destroyed after the RenderProcessHost.
@@ -125,13 +140,20 @@ ServiceWorkerProcessManager::AllocateWorkerProcess(
           browser_context_, service_worker_url, can_use_existing_process,
           is_guest);
 
-  // Get the process from the SiteInstance.
+  // Get the process from the SiteInstance. A pooled process can only be
+  // chosen here if process reuse is allowed, since it is picked as an unused
+  // process by RenderProcessHostImpl::GetProcessHostForSiteInstance().
+  // Assigning it marks it as used, so the pool is checked beforehand: a
+  // process taken from it below was still unused when chosen.
+  DropUsedProcessesFromWarmPool();
   RenderProcessHost* rph = site_instance->GetProcess();
   DCHECK(!storage_partition_ ||
          rph->InSameStoragePartition(storage_partition_));
 
   ServiceWorkerMetrics::StartSituation start_situation;
-  if (!rph->IsInitializedAndNotDead()) {
+  if (TakeFromWarmPool(rph)) {
+    start_situation = ServiceWorkerMetrics::StartSituation::WARM_POOL_PROCESS;
+  } else if (!rph->IsInitializedAndNotDead()) {
     // IsInitializedAndNotDead() is false means that Init() has not been called
     // or the process has been killed.
     start_situation = ServiceWorkerMetrics::StartSituation::NEW_PROCESS;
@@ -153,6 +175,23 @@ ServiceWorkerProcessManager::AllocateWorkerProcess(
     rph->IncrementKeepAliveRefCount();
   out_info->process_id = rph->GetID();
   out_info->start_situation = start_situation;
+
+  if (base::FeatureList::IsEnabled(kServiceWorkerWarmPool)) {
+    // Only starts that would otherwise launch a process are pool misses.
+    if (start_situation ==
+            ServiceWorkerMetrics::StartSituation::WARM_POOL_PROCESS ||
+        start_situation == ServiceWorkerMetrics::StartSituation::NEW_PROCESS) {
+      ServiceWorkerMetrics::RecordWarmPoolResult(
+          start_situation ==
+          ServiceWorkerMetrics::StartSituation::WARM_POOL_PROCESS);
+    }
+    // Refill the pool once the worker's own process has been launched, so
+    // the two launches don't compete.
+    base::PostTask(
+        FROM_HERE, {BrowserThread::UI},
+        base::BindOnce(&ServiceWorkerProcessManager::WarmUpProcessPool,
+                       weak_this_));
+  }
   return blink::ServiceWorkerStatusCode::kOk;
 }
 
@@ -194,6 +233,97 @@ SiteInstance* ServiceWorkerProcessManager::GetSiteInstanceForWorker(
   return it->second.get();
 }
 
+void ServiceWorkerProcessManager::WarmUpProcessPool() {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (!base::FeatureList::IsEnabled(kServiceWorkerWarmPool) || IsShutdown() ||
+      RenderProcessHost::run_renderer_in_process() ||
+      process_id_for_test_ != ChildProcessHost::kInvalidUniqueID) {
+    return;
+  }
+
+  DropUsedProcessesFromWarmPool();
+
+  auto* memory_monitor = base::MemoryPressureMonitor::Get();
+  if (memory_monitor &&
+      memory_monitor->GetCurrentPressureLevel() >=
+          base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE) {
+    return;
+  }
+
+  const size_t pool_size = std::max(kServiceWorkerWarmPoolSize.Get(), 0);
+  while (warm_pool_.size() < pool_size) {
+    size_t process_count = 0;
+    for (RenderProcessHost::iterator it = RenderProcessHost::AllHostsIterator();
+         !it.IsAtEnd(); it.Advance()) {
+      ++process_count;
+    }
+    if (process_count >= RenderProcessHost::GetMaxRendererProcessCount())
+      return;
+
+    RenderProcessHost* host = RenderProcessHostImpl::CreateRenderProcessHost(
+        browser_context_, storage_partition_, nullptr /* site_instance */);
+    host->AddObserver(this);
+    if (!host->Init()) {
+      host->RemoveObserver(this);
+      host->Cleanup();
+      return;
+    }
+    warm_pool_.push_back(host);
+    RenderProcessHostImpl::AddToServiceWorkerWarmPool(host);
+  }
+}
+
+void ServiceWorkerProcessManager::RenderProcessExited(
+    RenderProcessHost* host,
+    const ChildProcessTerminationInfo& info) {
+  TakeFromWarmPool(host);
+}
+
+void ServiceWorkerProcessManager::RenderProcessHostDestroyed(
+    RenderProcessHost* host) {
+  TakeFromWarmPool(host);
+}
+
+bool ServiceWorkerProcessManager::TakeFromWarmPool(RenderProcessHost* host) {
+  auto it = std::find(warm_pool_.begin(), warm_pool_.end(), host);
+  if (it == warm_pool_.end())
+    return false;
+  warm_pool_.erase(it);
+  host->RemoveObserver(this);
+  RenderProcessHostImpl::RemoveFromServiceWorkerWarmPool(host);
+  return true;
+}
+
+void ServiceWorkerProcessManager::DropUsedProcessesFromWarmPool() {
+  // Something other than a worker may have used a pooled process, e.g. a
+  // navigation that chose it as an unused process.
+  for (RenderProcessHost* host : std::vector<RenderProcessHost*>(warm_pool_)) {
+    if (!host->IsUnused() || !host->HostHasNotBeenUsed())
+      TakeFromWarmPool(host);
+  }
+}
+
+void ServiceWorkerProcessManager::DrainWarmPool() {
+  std::vector<RenderProcessHost*> pool;
+  pool.swap(warm_pool_);
+  for (RenderProcessHost* host : pool) {
+    host->RemoveObserver(this);
+    RenderProcessHostImpl::RemoveFromServiceWorkerWarmPool(host);
+    // Shuts the process down, since nothing else uses it.
+    host->Cleanup();
+  }
+}
+
+void ServiceWorkerProcessManager::OnMemoryPressure(
+    base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level) {
+  DCHECK_CURRENTLY_ON(BrowserThread::UI);
+  if (memory_pressure_level <
+      base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE) {
+    return;
+  }
+  DrainWarmPool();
+}
+
 }  // namespace content
 
 namespace std {
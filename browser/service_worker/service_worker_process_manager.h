@@ -10,10 +10,14 @@
 #include <vector>
 
 #include "base/callback.h"
+#include "base/feature_list.h"
 #include "base/gtest_prod_util.h"
+#include "base/memory/memory_pressure_listener.h"
 #include "base/memory/weak_ptr.h"
+#include "base/metrics/field_trial_params.h"
 #include "base/synchronization/lock.h"
 #include "content/browser/service_worker/service_worker_metrics.h"
+#include "content/public/browser/render_process_host_observer.h"
 #include "third_party/blink/public/common/service_worker/service_worker_status_code.h"
 
 class GURL;
@@ -21,15 +25,32 @@ class GURL;
 namespace content {
 
 class BrowserContext;
+class RenderProcessHost;
 class SiteInstance;
 class StoragePartitionImpl;
 
+// Keeps renderer processes started ahead of time for service workers, so that
+// starting a worker which would need a new process takes a pooled one
+// instead. Disabled by default.
+CONTENT_EXPORT extern const base::Feature kServiceWorkerWarmPool;
+// The number of processes the warm pool keeps ready.
+CONTENT_EXPORT extern const base::FeatureParam<int>
+    kServiceWorkerWarmPoolSize;
+
 // Interacts with the UI thread to keep RenderProcessHosts alive while the
 // ServiceWorker system is using them. There is one process manager per
 // ServiceWorkerContextWrapper. Each instance of ServiceWorkerProcessManager is
 // destroyed on the UI thread shortly after its ServiceWorkerContextWrapper is
 // destroyed.
-class CONTENT_EXPORT ServiceWorkerProcessManager {
+//
+// When kServiceWorkerWarmPool is enabled, the process manager also keeps a
+// small pool of unused renderer processes in its StoragePartition. Pooled
+// processes are not locked to an origin; the one chosen for a worker is
+// locked to the worker's site as it is assigned to the worker's SiteInstance.
+// The pool is refilled after each worker start and emptied under memory
+// pressure.
+class CONTENT_EXPORT ServiceWorkerProcessManager
+    : public RenderProcessHostObserver {
  public:
   // The return value for AllocateWorkerProcess().
   struct AllocatedProcessInfo {
@@ -46,7 +67,7 @@ class CONTENT_EXPORT ServiceWorkerProcessManager {
   explicit ServiceWorkerProcessManager(BrowserContext* browser_context);
 
   // Shutdown must be called before the ProcessManager is destroyed.
-  ~ServiceWorkerProcessManager();
+  ~ServiceWorkerProcessManager() override;
 
   // Called on the UI thread.
   BrowserContext* browser_context();
@@ -112,9 +133,27 @@ class CONTENT_EXPORT ServiceWorkerProcessManager {
 
   SiteInstance* GetSiteInstanceForWorker(int embedded_worker_id);
 
+  // Starts processes until the warm pool is full, unless the process limit
+  // is reached or memory is under pressure. Called on the UI thread.
+  void WarmUpProcessPool();
+
  private:
   friend class ServiceWorkerProcessManagerTest;
 
+  // RenderProcessHostObserver implementation. Only observes the processes in
+  // |warm_pool_|.
+  void RenderProcessExited(RenderProcessHost* host,
+                           const ChildProcessTerminationInfo& info) override;
+  void RenderProcessHostDestroyed(RenderProcessHost* host) override;
+
+  // Removes |host| from the warm pool. Returns false if it was not pooled.
+  bool TakeFromWarmPool(RenderProcessHost* host);
+  // Removes the pooled processes that are no longer unused.
+  void DropUsedProcessesFromWarmPool();
+  void DrainWarmPool();
+  void OnMemoryPressure(
+      base::MemoryPressureListener::MemoryPressureLevel memory_pressure_level);
+
   // Guarded by |browser_context_lock_|.
   // Written only on the UI thread, so the UI thread doesn't need to acquire the
   // lock when reading. Can be read from other threads with the lock.
@@ -143,6 +182,10 @@ class CONTENT_EXPORT ServiceWorkerProcessManager {
 
   bool force_new_process_for_test_;
 
+  // Processes started for service workers that no worker has used yet.
+  std::vector<RenderProcessHost*> warm_pool_;
+  std::unique_ptr<base::MemoryPressureListener> memory_pressure_listener_;
+
   // Used to double-check that we don't access *this after it's destroyed.
   base::WeakPtr<ServiceWorkerProcessManager> weak_this_;
   base::WeakPtrFactory<ServiceWorkerProcessManager> weak_this_factory_{this};
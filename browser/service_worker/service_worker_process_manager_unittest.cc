@@ -5,8 +5,11 @@
 #include "content/browser/service_worker/service_worker_process_manager.h"
 
 #include <string>
+#include <vector>
 
 #include "base/macros.h"
+#include "base/memory/memory_pressure_listener.h"
+#include "base/run_loop.h"
 #include "base/test/scoped_feature_list.h"
 #include "content/browser/renderer_host/render_process_host_impl.h"
 #include "content/browser/site_instance_impl.h"
@@ -88,6 +91,10 @@ class ServiceWorkerProcessManagerTest : public testing::Test {
     return process_manager_->worker_process_map_;
   }
 
+  const std::vector<RenderProcessHost*>& warm_pool() {
+    return process_manager_->warm_pool_;
+  }
+
  protected:
   content::BrowserTaskEnvironment task_environment_;
   std::unique_ptr<TestBrowserContext> browser_context_;
@@ -199,6 +206,116 @@ TEST_F(ServiceWorkerProcessManagerTest, AllocateWorkerProcess_InShutdown) {
   EXPECT_TRUE(worker_process_map().empty());
 }
 
+class ServiceWorkerProcessManagerWarmPoolTest
+    : public ServiceWorkerProcessManagerTest {
+ public:
+  ServiceWorkerProcessManagerWarmPoolTest() {
+    // Enabled before SetUp() creates the process manager, since the memory
+    // pressure listener is only registered when the feature is on.
+    scoped_feature_list_.InitAndEnableFeature(kServiceWorkerWarmPool);
+  }
+
+  void SetUp() override {
+    ServiceWorkerProcessManagerTest::SetUp();
+    // Pooled processes are deleted by Cleanup(), which the factory below
+    // supports.
+    RenderProcessHostImpl::set_render_process_host_factory_for_testing(
+        &mock_render_process_host_factory_);
+  }
+
+ private:
+  base::test::ScopedFeatureList scoped_feature_list_;
+  MockRenderProcessHostFactory mock_render_process_host_factory_;
+
+  DISALLOW_COPY_AND_ASSIGN(ServiceWorkerProcessManagerWarmPoolTest);
+};
+
+TEST_F(ServiceWorkerProcessManagerWarmPoolTest, AllocateFromWarmPool) {
+  const int kEmbeddedWorkerId = 100;
+
+  process_manager_->WarmUpProcessPool();
+  ASSERT_EQ(1u, warm_pool().size());
+  RenderProcessHost* pooled_host = warm_pool().front();
+  EXPECT_TRUE(pooled_host->IsInitializedAndNotDead());
+
+  // The pooled process is taken by a worker that may use an existing process.
+  ServiceWorkerProcessManager::AllocatedProcessInfo process_info;
+  blink::ServiceWorkerStatusCode status =
+      process_manager_->AllocateWorkerProcess(
+          kEmbeddedWorkerId, script_url_, true /* can_use_existing_process */,
+          &process_info);
+  EXPECT_EQ(blink::ServiceWorkerStatusCode::kOk, status);
+  EXPECT_EQ(pooled_host->GetID(), process_info.process_id);
+  EXPECT_EQ(ServiceWorkerMetrics::StartSituation::WARM_POOL_PROCESS,
+            process_info.start_situation);
+  EXPECT_TRUE(warm_pool().empty());
+
+  // The pool is refilled with another process.
+  base::RunLoop().RunUntilIdle();
+  ASSERT_EQ(1u, warm_pool().size());
+  EXPECT_NE(pooled_host, warm_pool().front());
+
+  process_manager_->ReleaseWorkerProcess(kEmbeddedWorkerId);
+}
+
+TEST_F(ServiceWorkerProcessManagerWarmPoolTest, OnlyPooledProcessIsReused) {
+  const int kEmbeddedWorkerId = 100;
+
+  // An unused process that is not in the pool, e.g. one created for a
+  // navigation, is not chosen for the worker.
+  RenderProcessHost* unused_host =
+      RenderProcessHostImpl::CreateRenderProcessHost(
+          browser_context_.get(), nullptr /* storage_partition_impl */,
+          nullptr /* site_instance */);
+  ASSERT_TRUE(unused_host->IsUnused());
+  process_manager_->WarmUpProcessPool();
+  ASSERT_EQ(1u, warm_pool().size());
+  RenderProcessHost* pooled_host = warm_pool().front();
+
+  ServiceWorkerProcessManager::AllocatedProcessInfo process_info;
+  blink::ServiceWorkerStatusCode status =
+      process_manager_->AllocateWorkerProcess(
+          kEmbeddedWorkerId, script_url_, true /* can_use_existing_process */,
+          &process_info);
+  EXPECT_EQ(blink::ServiceWorkerStatusCode::kOk, status);
+  EXPECT_EQ(pooled_host->GetID(), process_info.process_id);
+  EXPECT_TRUE(unused_host->IsUnused());
+
+  process_manager_->ReleaseWorkerProcess(kEmbeddedWorkerId);
+}
+
+TEST_F(ServiceWorkerProcessManagerWarmPoolTest, UsedPooledProcessIsNotTaken) {
+  const int kEmbeddedWorkerId = 100;
+
+  process_manager_->WarmUpProcessPool();
+  ASSERT_EQ(1u, warm_pool().size());
+  RenderProcessHost* pooled_host = warm_pool().front();
+  // Something else used the pooled process since it was pooled.
+  pooled_host->SetIsUsed();
+
+  ServiceWorkerProcessManager::AllocatedProcessInfo process_info;
+  blink::ServiceWorkerStatusCode status =
+      process_manager_->AllocateWorkerProcess(
+          kEmbeddedWorkerId, script_url_, true /* can_use_existing_process */,
+          &process_info);
+  EXPECT_EQ(blink::ServiceWorkerStatusCode::kOk, status);
+  EXPECT_NE(pooled_host->GetID(), process_info.process_id);
+  EXPECT_NE(ServiceWorkerMetrics::StartSituation::WARM_POOL_PROCESS,
+            process_info.start_situation);
+
+  process_manager_->ReleaseWorkerProcess(kEmbeddedWorkerId);
+}
+
+TEST_F(ServiceWorkerProcessManagerWarmPoolTest, DrainOnMemoryPressure) {
+  process_manager_->WarmUpProcessPool();
+  ASSERT_EQ(1u, warm_pool().size());
+
+  base::MemoryPressureListener::SimulatePressureNotification(
+      base::MemoryPressureListener::MEMORY_PRESSURE_LEVEL_MODERATE);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(warm_pool().empty());
+}
+
 // Tests that ServiceWorkerProcessManager uses
 // StoragePartitionImpl::site_for_guest_service_worker() when it's set. This
 // enables finding the appropriate process when inside a StoragePartition for
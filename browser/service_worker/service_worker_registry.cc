@@ -175,6 +175,38 @@ void ServiceWorkerRegistry::FindRegistrationForClientUrl(
   TRACE_EVENT_ASYNC_BEGIN1(
       "ServiceWorker", "ServiceWorkerRegistry::FindRegistrationForClientUrl",
       trace_event_id, "URL", client_url.spec());
+
+  // The scope trie of storage finds the matching registration without a
+  // database lookup. Only a registration that isn't live has to be read.
+  int64_t registration_id = blink::mojom::kInvalidServiceWorkerRegistrationId;
+  if (storage()->FindRegistrationIdForClientUrl(client_url,
+                                                &registration_id)) {
+    if (registration_id == blink::mojom::kInvalidServiceWorkerRegistrationId) {
+      DidFindRegistrationForClientUrl(
+          client_url, trace_event_id, std::move(callback), /*data=*/nullptr,
+          /*resources=*/nullptr,
+          storage::mojom::ServiceWorkerDatabaseStatus::kErrorNotFound);
+      return;
+    }
+    scoped_refptr<ServiceWorkerRegistration> registration =
+        context_->GetLiveRegistration(registration_id);
+    if (registration && registration->IsStored()) {
+      TRACE_EVENT_ASYNC_END1(
+          "ServiceWorker",
+          "ServiceWorkerRegistry::FindRegistrationForClientUrl", trace_event_id,
+          "Status", "Live registration is found");
+      CompleteFindNow(std::move(registration),
+                      blink::ServiceWorkerStatusCode::kOk, std::move(callback));
+      return;
+    }
+    storage()->FindRegistrationForId(
+        registration_id, client_url.GetOrigin(),
+        base::BindOnce(&ServiceWorkerRegistry::DidFindRegistrationForClientUrl,
+                       weak_factory_.GetWeakPtr(), client_url, trace_event_id,
+                       std::move(callback)));
+    return;
+  }
+
   storage()->FindRegistrationForClientUrl(
       client_url,
       base::BindOnce(&ServiceWorkerRegistry::DidFindRegistrationForClientUrl,
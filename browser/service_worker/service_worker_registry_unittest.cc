@@ -5,8 +5,10 @@
 #include "content/browser/service_worker/service_worker_registry.h"
 
 #include "base/test/bind_test_util.h"
+#include "base/test/scoped_feature_list.h"
 #include "content/browser/service_worker/embedded_worker_test_helper.h"
 #include "content/browser/service_worker/service_worker_context_core.h"
+#include "content/browser/service_worker/service_worker_scope_trie.h"
 #include "content/browser/service_worker/service_worker_test_utils.h"
 #include "content/public/test/browser_task_environment.h"
 #include "content/public/test/test_browser_context.h"
@@ -93,4 +95,52 @@ TEST_F(ServiceWorkerRegistryTest, StoragePolicyChange) {
   EXPECT_TRUE(registry()->ShouldPurgeOnShutdown(kOrigin));
 }
 
+class ServiceWorkerRegistryScopeTrieTest : public ServiceWorkerRegistryTest {
+ public:
+  ServiceWorkerRegistryScopeTrieTest() {
+    // Enabled before SetUp() initializes storage, which reads the scopes.
+    scoped_feature_list_.InitAndEnableFeature(kServiceWorkerScopeTrie);
+  }
+
+ private:
+  base::test::ScopedFeatureList scoped_feature_list_;
+};
+
+// Tests that registrations are found for client URLs without a database
+// lookup, that is, synchronously.
+TEST_F(ServiceWorkerRegistryScopeTrieTest, FindRegistrationForClientUrl) {
+  const GURL kScope("http://www.example.com/scope/");
+  const GURL kScriptUrl("http://www.example.com/script.js");
+
+  scoped_refptr<ServiceWorkerRegistration> registration =
+      CreateServiceWorkerRegistrationAndVersion(context(), kScope, kScriptUrl,
+                                                /*resource_id=*/1);
+  ASSERT_EQ(StoreRegistration(registration, registration->waiting_version()),
+            blink::ServiceWorkerStatusCode::kOk);
+
+  bool called = false;
+  registry()->FindRegistrationForClientUrl(
+      GURL("http://www.example.com/scope/page.html"),
+      base::BindLambdaForTesting(
+          [&](blink::ServiceWorkerStatusCode status,
+              scoped_refptr<ServiceWorkerRegistration> found_registration) {
+            called = true;
+            EXPECT_EQ(blink::ServiceWorkerStatusCode::kOk, status);
+            EXPECT_EQ(registration, found_registration);
+          }));
+  EXPECT_TRUE(called);
+
+  called = false;
+  registry()->FindRegistrationForClientUrl(
+      GURL("http://www.example.com/other/page.html"),
+      base::BindLambdaForTesting(
+          [&](blink::ServiceWorkerStatusCode status,
+              scoped_refptr<ServiceWorkerRegistration> found_registration) {
+            called = true;
+            EXPECT_EQ(blink::ServiceWorkerStatusCode::kErrorNotFound, status);
+            EXPECT_FALSE(found_registration);
+          }));
+  EXPECT_TRUE(called);
+}
+
 }  // namespace content
@@ -0,0 +1,143 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/service_worker/service_worker_scope_trie.h"
+
+#include <utility>
+
+#include "base/check.h"
+
+namespace content {
+
+const base::Feature kServiceWorkerScopeTrie{"ServiceWorkerScopeTrie",
+                                            base::FEATURE_DISABLED_BY_DEFAULT};
+
+ServiceWorkerScopeTrie::Node::Node() = default;
+ServiceWorkerScopeTrie::Node::~Node() = default;
+
+ServiceWorkerScopeTrie::ServiceWorkerScopeTrie() = default;
+ServiceWorkerScopeTrie::~ServiceWorkerScopeTrie() = default;
+
+void ServiceWorkerScopeTrie::Insert(const GURL& scope,
+                                    int64_t registration_id) {
+  DCHECK(!scope.has_ref());
+  DCHECK_NE(blink::mojom::kInvalidServiceWorkerRegistrationId,
+            registration_id);
+  Remove(registration_id);
+
+  const std::string& key = scope.spec();
+  DCHECK(!key.empty());
+  Node* node = &root_;
+  size_t pos = 0;
+  while (pos < key.size()) {
+    auto found = node->children.find(key[pos]);
+    if (found == node->children.end()) {
+      auto child = std::make_unique<Node>();
+      child->label = key.substr(pos);
+      Node* raw_child = child.get();
+      node->children.emplace(key[pos], std::move(child));
+      node = raw_child;
+      pos = key.size();
+      break;
+    }
+
+    Node* child = found->second.get();
+    size_t common = 0;
+    while (common < child->label.size() && pos + common < key.size() &&
+           child->label[common] == key[pos + common]) {
+      ++common;
+    }
+    if (common < child->label.size()) {
+      // Split the edge where |key| leaves it.
+      auto middle = std::make_unique<Node>();
+      middle->label = child->label.substr(0, common);
+      std::unique_ptr<Node> old_child = std::move(found->second);
+      old_child->label = old_child->label.substr(common);
+      middle->children.emplace(old_child->label[0], std::move(old_child));
+      child = middle.get();
+      found->second = std::move(middle);
+    }
+    node = child;
+    pos += common;
+  }
+
+  // A scope that another registration had is taken over.
+  if (node->registration_id !=
+      blink::mojom::kInvalidServiceWorkerRegistrationId) {
+    scopes_by_id_.erase(node->registration_id);
+  }
+  node->registration_id = registration_id;
+  scopes_by_id_[registration_id] = key;
+}
+
+void ServiceWorkerScopeTrie::Remove(int64_t registration_id) {
+  auto found = scopes_by_id_.find(registration_id);
+  if (found == scopes_by_id_.end())
+    return;
+  RemoveKey(&root_, found->second);
+  scopes_by_id_.erase(found);
+}
+
+int64_t ServiceWorkerScopeTrie::FindLongestMatch(const GURL& client_url) const {
+  const std::string& key = client_url.spec();
+  int64_t match = blink::mojom::kInvalidServiceWorkerRegistrationId;
+  const Node* node = &root_;
+  size_t pos = 0;
+  while (true) {
+    if (node->registration_id !=
+        blink::mojom::kInvalidServiceWorkerRegistrationId) {
+      match = node->registration_id;
+    }
+    if (pos == key.size())
+      break;
+    auto found = node->children.find(key[pos]);
+    if (found == node->children.end())
+      break;
+    const Node* child = found->second.get();
+    if (key.compare(pos, child->label.size(), child->label) != 0)
+      break;
+    pos += child->label.size();
+    node = child;
+  }
+  return match;
+}
+
+void ServiceWorkerScopeTrie::Clear() {
+  root_.children.clear();
+  scopes_by_id_.clear();
+}
+
+// static
+bool ServiceWorkerScopeTrie::RemoveKey(Node* node, base::StringPiece key) {
+  if (key.empty()) {
+    node->registration_id = blink::mojom::kInvalidServiceWorkerRegistrationId;
+  } else {
+    auto found = node->children.find(key[0]);
+    DCHECK(found != node->children.end());
+    Node* child = found->second.get();
+    DCHECK(key.starts_with(child->label));
+    if (RemoveKey(child, key.substr(child->label.size())))
+      node->children.erase(found);
+    else
+      MaybeMergeWithChild(child);
+  }
+  return node->registration_id ==
+             blink::mojom::kInvalidServiceWorkerRegistrationId &&
+         node->children.empty();
+}
+
+// static
+void ServiceWorkerScopeTrie::MaybeMergeWithChild(Node* node) {
+  if (node->registration_id !=
+          blink::mojom::kInvalidServiceWorkerRegistrationId ||
+      node->children.size() != 1) {
+    return;
+  }
+  std::unique_ptr<Node> child = std::move(node->children.begin()->second);
+  node->label += child->label;
+  node->registration_id = child->registration_id;
+  node->children = std::move(child->children);
+}
+
+}  // namespace content
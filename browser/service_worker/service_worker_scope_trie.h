@@ -0,0 +1,86 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_SCOPE_TRIE_H_
+#define CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_SCOPE_TRIE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/feature_list.h"
+#include "base/macros.h"
+#include "base/strings/string_piece.h"
+#include "content/common/content_export.h"
+#include "third_party/blink/public/mojom/service_worker/service_worker_registration.mojom.h"
+#include "url/gurl.h"
+
+namespace content {
+
+// Keeps the scopes of all stored registrations in memory in a
+// ServiceWorkerScopeTrie, so that the registration for a client URL is
+// found without a database lookup. Disabled by default.
+CONTENT_EXPORT extern const base::Feature kServiceWorkerScopeTrie;
+
+// Maps registration scopes to registration IDs, and finds the registration
+// whose scope is the longest prefix of a client URL, as LongestScopeMatcher
+// does over a list of scopes.
+//
+// The scopes are kept in a radix tree over their specs: each edge is labeled
+// with a string, and the children of a node start with distinct characters.
+// A lookup therefore takes time linear in the length of the URL, whatever
+// the number of scopes.
+class CONTENT_EXPORT ServiceWorkerScopeTrie {
+ public:
+  ServiceWorkerScopeTrie();
+  ~ServiceWorkerScopeTrie();
+
+  // Adds |scope| for |registration_id|, replacing the scope it had before,
+  // if any. Each scope belongs to at most one registration.
+  void Insert(const GURL& scope, int64_t registration_id);
+
+  // Removes the scope of |registration_id|. Does nothing if it has none.
+  void Remove(int64_t registration_id);
+
+  // Returns the ID of the registration with the longest scope matching
+  // |client_url|, or blink::mojom::kInvalidServiceWorkerRegistrationId.
+  int64_t FindLongestMatch(const GURL& client_url) const;
+
+  void Clear();
+
+  size_t size() const { return scopes_by_id_.size(); }
+
+ private:
+  struct Node {
+    Node();
+    ~Node();
+
+    // The label of the edge from the parent node.
+    std::string label;
+    int64_t registration_id =
+        blink::mojom::kInvalidServiceWorkerRegistrationId;
+    // Keyed by the first character of the child's label.
+    std::map<char, std::unique_ptr<Node>> children;
+  };
+
+  // Removes |key|, relative to |node|. Returns true if |node| is left without
+  // a registration or children, so that its parent can drop it.
+  static bool RemoveKey(Node* node, base::StringPiece key);
+
+  // Merges |node| with its child if it has a single child and no
+  // registration, to keep the tree compressed.
+  static void MaybeMergeWithChild(Node* node);
+
+  Node root_;
+  std::map<int64_t, std::string> scopes_by_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(ServiceWorkerScopeTrie);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_BROWSER_SERVICE_WORKER_SERVICE_WORKER_SCOPE_TRIE_H_
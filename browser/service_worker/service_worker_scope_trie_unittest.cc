@@ -0,0 +1,78 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/browser/service_worker/service_worker_scope_trie.h"
+
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/blink/public/mojom/service_worker/service_worker_registration.mojom.h"
+#include "url/gurl.h"
+
+namespace content {
+
+namespace {
+
+constexpr int64_t kNoMatch = blink::mojom::kInvalidServiceWorkerRegistrationId;
+
+}  // namespace
+
+TEST(ServiceWorkerScopeTrieTest, FindLongestMatch) {
+  ServiceWorkerScopeTrie trie;
+  EXPECT_EQ(kNoMatch, trie.FindLongestMatch(GURL("https://example.com/")));
+
+  trie.Insert(GURL("https://example.com/"), 1);
+  trie.Insert(GURL("https://example.com/foo"), 2);
+  trie.Insert(GURL("https://example.com/foo/bar/"), 3);
+  trie.Insert(GURL("https://example.com/fob/"), 4);
+  trie.Insert(GURL("https://example.org/foo/"), 5);
+  EXPECT_EQ(5u, trie.size());
+
+  EXPECT_EQ(1, trie.FindLongestMatch(GURL("https://example.com/")));
+  EXPECT_EQ(1, trie.FindLongestMatch(GURL("https://example.com/fo")));
+  // Scopes match as string prefixes, not path segments.
+  EXPECT_EQ(2, trie.FindLongestMatch(GURL("https://example.com/foobar")));
+  EXPECT_EQ(2, trie.FindLongestMatch(GURL("https://example.com/foo/bar")));
+  EXPECT_EQ(3, trie.FindLongestMatch(GURL("https://example.com/foo/bar/baz")));
+  EXPECT_EQ(4, trie.FindLongestMatch(GURL("https://example.com/fob/")));
+  EXPECT_EQ(5, trie.FindLongestMatch(GURL("https://example.org/foo/x")));
+  EXPECT_EQ(kNoMatch, trie.FindLongestMatch(GURL("https://example.org/")));
+  EXPECT_EQ(kNoMatch, trie.FindLongestMatch(GURL("http://example.com/")));
+}
+
+TEST(ServiceWorkerScopeTrieTest, InsertAndRemove) {
+  ServiceWorkerScopeTrie trie;
+  trie.Insert(GURL("https://example.com/a/"), 1);
+  trie.Insert(GURL("https://example.com/a/b/"), 2);
+  trie.Insert(GURL("https://example.com/a/c/"), 3);
+
+  // Removing a scope with longer scopes under it keeps them.
+  trie.Remove(1);
+  EXPECT_EQ(kNoMatch, trie.FindLongestMatch(GURL("https://example.com/a/")));
+  EXPECT_EQ(2, trie.FindLongestMatch(GURL("https://example.com/a/b/x")));
+  EXPECT_EQ(3, trie.FindLongestMatch(GURL("https://example.com/a/c/x")));
+
+  // Removing the same registration again, or an unknown one, does nothing.
+  trie.Remove(1);
+  trie.Remove(42);
+  EXPECT_EQ(2u, trie.size());
+
+  trie.Remove(2);
+  EXPECT_EQ(kNoMatch, trie.FindLongestMatch(GURL("https://example.com/a/b/")));
+  EXPECT_EQ(3, trie.FindLongestMatch(GURL("https://example.com/a/c/x")));
+
+  // Inserting a registration again moves it to its new scope.
+  trie.Insert(GURL("https://example.com/d/"), 3);
+  EXPECT_EQ(kNoMatch, trie.FindLongestMatch(GURL("https://example.com/a/c/")));
+  EXPECT_EQ(3, trie.FindLongestMatch(GURL("https://example.com/d/")));
+
+  // A registration that takes over a scope replaces the old one.
+  trie.Insert(GURL("https://example.com/d/"), 4);
+  EXPECT_EQ(4, trie.FindLongestMatch(GURL("https://example.com/d/")));
+  EXPECT_EQ(1u, trie.size());
+
+  trie.Clear();
+  EXPECT_EQ(0u, trie.size());
+  EXPECT_EQ(kNoMatch, trie.FindLongestMatch(GURL("https://example.com/d/")));
+}
+
+}  // namespace content
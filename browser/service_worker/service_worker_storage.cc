@@ -10,6 +10,7 @@
 #include <utility>
 
 #include "base/bind_helpers.h"
+#include "base/feature_list.h"
 #include "base/files/file_util.h"
 #include "base/memory/ptr_util.h"
 #include "base/run_loop.h"
@@ -164,6 +165,16 @@ void ServiceWorkerStorage::FindRegistrationForClientUrl(
                                 std::move(callback)));
 }
 
+bool ServiceWorkerStorage::FindRegistrationIdForClientUrl(
+    const GURL& client_url,
+    int64_t* registration_id) {
+  DCHECK(!client_url.has_ref());
+  if (state_ != STORAGE_STATE_INITIALIZED || !scope_trie_ready_)
+    return false;
+  *registration_id = scope_trie_.FindLongestMatch(client_url);
+  return true;
+}
+
 void ServiceWorkerStorage::FindRegistrationForScope(
     const GURL& scope,
     FindRegistrationDataCallback callback) {
@@ -337,6 +348,8 @@ void ServiceWorkerStorage::StoreRegistrationData(
 
   uint64_t resources_total_size_bytes =
       registration_data->resources_total_size_bytes;
+  int64_t registration_id = registration_data->registration_id;
+  GURL scope = registration_data->scope;
   database_task_runner_->PostTask(
       FROM_HERE,
       base::BindOnce(
@@ -345,7 +358,8 @@ void ServiceWorkerStorage::StoreRegistrationData(
           std::move(resources),
           base::BindOnce(&ServiceWorkerStorage::DidStoreRegistrationData,
                          weak_factory_.GetWeakPtr(), std::move(callback),
-                         resources_total_size_bytes)));
+                         resources_total_size_bytes, registration_id,
+                         std::move(scope))));
 }
 
 void ServiceWorkerStorage::UpdateToActiveState(
@@ -980,6 +994,11 @@ void ServiceWorkerStorage::DidReadInitialData(
     next_version_id_ = data->next_version_id;
     next_resource_id_ = data->next_resource_id;
     registered_origins_.swap(data->origins);
+    if (base::FeatureList::IsEnabled(kServiceWorkerScopeTrie)) {
+      for (const auto& scope : data->scopes)
+        scope_trie_.Insert(scope.second, scope.first);
+      scope_trie_ready_ = true;
+    }
     state_ = STORAGE_STATE_INITIALIZED;
     ServiceWorkerMetrics::RecordRegisteredOriginCount(
         registered_origins_.size());
@@ -1013,6 +1032,8 @@ void ServiceWorkerStorage::DidGetAllRegistrations(
 void ServiceWorkerStorage::DidStoreRegistrationData(
     StoreRegistrationDataCallback callback,
     uint64_t new_resources_total_size_bytes,
+    int64_t registration_id,
+    const GURL& scope,
     const GURL& origin,
     const ServiceWorkerDatabase::DeletedVersion& deleted_version,
     ServiceWorkerDatabase::Status status) {
@@ -1023,6 +1044,7 @@ void ServiceWorkerStorage::DidStoreRegistrationData(
     return;
   }
   registered_origins_.insert(origin);
+  scope_trie_.Insert(scope, registration_id);
 
   if (quota_manager_proxy_) {
     // Can be nullptr in tests.
@@ -1069,6 +1091,7 @@ void ServiceWorkerStorage::DidDeleteRegistration(
 
   if (origin_state == OriginState::kDelete)
     registered_origins_.erase(params->origin);
+  scope_trie_.Remove(params->registration_id);
 
   std::move(params->callback)
       .Run(ServiceWorkerDatabase::Status::kOk, origin_state,
@@ -1320,6 +1343,16 @@ void ServiceWorkerStorage::ReadInitialDataFromDB(
     return;
   }
 
+  if (base::FeatureList::IsEnabled(kServiceWorkerScopeTrie)) {
+    status = database->GetAllRegistrationScopes(&data->scopes);
+    if (status != ServiceWorkerDatabase::Status::kOk) {
+      original_task_runner->PostTask(
+          FROM_HERE,
+          base::BindOnce(std::move(callback), std::move(data), status));
+      return;
+    }
+  }
+
   original_task_runner->PostTask(
       FROM_HERE, base::BindOnce(std::move(callback), std::move(data), status));
 }
@@ -25,6 +25,7 @@
 #include "components/services/storage/public/mojom/service_worker_storage_control.mojom.h"
 #include "content/browser/service_worker/service_worker_database.h"
 #include "content/browser/service_worker/service_worker_metrics.h"
+#include "content/browser/service_worker/service_worker_scope_trie.h"
 #include "content/common/content_export.h"
 #include "url/gurl.h"
 
@@ -137,6 +138,15 @@ class CONTENT_EXPORT ServiceWorkerStorage {
   void FindRegistrationForIdOnly(int64_t registration_id,
                                  FindRegistrationDataCallback callback);
 
+  // Looks up the ID of the stored registration for |client_url| in memory,
+  // without reading the database. Returns false if that isn't possible yet,
+  // because kServiceWorkerScopeTrie is disabled or storage isn't initialized;
+  // FindRegistrationForClientUrl() should be used then. Otherwise sets
+  // |registration_id|, to blink::mojom::kInvalidServiceWorkerRegistrationId
+  // if no scope matches.
+  bool FindRegistrationIdForClientUrl(const GURL& client_url,
+                                      int64_t* registration_id);
+
   // Returns all stored registrations for a given origin.
   void GetRegistrationsForOrigin(const GURL& origin,
                                  GetRegistrationsDataCallback callback);
@@ -327,6 +337,8 @@ class CONTENT_EXPORT ServiceWorkerStorage {
     int64_t next_version_id;
     int64_t next_resource_id;
     std::set<GURL> origins;
+    // Only read if kServiceWorkerScopeTrie is enabled.
+    std::map<int64_t, GURL> scopes;
 
     InitialData();
     ~InitialData();
@@ -386,6 +398,8 @@ class CONTENT_EXPORT ServiceWorkerStorage {
   void DidStoreRegistrationData(
       StoreRegistrationDataCallback callback,
       uint64_t new_resources_total_size_bytes,
+      int64_t registration_id,
+      const GURL& scope,
       const GURL& origin,
       const ServiceWorkerDatabase::DeletedVersion& deleted_version,
       ServiceWorkerDatabase::Status status);
@@ -515,6 +529,10 @@ class CONTENT_EXPORT ServiceWorkerStorage {
 
   // Origins having registations.
   std::set<GURL> registered_origins_;
+  // The scopes of the stored registrations. Only used once
+  // |scope_trie_ready_| is set, when kServiceWorkerScopeTrie is enabled.
+  ServiceWorkerScopeTrie scope_trie_;
+  bool scope_trie_ready_ = false;
   // The set of origins whose storage should be cleaned on shutdown.
   std::set<GURL> origins_to_purge_on_shutdown_;
 
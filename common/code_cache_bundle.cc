@@ -0,0 +1,109 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/code_cache_bundle.h"
+
+#include <string.h>
+
+#include <string>
+#include <utility>
+
+#include "base/memory/ptr_util.h"
+#include "base/pickle.h"
+
+namespace content {
+
+CodeCacheBundle::Entry::Entry(const GURL& url,
+                              base::Time response_time,
+                              mojo_base::BigBuffer data)
+    : url(url), response_time(response_time), data(std::move(data)) {}
+
+CodeCacheBundle::Entry::Entry(Entry&& other) = default;
+
+CodeCacheBundle::Entry& CodeCacheBundle::Entry::operator=(Entry&& other) =
+    default;
+
+CodeCacheBundle::Entry::~Entry() = default;
+
+// static
+base::ReadOnlySharedMemoryRegion CodeCacheBundle::Serialize(
+    const std::vector<Entry>& entries) {
+  // The bundle is a pickle of the entry count, followed by the URL, response
+  // time and data of each entry.
+  base::Pickle pickle;
+  pickle.WriteUInt32(entries.size());
+  for (const Entry& entry : entries) {
+    pickle.WriteString(entry.url.spec());
+    pickle.WriteInt64(
+        entry.response_time.ToDeltaSinceWindowsEpoch().InMicroseconds());
+    pickle.WriteData(reinterpret_cast<const char*>(entry.data.data()),
+                     entry.data.size());
+  }
+
+  base::MappedReadOnlyRegion region =
+      base::ReadOnlySharedMemoryRegion::Create(pickle.size());
+  if (!region.IsValid())
+    return base::ReadOnlySharedMemoryRegion();
+  memcpy(region.mapping.memory(), pickle.data(), pickle.size());
+  return std::move(region.region);
+}
+
+// static
+std::unique_ptr<CodeCacheBundle> CodeCacheBundle::Create(
+    base::ReadOnlySharedMemoryRegion region) {
+  base::ReadOnlySharedMemoryMapping mapping = region.Map();
+  if (!mapping.IsValid())
+    return nullptr;
+  auto bundle = base::WrapUnique(new CodeCacheBundle(std::move(mapping)));
+  if (!bundle->Parse())
+    return nullptr;
+  return bundle;
+}
+
+CodeCacheBundle::CodeCacheBundle(base::ReadOnlySharedMemoryMapping mapping)
+    : mapping_(std::move(mapping)) {}
+
+CodeCacheBundle::~CodeCacheBundle() = default;
+
+bool CodeCacheBundle::TakeEntry(const GURL& url,
+                                base::Time* response_time,
+                                mojo_base::BigBuffer* data) {
+  auto it = entries_.find(url);
+  if (it == entries_.end())
+    return false;
+  *response_time = it->second.response_time;
+  *data = mojo_base::BigBuffer(it->second.data);
+  entries_.erase(it);
+  return true;
+}
+
+bool CodeCacheBundle::Parse() {
+  // The pickle does not copy the mapped memory.
+  base::Pickle pickle(static_cast<const char*>(mapping_.memory()),
+                      mapping_.size());
+  base::PickleIterator iterator(pickle);
+  uint32_t entry_count;
+  if (!iterator.ReadUInt32(&entry_count))
+    return false;
+  for (uint32_t i = 0; i < entry_count; ++i) {
+    std::string spec;
+    int64_t response_time;
+    const char* data;
+    int data_size;
+    if (!iterator.ReadString(&spec) || !iterator.ReadInt64(&response_time) ||
+        !iterator.ReadData(&data, &data_size)) {
+      return false;
+    }
+    GURL url(spec);
+    if (!url.is_valid())
+      return false;
+    entries_[url] = {base::Time::FromDeltaSinceWindowsEpoch(
+                         base::TimeDelta::FromMicroseconds(response_time)),
+                     base::make_span(reinterpret_cast<const uint8_t*>(data),
+                                     static_cast<size_t>(data_size))};
+  }
+  return true;
+}
+
+}  // namespace content
@@ -0,0 +1,82 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef CONTENT_COMMON_CODE_CACHE_BUNDLE_H_
+#define CONTENT_COMMON_CODE_CACHE_BUNDLE_H_
+
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/containers/span.h"
+#include "base/macros.h"
+#include "base/memory/read_only_shared_memory_region.h"
+#include "base/time/time.h"
+#include "content/common/content_export.h"
+#include "mojo/public/cpp/base/big_buffer.h"
+#include "url/gurl.h"
+
+namespace content {
+
+// A bundle of JavaScript code cache entries, which the browser process
+// prefetches for a navigation and passes to the renderer in read-only shared
+// memory. The renderer takes entries from the bundle instead of fetching them
+// from the browser one at a time.
+class CONTENT_EXPORT CodeCacheBundle {
+ public:
+  struct CONTENT_EXPORT Entry {
+    Entry(const GURL& url,
+          base::Time response_time,
+          mojo_base::BigBuffer data);
+    Entry(Entry&& other);
+    Entry& operator=(Entry&& other);
+    ~Entry();
+
+    GURL url;
+    base::Time response_time;
+    mojo_base::BigBuffer data;
+  };
+
+  // Packs |entries| into a new region. Returns an invalid region if it could
+  // not be created.
+  static base::ReadOnlySharedMemoryRegion Serialize(
+      const std::vector<Entry>& entries);
+
+  // Returns null if |region| cannot be mapped or was not created by
+  // Serialize().
+  static std::unique_ptr<CodeCacheBundle> Create(
+      base::ReadOnlySharedMemoryRegion region);
+
+  ~CodeCacheBundle();
+
+  // Returns true and fills |response_time| and |data| if the bundle has an
+  // entry for |url|. Each entry is only returned once.
+  bool TakeEntry(const GURL& url,
+                 base::Time* response_time,
+                 mojo_base::BigBuffer* data);
+
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct EntryLocation {
+    base::Time response_time;
+    base::span<const uint8_t> data;
+  };
+
+  explicit CodeCacheBundle(base::ReadOnlySharedMemoryMapping mapping);
+
+  bool Parse();
+
+  base::ReadOnlySharedMemoryMapping mapping_;
+  // Points into |mapping_|.
+  std::map<GURL, EntryLocation> entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(CodeCacheBundle);
+};
+
+}  // namespace content
+
+#endif  // CONTENT_COMMON_CODE_CACHE_BUNDLE_H_
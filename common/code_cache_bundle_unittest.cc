@@ -0,0 +1,71 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "content/common/code_cache_bundle.h"
+
+#include <string.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace content {
+
+namespace {
+
+mojo_base::BigBuffer MakeData(const std::string& data) {
+  return mojo_base::BigBuffer(base::make_span(
+      reinterpret_cast<const uint8_t*>(data.data()), data.size()));
+}
+
+std::string ToString(const mojo_base::BigBuffer& data) {
+  return std::string(data.data(), data.data() + data.size());
+}
+
+}  // namespace
+
+TEST(CodeCacheBundleTest, TakeEntry) {
+  const GURL url1("https://example.com/script1.js");
+  const GURL url2("https://example.com/script2.js");
+  const base::Time time1 = base::Time::Now();
+  const base::Time time2 = time1 + base::TimeDelta::FromSeconds(1);
+  std::vector<CodeCacheBundle::Entry> entries;
+  entries.emplace_back(url1, time1, MakeData("data1"));
+  entries.emplace_back(url2, time2, MakeData("data2"));
+
+  std::unique_ptr<CodeCacheBundle> bundle =
+      CodeCacheBundle::Create(CodeCacheBundle::Serialize(entries));
+  ASSERT_TRUE(bundle);
+  EXPECT_EQ(2u, bundle->size());
+
+  base::Time response_time;
+  mojo_base::BigBuffer data;
+  ASSERT_TRUE(bundle->TakeEntry(url2, &response_time, &data));
+  EXPECT_EQ(time2, response_time);
+  EXPECT_EQ("data2", ToString(data));
+  ASSERT_TRUE(bundle->TakeEntry(url1, &response_time, &data));
+  EXPECT_EQ(time1, response_time);
+  EXPECT_EQ("data1", ToString(data));
+
+  // Entries are only returned once.
+  EXPECT_FALSE(bundle->TakeEntry(url1, &response_time, &data));
+  EXPECT_FALSE(bundle->TakeEntry(GURL("https://example.com/other.js"),
+                                 &response_time, &data));
+  EXPECT_EQ(0u, bundle->size());
+}
+
+TEST(CodeCacheBundleTest, Invalid) {
+  EXPECT_FALSE(CodeCacheBundle::Create(base::ReadOnlySharedMemoryRegion()));
+
+  // A region that does not hold a bundle.
+  base::MappedReadOnlyRegion region =
+      base::ReadOnlySharedMemoryRegion::Create(64);
+  ASSERT_TRUE(region.IsValid());
+  memset(region.mapping.memory(), 0xff, 64);
+  EXPECT_FALSE(CodeCacheBundle::Create(std::move(region.region)));
+}
+
+}  // namespace content
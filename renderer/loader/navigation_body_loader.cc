@@ -4,8 +4,14 @@
 
 #include "content/renderer/loader/navigation_body_loader.h"
 
+#include <algorithm>
+
 #include "base/bind.h"
 #include "base/macros.h"
+#include "base/metrics/field_trial_params.h"
+#include "base/metrics/histogram_macros.h"
+#include "base/sequence_checker.h"
+#include "base/task/thread_pool.h"
 #include "content/public/common/referrer.h"
 #include "content/renderer/loader/code_cache_loader_impl.h"
 #include "content/renderer/loader/resource_load_stats.h"
@@ -16,9 +22,122 @@
 
 namespace content {
 
+const base::Feature kOffMainThreadNavigationBodyLoading{
+    "OffMainThreadNavigationBodyLoading", base::FEATURE_DISABLED_BY_DEFAULT};
+
+namespace {
+
+// How many bytes the background sequence reads ahead of the chunks dispatched
+// on the main thread.
+constexpr base::FeatureParam<int> kMaxBufferedKb{
+    &kOffMainThreadNavigationBodyLoading, "max_buffered_kb", 512};
+
+}  // namespace
+
 // static
 constexpr uint32_t NavigationBodyLoader::kMaxNumConsumedBytesInTask;
 
+// Reads from the response body data pipe on a background sequence, and posts
+// what it reads to the NavigationBodyLoader in batches of chunks. Reading stops
+// while more than |max_buffered_bytes| have been posted and not dispatched to
+// the client yet, so that a busy main thread does not buffer the whole body.
+// Lives on the background sequence, apart from its constructor.
+class NavigationBodyLoader::OffThreadBodyReader {
+ public:
+  OffThreadBodyReader(mojo::ScopedDataPipeConsumerHandle handle,
+                      size_t max_buffered_bytes,
+                      scoped_refptr<base::SequencedTaskRunner> loader_runner,
+                      base::WeakPtr<NavigationBodyLoader> loader)
+      : handle_(std::move(handle)),
+        max_buffered_bytes_(max_buffered_bytes),
+        loader_runner_(std::move(loader_runner)),
+        loader_(std::move(loader)) {
+    DETACH_FROM_SEQUENCE(sequence_checker_);
+  }
+
+  ~OffThreadBodyReader() {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  }
+
+  void Start() {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+    watcher_ = std::make_unique<mojo::SimpleWatcher>(
+        FROM_HERE, mojo::SimpleWatcher::ArmingPolicy::MANUAL);
+    watcher_->Watch(handle_.get(), MOJO_HANDLE_SIGNAL_READABLE,
+                    base::BindRepeating(&OffThreadBodyReader::OnReadable,
+                                        base::Unretained(this)));
+    ReadFromDataPipe();
+  }
+
+  // Called when the loader has dispatched a chunk of |size| bytes.
+  void OnChunkDispatched(size_t size) {
+    DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+    DCHECK_GE(buffered_bytes_, size);
+    buffered_bytes_ -= size;
+    if (is_waiting_for_dispatch_ && buffered_bytes_ < max_buffered_bytes_) {
+      is_waiting_for_dispatch_ = false;
+      ReadFromDataPipe();
+    }
+  }
+
+ private:
+  void OnReadable(MojoResult unused) { ReadFromDataPipe(); }
+
+  void ReadFromDataPipe() {
+    TRACE_EVENT0("loading",
+                 "NavigationBodyLoader::OffThreadBodyReader::ReadFromDataPipe");
+    std::vector<std::vector<char>> chunks;
+    base::Optional<MojoResult> end_of_data_result;
+    while (true) {
+      if (buffered_bytes_ >= max_buffered_bytes_) {
+        is_waiting_for_dispatch_ = true;
+        break;
+      }
+      const void* buffer = nullptr;
+      uint32_t available = 0;
+      MojoResult result =
+          handle_->BeginReadData(&buffer, &available, MOJO_READ_DATA_FLAG_NONE);
+      if (result == MOJO_RESULT_SHOULD_WAIT) {
+        watcher_->ArmOrNotify();
+        break;
+      }
+      if (result != MOJO_RESULT_OK) {
+        end_of_data_result = result;
+        watcher_->Cancel();
+        break;
+      }
+      // Some clients cannot handle too large chunks, so keep them as large as
+      // on the main thread.
+      available = std::min(available, kMaxNumConsumedBytesInTask);
+      const char* data = static_cast<const char*>(buffer);
+      chunks.emplace_back(data, data + available);
+      buffered_bytes_ += available;
+      result = handle_->EndReadData(available);
+      DCHECK_EQ(MOJO_RESULT_OK, result);
+    }
+    if (chunks.empty() && !end_of_data_result)
+      return;
+    loader_runner_->PostTask(
+        FROM_HERE,
+        base::BindOnce(&NavigationBodyLoader::OnBodyReadOffMainThread, loader_,
+                       std::move(chunks), end_of_data_result));
+  }
+
+  mojo::ScopedDataPipeConsumerHandle handle_;
+  std::unique_ptr<mojo::SimpleWatcher> watcher_;
+  const size_t max_buffered_bytes_;
+  // Bytes posted to the loader and not dispatched yet.
+  size_t buffered_bytes_ = 0;
+  bool is_waiting_for_dispatch_ = false;
+  const scoped_refptr<base::SequencedTaskRunner> loader_runner_;
+  // Only dereferenced on |loader_runner_|.
+  const base::WeakPtr<NavigationBodyLoader> loader_;
+
+  SEQUENCE_CHECKER(sequence_checker_);
+
+  DISALLOW_COPY_AND_ASSIGN(OffThreadBodyReader);
+};
+
 // static
 void NavigationBodyLoader::FillNavigationParamsResponseAndBodyLoader(
     mojom::CommonNavigationParamsPtr common_params,
@@ -156,6 +275,11 @@ void NavigationBodyLoader::OnStartLoadingResponseBody(
   DCHECK(!has_received_completion_);
   has_received_body_handle_ = true;
   has_seen_end_of_data_ = false;
+  body_handle_received_time_ = base::TimeTicks::Now();
+  if (base::FeatureList::IsEnabled(kOffMainThreadNavigationBodyLoading)) {
+    StartReadingOffMainThread(std::move(handle));
+    return;
+  }
   handle_ = std::move(handle);
   DCHECK(handle_.is_valid());
   handle_watcher_.Watch(handle_.get(), MOJO_HANDLE_SIGNAL_READABLE,
@@ -179,6 +303,8 @@ void NavigationBodyLoader::SetDefersLoading(bool defers) {
   is_deferred_ = defers;
   if (handle_.is_valid())
     OnReadable(MOJO_RESULT_OK);
+  else if (off_thread_reader_)
+    DispatchPendingChunks();
 }
 
 void NavigationBodyLoader::StartLoadingBody(
@@ -294,6 +420,7 @@ void NavigationBodyLoader::ReadFromDataPipe() {
       return;
     }
     num_bytes_consumed += available;
+    WillDispatchBodyData();
     base::WeakPtr<NavigationBodyLoader> weak_self = weak_factory_.GetWeakPtr();
     client_->BodyDataReceived(
         base::make_span(static_cast<const char*>(buffer), available));
@@ -304,11 +431,99 @@ void NavigationBodyLoader::ReadFromDataPipe() {
   }
 }
 
+void NavigationBodyLoader::StartReadingOffMainThread(
+    mojo::ScopedDataPipeConsumerHandle handle) {
+  DCHECK(handle.is_valid());
+  off_thread_reader_task_runner_ = base::ThreadPool::CreateSequencedTaskRunner(
+      {base::TaskPriority::USER_BLOCKING});
+  off_thread_reader_ =
+      std::unique_ptr<OffThreadBodyReader, base::OnTaskRunnerDeleter>(
+          new OffThreadBodyReader(
+              std::move(handle),
+              static_cast<size_t>(std::max(kMaxBufferedKb.Get(), 1)) * 1024,
+              task_runner_, weak_factory_.GetWeakPtr()),
+          base::OnTaskRunnerDeleter(off_thread_reader_task_runner_));
+  // The reader is deleted on its own sequence, after the tasks posted to it.
+  off_thread_reader_task_runner_->PostTask(
+      FROM_HERE, base::BindOnce(&OffThreadBodyReader::Start,
+                                base::Unretained(off_thread_reader_.get())));
+}
+
+void NavigationBodyLoader::OnBodyReadOffMainThread(
+    std::vector<std::vector<char>> chunks,
+    base::Optional<MojoResult> end_of_data_result) {
+  for (auto& chunk : chunks)
+    pending_chunks_.push_back(std::move(chunk));
+  if (end_of_data_result)
+    off_thread_end_of_data_result_ = end_of_data_result;
+  DispatchPendingChunks();
+}
+
+void NavigationBodyLoader::DispatchPendingChunks() {
+  TRACE_EVENT1("loading", "NavigationBodyLoader::DispatchPendingChunks", "url",
+               resource_load_info_->original_url.possibly_invalid_spec());
+  if (has_seen_end_of_data_ || is_deferred_ || is_in_on_readable_)
+    return;
+  // Protect against reentrancy, as in OnReadable.
+  is_in_on_readable_ = true;
+  base::WeakPtr<NavigationBodyLoader> weak_self = weak_factory_.GetWeakPtr();
+  DispatchPendingChunksImpl();
+  if (!weak_self)
+    return;
+  is_in_on_readable_ = false;
+}
+
+void NavigationBodyLoader::DispatchPendingChunksImpl() {
+  uint32_t num_bytes_dispatched = 0;
+  while (!is_deferred_ && !pending_chunks_.empty()) {
+    if (num_bytes_dispatched >= kMaxNumConsumedBytesInTask) {
+      // We've already dispatched many bytes in this task. Defer the remaining
+      // to the next task.
+      task_runner_->PostTask(
+          FROM_HERE,
+          base::BindOnce(&NavigationBodyLoader::DispatchPendingChunks,
+                         weak_factory_.GetWeakPtr()));
+      return;
+    }
+    std::vector<char> chunk = std::move(pending_chunks_.front());
+    pending_chunks_.pop_front();
+    num_bytes_dispatched += chunk.size();
+    WillDispatchBodyData();
+    base::WeakPtr<NavigationBodyLoader> weak_self = weak_factory_.GetWeakPtr();
+    client_->BodyDataReceived(base::make_span(chunk));
+    if (!weak_self)
+      return;
+    off_thread_reader_task_runner_->PostTask(
+        FROM_HERE, base::BindOnce(&OffThreadBodyReader::OnChunkDispatched,
+                                  base::Unretained(off_thread_reader_.get()),
+                                  chunk.size()));
+  }
+  if (is_deferred_ || !pending_chunks_.empty() ||
+      !off_thread_end_of_data_result_) {
+    return;
+  }
+  if (*off_thread_end_of_data_result_ != MOJO_RESULT_FAILED_PRECONDITION) {
+    status_.error_code = net::ERR_FAILED;
+    has_received_completion_ = true;
+  }
+  has_seen_end_of_data_ = true;
+  NotifyCompletionIfAppropriate();
+}
+
+void NavigationBodyLoader::WillDispatchBodyData() {
+  if (has_dispatched_body_data_)
+    return;
+  has_dispatched_body_data_ = true;
+  UMA_HISTOGRAM_TIMES("Navigation.BodyLoader.TimeToFirstBodyData",
+                      base::TimeTicks::Now() - body_handle_received_time_);
+}
+
 void NavigationBodyLoader::NotifyCompletionIfAppropriate() {
   if (!has_received_completion_ || !has_seen_end_of_data_)
     return;
 
   handle_watcher_.Cancel();
+  off_thread_reader_.reset();
 
   base::Optional<blink::WebURLError> error;
   if (status_.error_code != net::OK) {
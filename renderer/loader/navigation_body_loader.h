@@ -8,12 +8,18 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include <memory>
 #include <utility>
 #include <vector>
 
+#include "base/containers/circular_deque.h"
+#include "base/feature_list.h"
 #include "base/macros.h"
 #include "base/memory/weak_ptr.h"
+#include "base/optional.h"
+#include "base/sequenced_task_runner.h"
 #include "base/single_thread_task_runner.h"
+#include "base/time/time.h"
 #include "content/common/content_export.h"
 #include "content/common/navigation_params.h"
 #include "mojo/public/cpp/base/big_buffer.h"
@@ -38,6 +44,11 @@ namespace content {
 
 class CodeCacheLoaderImpl;
 
+// Reads the response body on a background sequence, so that a busy main thread
+// does not delay reading from the data pipe. The main thread only dispatches
+// the chunks read to Blink.
+CONTENT_EXPORT extern const base::Feature kOffMainThreadNavigationBodyLoading;
+
 // Navigation request is started in the browser process, and all redirects
 // and final response are received there. Then we pass URLLoader and
 // URLLoaderClient bindings to the renderer process, and create an instance
@@ -86,6 +97,10 @@ class CONTENT_EXPORT NavigationBodyLoader
   //   notify client about data
   // NotifyCompletionIfAppropriate
   //   notify client about completion
+  //
+  // With kOffMainThreadNavigationBodyLoading, an OffThreadBodyReader reads
+  // from the pipe instead, and OnBodyReadOffMainThread and
+  // DispatchPendingChunks take the place of OnReadable.
 
   // The maximal number of bytes consumed in a task. When there are more bytes
   // in the data pipe, they will be consumed in following tasks. Setting a too
@@ -94,6 +109,8 @@ class CONTENT_EXPORT NavigationBodyLoader
   // (512k for example).
   static constexpr uint32_t kMaxNumConsumedBytesInTask = 64 * 1024;
 
+  class OffThreadBodyReader;
+
   NavigationBodyLoader(
       network::mojom::URLResponseHeadPtr response_head,
       mojo::ScopedDataPipeConsumerHandle response_body,
@@ -134,6 +151,18 @@ class CONTENT_EXPORT NavigationBodyLoader
   void NotifyCompletionIfAppropriate();
   void BindURLLoaderAndStartLoadingResponseBodyIfPossible();
 
+  void StartReadingOffMainThread(mojo::ScopedDataPipeConsumerHandle handle);
+  // Receives the chunks read by |off_thread_reader_|. |end_of_data_result| is
+  // set to the result of the last read once there is nothing more to read.
+  void OnBodyReadOffMainThread(std::vector<std::vector<char>> chunks,
+                               base::Optional<MojoResult> end_of_data_result);
+  // Like OnReadable, dispatches |pending_chunks_| to the client.
+  void DispatchPendingChunks();
+  void DispatchPendingChunksImpl();
+
+  // Records the time to the first BodyDataReceived notification.
+  void WillDispatchBodyData();
+
   // Navigation parameters.
   const int render_frame_id_;
   network::mojom::URLResponseHeadPtr response_head_;
@@ -154,6 +183,20 @@ class CONTENT_EXPORT NavigationBodyLoader
   mojo::ScopedDataPipeConsumerHandle handle_;
   mojo::SimpleWatcher handle_watcher_;
 
+  // These are live while loading the body off the main thread. The reader
+  // lives on |off_thread_reader_task_runner_|.
+  scoped_refptr<base::SequencedTaskRunner> off_thread_reader_task_runner_;
+  std::unique_ptr<OffThreadBodyReader, base::OnTaskRunnerDeleter>
+      off_thread_reader_{nullptr, base::OnTaskRunnerDeleter(nullptr)};
+  // Chunks read by |off_thread_reader_| and not dispatched yet.
+  base::circular_deque<std::vector<char>> pending_chunks_;
+  // The result of the last read of |off_thread_reader_|, once it has read
+  // everything.
+  base::Optional<MojoResult> off_thread_end_of_data_result_;
+
+  base::TimeTicks body_handle_received_time_;
+  bool has_dispatched_body_data_ = false;
+
   // This loader is live while retrieving the code cache.
   std::unique_ptr<CodeCacheLoaderImpl> code_cache_loader_;
 
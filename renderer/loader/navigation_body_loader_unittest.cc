@@ -8,6 +8,8 @@
 #include "base/macros.h"
 #include "base/run_loop.h"
 #include "base/single_thread_task_runner.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/task_environment.h"
 #include "content/common/navigation_params.mojom.h"
 #include "mojo/public/cpp/bindings/remote.h"
@@ -289,6 +291,99 @@ TEST_F(NavigationBodyLoaderTest, SetDefersLoadingFromCloseThenOnComplete) {
   EXPECT_TRUE(error_.has_value());
 }
 
+// Reads the body off the main thread, buffering at most 1KB ahead of the
+// client.
+class OffMainThreadNavigationBodyLoaderTest : public NavigationBodyLoaderTest {
+ protected:
+  OffMainThreadNavigationBodyLoaderTest() {
+    scoped_feature_list_.InitAndEnableFeatureWithParameters(
+        kOffMainThreadNavigationBodyLoading, {{"max_buffered_kb", "1"}});
+  }
+
+  base::test::ScopedFeatureList scoped_feature_list_;
+};
+
+TEST_F(OffMainThreadNavigationBodyLoaderTest, DataReceived) {
+  base::HistogramTester histogram_tester;
+  CreateBodyLoader();
+  StartLoading();
+  ExpectDataReceived();
+  Write("hello");
+  Wait();
+  EXPECT_EQ("hello", TakeDataReceived());
+  histogram_tester.ExpectTotalCount(
+      "Navigation.BodyLoader.TimeToFirstBodyData", 1);
+}
+
+TEST_F(OffMainThreadNavigationBodyLoaderTest, DestroyFromDataReceived) {
+  CreateBodyLoader();
+  StartLoading();
+  ExpectDataReceived();
+  destroy_loader_ = true;
+  Write("hello");
+  Wait();
+  EXPECT_EQ("hello", TakeDataReceived());
+  EXPECT_FALSE(loader_);
+}
+
+TEST_F(OffMainThreadNavigationBodyLoaderTest, StartDeferred) {
+  CreateBodyLoader();
+  loader_->SetDefersLoading(true);
+  StartLoading();
+  Write("hello");
+  base::RunLoop().RunUntilIdle();
+  ExpectDataReceived();
+  loader_->SetDefersLoading(false);
+  Wait();
+  EXPECT_EQ("hello", TakeDataReceived());
+}
+
+TEST_F(OffMainThreadNavigationBodyLoaderTest, Backpressure) {
+  CreateBodyLoader();
+  loader_->SetDefersLoading(true);
+  StartLoading();
+  const std::string first(1024, 'a');
+  const std::string second(1024, 'b');
+  Write(first);
+  base::RunLoop().RunUntilIdle();
+  // The first 1KB has been read from the pipe, which the reader stops reading
+  // until it is dispatched.
+  Write(second);
+  base::RunLoop().RunUntilIdle();
+  uint32_t size = 1;
+  EXPECT_EQ(MOJO_RESULT_SHOULD_WAIT, writer_->WriteData("c", &size, kNone));
+
+  ExpectDataReceived();
+  loader_->SetDefersLoading(false);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(first + second, TakeDataReceived());
+}
+
+TEST_F(OffMainThreadNavigationBodyLoaderTest, OnCompleteThenClose) {
+  CreateBodyLoader();
+  StartLoading();
+  Complete(net::ERR_FAILED);
+  ExpectFinished();
+  writer_.reset();
+  Wait();
+  EXPECT_TRUE(error_.has_value());
+}
+
+TEST_F(OffMainThreadNavigationBodyLoaderTest, CloseThenOnComplete) {
+  CreateBodyLoader();
+  StartLoading();
+  ExpectDataReceived();
+  Write("hello");
+  writer_.reset();
+  base::RunLoop().RunUntilIdle();
+  Wait();
+  EXPECT_EQ("hello", TakeDataReceived());
+  ExpectFinished();
+  Complete(net::OK);
+  Wait();
+  EXPECT_FALSE(error_.has_value());
+}
+
 // Tests that FillNavigationParamsResponseAndBodyLoader populates security
 // details on the response when they are present.
 TEST_F(NavigationBodyLoaderTest, FillResponseWithSecurityDetails) {
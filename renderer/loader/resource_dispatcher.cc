@@ -13,6 +13,7 @@
 #include "base/compiler_specific.h"
 #include "base/debug/alias.h"
 #include "base/files/file_path.h"
+#include "base/metrics/field_trial_params.h"
 #include "base/metrics/histogram_macros.h"
 #include "base/rand_util.h"
 #include "base/strings/string_util.h"
@@ -50,8 +51,16 @@
 
 namespace content {
 
+const base::Feature kBatchedDeferredMessageFlush{
+    "BatchedDeferredMessageFlush", base::FEATURE_DISABLED_BY_DEFAULT};
+
 namespace {
 
+// How long a task flushing deferred messages runs before yielding. At least
+// one request is flushed per task.
+constexpr base::FeatureParam<int> kFlushBudgetMs{
+    &kBatchedDeferredMessageFlush, "flush_budget_ms", 4};
+
 // Converts |time| from a remote to local TimeTicks, overwriting the original
 // value.
 void RemoteToLocalTimeTicks(
@@ -222,9 +231,15 @@ void ResourceDispatcher::OnReceivedRedirect(
                                     redirect_info.new_url);
 
   ToLocalURLResponseHead(*request_info, *response_head);
+  // The load stats only read these fields of the redirect response, so hand
+  // the response itself to the peer rather than a full copy of it.
+  auto redirect_response = network::mojom::URLResponseHead::New();
+  redirect_response->network_accessed = response_head->network_accessed;
+  redirect_response->headers = response_head->headers;
+  redirect_response->remote_endpoint = response_head->remote_endpoint;
   std::vector<std::string> removed_headers;
   if (request_info->peer->OnReceivedRedirect(
-          redirect_info, response_head.Clone(), &removed_headers)) {
+          redirect_info, std::move(response_head), &removed_headers)) {
     // Double-check if the request is still around. The call above could
     // potentially remove it.
     request_info = GetPendingRequestInfo(request_id);
@@ -238,7 +253,7 @@ void ResourceDispatcher::OnReceivedRedirect(
     request_info->has_pending_redirect = true;
     NotifyResourceRedirectReceived(request_info->render_frame_id,
                                    request_info->resource_load_info.get(),
-                                   redirect_info, std::move(response_head));
+                                   redirect_info, std::move(redirect_response));
     if (!request_info->is_deferred)
       FollowPendingRedirect(request_info);
   } else {
@@ -377,6 +392,92 @@ void ResourceDispatcher::SetDefersLoading(int request_id, bool value) {
   }
 }
 
+void ResourceDispatcher::ScheduleFlushDeferredMessages(
+    int request_id,
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner) {
+  PendingRequestInfo* request_info = GetPendingRequestInfo(request_id);
+  if (!request_info)
+    return;
+  auto result = requests_to_flush_.emplace(request_info->render_frame_id,
+                                           base::circular_deque<int>());
+  if (result.second) {
+    PostFlushDeferredMessagesBatch(request_info->render_frame_id,
+                                   std::move(task_runner));
+  }
+  result.first->second.push_back(request_id);
+}
+
+void ResourceDispatcher::PostFlushDeferredMessagesBatch(
+    int render_frame_id,
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner) {
+  base::ScopedClosureRunner on_dropped(base::BindOnce(
+      &ResourceDispatcher::OnFlushDeferredMessagesBatchDropped,
+      weak_factory_.GetWeakPtr(), render_frame_id));
+  task_runner->PostTask(
+      FROM_HERE,
+      base::BindOnce(&ResourceDispatcher::FlushDeferredMessagesBatch,
+                     weak_factory_.GetWeakPtr(), render_frame_id, task_runner,
+                     std::move(on_dropped)));
+}
+
+void ResourceDispatcher::FlushDeferredMessagesBatch(
+    int render_frame_id,
+    scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+    base::ScopedClosureRunner on_dropped) {
+  TRACE_EVENT1("loading", "ResourceDispatcher::FlushDeferredMessagesBatch",
+               "render_frame_id", render_frame_id);
+  // The task runs, so it is not dropped.
+  ignore_result(on_dropped.Release());
+  auto it = requests_to_flush_.find(render_frame_id);
+  if (it == requests_to_flush_.end())
+    return;
+
+  const base::TimeTicks start_time = base::TimeTicks::Now();
+  const base::TimeDelta budget =
+      base::TimeDelta::FromMilliseconds(kFlushBudgetMs.Get());
+  base::WeakPtr<ResourceDispatcher> weak_this = weak_factory_.GetWeakPtr();
+  int num_flushed_requests = 0;
+  bool has_yielded = false;
+  while (!it->second.empty()) {
+    if (num_flushed_requests > 0 &&
+        base::TimeTicks::Now() - start_time >= budget) {
+      // Leave the remaining requests to the next task, so that other tasks on
+      // the main thread get to run.
+      PostFlushDeferredMessagesBatch(render_frame_id, task_runner);
+      has_yielded = true;
+      break;
+    }
+    const int request_id = it->second.front();
+    it->second.pop_front();
+    ++num_flushed_requests;
+    PendingRequestInfo* request_info = GetPendingRequestInfo(request_id);
+    if (!request_info)
+      continue;
+    // Flushing may start or flush other requests, which may add to this
+    // batch.
+    request_info->url_loader_client->FlushDeferredMessages();
+    if (!weak_this)
+      return;
+    it = requests_to_flush_.find(render_frame_id);
+    DCHECK(it != requests_to_flush_.end());
+  }
+  if (!has_yielded)
+    requests_to_flush_.erase(it);
+
+  UMA_HISTOGRAM_COUNTS_1000("Renderer.DeferredMessageFlush.RequestCount",
+                            num_flushed_requests);
+  UMA_HISTOGRAM_CUSTOM_MICROSECONDS_TIMES(
+      "Renderer.DeferredMessageFlush.TaskDuration",
+      base::TimeTicks::Now() - start_time,
+      base::TimeDelta::FromMicroseconds(1), base::TimeDelta::FromSeconds(1),
+      50);
+}
+
+void ResourceDispatcher::OnFlushDeferredMessagesBatchDropped(
+    int render_frame_id) {
+  requests_to_flush_.erase(render_frame_id);
+}
+
 void ResourceDispatcher::DidChangePriority(int request_id,
                                            net::RequestPriority new_priority,
                                            int intra_priority_value) {
@@ -14,7 +14,9 @@
 #include <string>
 #include <vector>
 
+#include "base/callback_helpers.h"
 #include "base/containers/circular_deque.h"
+#include "base/feature_list.h"
 #include "base/macros.h"
 #include "base/memory/weak_ptr.h"
 #include "base/single_thread_task_runner.h"
@@ -64,6 +66,10 @@ class ResourceDispatcherDelegate;
 struct SyncLoadResponse;
 class URLLoaderClientImpl;
 
+// Replays the messages deferred by the requests of a frame from one task, up
+// to a time budget per task, rather than from one task per request.
+CONTENT_EXPORT extern const base::Feature kBatchedDeferredMessageFlush;
+
 // This class serves as a communication interface to the ResourceDispatcherHost
 // in the browser process. It can be used from any child process.
 // Virtual methods are for tests.
@@ -246,9 +252,31 @@ class CONTENT_EXPORT ResourceDispatcher {
 
   void ContinueForNavigation(int request_id);
 
+  // Schedules flushing the deferred messages of |request_id|, together with
+  // the other requests of its frame. The batch is flushed on the
+  // |task_runner| of the request that started it. Used with
+  // kBatchedDeferredMessageFlush.
+  void ScheduleFlushDeferredMessages(
+      int request_id,
+      scoped_refptr<base::SingleThreadTaskRunner> task_runner);
+  void PostFlushDeferredMessagesBatch(
+      int render_frame_id,
+      scoped_refptr<base::SingleThreadTaskRunner> task_runner);
+  // |on_dropped| clears the batch if the task is destroyed without running,
+  // e.g. when the frame's task queues shut down.
+  void FlushDeferredMessagesBatch(
+      int render_frame_id,
+      scoped_refptr<base::SingleThreadTaskRunner> task_runner,
+      base::ScopedClosureRunner on_dropped);
+  void OnFlushDeferredMessagesBatchDropped(int render_frame_id);
+
   // All pending requests issued to the host
   PendingRequestMap pending_requests_;
 
+  // The requests to flush the deferred messages of, by render frame id. A
+  // frame is in the map while a flush task for it is posted or running.
+  std::map<int, base::circular_deque<int>> requests_to_flush_;
+
   ResourceDispatcherDelegate* delegate_;
 
   base::WaitableEvent* terminate_sync_load_event_ = nullptr;
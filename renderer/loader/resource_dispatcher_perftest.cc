@@ -0,0 +1,200 @@
+// Copyright 2020 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/run_loop.h"
+#include "base/test/task_environment.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/timer/elapsed_timer.h"
+#include "content/renderer/loader/resource_dispatcher.h"
+#include "content/renderer/loader/test_request_peer.h"
+#include "content/renderer/render_thread_impl.h"
+#include "mojo/public/cpp/bindings/pending_receiver.h"
+#include "mojo/public/cpp/bindings/pending_remote.h"
+#include "mojo/public/cpp/bindings/remote.h"
+#include "net/http/http_response_headers.h"
+#include "net/traffic_annotation/network_traffic_annotation_test_helper.h"
+#include "net/url_request/redirect_info.h"
+#include "services/network/public/cpp/resource_request.h"
+#include "services/network/public/cpp/weak_wrapper_shared_url_loader_factory.h"
+#include "services/network/public/mojom/url_loader.mojom.h"
+#include "services/network/public/mojom/url_loader_factory.mojom.h"
+#include "services/network/public/mojom/url_response_head.mojom.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "third_party/blink/public/platform/scheduler/test/renderer_scheduler_test_support.h"
+#include "url/gurl.h"
+
+namespace content {
+namespace {
+
+constexpr char kMetricPrefixResourceDispatcher[] = "ResourceDispatcher.";
+constexpr char kMetricResponseTimeUs[] = "response_time";
+constexpr char kMetricRedirectTimeUs[] = "redirect_time";
+
+constexpr char kUrl[] = "https://example.com/script.js";
+constexpr char kRedirectUrl[] = "https://cdn.example.com/script.js";
+// Subresources loaded by a page.
+constexpr int kRequestCount = 200;
+
+// Response headers of a typical cacheable subresource served from a CDN.
+constexpr char kResponseHeaders[] =
+    "HTTP/1.1 200 OK\n"
+    "Content-Type: application/javascript; charset=utf-8\n"
+    "Content-Length: 48213\n"
+    "Content-Encoding: br\n"
+    "Cache-Control: public, max-age=31536000, immutable\n"
+    "Date: Mon, 01 Jun 2020 12:00:00 GMT\n"
+    "Last-Modified: Fri, 29 May 2020 08:30:00 GMT\n"
+    "ETag: \"5ed0c4a8-bc55\"\n"
+    "Expires: Tue, 01 Jun 2021 12:00:00 GMT\n"
+    "Vary: Accept-Encoding\n"
+    "Access-Control-Allow-Origin: *\n"
+    "Timing-Allow-Origin: *\n"
+    "Strict-Transport-Security: max-age=63072000; includeSubDomains\n"
+    "X-Content-Type-Options: nosniff\n"
+    "Cross-Origin-Resource-Policy: cross-origin\n"
+    "Server: cdn\n"
+    "Age: 3600\n"
+    "Accept-Ranges: bytes\n"
+    "Alt-Svc: h3-29=\":443\"; ma=86400\n\n";
+
+constexpr char kRedirectHeaders[] =
+    "HTTP/1.1 302 Found\n"
+    "Location: https://cdn.example.com/script.js\n"
+    "Cache-Control: no-cache\n"
+    "Date: Mon, 01 Jun 2020 12:00:00 GMT\n"
+    "Content-Length: 0\n"
+    "Server: frontend\n\n";
+
+network::mojom::URLResponseHeadPtr CreateResponseHead(const char* headers) {
+  std::string raw_headers(headers);
+  std::replace(raw_headers.begin(), raw_headers.end(), '\n', '\0');
+  auto head = network::mojom::URLResponseHead::New();
+  head->headers = base::MakeRefCounted<net::HttpResponseHeaders>(raw_headers);
+  head->mime_type = "application/javascript";
+  head->charset = "utf-8";
+  head->network_accessed = true;
+  return head;
+}
+
+// Starts |kRequestCount| requests, and measures how long the renderer takes to
+// dispatch one response or redirect to its peer, from the URLLoaderClient
+// pipe through URLLoaderClientImpl and ResourceDispatcher, including the load
+// stats reported for the frame. The requests are loaded on the main thread, as
+// the load stats are only reported when there is one.
+class ResourceDispatcherPerfTest : public testing::Test,
+                                   public network::mojom::URLLoaderFactory {
+ protected:
+  ResourceDispatcherPerfTest() : dispatcher_(new ResourceDispatcher()) {
+    RenderThreadImpl::SetMainTaskRunnerForTesting(
+        base::ThreadTaskRunnerHandle::Get());
+  }
+
+  ~ResourceDispatcherPerfTest() override {
+    dispatcher_.reset();
+    base::RunLoop().RunUntilIdle();
+    RenderThreadImpl::SetMainTaskRunnerForTesting(nullptr);
+  }
+
+  void CreateLoaderAndStart(
+      mojo::PendingReceiver<network::mojom::URLLoader> receiver,
+      int32_t routing_id,
+      int32_t request_id,
+      uint32_t options,
+      const network::ResourceRequest& url_request,
+      mojo::PendingRemote<network::mojom::URLLoaderClient> client,
+      const net::MutableNetworkTrafficAnnotationTag& annotation) override {
+    loaders_.push_back(std::move(receiver));
+    clients_.emplace_back(std::move(client));
+  }
+
+  void Clone(mojo::PendingReceiver<network::mojom::URLLoaderFactory> receiver)
+      override {
+    NOTREACHED();
+  }
+
+  void StartRequests() {
+    for (int i = 0; i < kRequestCount; ++i) {
+      auto request = std::make_unique<network::ResourceRequest>();
+      request->method = "GET";
+      request->url = GURL(kUrl);
+      peer_contexts_.push_back(std::make_unique<TestRequestPeer::Context>());
+      TestRequestPeer::Context* peer_context = peer_contexts_.back().get();
+      peer_context->request_id = dispatcher_->StartAsync(
+          std::move(request), 0,
+          blink::scheduler::GetSingleThreadTaskRunnerForTesting(),
+          TRAFFIC_ANNOTATION_FOR_TESTS, false,
+          std::make_unique<TestRequestPeer>(dispatcher_.get(), peer_context),
+          base::MakeRefCounted<network::WeakWrapperSharedURLLoaderFactory>(
+              this),
+          std::vector<std::unique_ptr<blink::URLLoaderThrottle>>(),
+          nullptr /* navigation_response_override_params */);
+    }
+    base::RunLoop().RunUntilIdle();
+    ASSERT_EQ(static_cast<size_t>(kRequestCount), clients_.size());
+  }
+
+  base::test::SingleThreadTaskEnvironment task_environment_;
+  std::unique_ptr<ResourceDispatcher> dispatcher_;
+  std::vector<std::unique_ptr<TestRequestPeer::Context>> peer_contexts_;
+  std::vector<mojo::PendingReceiver<network::mojom::URLLoader>> loaders_;
+  std::vector<mojo::Remote<network::mojom::URLLoaderClient>> clients_;
+};
+
+TEST_F(ResourceDispatcherPerfTest, Response) {
+  StartRequests();
+  std::vector<network::mojom::URLResponseHeadPtr> heads;
+  for (int i = 0; i < kRequestCount; ++i)
+    heads.push_back(CreateResponseHead(kResponseHeaders));
+
+  perf_test::PerfResultReporter reporter(kMetricPrefixResourceDispatcher,
+                                         "subresource");
+  reporter.RegisterImportantMetric(kMetricResponseTimeUs, "us");
+
+  base::ElapsedTimer timer;
+  for (int i = 0; i < kRequestCount; ++i)
+    clients_[i]->OnReceiveResponse(std::move(heads[i]));
+  base::RunLoop().RunUntilIdle();
+  reporter.AddResult(kMetricResponseTimeUs,
+                     timer.Elapsed().InMicrosecondsF() / kRequestCount);
+
+  for (const auto& peer_context : peer_contexts_)
+    EXPECT_TRUE(peer_context->received_response);
+}
+
+TEST_F(ResourceDispatcherPerfTest, Redirect) {
+  StartRequests();
+  net::RedirectInfo redirect_info;
+  redirect_info.status_code = 302;
+  redirect_info.new_method = "GET";
+  redirect_info.new_url = GURL(kRedirectUrl);
+  std::vector<network::mojom::URLResponseHeadPtr> heads;
+  for (int i = 0; i < kRequestCount; ++i)
+    heads.push_back(CreateResponseHead(kRedirectHeaders));
+
+  perf_test::PerfResultReporter reporter(kMetricPrefixResourceDispatcher,
+                                         "subresource");
+  reporter.RegisterImportantMetric(kMetricRedirectTimeUs, "us");
+
+  base::ElapsedTimer timer;
+  for (int i = 0; i < kRequestCount; ++i)
+    clients_[i]->OnReceiveRedirect(redirect_info, std::move(heads[i]));
+  base::RunLoop().RunUntilIdle();
+  reporter.AddResult(kMetricRedirectTimeUs,
+                     timer.Elapsed().InMicrosecondsF() / kRequestCount);
+
+  for (const auto& peer_context : peer_contexts_)
+    EXPECT_EQ(1, peer_context->seen_redirects);
+}
+
+}  // namespace
+}  // namespace content
@@ -42,6 +42,8 @@ blink::mojom::ResourceLoadInfoPtr NotifyResourceLoadInitiated(
     network::mojom::RequestDestination request_destination,
     net::RequestPriority request_priority);
 
+// Only reads |network_accessed|, |headers| and |remote_endpoint| from
+// |redirect_response|.
 void NotifyResourceRedirectReceived(
     int render_frame_id,
     blink::mojom::ResourceLoadInfo* resource_load_info,
@@ -20,6 +20,8 @@ TestRequestPeer::~TestRequestPeer() = default;
 
 void TestRequestPeer::OnUploadProgress(uint64_t position, uint64_t size) {
   EXPECT_FALSE(context_->complete);
+  ++context_->seen_upload_progress;
+  context_->upload_position = position;
 }
 
 bool TestRequestPeer::OnReceivedRedirect(
@@ -56,6 +56,10 @@ class TestRequestPeer : public RequestPeer {
     // Number of total redirects seen.
     int seen_redirects = 0;
 
+    // Number of upload progress notifications seen, and the last position.
+    int seen_upload_progress = 0;
+    uint64_t upload_position = 0;
+
     bool cancel_on_receive_response = false;
     bool cancel_on_receive_data = false;
     bool received_response = false;
@@ -37,6 +37,10 @@ class URLLoaderClientImpl::DeferredMessage {
   virtual void HandleMessage(ResourceDispatcher* dispatcher,
                              int request_id) = 0;
   virtual bool IsCompletionMessage() const = 0;
+  // Returns true if |this| took over |message|, the message deferred right
+  // after it, so that |message| does not need to be dispatched.
+  virtual bool MergeWith(const DeferredMessage& message) { return false; }
+  virtual bool IsUploadProgressMessage() const { return false; }
   virtual ~DeferredMessage() = default;
 
  private:
@@ -92,10 +96,21 @@ class URLLoaderClientImpl::DeferredOnUploadProgress final
     dispatcher->OnUploadProgress(request_id, current_, total_);
   }
   bool IsCompletionMessage() const override { return false; }
+  bool MergeWith(const DeferredMessage& message) override {
+    // Only the latest upload progress matters to the client.
+    if (!message.IsUploadProgressMessage())
+      return false;
+    const auto& upload_progress =
+        static_cast<const DeferredOnUploadProgress&>(message);
+    current_ = upload_progress.current_;
+    total_ = upload_progress.total_;
+    return true;
+  }
+  bool IsUploadProgressMessage() const override { return true; }
 
  private:
-  const int64_t current_;
-  const int64_t total_;
+  int64_t current_;
+  int64_t total_;
 };
 
 class URLLoaderClientImpl::DeferredOnReceiveCachedMetadata final
@@ -164,6 +179,11 @@ void URLLoaderClientImpl::SetDefersLoading() {
 void URLLoaderClientImpl::UnsetDefersLoading() {
   is_deferred_ = false;
 
+  if (base::FeatureList::IsEnabled(kBatchedDeferredMessageFlush)) {
+    resource_dispatcher_->ScheduleFlushDeferredMessages(request_id_,
+                                                        task_runner_);
+    return;
+  }
   task_runner_->PostTask(
       FROM_HERE, base::BindOnce(&URLLoaderClientImpl::FlushDeferredMessages,
                                 weak_factory_.GetWeakPtr()));
@@ -353,6 +373,11 @@ void URLLoaderClientImpl::StoreAndDispatch(
     std::unique_ptr<DeferredMessage> message) {
   DCHECK(NeedsStoringMessage());
   if (is_deferred_) {
+    if (base::FeatureList::IsEnabled(kBatchedDeferredMessageFlush) &&
+        !deferred_messages_.empty() &&
+        deferred_messages_.back()->MergeWith(*message)) {
+      return;
+    }
     deferred_messages_.push_back(std::move(message));
   } else if (deferred_messages_.size() > 0 ||
              accumulated_transfer_size_diff_during_deferred_ > 0) {
@@ -5,7 +5,10 @@
 #include "content/renderer/loader/url_loader_client_impl.h"
 
 #include <vector>
+#include "base/bind_helpers.h"
 #include "base/run_loop.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/task_environment.h"
 #include "content/renderer/loader/navigation_response_override_parameters.h"
 #include "content/renderer/loader/resource_dispatcher.h"
@@ -78,6 +81,10 @@ class URLLoaderClientImplTest : public ::testing::Test,
       mojo::PendingRemote<network::mojom::URLLoaderClient> client,
       const net::MutableNetworkTrafficAnnotationTag& traffic_annotation)
       override {
+    if (url_loader_client_) {
+      other_url_loader_clients_.emplace_back(std::move(client));
+      return;
+    }
     url_loader_client_.Bind(std::move(client));
   }
 
@@ -100,6 +107,9 @@ class URLLoaderClientImplTest : public ::testing::Test,
   TestRequestPeer::Context request_peer_context_;
   int request_id_ = 0;
   mojo::Remote<network::mojom::URLLoaderClient> url_loader_client_;
+  // The clients of the requests started by the tests themselves.
+  std::vector<mojo::Remote<network::mojom::URLLoaderClient>>
+      other_url_loader_clients_;
 };
 
 TEST_F(URLLoaderClientImplTest, OnReceiveResponse) {
@@ -464,4 +474,102 @@ TEST_F(URLLoaderClientImplTest,
   EXPECT_FALSE(request_peer_context_.cancelled);
 }
 
+class URLLoaderClientImplBatchedFlushTest : public URLLoaderClientImplTest {
+ protected:
+  URLLoaderClientImplBatchedFlushTest() {
+    // A budget large enough for every test batch to be flushed in one task.
+    scoped_feature_list_.InitAndEnableFeatureWithParameters(
+        kBatchedDeferredMessageFlush, {{"flush_budget_ms", "10000"}});
+  }
+
+  base::test::ScopedFeatureList scoped_feature_list_;
+};
+
+TEST_F(URLLoaderClientImplBatchedFlushTest, Defer) {
+  base::HistogramTester histogram_tester;
+  network::URLLoaderCompletionStatus status;
+
+  dispatcher_->SetDefersLoading(request_id_, true);
+  url_loader_client_->OnReceiveResponse(network::mojom::URLResponseHead::New());
+  mojo::DataPipe data_pipe;
+  data_pipe.producer_handle.reset();  // Empty body.
+  url_loader_client_->OnStartLoadingResponseBody(
+      std::move(data_pipe.consumer_handle));
+  url_loader_client_->OnComplete(status);
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(request_peer_context_.received_response);
+  EXPECT_FALSE(request_peer_context_.complete);
+
+  dispatcher_->SetDefersLoading(request_id_, false);
+  EXPECT_FALSE(request_peer_context_.received_response);
+  EXPECT_FALSE(request_peer_context_.complete);
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(request_peer_context_.received_response);
+  EXPECT_TRUE(request_peer_context_.complete);
+  histogram_tester.ExpectUniqueSample(
+      "Renderer.DeferredMessageFlush.RequestCount", 1, 1);
+}
+
+// The requests of a frame undeferred together are flushed from one task.
+TEST_F(URLLoaderClientImplBatchedFlushTest, FlushRequestsOfFrameInOneTask) {
+  constexpr size_t kOtherRequestCount = 3;
+  std::vector<std::unique_ptr<TestRequestPeer::Context>> peer_contexts;
+  for (size_t i = 0; i < kOtherRequestCount; ++i) {
+    peer_contexts.push_back(std::make_unique<TestRequestPeer::Context>());
+    peer_contexts.back()->request_id = dispatcher_->StartAsync(
+        std::make_unique<network::ResourceRequest>(), 0 /* routing_id */,
+        blink::scheduler::GetSingleThreadTaskRunnerForTesting(),
+        TRAFFIC_ANNOTATION_FOR_TESTS, false,
+        std::make_unique<TestRequestPeer>(dispatcher_.get(),
+                                          peer_contexts.back().get()),
+        base::MakeRefCounted<network::WeakWrapperSharedURLLoaderFactory>(this),
+        std::vector<std::unique_ptr<blink::URLLoaderThrottle>>(),
+        nullptr /* navigation_response_override_params */);
+  }
+  base::RunLoop().RunUntilIdle();
+  ASSERT_EQ(kOtherRequestCount, other_url_loader_clients_.size());
+
+  base::HistogramTester histogram_tester;
+  dispatcher_->SetDefersLoading(request_id_, true);
+  for (size_t i = 0; i < kOtherRequestCount; ++i)
+    dispatcher_->SetDefersLoading(peer_contexts[i]->request_id, true);
+  url_loader_client_->OnReceiveResponse(network::mojom::URLResponseHead::New());
+  for (auto& client : other_url_loader_clients_)
+    client->OnReceiveResponse(network::mojom::URLResponseHead::New());
+  base::RunLoop().RunUntilIdle();
+  EXPECT_FALSE(request_peer_context_.received_response);
+
+  dispatcher_->SetDefersLoading(request_id_, false);
+  for (size_t i = 0; i < kOtherRequestCount; ++i)
+    dispatcher_->SetDefersLoading(peer_contexts[i]->request_id, false);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_TRUE(request_peer_context_.received_response);
+  for (size_t i = 0; i < kOtherRequestCount; ++i)
+    EXPECT_TRUE(peer_contexts[i]->received_response);
+  histogram_tester.ExpectUniqueSample(
+      "Renderer.DeferredMessageFlush.RequestCount",
+      static_cast<int>(kOtherRequestCount + 1), 1);
+}
+
+// Upload progress deferred in a row is dispatched once, with the latest
+// position.
+TEST_F(URLLoaderClientImplBatchedFlushTest, MergeUploadProgress) {
+  dispatcher_->SetDefersLoading(request_id_, true);
+  url_loader_client_->OnUploadProgress(1, 10, base::DoNothing());
+  url_loader_client_->OnUploadProgress(5, 10, base::DoNothing());
+  url_loader_client_->OnUploadProgress(10, 10, base::DoNothing());
+  url_loader_client_->OnReceiveResponse(network::mojom::URLResponseHead::New());
+
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(0, request_peer_context_.seen_upload_progress);
+
+  dispatcher_->SetDefersLoading(request_id_, false);
+  base::RunLoop().RunUntilIdle();
+  EXPECT_EQ(1, request_peer_context_.seen_upload_progress);
+  EXPECT_EQ(10u, request_peer_context_.upload_position);
+  EXPECT_TRUE(request_peer_context_.received_response);
+}
+
 }  // namespace content
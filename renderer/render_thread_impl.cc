@@ -60,6 +60,7 @@
 #include "content/child/runtime_features.h"
 #include "content/child/thread_safe_sender.h"
 #include "content/common/buildflags.h"
+#include "content/common/code_cache_bundle.h"
 #include "content/common/content_constants_internal.h"
 #include "content/common/frame_messages.h"
 #include "content/common/render_frame_metadata.mojom.h"
@@ -519,6 +520,12 @@ void RenderThreadImpl::SetRendererBlinkPlatformImplForTesting(
   g_current_blink_platform_impl_for_testing = blink_platform_impl;
 }
 
+// static
+void RenderThreadImpl::SetMainTaskRunnerForTesting(
+    scoped_refptr<base::SingleThreadTaskRunner> main_task_runner) {
+  g_main_task_runner.Get() = std::move(main_task_runner);
+}
+
 // static
 scoped_refptr<base::SingleThreadTaskRunner>
 RenderThreadImpl::DeprecatedGetMainTaskRunner() {
@@ -1487,6 +1494,13 @@ void RenderThreadImpl::EnableV8LowMemoryMode() {
     low_memory_mode_controller_.reset(new LowMemoryModeController());
 }
 
+void RenderThreadImpl::SetCodeCacheBundle(
+    base::ReadOnlySharedMemoryRegion bundle) {
+  DCHECK(blink_platform_impl_);
+  blink_platform_impl_->SetCodeCacheBundle(
+      CodeCacheBundle::Create(std::move(bundle)));
+}
+
 #if BUILDFLAG(CLANG_PROFILING_INSIDE_SANDBOX)
 void RenderThreadImpl::WriteClangProfilingProfile(
     WriteClangProfilingProfileCallback callback) {
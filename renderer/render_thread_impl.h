@@ -137,6 +137,10 @@ class CONTENT_EXPORT RenderThreadImpl
       mojom::RenderMessageFilter* render_message_filter);
   static void SetRendererBlinkPlatformImplForTesting(
       RendererBlinkPlatformImpl* blink_platform_impl);
+  // Lets tests without a RenderThreadImpl run code that reports to the main
+  // thread. Pass nullptr to reset.
+  static void SetMainTaskRunnerForTesting(
+      scoped_refptr<base::SingleThreadTaskRunner> main_task_runner);
 
   // Returns the task runner for the main thread where the RenderThread lives.
   static scoped_refptr<base::SingleThreadTaskRunner>
@@ -489,6 +493,7 @@ class CONTENT_EXPORT RenderThreadImpl
   void SetSchedulerKeepActive(bool keep_active) override;
   void SetIsLockedToSite() override;
   void EnableV8LowMemoryMode() override;
+  void SetCodeCacheBundle(base::ReadOnlySharedMemoryRegion bundle) override;
 #if BUILDFLAG(CLANG_PROFILING_INSIDE_SANDBOX)
   void WriteClangProfilingProfile(
       WriteClangProfilingProfileCallback callback) override;
@@ -26,12 +26,14 @@
 #include "base/strings/utf_string_conversions.h"
 #include "base/task/post_task.h"
 #include "base/task/thread_pool.h"
+#include "base/threading/sequenced_task_runner_handle.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "base/time/time.h"
 #include "build/build_config.h"
 #include "components/url_formatter/url_formatter.h"
 #include "content/child/child_process.h"
 #include "content/child/thread_safe_sender.h"
+#include "content/common/code_cache_bundle.h"
 #include "content/common/frame_messages.h"
 #include "content/public/common/content_features.h"
 #include "content/public/common/content_switches.h"
@@ -348,6 +350,19 @@ void RendererBlinkPlatformImpl::FetchCachedCode(
     blink::mojom::CodeCacheType cache_type,
     const GURL& url,
     FetchCachedCodeCallback callback) {
+  if (cache_type == blink::mojom::CodeCacheType::kJavascript) {
+    base::Time response_time;
+    mojo_base::BigBuffer data;
+    if (TakeBundledCodeCacheEntry(url, &response_time, &data)) {
+      // Run |callback| asynchronously, as when the entry is fetched from the
+      // browser.
+      base::SequencedTaskRunnerHandle::Get()->PostTask(
+          FROM_HERE, base::BindOnce(std::move(callback), response_time,
+                                    std::move(data)));
+      return;
+    }
+  }
+
   GetCodeCacheHost().FetchCachedCode(
       cache_type, url,
       base::BindOnce(
@@ -361,6 +376,16 @@ void RendererBlinkPlatformImpl::FetchCachedCode(
 void RendererBlinkPlatformImpl::ClearCodeCacheEntry(
     blink::mojom::CodeCacheType cache_type,
     const GURL& url) {
+  if (cache_type == blink::mojom::CodeCacheType::kJavascript) {
+    base::AutoLock lock(code_cache_bundle_lock_);
+    if (code_cache_bundle_) {
+      base::Time response_time;
+      mojo_base::BigBuffer data;
+      code_cache_bundle_->TakeEntry(url, &response_time, &data);
+      if (!code_cache_bundle_->size())
+        code_cache_bundle_.reset();
+    }
+  }
   GetCodeCacheHost().ClearCodeCacheEntry(cache_type, url);
 }
 
@@ -432,6 +457,28 @@ void RendererBlinkPlatformImpl::SetIsLockedToSite() {
   is_locked_to_site_ = true;
 }
 
+void RendererBlinkPlatformImpl::SetCodeCacheBundle(
+    std::unique_ptr<CodeCacheBundle> bundle) {
+  DCHECK_CALLED_ON_VALID_THREAD(main_thread_checker_);
+  base::AutoLock lock(code_cache_bundle_lock_);
+  code_cache_bundle_ = std::move(bundle);
+}
+
+bool RendererBlinkPlatformImpl::TakeBundledCodeCacheEntry(
+    const GURL& url,
+    base::Time* response_time,
+    mojo_base::BigBuffer* data) {
+  base::AutoLock lock(code_cache_bundle_lock_);
+  if (!code_cache_bundle_)
+    return false;
+  bool hit = code_cache_bundle_->TakeEntry(url, response_time, data);
+  UMA_HISTOGRAM_BOOLEAN("SiteIsolatedCodeCache.JS.Bundle.Hit", hit);
+  // Unmap the bundle once every entry has been taken.
+  if (!code_cache_bundle_->size())
+    code_cache_bundle_.reset();
+  return hit;
+}
+
 bool RendererBlinkPlatformImpl::IsGpuCompositingDisabled() {
   DCHECK_CALLED_ON_VALID_THREAD(main_thread_checker_);
   RenderThreadImpl* thread = RenderThreadImpl::current();
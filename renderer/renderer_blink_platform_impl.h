@@ -16,6 +16,8 @@
 #include "base/macros.h"
 #include "base/optional.h"
 #include "base/single_thread_task_runner.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
 #include "base/time/time.h"
 #include "build/build_config.h"
 #include "content/child/blink_platform_impl.h"
@@ -57,6 +59,7 @@ class RasterContextProvider;
 
 namespace content {
 class ChildURLLoaderFactoryBundle;
+class CodeCacheBundle;
 class ThreadSafeSender;
 
 class CONTENT_EXPORT RendererBlinkPlatformImpl : public BlinkPlatformImpl {
@@ -211,9 +214,20 @@ class CONTENT_EXPORT RendererBlinkPlatformImpl : public BlinkPlatformImpl {
   // plus eTLD+1, such as https://google.com), or to a more specific origin.
   void SetIsLockedToSite();
 
+  // Replaces the code cache entries that the browser prefetched for the last
+  // navigation. FetchCachedCode() takes entries from |bundle| instead of
+  // fetching them from the browser.
+  void SetCodeCacheBundle(std::unique_ptr<CodeCacheBundle> bundle);
+
  private:
   bool CheckPreparsedJsCachingEnabled() const;
 
+  // Takes the entry for |url| from |code_cache_bundle_|, if it has one. This
+  // may be called on any thread.
+  bool TakeBundledCodeCacheEntry(const GURL& url,
+                                 base::Time* response_time,
+                                 mojo_base::BigBuffer* data);
+
   // Return the mojo interface for making CodeCache calls.
   blink::mojom::CodeCacheHost& GetCodeCacheHost();
 
@@ -243,6 +257,10 @@ class CONTENT_EXPORT RendererBlinkPlatformImpl : public BlinkPlatformImpl {
   mojo::PendingRemote<blink::mojom::CodeCacheHost> code_cache_host_remote_;
   mojo::SharedRemote<blink::mojom::CodeCacheHost> code_cache_host_;
 
+  base::Lock code_cache_bundle_lock_;
+  std::unique_ptr<CodeCacheBundle> code_cache_bundle_
+      GUARDED_BY(code_cache_bundle_lock_);
+
 #if defined(OS_LINUX)
   sk_sp<font_service::FontLoader> font_loader_;
 #endif